@@ -100,6 +100,54 @@ extern unsigned long  * ps7_peripherals_init_data;
 #define SCU_GLOBAL_TIMER_CONTROL	0xF8F00208
 #define SCU_GLOBAL_TIMER_AUTO_INC	0xF8F00218
 
+/* MASKPOLL timeout, measured with the SCU global timer */
+#define PS7_MASK_POLL_TIMEOUT_US	1000000
+
+/* PS_CLK, the ARM PLL runs at 40 x PS_CLK for APU_FREQ */
+#define PS7_PS_CLK_FREQ  33333333
+
+/*
+ * Boot timing record. ps7_init() times each phase and every MASKPOLL with
+ * the global timer, following the CPU clock as the tables change it, and
+ * copies the record to PS7_BOOT_RECORD_ADDR once the DDR is up, for U-Boot
+ * and Linux to report. Every field is a 32-bit word.
+ */
+#define PS7_BOOT_RECORD_ADDR     0x0FFFF000
+#define PS7_BOOT_RECORD_MAGIC    0x52375350	// "PS7R"
+#define PS7_BOOT_RECORD_VERSION  1
+#define PS7_BOOT_RECORD_POLLS    8
+
+#define PS7_BOOT_PHASE_MIO          0
+#define PS7_BOOT_PHASE_PLL          1
+#define PS7_BOOT_PHASE_CLOCK        2
+#define PS7_BOOT_PHASE_DDR          3
+#define PS7_BOOT_PHASE_PERIPHERALS  4
+#define PS7_BOOT_PHASES             5
+
+struct ps7_boot_poll {
+  unsigned long addr;
+  unsigned long mask;
+  unsigned long phase;
+  unsigned long us;		// until the bits were set, or the timeout
+};
+
+struct ps7_boot_record {
+  unsigned long magic;
+  unsigned long version;
+  unsigned long size;		// sizeof (struct ps7_boot_record)
+  unsigned long status;		// PS7_INIT_* returned by ps7_init()
+  unsigned long timer_hz;	// global timer rate at the end of ps7_init()
+  unsigned long timer_lo;	// global timer count at the end of ps7_init()
+  unsigned long timer_hi;
+  unsigned long total_us;
+  unsigned long phase_us[PS7_BOOT_PHASES];
+  unsigned long npolls;
+  struct ps7_boot_poll polls[PS7_BOOT_RECORD_POLLS];
+  unsigned long checksum;	// makes the 32-bit sum of the record zero
+};
+
+extern struct ps7_boot_record ps7_boot_record;
+
 int ps7_config( unsigned long*);
 int ps7_init();
 int ps7_post_config();
@@ -111,6 +159,20 @@ void perf_disable_clock(void);
 void perf_reset_clock(void);
 void perf_reset_and_start_timer(); 
 int get_number_of_cycles_for_delay(unsigned int delay); 
+
+void mask_write(unsigned long add, unsigned long mask, unsigned long val);
+int mask_poll(unsigned long add, unsigned long mask);
+unsigned long mask_read(unsigned long add, unsigned long mask);
+void mask_delay(unsigned long ms);
+
+unsigned long long ps7_timer_count(void);
+unsigned long ps7_timer_hz(void);
+unsigned long ps7_time_now(void);
+void ps7_time_sync(unsigned long add);
+void ps7_boot_begin(void);
+void ps7_boot_phase_begin(unsigned long phase);
+int ps7_boot_phase_end(int ret);
+int ps7_boot_end(int ret);
 #ifdef __cplusplus
 }
 #endif
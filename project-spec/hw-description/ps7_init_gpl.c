@@ -11833,7 +11833,6 @@ unsigned long ps7_debug_1_0[] = {
 
 
 #include "xil_io.h"
-#define PS7_MASK_POLL_TIME 100000000
 
 char*
 getPS7MessageInfo(unsigned key) {
@@ -11868,16 +11867,103 @@ void mask_write (unsigned long add , unsigned long  mask, unsigned long val ) {
 }
 
 
+/* Boot timing record, see ps7_init.h */
+struct ps7_boot_record ps7_boot_record;
+
+static unsigned long ps7_boot_cur_phase = PS7_BOOT_PHASES;
+static unsigned long ps7_boot_phase_start;
+static unsigned long ps7_boot_start;
+static int ps7_boot_ddr_up;
+
+/* Microseconds since the first ps7_time_now(), each interval at its rate */
+static unsigned long long ps7_time_last;
+static unsigned long long ps7_time_frac;
+static unsigned long ps7_time_hz;
+static unsigned long ps7_time_us;
+
+unsigned long long ps7_timer_count (void) {
+        volatile unsigned long *lo = (volatile unsigned long*) SCU_GLOBAL_TIMER_COUNT_L32;
+        volatile unsigned long *hi = (volatile unsigned long*) SCU_GLOBAL_TIMER_COUNT_U32;
+        unsigned long h, l;
+
+        do {
+          h = *hi;
+          l = *lo;
+        } while (h != *hi);
+        return ((unsigned long long) h << 32) | l;
+}
+
+/* Global timer rate: CPU_6x4x / 2, from ARM_CLK_CTRL and its source PLL */
+unsigned long ps7_timer_hz (void) {
+        unsigned long clk = *(volatile unsigned long*) 0XF8000120;
+        unsigned long src = (clk >> 4) & 0x3;
+        unsigned long div = (clk >> 8) & 0x3F;
+        unsigned long pll_ctrl = src < 2 ? 0XF8000100 : src == 2 ? 0XF8000104 : 0XF8000108;
+        unsigned long pll = *(volatile unsigned long*) pll_ctrl;
+        unsigned long long hz = PS7_PS_CLK_FREQ;
+
+        // PLL_RESET or PLL_BYPASS_FORCE: the CPU runs from PS_CLK
+        if (!(pll & 0x11))
+          hz *= (pll >> 12) & 0x7F;
+        return hz / (div ? div : 1) / 2;
+}
+
+unsigned long ps7_time_now (void) {
+        unsigned long long now;
+
+        if (!ps7_time_hz) {
+          // keep the count the BootROM and FSBL have run up, if any
+          if (!(*(volatile unsigned int*)SCU_GLOBAL_TIMER_CONTROL & 1))
+            perf_start_clock();
+          ps7_time_last = ps7_timer_count ();
+          ps7_time_hz = ps7_timer_hz ();
+          return ps7_time_us;
+        }
+
+        now = ps7_timer_count ();
+        ps7_time_frac += (now - ps7_time_last) * 1000000ULL;
+        ps7_time_us += ps7_time_frac / ps7_time_hz;
+        ps7_time_frac %= ps7_time_hz;
+        ps7_time_last = now;
+        ps7_time_hz = ps7_timer_hz ();
+        return ps7_time_us;
+}
+
+/* Call after writing add: a CPU clock change starts a new rate interval */
+void ps7_time_sync (unsigned long add) {
+        if ((add >= 0XF8000100 && add <= 0XF8000108) || add == 0XF8000120)
+          ps7_time_now ();
+}
+
+static void ps7_boot_poll (unsigned long add, unsigned long mask, unsigned long us) {
+        struct ps7_boot_poll *poll;
+
+        if (ps7_boot_cur_phase >= PS7_BOOT_PHASES ||
+            ps7_boot_record.npolls >= PS7_BOOT_RECORD_POLLS)
+          return;
+        poll = &ps7_boot_record.polls[ps7_boot_record.npolls++];
+        poll->addr = add;
+        poll->mask = mask;
+        poll->phase = ps7_boot_cur_phase;
+        poll->us = us;
+}
+
 int mask_poll(unsigned long add , unsigned long mask ) {
         volatile unsigned long *addr = (volatile unsigned long*) add;
-        int i = 0;
+        unsigned long start = ps7_time_now ();
+        unsigned long long t0 = ps7_time_last;
+        unsigned long long timeout = (unsigned long long) ps7_time_hz *
+                                     PS7_MASK_POLL_TIMEOUT_US / 1000000;
+        int ret = 1;
+
         while (!(*addr & mask)) {
-          if (i == PS7_MASK_POLL_TIME) {
-            return -1;
+          if (ps7_timer_count () - t0 > timeout) {
+            ret = -1;
+            break;
           }
-          i++;
         }
-     return 1;   
+        ps7_boot_poll (add, mask, ps7_time_now () - start);
+        return ret;
         //xil_printf("MaskPoll : 0x%x --> 0x%x \n \r" , add, *addr);
 }
 
@@ -11888,6 +11974,71 @@ unsigned long mask_read(unsigned long add , unsigned long mask ) {
         return val;
 }
 
+/* Busy wait on the global timer without resetting it */
+void mask_delay (unsigned long ms) {
+        unsigned long long start, ticks;
+
+        ps7_time_now ();
+        start = ps7_time_last;
+        ticks = (unsigned long long) ps7_time_hz * ms / 1000;
+        while (ps7_timer_count () - start < ticks) {
+        }
+}
+
+void ps7_boot_begin (void) {
+        unsigned long *p = (unsigned long*) &ps7_boot_record;
+        unsigned long i;
+
+        for (i = 0; i < sizeof (ps7_boot_record) / sizeof (*p); i++)
+          p[i] = 0;
+        ps7_boot_record.magic = PS7_BOOT_RECORD_MAGIC;
+        ps7_boot_record.version = PS7_BOOT_RECORD_VERSION;
+        ps7_boot_record.size = sizeof (ps7_boot_record);
+        ps7_boot_ddr_up = 0;
+        ps7_boot_start = ps7_time_now ();
+}
+
+void ps7_boot_phase_begin (unsigned long phase) {
+        ps7_boot_cur_phase = phase;
+        ps7_boot_phase_start = ps7_time_now ();
+}
+
+int ps7_boot_phase_end (int ret) {
+        if (ps7_boot_cur_phase < PS7_BOOT_PHASES) {
+          ps7_boot_record.phase_us[ps7_boot_cur_phase] = ps7_time_now () - ps7_boot_phase_start;
+          if (ps7_boot_cur_phase == PS7_BOOT_PHASE_DDR && ret == PS7_INIT_SUCCESS)
+            ps7_boot_ddr_up = 1;
+        }
+        ps7_boot_cur_phase = PS7_BOOT_PHASES;
+        return ret;
+}
+
+/*
+ * Seal the record and copy it to DDR if the DDR came up. The FSBL cleans
+ * the data cache before it hands off to the next stage.
+ */
+int ps7_boot_end (int ret) {
+        struct ps7_boot_record *rec = &ps7_boot_record;
+        volatile unsigned long *dst = (volatile unsigned long*) PS7_BOOT_RECORD_ADDR;
+        unsigned long *p = (unsigned long*) rec;
+        unsigned long i, sum = 0;
+
+        rec->total_us = ps7_time_now () - ps7_boot_start;
+        rec->status = ret;
+        rec->timer_hz = ps7_time_hz;
+        rec->timer_lo = ps7_time_last;
+        rec->timer_hi = ps7_time_last >> 32;
+        rec->checksum = 0;
+        for (i = 0; i < sizeof (*rec) / sizeof (*p); i++)
+          sum += p[i];
+        rec->checksum = 0 - sum;
+
+        if (ps7_boot_ddr_up)
+          for (i = 0; i < sizeof (*rec) / sizeof (*p); i++)
+            dst[i] = p[i];
+        return ret;
+}
+
 
 
 int
@@ -11904,7 +12055,6 @@ ps7_config(unsigned long * ps7_config_init)
     unsigned long  val,mask;              // some variable to make code readable
 
     int finish = -1 ;           // loop while this is negative !
-    int i = 0;                  // Timeout variable
     
     while( finish < 0 ) {
         numargs = ptr[0] & 0xF;
@@ -11930,6 +12080,7 @@ ps7_config(unsigned long * ps7_config_init)
             addr = (unsigned long*) args[0];
             val = args[1];
             *addr = val;
+            ps7_time_sync (args[0]);
             break;
 
         case OPCODE_MASKWRITE:
@@ -11937,29 +12088,17 @@ ps7_config(unsigned long * ps7_config_init)
             mask = args[1];
             val = args[2];
             *addr = ( val & mask ) | ( *addr & ~mask);
+            ps7_time_sync (args[0]);
             break;
 
         case OPCODE_MASKPOLL:
-            addr = (unsigned long*) args[0];
-            mask = args[1];
-            i = 0;
-            while (!(*addr & mask)) {
-                if (i == PS7_MASK_POLL_TIME) {
-                    finish = PS7_INIT_TIMEOUT;
-                    break;
-                }
-                i++;
-            }
+            // time-bounded, and timed into ps7_boot_record
+            if (mask_poll (args[0], args[1]) < 0)
+                finish = PS7_INIT_TIMEOUT;
             break;
         case OPCODE_MASKDELAY:
-	    {
-		    addr = (unsigned long*) args[0];
-		    mask = args[1];
-		    int delay = get_number_of_cycles_for_delay(mask);
-		    perf_reset_and_start_timer(); 
-		    while ((*addr < delay)) {
-		    }
-	    }
+	    // args[0] is the global timer, which keeps running for the record
+	    mask_delay (args[1]);
 	    break;
 	default:
 	    finish = PS7_INIT_CORRUPT;
@@ -12047,29 +12186,36 @@ ps7_init()
     //pcw_ver = 3;
   }
 
+  ps7_boot_begin ();
+
   // MIO init
-  ret = ps7_config (ps7_mio_init_data);  
-  if (ret != PS7_INIT_SUCCESS) return ret;
+  ps7_boot_phase_begin (PS7_BOOT_PHASE_MIO);
+  ret = ps7_boot_phase_end (ps7_config (ps7_mio_init_data));
+  if (ret != PS7_INIT_SUCCESS) return ps7_boot_end (ret);
 
   // PLL init
-  ret = ps7_config (ps7_pll_init_data); 
-  if (ret != PS7_INIT_SUCCESS) return ret;
+  ps7_boot_phase_begin (PS7_BOOT_PHASE_PLL);
+  ret = ps7_boot_phase_end (ps7_config (ps7_pll_init_data));
+  if (ret != PS7_INIT_SUCCESS) return ps7_boot_end (ret);
 
   // Clock init
-  ret = ps7_config (ps7_clock_init_data);
-  if (ret != PS7_INIT_SUCCESS) return ret;
+  ps7_boot_phase_begin (PS7_BOOT_PHASE_CLOCK);
+  ret = ps7_boot_phase_end (ps7_config (ps7_clock_init_data));
+  if (ret != PS7_INIT_SUCCESS) return ps7_boot_end (ret);
 
   // DDR init
-  ret = ps7_config (ps7_ddr_init_data);
-  if (ret != PS7_INIT_SUCCESS) return ret;
+  ps7_boot_phase_begin (PS7_BOOT_PHASE_DDR);
+  ret = ps7_boot_phase_end (ps7_config (ps7_ddr_init_data));
+  if (ret != PS7_INIT_SUCCESS) return ps7_boot_end (ret);
 
 
 
   // Peripherals init
-  ret = ps7_config (ps7_peripherals_init_data);
-  if (ret != PS7_INIT_SUCCESS) return ret;
+  ps7_boot_phase_begin (PS7_BOOT_PHASE_PERIPHERALS);
+  ret = ps7_boot_phase_end (ps7_config (ps7_peripherals_init_data));
+  if (ret != PS7_INIT_SUCCESS) return ps7_boot_end (ret);
   //xil_printf ("\n PCW Silicon Version : %d.0", pcw_ver);
-  return PS7_INIT_SUCCESS;
+  return ps7_boot_end (PS7_INIT_SUCCESS);
 }
 
 
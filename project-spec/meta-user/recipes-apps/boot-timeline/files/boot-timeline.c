@@ -0,0 +1,315 @@
+/*
+ * boot-timeline - one boot timeline from ps7_init to the first frame
+ *
+ * The ps7-boot-record driver merges the FSBL's ps7_init record and the
+ * U-Boot bootstage records into its timeline attribute, in microseconds
+ * from the start of ps7_init(), and gives the time the kernel started on
+ * that scale. This tool adds the kernel side: initcalls from the kernel
+ * log (boot with initcall_debug), the start of init, and the first frame
+ * of xlnx-pl-disp (first_flip_us). Kernel log times are taken to start at
+ * the U-Boot start_kernel mark.
+ *
+ * Copyright (C) 2026
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <getopt.h>
+#include <glob.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/klog.h>
+
+#define RECORD_SYSFS_GLOB	"/sys/bus/platform/drivers/ps7-boot-record/*"
+#define PL_DISP_SYSFS_GLOB	"/sys/bus/platform/drivers/xlnx-pl-disp/*"
+
+#define SYSLOG_ACTION_READ_ALL	3
+#define SYSLOG_ACTION_SIZE_BUFFER 10
+
+#define MAX_EVENTS		1024
+#define NAME_LEN		64
+
+struct event {
+	int64_t start_us;
+	int64_t dur_us;
+	char source[8];
+	char name[NAME_LEN];
+};
+
+struct timeline {
+	struct event ev[MAX_EVENTS];
+	unsigned int n;
+	int64_t kernel_start_us;
+	int64_t ps7_end_us;
+	int64_t init_us;
+	int64_t flip_us;
+};
+
+static void add_event(struct timeline *tl, int64_t start_us, int64_t dur_us,
+		      const char *source, const char *name)
+{
+	struct event *ev;
+
+	if (tl->n == MAX_EVENTS)
+		return;
+
+	ev = &tl->ev[tl->n++];
+	ev->start_us = start_us;
+	ev->dur_us = dur_us;
+	snprintf(ev->source, sizeof(ev->source), "%s", source);
+	snprintf(ev->name, sizeof(ev->name), "%s", name);
+}
+
+/*
+ * <attr> of the first device matching <glob>, NULL if there is none. The
+ * attribute is part of the pattern, so the driver's own bind, unbind and
+ * uevent entries never match.
+ */
+static FILE *open_sysfs(const char *pattern, const char *attr)
+{
+	char path[512];
+	glob_t g;
+	FILE *f;
+
+	snprintf(path, sizeof(path), "%s/%s", pattern, attr);
+	if (glob(path, 0, NULL, &g))
+		return NULL;
+
+	f = fopen(g.gl_pathv[0], "r");
+	globfree(&g);
+	return f;
+}
+
+static int read_firmware(struct timeline *tl)
+{
+	char line[256], source[8], name[NAME_LEN];
+	long long start, dur;
+	FILE *f;
+
+	f = open_sysfs(RECORD_SYSFS_GLOB, "timeline");
+	if (!f) {
+		fprintf(stderr, "no ps7-boot-record timeline, is the module loaded?\n");
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		if (sscanf(line, "%lld %lld %7s %63s", &start, &dur, source,
+			   name) != 4)
+			continue;
+		add_event(tl, start, dur, source, name);
+		if (!strcmp(source, "ps7") && start + dur > tl->ps7_end_us)
+			tl->ps7_end_us = start + dur;
+	}
+	fclose(f);
+
+	f = open_sysfs(RECORD_SYSFS_GLOB, "kernel_start_us");
+	if (f) {
+		if (fscanf(f, "%lld", &start) == 1)
+			tl->kernel_start_us = start;
+		fclose(f);
+	}
+
+	return 0;
+}
+
+static char *read_kernel_log(const char *file)
+{
+	char *buf;
+	long size;
+	FILE *f;
+	int len;
+
+	if (file) {
+		f = fopen(file, "r");
+		if (!f) {
+			perror(file);
+			return NULL;
+		}
+		fseek(f, 0, SEEK_END);
+		size = ftell(f);
+		rewind(f);
+		buf = malloc(size + 1);
+		if (buf) {
+			size = fread(buf, 1, size, f);
+			buf[size] = 0;
+		}
+		fclose(f);
+		return buf;
+	}
+
+	size = klogctl(SYSLOG_ACTION_SIZE_BUFFER, NULL, 0);
+	if (size <= 0)
+		size = 1 << 20;
+	buf = malloc(size + 1);
+	if (!buf)
+		return NULL;
+
+	len = klogctl(SYSLOG_ACTION_READ_ALL, buf, size);
+	if (len < 0) {
+		perror("klogctl");
+		free(buf);
+		return NULL;
+	}
+	buf[len] = 0;
+
+	return buf;
+}
+
+/*
+ * Lines look like "<6>[    1.234567] text" from klogctl or "[    1.234567]
+ * text" from dmesg. Initcalls with initcall_debug end with
+ * "initcall fn+0x0/0x40 returned 0 after 1234 usecs".
+ */
+static void parse_kernel_log(struct timeline *tl, char *log,
+			     long long threshold_us)
+{
+	char *line, *save, *text, *p;
+	char name[NAME_LEN];
+	long long usecs;
+	unsigned long sec, usec;
+	int64_t t;
+	int ret;
+
+	for (line = strtok_r(log, "\n", &save); line;
+	     line = strtok_r(NULL, "\n", &save)) {
+		p = strchr(line, '[');
+		if (!p || sscanf(p, "[%lu.%lu]", &sec, &usec) != 2)
+			continue;
+		text = strchr(p, ']');
+		if (!text)
+			continue;
+		text++;
+		while (*text == ' ')
+			text++;
+		t = tl->kernel_start_us + (int64_t)sec * 1000000 + usec;
+
+		if (sscanf(text, "initcall %63[^+ ]%*s returned %d after %lld usecs",
+			   name, &ret, &usecs) == 3) {
+			if (usecs >= threshold_us)
+				add_event(tl, t - usecs, usecs, "kernel", name);
+		} else if (!strncmp(text, "Run ", 4) &&
+			   strstr(text, "as init process")) {
+			if (tl->init_us < 0) {
+				tl->init_us = t;
+				add_event(tl, t, 0, "kernel", "init");
+			}
+		}
+	}
+}
+
+static void read_first_flip(struct timeline *tl)
+{
+	long long submit, flip;
+	FILE *f;
+
+	f = open_sysfs(PL_DISP_SYSFS_GLOB, "first_flip_us");
+	if (!f)
+		return;
+
+	if (fscanf(f, "%lld %lld", &submit, &flip) == 2 && flip) {
+		add_event(tl, tl->kernel_start_us + submit, flip - submit,
+			  "drm", "first_flip");
+		tl->flip_us = tl->kernel_start_us + flip;
+	}
+	fclose(f);
+}
+
+static int cmp_event(const void *a, const void *b)
+{
+	const struct event *x = a, *y = b;
+
+	if (x->start_us != y->start_us)
+		return x->start_us < y->start_us ? -1 : 1;
+	return 0;
+}
+
+static void print_timeline(struct timeline *tl)
+{
+	const struct event *ev;
+	int64_t prev = 0;
+	unsigned int i;
+
+	qsort(tl->ev, tl->n, sizeof(tl->ev[0]), cmp_event);
+
+	printf("%12s %10s %10s  %-6s %s\n", "start ms", "delta ms", "dur ms",
+	       "source", "event");
+	for (i = 0; i < tl->n; i++) {
+		ev = &tl->ev[i];
+		printf("%12.3f %10.3f %10.3f  %-6s %s\n", ev->start_us / 1000.0,
+		       (ev->start_us - prev) / 1000.0, ev->dur_us / 1000.0,
+		       ev->source, ev->name);
+		prev = ev->start_us;
+	}
+
+	printf("\n");
+	if (tl->ps7_end_us)
+		printf("ps7_init              %10.3f ms\n",
+		       tl->ps7_end_us / 1000.0);
+	if (tl->kernel_start_us > 0)
+		printf("FSBL + U-Boot         %10.3f ms\n",
+		       (tl->kernel_start_us - tl->ps7_end_us) / 1000.0);
+	if (tl->init_us >= 0)
+		printf("kernel to init        %10.3f ms\n",
+		       (tl->init_us - tl->kernel_start_us) / 1000.0);
+	if (tl->flip_us >= 0) {
+		printf("kernel to first frame %10.3f ms\n",
+		       (tl->flip_us - tl->kernel_start_us) / 1000.0);
+		printf("ps7_init to picture   %10.3f ms\n",
+		       tl->flip_us / 1000.0);
+	}
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  -k <file>     kernel log saved by dmesg (default: read the log)\n"
+		"  -t <us>       shortest initcall to list (default 1000)\n",
+		prog);
+}
+
+int main(int argc, char *argv[])
+{
+	static struct timeline tl = {
+		.kernel_start_us = -1,
+		.init_us = -1,
+		.flip_us = -1,
+	};
+	long long threshold_us = 1000;
+	const char *log_file = NULL;
+	char *log;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "k:t:h")) != -1) {
+		switch (opt) {
+		case 'k':
+			log_file = optarg;
+			break;
+		case 't':
+			threshold_us = strtoll(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (read_firmware(&tl))
+		return 1;
+	if (tl.kernel_start_us < 0) {
+		fprintf(stderr, "no U-Boot start_kernel mark, kernel times start at 0\n");
+		tl.kernel_start_us = 0;
+	}
+
+	log = read_kernel_log(log_file);
+	if (log) {
+		parse_kernel_log(&tl, log, threshold_us);
+		free(log);
+	}
+	read_first_flip(&tl);
+
+	print_timeline(&tl);
+
+	return 0;
+}
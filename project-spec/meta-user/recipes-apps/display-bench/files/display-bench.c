@@ -0,0 +1,1037 @@
+/*
+ * display-bench - modeset, page-flip and frame buffer throughput benchmark
+ *
+ * Times the display path through the atomic KMS API and prints one JSON
+ * document, so runs on the board (xlnx_pl_disp) and on a host (vkms) can
+ * be stored and compared by CI:
+ *
+ *   modeset  full modesets from a disabled CRTC, per mode and format; the
+ *            blocking commit returns once the first frame is out
+ *   flip     non-blocking page flips back to back, submit to flip event
+ *            latency, event intervals and missed vblanks from the CRTC
+ *            sequence, with a latency histogram
+ *   fb       fill, blit, blend and scroll throughput (fb-ops.h, shared
+ *            with scanout-bench) on a scanned out dumb buffer for each format
+ *
+ * Formats the primary plane does not support are reported as skipped.
+ *
+ * Copyright (C) 2026
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <math.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/utsname.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <drm_fourcc.h>
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+#include "fb-ops.h"
+
+#define MAX_MODES		16
+#define MAX_FORMATS		4
+#define HIST_BUCKETS		16
+#define FLIP_TIMEOUT_MS		1000
+
+enum {
+	TEST_MODESET = 1 << 0,
+	TEST_FLIP = 1 << 1,
+	TEST_FB = 1 << 2,
+};
+
+struct bench_format {
+	const char *name;
+	uint32_t fourcc;
+	unsigned int cpp;
+};
+
+static const struct bench_format formats[] = {
+	{ "RG24", DRM_FORMAT_RGB888, 3 },
+	{ "XR24", DRM_FORMAT_XRGB8888, 4 },
+};
+
+struct bench_props {
+	uint32_t crtc_active;
+	uint32_t crtc_mode_id;
+	uint32_t conn_crtc_id;
+	uint32_t plane_fb_id;
+	uint32_t plane_crtc_id;
+	uint32_t plane_src_x, plane_src_y, plane_src_w, plane_src_h;
+	uint32_t plane_crtc_x, plane_crtc_y, plane_crtc_w, plane_crtc_h;
+};
+
+struct bench_dev {
+	int fd;
+	uint32_t conn_id;
+	uint32_t crtc_id;
+	uint32_t plane_id;
+	char conn_name[32];
+	drmModeModeInfo *modes;
+	int count_modes;
+	drmModeConnector *conn;
+	drmModePlane *plane;
+	drmModeCrtc *saved_crtc;
+	struct bench_props props;
+};
+
+struct bench_buf {
+	uint32_t handle;
+	uint32_t fb_id;
+	uint32_t pitch;
+	uint64_t size;
+	uint8_t *map;
+};
+
+struct bench_opts {
+	const char *device;
+	const char *output;
+	unsigned int tests;
+	unsigned int nmodes;
+	char modes[MAX_MODES][32];
+	int all_modes;
+	unsigned int nformats;
+	const struct bench_format *formats[MAX_FORMATS];
+	unsigned int modesets;
+	unsigned int flips;
+	unsigned int loops;
+};
+
+struct flip_state {
+	double submit;
+	double event;
+	unsigned int sequence;
+	int pending;
+};
+
+static double now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* Percentile of a sorted array, nearest rank */
+static double percentile(const double *v, unsigned int n, double p)
+{
+	unsigned int i = (unsigned int)ceil(p / 100.0 * n);
+
+	return v[i ? i - 1 : 0];
+}
+
+/* "min", "median", ... of n samples in ms, sorts v */
+static void print_stats(FILE *out, const char *key, double *v, unsigned int n)
+{
+	double sum = 0, sq = 0, mean;
+	unsigned int i;
+
+	if (!n) {
+		fprintf(out, "\"%s\": null", key);
+		return;
+	}
+
+	qsort(v, n, sizeof(*v), cmp_double);
+	for (i = 0; i < n; i++)
+		sum += v[i];
+	mean = sum / n;
+	for (i = 0; i < n; i++)
+		sq += (v[i] - mean) * (v[i] - mean);
+
+	fprintf(out,
+		"\"%s\": {\"min\": %.3f, \"median\": %.3f, \"p90\": %.3f, "
+		"\"p99\": %.3f, \"max\": %.3f, \"mean\": %.3f, \"stddev\": %.3f}",
+		key, v[0], percentile(v, n, 50), percentile(v, n, 90),
+		percentile(v, n, 99), v[n - 1], mean, sqrt(sq / n));
+}
+
+static uint32_t prop_id(int fd, uint32_t obj_id, uint32_t obj_type,
+			const char *name)
+{
+	drmModeObjectProperties *props;
+	drmModePropertyRes *prop;
+	uint32_t id = 0, i;
+
+	props = drmModeObjectGetProperties(fd, obj_id, obj_type);
+	if (!props)
+		return 0;
+
+	for (i = 0; i < props->count_props && !id; i++) {
+		prop = drmModeGetProperty(fd, props->props[i]);
+		if (!prop)
+			continue;
+		if (!strcmp(prop->name, name))
+			id = prop->prop_id;
+		drmModeFreeProperty(prop);
+	}
+	drmModeFreeObjectProperties(props);
+
+	return id;
+}
+
+static uint64_t prop_value(int fd, uint32_t obj_id, uint32_t obj_type,
+			   const char *name)
+{
+	drmModeObjectProperties *props;
+	drmModePropertyRes *prop;
+	uint64_t val = 0;
+	uint32_t i;
+
+	props = drmModeObjectGetProperties(fd, obj_id, obj_type);
+	if (!props)
+		return 0;
+
+	for (i = 0; i < props->count_props; i++) {
+		prop = drmModeGetProperty(fd, props->props[i]);
+		if (!prop)
+			continue;
+		if (!strcmp(prop->name, name))
+			val = props->prop_values[i];
+		drmModeFreeProperty(prop);
+	}
+	drmModeFreeObjectProperties(props);
+
+	return val;
+}
+
+static int find_props(struct bench_dev *dev)
+{
+	struct bench_props *p = &dev->props;
+	int fd = dev->fd;
+
+	p->crtc_active = prop_id(fd, dev->crtc_id, DRM_MODE_OBJECT_CRTC, "ACTIVE");
+	p->crtc_mode_id = prop_id(fd, dev->crtc_id, DRM_MODE_OBJECT_CRTC, "MODE_ID");
+	p->conn_crtc_id = prop_id(fd, dev->conn_id, DRM_MODE_OBJECT_CONNECTOR,
+				  "CRTC_ID");
+	p->plane_fb_id = prop_id(fd, dev->plane_id, DRM_MODE_OBJECT_PLANE, "FB_ID");
+	p->plane_crtc_id = prop_id(fd, dev->plane_id, DRM_MODE_OBJECT_PLANE,
+				   "CRTC_ID");
+	p->plane_src_x = prop_id(fd, dev->plane_id, DRM_MODE_OBJECT_PLANE, "SRC_X");
+	p->plane_src_y = prop_id(fd, dev->plane_id, DRM_MODE_OBJECT_PLANE, "SRC_Y");
+	p->plane_src_w = prop_id(fd, dev->plane_id, DRM_MODE_OBJECT_PLANE, "SRC_W");
+	p->plane_src_h = prop_id(fd, dev->plane_id, DRM_MODE_OBJECT_PLANE, "SRC_H");
+	p->plane_crtc_x = prop_id(fd, dev->plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_X");
+	p->plane_crtc_y = prop_id(fd, dev->plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_Y");
+	p->plane_crtc_w = prop_id(fd, dev->plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_W");
+	p->plane_crtc_h = prop_id(fd, dev->plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_H");
+
+	if (!p->crtc_active || !p->crtc_mode_id || !p->conn_crtc_id ||
+	    !p->plane_fb_id || !p->plane_crtc_id || !p->plane_crtc_h) {
+		fprintf(stderr, "missing atomic properties\n");
+		return -ENOENT;
+	}
+
+	return 0;
+}
+
+/* The primary plane that can feed the CRTC */
+static int find_plane(struct bench_dev *dev, int crtc_index)
+{
+	drmModePlaneRes *res;
+	drmModePlane *plane;
+	uint32_t i;
+
+	res = drmModeGetPlaneResources(dev->fd);
+	if (!res) {
+		fprintf(stderr, "cannot get planes: %s\n", strerror(errno));
+		return -errno;
+	}
+
+	for (i = 0; i < res->count_planes && !dev->plane; i++) {
+		plane = drmModeGetPlane(dev->fd, res->planes[i]);
+		if (!plane)
+			continue;
+		if ((plane->possible_crtcs & (1 << crtc_index)) &&
+		    prop_value(dev->fd, plane->plane_id, DRM_MODE_OBJECT_PLANE,
+			       "type") == DRM_PLANE_TYPE_PRIMARY) {
+			dev->plane = plane;
+			dev->plane_id = plane->plane_id;
+		} else {
+			drmModeFreePlane(plane);
+		}
+	}
+	drmModeFreePlaneResources(res);
+
+	if (!dev->plane) {
+		fprintf(stderr, "no primary plane for CRTC %u\n", dev->crtc_id);
+		return -ENODEV;
+	}
+
+	return 0;
+}
+
+static int dev_open(struct bench_dev *dev, const char *path)
+{
+	drmModeRes *res;
+	drmModeConnector *conn = NULL;
+	drmModeEncoder *enc;
+	uint64_t cap;
+	int i, crtc_index = -1;
+
+	dev->fd = open(path, O_RDWR | O_CLOEXEC);
+	if (dev->fd < 0) {
+		fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+		return -errno;
+	}
+
+	if (drmGetCap(dev->fd, DRM_CAP_DUMB_BUFFER, &cap) || !cap) {
+		fprintf(stderr, "%s does not support dumb buffers\n", path);
+		return -EOPNOTSUPP;
+	}
+	if (drmGetCap(dev->fd, DRM_CAP_TIMESTAMP_MONOTONIC, &cap) || !cap) {
+		fprintf(stderr, "%s has no monotonic event timestamps\n", path);
+		return -EOPNOTSUPP;
+	}
+	if (drmSetClientCap(dev->fd, DRM_CLIENT_CAP_UNIVERSAL_PLANES, 1) ||
+	    drmSetClientCap(dev->fd, DRM_CLIENT_CAP_ATOMIC, 1)) {
+		fprintf(stderr, "%s does not support atomic modesetting\n", path);
+		return -EOPNOTSUPP;
+	}
+
+	res = drmModeGetResources(dev->fd);
+	if (!res) {
+		fprintf(stderr, "cannot get DRM resources: %s\n", strerror(errno));
+		return -errno;
+	}
+
+	for (i = 0; i < res->count_connectors; i++) {
+		conn = drmModeGetConnector(dev->fd, res->connectors[i]);
+		if (conn && conn->connection == DRM_MODE_CONNECTED &&
+		    conn->count_modes)
+			break;
+		drmModeFreeConnector(conn);
+		conn = NULL;
+	}
+	if (!conn) {
+		fprintf(stderr, "no connected connector\n");
+		drmModeFreeResources(res);
+		return -ENODEV;
+	}
+
+	dev->conn = conn;
+	dev->conn_id = conn->connector_id;
+	dev->modes = conn->modes;
+	dev->count_modes = conn->count_modes;
+	snprintf(dev->conn_name, sizeof(dev->conn_name), "%s-%u",
+		 drmModeGetConnectorTypeName(conn->connector_type) ?: "Unknown",
+		 conn->connector_type_id);
+
+	enc = conn->encoder_id ? drmModeGetEncoder(dev->fd, conn->encoder_id) : NULL;
+	if (enc) {
+		dev->crtc_id = enc->crtc_id;
+		drmModeFreeEncoder(enc);
+	}
+	if (!dev->crtc_id && res->count_crtcs)
+		dev->crtc_id = res->crtcs[0];
+	for (i = 0; i < res->count_crtcs; i++)
+		if (res->crtcs[i] == dev->crtc_id)
+			crtc_index = i;
+	drmModeFreeResources(res);
+
+	if (crtc_index < 0) {
+		fprintf(stderr, "no CRTC available\n");
+		return -ENODEV;
+	}
+
+	dev->saved_crtc = drmModeGetCrtc(dev->fd, dev->crtc_id);
+
+	if (find_plane(dev, crtc_index))
+		return -ENODEV;
+
+	return find_props(dev);
+}
+
+static void dev_close(struct bench_dev *dev)
+{
+	drmModeCrtc *c = dev->saved_crtc;
+
+	if (c) {
+		drmModeSetCrtc(dev->fd, c->crtc_id, c->buffer_id, c->x, c->y,
+			       &dev->conn_id, 1, &c->mode);
+		drmModeFreeCrtc(c);
+	}
+	if (dev->plane)
+		drmModeFreePlane(dev->plane);
+	if (dev->conn)
+		drmModeFreeConnector(dev->conn);
+	close(dev->fd);
+}
+
+static int plane_has_format(struct bench_dev *dev, uint32_t fourcc)
+{
+	uint32_t i;
+
+	for (i = 0; i < dev->plane->count_formats; i++)
+		if (dev->plane->formats[i] == fourcc)
+			return 1;
+	return 0;
+}
+
+static void buf_destroy(struct bench_dev *dev, struct bench_buf *buf)
+{
+	struct drm_mode_destroy_dumb destroy = { .handle = buf->handle };
+
+	if (buf->map)
+		munmap(buf->map, buf->size);
+	if (buf->fb_id)
+		drmModeRmFB(dev->fd, buf->fb_id);
+	if (buf->handle)
+		drmIoctl(dev->fd, DRM_IOCTL_MODE_DESTROY_DUMB, &destroy);
+	memset(buf, 0, sizeof(*buf));
+}
+
+static int buf_create(struct bench_dev *dev, struct bench_buf *buf,
+		      unsigned int width, unsigned int height,
+		      const struct bench_format *fmt, uint8_t fill)
+{
+	struct drm_mode_create_dumb create = { 0 };
+	struct drm_mode_map_dumb map = { 0 };
+	uint32_t handles[4] = { 0 }, pitches[4] = { 0 }, offsets[4] = { 0 };
+	int ret;
+
+	memset(buf, 0, sizeof(*buf));
+
+	create.width = width;
+	create.height = height;
+	create.bpp = fmt->cpp * 8;
+	if (drmIoctl(dev->fd, DRM_IOCTL_MODE_CREATE_DUMB, &create)) {
+		ret = -errno;
+		fprintf(stderr, "cannot create dumb buffer: %s\n", strerror(errno));
+		return ret;
+	}
+	buf->handle = create.handle;
+	buf->pitch = create.pitch;
+	buf->size = create.size;
+
+	handles[0] = buf->handle;
+	pitches[0] = buf->pitch;
+	if (drmModeAddFB2(dev->fd, width, height, fmt->fourcc, handles, pitches,
+			  offsets, &buf->fb_id, 0)) {
+		ret = -errno;
+		fprintf(stderr, "cannot add framebuffer: %s\n", strerror(errno));
+		goto err;
+	}
+
+	map.handle = buf->handle;
+	if (drmIoctl(dev->fd, DRM_IOCTL_MODE_MAP_DUMB, &map)) {
+		ret = -errno;
+		fprintf(stderr, "cannot map dumb buffer: %s\n", strerror(errno));
+		goto err;
+	}
+	buf->map = mmap(NULL, buf->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			dev->fd, map.offset);
+	if (buf->map == MAP_FAILED) {
+		buf->map = NULL;
+		ret = -errno;
+		fprintf(stderr, "cannot mmap dumb buffer: %s\n", strerror(errno));
+		goto err;
+	}
+	memset(buf->map, fill, buf->size);
+
+	return 0;
+
+err:
+	buf_destroy(dev, buf);
+	return ret;
+}
+
+static void add_plane(drmModeAtomicReq *req, struct bench_dev *dev,
+		      uint32_t fb_id, const drmModeModeInfo *mode)
+{
+	const struct bench_props *p = &dev->props;
+	uint32_t id = dev->plane_id;
+
+	drmModeAtomicAddProperty(req, id, p->plane_fb_id, fb_id);
+	drmModeAtomicAddProperty(req, id, p->plane_crtc_id,
+				 fb_id ? dev->crtc_id : 0);
+	if (!fb_id)
+		return;
+	drmModeAtomicAddProperty(req, id, p->plane_src_x, 0);
+	drmModeAtomicAddProperty(req, id, p->plane_src_y, 0);
+	drmModeAtomicAddProperty(req, id, p->plane_src_w,
+				 (uint64_t)mode->hdisplay << 16);
+	drmModeAtomicAddProperty(req, id, p->plane_src_h,
+				 (uint64_t)mode->vdisplay << 16);
+	drmModeAtomicAddProperty(req, id, p->plane_crtc_x, 0);
+	drmModeAtomicAddProperty(req, id, p->plane_crtc_y, 0);
+	drmModeAtomicAddProperty(req, id, p->plane_crtc_w, mode->hdisplay);
+	drmModeAtomicAddProperty(req, id, p->plane_crtc_h, mode->vdisplay);
+}
+
+/* Blocking modeset to mode on fb, or off with a NULL mode */
+static int commit_mode(struct bench_dev *dev, const drmModeModeInfo *mode,
+		       uint32_t fb_id)
+{
+	const struct bench_props *p = &dev->props;
+	drmModeAtomicReq *req;
+	uint32_t blob = 0;
+	int ret;
+
+	if (mode && drmModeCreatePropertyBlob(dev->fd, mode, sizeof(*mode), &blob))
+		return -errno;
+
+	req = drmModeAtomicAlloc();
+	if (!req) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	drmModeAtomicAddProperty(req, dev->crtc_id, p->crtc_active, !!mode);
+	drmModeAtomicAddProperty(req, dev->crtc_id, p->crtc_mode_id, blob);
+	drmModeAtomicAddProperty(req, dev->conn_id, p->conn_crtc_id,
+				 mode ? dev->crtc_id : 0);
+	add_plane(req, dev, mode ? fb_id : 0, mode);
+
+	ret = drmModeAtomicCommit(dev->fd, req, DRM_MODE_ATOMIC_ALLOW_MODESET,
+				  NULL) ? -errno : 0;
+	drmModeAtomicFree(req);
+out:
+	if (blob)
+		drmModeDestroyPropertyBlob(dev->fd, blob);
+	return ret;
+}
+
+static const drmModeModeInfo *find_mode(struct bench_dev *dev, const char *spec)
+{
+	unsigned int w, h, hz = 0;
+	int i;
+
+	if (sscanf(spec, "%ux%u@%u", &w, &h, &hz) < 2)
+		return NULL;
+
+	for (i = 0; i < dev->count_modes; i++)
+		if (dev->modes[i].hdisplay == w && dev->modes[i].vdisplay == h &&
+		    (!hz || dev->modes[i].vrefresh == hz))
+			return &dev->modes[i];
+	return NULL;
+}
+
+static const drmModeModeInfo *preferred_mode(struct bench_dev *dev)
+{
+	int i;
+
+	for (i = 0; i < dev->count_modes; i++)
+		if (dev->modes[i].type & DRM_MODE_TYPE_PREFERRED)
+			return &dev->modes[i];
+	return &dev->modes[0];
+}
+
+/* Modes to run: -r list, every mode with -a, else the preferred one */
+static unsigned int select_modes(struct bench_dev *dev,
+				 const struct bench_opts *opts,
+				 const drmModeModeInfo **modes)
+{
+	unsigned int i, n = 0;
+
+	if (opts->all_modes) {
+		for (i = 0; i < (unsigned int)dev->count_modes && n < MAX_MODES; i++)
+			modes[n++] = &dev->modes[i];
+		return n;
+	}
+	for (i = 0; i < opts->nmodes; i++) {
+		modes[n] = find_mode(dev, opts->modes[i]);
+		if (modes[n])
+			n++;
+		else
+			fprintf(stderr, "%s: no such mode on %s\n",
+				opts->modes[i], dev->conn_name);
+	}
+	if (!opts->nmodes)
+		modes[n++] = preferred_mode(dev);
+
+	return n;
+}
+
+/* Start the next record of a JSON array with its mode and format */
+static void open_record(FILE *out, int *first, const drmModeModeInfo *mode,
+			const struct bench_format *fmt)
+{
+	fprintf(out, "%s    {\"mode\": \"%ux%u@%u\", \"format\": \"%s\"",
+		*first ? "" : ",\n", mode->hdisplay, mode->vdisplay,
+		mode->vrefresh, fmt->name);
+	*first = 0;
+}
+
+static int run_modeset(FILE *out, struct bench_dev *dev,
+		       const struct bench_opts *opts,
+		       const drmModeModeInfo *mode,
+		       const struct bench_format *fmt, int *first)
+{
+	struct bench_buf buf;
+	double *t, t0;
+	unsigned int i;
+	int ret;
+
+	t = calloc(opts->modesets, sizeof(*t));
+	if (!t)
+		return -ENOMEM;
+
+	ret = buf_create(dev, &buf, mode->hdisplay, mode->vdisplay, fmt, 0x40);
+	if (ret)
+		goto out;
+
+	for (i = 0; i < opts->modesets; i++) {
+		ret = commit_mode(dev, NULL, 0);
+		if (ret) {
+			fprintf(stderr, "cannot disable CRTC: %s\n", strerror(-ret));
+			goto out_buf;
+		}
+		t0 = now_sec();
+		ret = commit_mode(dev, mode, buf.fb_id);
+		t[i] = (now_sec() - t0) * 1e3;
+		if (ret) {
+			fprintf(stderr, "modeset failed: %s\n", strerror(-ret));
+			goto out_buf;
+		}
+	}
+
+	open_record(out, first, mode, fmt);
+	fprintf(out, ", \"runs\": %u, ", opts->modesets);
+	print_stats(out, "ms", t, opts->modesets);
+	fprintf(out, "}");
+
+out_buf:
+	buf_destroy(dev, &buf);
+out:
+	free(t);
+	return ret;
+}
+
+static void flip_handler(int fd, unsigned int sequence, unsigned int tv_sec,
+			 unsigned int tv_usec, unsigned int crtc_id,
+			 void *data)
+{
+	struct flip_state *st = data;
+
+	st->event = tv_sec + tv_usec / 1e6;
+	st->sequence = sequence;
+	st->pending = 0;
+}
+
+static int wait_flip(struct bench_dev *dev, struct flip_state *st)
+{
+	drmEventContext ev = {
+		.version = 3,
+		.page_flip_handler2 = flip_handler,
+	};
+	struct pollfd pfd = { .fd = dev->fd, .events = POLLIN };
+	int ret;
+
+	while (st->pending) {
+		ret = poll(&pfd, 1, FLIP_TIMEOUT_MS);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0) {
+			fprintf(stderr, "no flip event in %d ms\n", FLIP_TIMEOUT_MS);
+			return -ETIMEDOUT;
+		}
+		if (drmHandleEvent(dev->fd, &ev))
+			return -EIO;
+	}
+
+	return 0;
+}
+
+/*
+ * Flip between two buffers as fast as the display takes them: each flip is
+ * submitted as soon as the previous one completes, as a game loop would.
+ * Latency is submit to flip event, interval is event to event; a CRTC
+ * sequence step of more than one is a missed vblank. Jitter is how far an
+ * event lands from the vblank grid its sequence number puts it on.
+ */
+static int run_flip(FILE *out, struct bench_dev *dev,
+		    const struct bench_opts *opts,
+		    const drmModeModeInfo *mode,
+		    const struct bench_format *fmt, int *first)
+{
+	struct flip_state st = { 0 };
+	struct bench_buf buf[2];
+	drmModeAtomicReq *req;
+	double *lat, *ival, *jit, period, bucket;
+	unsigned int hist[HIST_BUCKETS] = { 0 };
+	unsigned int i, n = 0, missed = 0, last_seq = 0, b;
+	double last_event = 0;
+	int ret;
+
+	lat = calloc(opts->flips, sizeof(*lat));
+	ival = calloc(opts->flips, sizeof(*ival));
+	jit = calloc(opts->flips, sizeof(*jit));
+	if (!lat || !ival || !jit) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	period = (double)mode->htotal * mode->vtotal / mode->clock;
+
+	ret = buf_create(dev, &buf[0], mode->hdisplay, mode->vdisplay, fmt, 0x20);
+	if (ret)
+		goto out;
+	ret = buf_create(dev, &buf[1], mode->hdisplay, mode->vdisplay, fmt, 0xc0);
+	if (ret)
+		goto out_buf0;
+
+	ret = commit_mode(dev, mode, buf[0].fb_id);
+	if (ret) {
+		fprintf(stderr, "modeset failed: %s\n", strerror(-ret));
+		goto out_buf1;
+	}
+
+	for (i = 0; i < opts->flips + 1; i++) {
+		req = drmModeAtomicAlloc();
+		if (!req) {
+			ret = -ENOMEM;
+			break;
+		}
+		add_plane(req, dev, buf[(i + 1) & 1].fb_id, mode);
+
+		st.pending = 1;
+		st.submit = now_sec();
+		ret = drmModeAtomicCommit(dev->fd, req,
+					  DRM_MODE_ATOMIC_NONBLOCK |
+					  DRM_MODE_PAGE_FLIP_EVENT, &st) ? -errno : 0;
+		drmModeAtomicFree(req);
+		if (ret) {
+			fprintf(stderr, "flip failed: %s\n", strerror(-ret));
+			break;
+		}
+		ret = wait_flip(dev, &st);
+		if (ret)
+			break;
+
+		/* the first flip only lines the loop up with vblank */
+		if (i) {
+			lat[n] = (st.event - st.submit) * 1e3;
+			ival[n] = (st.event - last_event) * 1e3;
+			jit[n] = ival[n] - (st.sequence - last_seq) * period;
+			if (st.sequence - last_seq > 1)
+				missed += st.sequence - last_seq - 1;
+			n++;
+		}
+		last_event = st.event;
+		last_seq = st.sequence;
+	}
+	if (!n)
+		goto out_buf1;
+
+	/* histogram of latency in eighths of a frame, the last bucket open */
+	bucket = period / 8;
+	for (i = 0; i < n; i++) {
+		b = lat[i] / bucket;
+		hist[b < HIST_BUCKETS ? b : HIST_BUCKETS - 1]++;
+	}
+
+	open_record(out, first, mode, fmt);
+	fprintf(out, ", \"flips\": %u, \"frame_ms\": %.3f, \"missed_vblanks\": %u,\n      ",
+		n, period, missed);
+	print_stats(out, "latency_ms", lat, n);
+	fprintf(out, ",\n      ");
+	print_stats(out, "interval_ms", ival, n);
+	fprintf(out, ",\n      ");
+	print_stats(out, "jitter_ms", jit, n);
+	fprintf(out, ",\n      \"histogram\": {\"bucket_ms\": %.3f, \"counts\": [",
+		bucket);
+	for (i = 0; i < HIST_BUCKETS; i++)
+		fprintf(out, "%s%u", i ? ", " : "", hist[i]);
+	fprintf(out, "]}}");
+
+out_buf1:
+	buf_destroy(dev, &buf[1]);
+out_buf0:
+	buf_destroy(dev, &buf[0]);
+out:
+	free(lat);
+	free(ival);
+	free(jit);
+	return ret;
+}
+
+static int run_fb(FILE *out, struct bench_dev *dev,
+		  const struct bench_opts *opts,
+		  const drmModeModeInfo *mode,
+		  const struct bench_format *fmt, int *first)
+{
+	unsigned int w = mode->hdisplay, h = mode->vdisplay;
+	struct fb_op_rect r = { 0, 0, w, h };
+	struct bench_buf buf;
+	uint8_t *src;
+	double t0, dt;
+	unsigned int i, n;
+	int ret;
+
+	src = fb_op_image(w, fmt->cpp);
+	if (!src)
+		return -ENOMEM;
+
+	ret = buf_create(dev, &buf, w, h, fmt, 0);
+	if (ret)
+		goto out;
+
+	/* measured while scanned out, so the DMA competes for DDR */
+	ret = commit_mode(dev, mode, buf.fb_id);
+	if (ret) {
+		fprintf(stderr, "modeset failed: %s\n", strerror(-ret));
+		goto out_buf;
+	}
+
+	for (i = 0; i < FB_OPS_COUNT; i++) {
+		t0 = now_sec();
+		for (n = 0; n < opts->loops; n++)
+			fb_ops[i].fn(buf.map, buf.pitch, &r, fmt->cpp, src, n);
+		dt = now_sec() - t0;
+
+		open_record(out, first, mode, fmt);
+		fprintf(out, ", \"op\": \"%s\", \"ms\": %.3f, \"mb_s\": %.1f, "
+			"\"mpix_s\": %.1f}",
+			fb_ops[i].name, dt * 1e3 / opts->loops,
+			(double)w * h * fmt->cpp * fb_ops[i].passes *
+			opts->loops / dt / 1e6,
+			(double)w * h * opts->loops / dt / 1e6);
+	}
+
+out_buf:
+	buf_destroy(dev, &buf);
+out:
+	free(src);
+	return ret;
+}
+
+static void print_header(FILE *out, struct bench_dev *dev,
+			 const struct bench_opts *opts)
+{
+	drmVersion *ver = drmGetVersion(dev->fd);
+	struct utsname uts;
+	time_t now = time(NULL);
+	char date[32];
+
+	uname(&uts);
+	strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+	fprintf(out, "{\n  \"device\": \"%s\",\n  \"driver\": \"%s\",\n"
+		"  \"kernel\": \"%s\",\n  \"machine\": \"%s\",\n"
+		"  \"date\": \"%s\",\n  \"connector\": \"%s\",\n"
+		"  \"crtc\": %u,\n  \"plane\": %u",
+		opts->device, ver ? ver->name : "", uts.release, uts.machine,
+		date, dev->conn_name, dev->crtc_id, dev->plane_id);
+	drmFreeVersion(ver);
+}
+
+/* Run one test over every mode and format into a JSON array */
+static int run_test(FILE *out, struct bench_dev *dev,
+		    const struct bench_opts *opts, unsigned int test,
+		    const char *key, const drmModeModeInfo **modes,
+		    unsigned int nmodes)
+{
+	const struct bench_format *fmt;
+	unsigned int m, f;
+	int first = 1, ret = 0, err;
+
+	fprintf(out, ",\n  \"%s\": [\n", key);
+	for (m = 0; m < nmodes; m++) {
+		for (f = 0; f < opts->nformats; f++) {
+			fmt = opts->formats[f];
+			if (!plane_has_format(dev, fmt->fourcc)) {
+				open_record(out, &first, modes[m], fmt);
+				fprintf(out, ", \"skipped\": \"format not supported\"}");
+				continue;
+			}
+
+			if (test == TEST_MODESET)
+				err = run_modeset(out, dev, opts, modes[m], fmt, &first);
+			else if (test == TEST_FLIP)
+				err = run_flip(out, dev, opts, modes[m], fmt, &first);
+			else
+				err = run_fb(out, dev, opts, modes[m], fmt, &first);
+			if (err) {
+				open_record(out, &first, modes[m], fmt);
+				fprintf(out, ", \"error\": \"%s\"}", strerror(-err));
+				ret = 1;
+			}
+		}
+	}
+	fprintf(out, "\n  ]");
+
+	return ret;
+}
+
+static const struct bench_format *find_format(const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < sizeof(formats) / sizeof(formats[0]); i++)
+		if (!strcmp(formats[i].name, name))
+			return &formats[i];
+	return NULL;
+}
+
+/* A run count for -m, -n or -l: a number of at least 1 */
+static int parse_count(const char *arg, unsigned int *count)
+{
+	char *end;
+	long val;
+
+	errno = 0;
+	val = strtol(arg, &end, 0);
+	if (errno || end == arg || *end || val < 1 || val > 1000000)
+		return -EINVAL;
+	*count = val;
+	return 0;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  -D <device>   DRM device (default /dev/dri/card0)\n"
+		"  -t <tests>    modeset, flip, fb, comma separated (default all)\n"
+		"  -r <WxH[@Hz]> mode to test, may be repeated (default preferred)\n"
+		"  -a            test every mode of the connector\n"
+		"  -f <formats>  RG24, XR24, comma separated (default both)\n"
+		"  -m <runs>     modesets per mode and format (default 10)\n"
+		"  -n <flips>    page flips per mode and format (default 600)\n"
+		"  -l <loops>    iterations per fb operation (default 20)\n"
+		"  -o <file>     write the JSON there instead of stdout\n",
+		prog);
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench_opts opts = {
+		.device = "/dev/dri/card0",
+		.tests = TEST_MODESET | TEST_FLIP | TEST_FB,
+		.modesets = 10,
+		.flips = 600,
+		.loops = 20,
+	};
+	struct bench_dev dev = { .fd = -1 };
+	const drmModeModeInfo *modes[MAX_MODES];
+	const struct bench_format *fmt;
+	unsigned int nmodes;
+	FILE *out = stdout;
+	int opt, ret = 0;
+	char *tok;
+
+	while ((opt = getopt(argc, argv, "D:t:r:af:m:n:l:o:h")) != -1) {
+		switch (opt) {
+		case 'D':
+			opts.device = optarg;
+			break;
+		case 't':
+			opts.tests = 0;
+			for (tok = strtok(optarg, ","); tok; tok = strtok(NULL, ",")) {
+				if (!strcmp(tok, "modeset"))
+					opts.tests |= TEST_MODESET;
+				else if (!strcmp(tok, "flip"))
+					opts.tests |= TEST_FLIP;
+				else if (!strcmp(tok, "fb"))
+					opts.tests |= TEST_FB;
+				else {
+					usage(argv[0]);
+					return 1;
+				}
+			}
+			break;
+		case 'r':
+			if (opts.nmodes < MAX_MODES)
+				snprintf(opts.modes[opts.nmodes++],
+					 sizeof(opts.modes[0]), "%s", optarg);
+			break;
+		case 'a':
+			opts.all_modes = 1;
+			break;
+		case 'f':
+			opts.nformats = 0;
+			for (tok = strtok(optarg, ","); tok; tok = strtok(NULL, ",")) {
+				fmt = find_format(tok);
+				if (!fmt || opts.nformats == MAX_FORMATS) {
+					usage(argv[0]);
+					return 1;
+				}
+				opts.formats[opts.nformats++] = fmt;
+			}
+			break;
+		case 'm':
+			if (parse_count(optarg, &opts.modesets)) {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'n':
+			if (parse_count(optarg, &opts.flips)) {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'l':
+			if (parse_count(optarg, &opts.loops)) {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'o':
+			opts.output = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (!opts.nformats) {
+		opts.formats[opts.nformats++] = &formats[0];
+		opts.formats[opts.nformats++] = &formats[1];
+	}
+
+	if (dev_open(&dev, opts.device)) {
+		if (dev.fd >= 0)
+			dev_close(&dev);
+		return 1;
+	}
+
+	nmodes = select_modes(&dev, &opts, modes);
+	if (!nmodes) {
+		dev_close(&dev);
+		return 1;
+	}
+
+	if (opts.output) {
+		out = fopen(opts.output, "w");
+		if (!out) {
+			perror(opts.output);
+			dev_close(&dev);
+			return 1;
+		}
+	}
+
+	print_header(out, &dev, &opts);
+	if ((opts.tests & TEST_MODESET) &&
+	    run_test(out, &dev, &opts, TEST_MODESET, "modeset", modes, nmodes))
+		ret = 1;
+	if ((opts.tests & TEST_FLIP) &&
+	    run_test(out, &dev, &opts, TEST_FLIP, "flip", modes, nmodes))
+		ret = 1;
+	if ((opts.tests & TEST_FB) &&
+	    run_test(out, &dev, &opts, TEST_FB, "fb", modes, nmodes))
+		ret = 1;
+	fprintf(out, "\n}\n");
+
+	if (out != stdout)
+		fclose(out);
+	dev_close(&dev);
+	return ret;
+}
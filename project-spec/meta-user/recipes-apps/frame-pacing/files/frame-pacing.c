@@ -0,0 +1,1024 @@
+/*
+ * frame-pacing - flip and vblank timing of the PL display
+ *
+ * Follows every vblank of the PL CRTC and every page flip completed on it
+ * through tracefs, in a trace instance of its own, and keeps missed vblank
+ * counts, submit to vblank latency and present interval histograms. The
+ * report is written to a file every few seconds and to anyone connecting
+ * to the UNIX socket.
+ *
+ * Events:
+ *   drm_vblank_event            each vblank: sequence and timestamp
+ *   drm_vblank_event_delivered  a flip completed: client file and sequence
+ *   submit, legacy (kprobes)    atomic or legacy flip ioctl with an event
+ *   latch (kprobe)              xlnx_pl_disp programs the new buffer
+ *   retune_N, retuned_N         HDMI encoder atomic_mode_set, which sets
+ *   (kprobe, kretprobe)         the pixel clock rate
+ *
+ * A flip is late by the vblanks between the first vblank after its submit
+ * and the one it completed at. Late vblanks go to the clock retune when an
+ * encoder mode set ran while the flip was pending, and to the commit
+ * otherwise. When a client presents less often than its usual interval and
+ * the flip was not late, the extra vblanks are the application's.
+ *
+ * Copyright (C) 2026
+ * SPDX-License-Identifier: MIT
+ */
+
+#define _GNU_SOURCE
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define INSTANCE		"frame-pacing"
+#define GROUP			"frame_pacing"
+#define DEFAULT_REPORT		"/run/frame-pacing"
+#define DEFAULT_SOCKET		"/run/frame-pacing.sock"
+
+#define MAX_CLIENTS		16
+#define MAX_PENDING		8
+#define MAX_RETUNE		6
+#define LAT_BUCKETS		33	/* eighths of a frame, last is 4+ frames */
+#define INT_BUCKETS		10	/* 1 to 8 vblanks, 9+, index 0 unused */
+#define HOUR_MINUTES		60
+#define STALE_SUBMIT		1.0	/* s a submit waits for its completion */
+#define CLIENT_IDLE		600.0	/* s before a client slot is reused */
+
+#define DRM_MODE_PAGE_FLIP_EVENT	0x01
+#define DRM_MODE_ATOMIC_TEST_ONLY	0x0100
+
+/* Encoder mode sets that retune the pixel clock, as module:symbol */
+static const char *const retune_default[] = {
+	"digilent_hdmi:digilent_hdmi_atomic_mode_set",
+	"rehsd_hdmi:rehsd_hdmi_atomic_mode_set",
+};
+
+enum {
+	C_VBLANKS,
+	C_FLIPS,
+	C_MISSED_APP,
+	C_MISSED_COMMIT,
+	C_MISSED_RETUNE,
+	C_RETUNES,
+	C_COUNT
+};
+
+static const char *const counter_names[C_COUNT] = {
+	"vblanks", "flips", "missed_app", "missed_commit", "missed_retune",
+	"retunes",
+};
+
+struct pending {
+	double submit;		/* ioctl entry */
+	double latch;		/* plane update in xlnx_pl_disp, 0 if none */
+	uint32_t target;	/* first vblank after the submit */
+	int have_target;
+	int retune;		/* an encoder mode set ran meanwhile */
+};
+
+struct client {
+	unsigned long long file;	/* struct drm_file pointer */
+	char comm[17];
+	int pid;
+	double last_seen;
+	struct pending q[MAX_PENDING];
+	unsigned int nq;
+	uint32_t last_seq;
+	int have_last;
+	unsigned long counters[C_COUNT];
+	unsigned long intervals[INT_BUCKETS];
+};
+
+struct pacing {
+	int crtc;
+	int verbose;
+	double start;
+
+	/* vblank grid */
+	uint32_t vbl_seq;
+	double vbl_time;
+	int have_vbl;
+	double period;
+	unsigned int outliers;
+
+	/* encoder mode sets */
+	int retuning;
+	double retune_start;
+	double retune_last;
+
+	unsigned long counters[C_COUNT];
+	unsigned long minutes[HOUR_MINUTES][C_COUNT];
+	unsigned int minute;
+	double minute_start;
+
+	unsigned long latency[LAT_BUCKETS];
+	unsigned long latency_n;
+	double latency_max;
+	unsigned long intervals[INT_BUCKETS];
+
+	struct client clients[MAX_CLIENTS];
+	unsigned int nclients;
+};
+
+struct trace_rec {
+	char comm[17];
+	int pid;
+	double ts;
+	const char *event;
+	const char *args;
+};
+
+static volatile sig_atomic_t quit;
+static char tracefs[64];
+
+static double now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Counters */
+
+static void count(struct pacing *pc, struct client *cl, int c,
+		  unsigned long n)
+{
+	pc->counters[c] += n;
+	pc->minutes[pc->minute][c] += n;
+	if (cl)
+		cl->counters[c] += n;
+}
+
+/* Keeps one hour of per minute counters for the last_hour column */
+static void roll_minutes(struct pacing *pc, double now)
+{
+	if (now - pc->minute_start >= HOUR_MINUTES * 60.0) {
+		memset(pc->minutes, 0, sizeof(pc->minutes));
+		pc->minute_start = now;
+		return;
+	}
+	while (now - pc->minute_start >= 60.0) {
+		pc->minute = (pc->minute + 1) % HOUR_MINUTES;
+		memset(pc->minutes[pc->minute], 0, sizeof(pc->minutes[0]));
+		pc->minute_start += 60.0;
+	}
+}
+
+/* Clients */
+
+static struct client *client_get(struct pacing *pc, unsigned long long file,
+				 double now, int create)
+{
+	struct client *cl, *oldest = NULL;
+	unsigned int i;
+
+	for (i = 0; i < pc->nclients; i++) {
+		cl = &pc->clients[i];
+		if (cl->file == file) {
+			cl->last_seen = now;
+			return cl;
+		}
+		if (!oldest || cl->last_seen < oldest->last_seen)
+			oldest = cl;
+	}
+	if (!create)
+		return NULL;
+
+	if (pc->nclients < MAX_CLIENTS)
+		cl = &pc->clients[pc->nclients++];
+	else if (now - oldest->last_seen > CLIENT_IDLE)
+		cl = oldest;
+	else
+		return NULL;
+
+	memset(cl, 0, sizeof(*cl));
+	cl->file = file;
+	cl->last_seen = now;
+	strcpy(cl->comm, "?");
+	return cl;
+}
+
+/* The oldest pending flip of all clients, for events we cannot match */
+static struct client *oldest_pending(struct pacing *pc)
+{
+	struct client *best = NULL;
+	unsigned int i;
+
+	for (i = 0; i < pc->nclients; i++) {
+		struct client *cl = &pc->clients[i];
+
+		if (cl->nq && (!best || cl->q[0].submit < best->q[0].submit))
+			best = cl;
+	}
+	return best;
+}
+
+static void pending_pop(struct client *cl)
+{
+	cl->nq--;
+	memmove(&cl->q[0], &cl->q[1], cl->nq * sizeof(cl->q[0]));
+}
+
+/* Submits that never completed on this CRTC: other devices, failed ioctls */
+static void drop_stale(struct client *cl, double now)
+{
+	while (cl->nq && now - cl->q[0].submit > STALE_SUBMIT)
+		pending_pop(cl);
+}
+
+/* Usual present interval of a client, in vblanks */
+static unsigned int usual_interval(const struct client *cl)
+{
+	unsigned int i, best = 1;
+
+	for (i = 2; i < INT_BUCKETS - 1; i++)
+		if (cl->intervals[i] > cl->intervals[best])
+			best = i;
+	return best;
+}
+
+/* Event handlers */
+
+static void on_vblank(struct pacing *pc, uint32_t seq, double t)
+{
+	unsigned int i, j;
+
+	if (pc->have_vbl && seq != pc->vbl_seq) {
+		uint32_t n = seq - pc->vbl_seq;
+		double dt = (t - pc->vbl_time) / n;
+
+		/* a new mode shows as a run of samples off the estimate */
+		if (n <= 4 && dt > 0) {
+			if (!pc->period || pc->outliers >= 8) {
+				pc->period = dt;
+				pc->outliers = 0;
+			} else if (dt > pc->period * 0.75 &&
+				   dt < pc->period * 1.25) {
+				pc->period += (dt - pc->period) / 16;
+				pc->outliers = 0;
+			} else {
+				pc->outliers++;
+			}
+		}
+	}
+	pc->vbl_seq = seq;
+	pc->vbl_time = t;
+	pc->have_vbl = 1;
+	count(pc, NULL, C_VBLANKS, 1);
+
+	for (i = 0; i < pc->nclients; i++) {
+		struct client *cl = &pc->clients[i];
+
+		for (j = 0; j < cl->nq; j++) {
+			struct pending *p = &cl->q[j];
+
+			if (!p->have_target && t > p->submit) {
+				p->target = seq;
+				p->have_target = 1;
+			}
+		}
+	}
+}
+
+static void on_submit(struct pacing *pc, const struct trace_rec *r,
+		      unsigned long long file, unsigned long flags, int atomic)
+{
+	struct client *cl;
+	struct pending *p;
+
+	if (!(flags & DRM_MODE_PAGE_FLIP_EVENT) ||
+	    (atomic && (flags & DRM_MODE_ATOMIC_TEST_ONLY)))
+		return;
+
+	cl = client_get(pc, file, r->ts, 1);
+	if (!cl)
+		return;
+	snprintf(cl->comm, sizeof(cl->comm), "%s", r->comm);
+	cl->pid = r->pid;
+
+	drop_stale(cl, r->ts);
+	if (cl->nq == MAX_PENDING)
+		pending_pop(cl);
+	p = &cl->q[cl->nq++];
+	memset(p, 0, sizeof(*p));
+	p->submit = r->ts;
+	p->retune = pc->retuning;
+}
+
+static void on_latch(struct pacing *pc, double t)
+{
+	struct client *best = NULL;
+	struct pending *bp = NULL;
+	unsigned int i, j;
+
+	/* commits reach the plane in submit order */
+	for (i = 0; i < pc->nclients; i++) {
+		struct client *cl = &pc->clients[i];
+
+		for (j = 0; j < cl->nq; j++) {
+			struct pending *p = &cl->q[j];
+
+			if (p->latch)
+				continue;
+			if (!bp || p->submit < bp->submit) {
+				best = cl;
+				bp = p;
+			}
+			break;
+		}
+	}
+	if (best)
+		bp->latch = t;
+}
+
+static void on_retune(struct pacing *pc, double t, int done)
+{
+	unsigned int i, j;
+
+	if (!done) {
+		pc->retuning = 1;
+		pc->retune_start = t;
+		count(pc, NULL, C_RETUNES, 1);
+		for (i = 0; i < pc->nclients; i++)
+			for (j = 0; j < pc->clients[i].nq; j++)
+				pc->clients[i].q[j].retune = 1;
+		return;
+	}
+	if (pc->retuning)
+		pc->retune_last = t - pc->retune_start;
+	pc->retuning = 0;
+}
+
+static void on_delivered(struct pacing *pc, const struct trace_rec *r,
+			 unsigned long long file, uint32_t seq)
+{
+	struct client *cl = client_get(pc, file, r->ts, 0);
+	struct pending p = { 0 };
+	unsigned int interval = 0, late = 0, app = 0, bucket;
+	double vbl, latency = -1;
+	int have_p = 0;
+
+	/* hashed pointers do not match the submit: assume submit order */
+	if (!cl || !cl->nq) {
+		cl = oldest_pending(pc);
+		if (!cl)
+			cl = client_get(pc, file, r->ts, 1);
+		if (!cl)
+			return;
+	}
+
+	vbl = pc->vbl_time;
+	if (pc->have_vbl && seq != pc->vbl_seq)
+		vbl += (int32_t)(seq - pc->vbl_seq) * pc->period;
+
+	/* one flip in flight per CRTC: a later submit before this vblank
+	 * means the event of the older one was lost to a trace overrun */
+	while (cl->nq > 1 && cl->q[1].submit < vbl)
+		pending_pop(cl);
+
+	if (cl->nq) {
+		p = cl->q[0];
+		pending_pop(cl);
+		have_p = 1;
+	}
+
+	/* a vblank wait of a client we saw flip, not a flip */
+	if (!have_p && cl->pid)
+		return;
+
+	if (have_p) {
+		if (!p.have_target)
+			p.target = seq;
+		late = (int32_t)(seq - p.target) > 0 ? seq - p.target : 0;
+
+		latency = vbl - p.submit;
+		if (latency >= 0 && pc->period) {
+			bucket = latency * 8 / pc->period;
+			if (bucket >= LAT_BUCKETS)
+				bucket = LAT_BUCKETS - 1;
+			pc->latency[bucket]++;
+			pc->latency_n++;
+			if (latency > pc->latency_max)
+				pc->latency_max = latency;
+		}
+	}
+
+	if (cl->have_last) {
+		interval = seq - cl->last_seq;
+		if (interval && interval < INT_BUCKETS - 1) {
+			unsigned int usual = usual_interval(cl);
+
+			if (interval > usual + late)
+				app = interval - usual - late;
+		}
+		bucket = interval < INT_BUCKETS - 1 ? interval : INT_BUCKETS - 1;
+		cl->intervals[bucket]++;
+		pc->intervals[bucket]++;
+	}
+	cl->last_seq = seq;
+	cl->have_last = 1;
+
+	count(pc, cl, C_FLIPS, 1);
+	if (app)
+		count(pc, cl, C_MISSED_APP, app);
+	if (late)
+		count(pc, cl, p.retune ? C_MISSED_RETUNE : C_MISSED_COMMIT,
+		      late);
+
+	if (pc->verbose)
+		printf("%.6f %s-%d seq=%u interval=%u late=%u%s app=%u "
+		       "latency=%.3f latch=%.3f\n",
+		       r->ts, cl->comm, cl->pid, seq, interval, late,
+		       p.retune ? "(retune)" : "", app,
+		       latency * 1e3, p.latch ? (p.latch - p.submit) * 1e3 : 0);
+}
+
+/* Trace parsing */
+
+/* "          comm-pid     [cpu] flags  secs.usecs: event: args" */
+static int parse_line(char *line, struct trace_rec *r)
+{
+	char *p, *q, *cpu = NULL, *dash;
+	size_t n;
+
+	for (p = line; (p = strchr(p, '[')); p++) {
+		if (p > line && p[-1] == ' ' && isdigit((unsigned char)p[1])) {
+			for (q = p + 1; isdigit((unsigned char)*q); q++)
+				;
+			if (*q == ']') {
+				cpu = p;
+				break;
+			}
+		}
+	}
+	if (!cpu)
+		return -1;
+
+	/* task: comm may hold spaces and dashes, the pid follows the last */
+	for (q = cpu; q > line && q[-1] == ' '; q--)
+		;
+	*q = '\0';
+	dash = strrchr(line, '-');
+	if (!dash)
+		return -1;
+	r->pid = atoi(dash + 1);
+	*dash = '\0';
+	for (p = line; *p == ' '; p++)
+		;
+	n = strlen(p);
+	if (n >= sizeof(r->comm))
+		n = sizeof(r->comm) - 1;
+	memcpy(r->comm, p, n);
+	r->comm[n] = '\0';
+
+	/* irq flags, timestamp, event name */
+	p = strchr(cpu, ']') + 1;
+	while (*p == ' ')
+		p++;
+	while (*p && *p != ' ')
+		p++;
+	r->ts = strtod(p, &q);
+	if (q == p || strncmp(q, ": ", 2))
+		return -1;
+	r->event = q + 2;
+	q = strstr(r->event, ": ");
+	if (!q)
+		return -1;
+	*q = '\0';
+	r->args = q + 2;
+	return 0;
+}
+
+static int arg_get(const char *args, const char *key, int base,
+		   unsigned long long *val)
+{
+	size_t n = strlen(key);
+	const char *p = args;
+
+	while ((p = strstr(p, key))) {
+		if ((p == args || p[-1] == ' ' || p[-1] == ',') && p[n] == '=') {
+			*val = strtoull(p + n + 1, NULL, base);
+			return 0;
+		}
+		p += n;
+	}
+	return -1;
+}
+
+static void handle_line(struct pacing *pc, char *line)
+{
+	unsigned long long crtc, seq, time, file, flags;
+	struct trace_rec r;
+
+	if (line[0] == '#' || parse_line(line, &r))
+		return;
+	/* a replayed trace starts at its first record */
+	if (pc->start < 0)
+		pc->start = pc->minute_start = r.ts;
+
+	roll_minutes(pc, r.ts);
+
+	if (!strcmp(r.event, "drm_vblank_event")) {
+		if (arg_get(r.args, "crtc", 10, &crtc) || (int)crtc != pc->crtc ||
+		    arg_get(r.args, "seq", 10, &seq) ||
+		    arg_get(r.args, "time", 10, &time))
+			return;
+		on_vblank(pc, seq, time / 1e9);
+	} else if (!strcmp(r.event, "drm_vblank_event_delivered")) {
+		if (arg_get(r.args, "crtc", 10, &crtc) || (int)crtc != pc->crtc ||
+		    arg_get(r.args, "seq", 10, &seq) ||
+		    arg_get(r.args, "file", 16, &file))
+			return;
+		on_delivered(pc, &r, file, seq);
+	} else if (!strcmp(r.event, "submit") || !strcmp(r.event, "legacy")) {
+		if (arg_get(r.args, "file", 16, &file) ||
+		    arg_get(r.args, "flags", 16, &flags))
+			return;
+		on_submit(pc, &r, file, flags, r.event[0] == 's');
+	} else if (!strcmp(r.event, "latch")) {
+		on_latch(pc, r.ts);
+	} else if (!strncmp(r.event, "retuned", 7)) {
+		on_retune(pc, r.ts, 1);
+	} else if (!strncmp(r.event, "retune", 6)) {
+		on_retune(pc, r.ts, 0);
+	}
+}
+
+/* Report */
+
+static double latency_percentile(const struct pacing *pc, double pct)
+{
+	unsigned long want = pc->latency_n * pct, sum = 0;
+	unsigned int i;
+
+	for (i = 0; i < LAT_BUCKETS - 1; i++) {
+		sum += pc->latency[i];
+		if (sum > want)
+			return (i + 1) * pc->period / 8;
+	}
+	return pc->latency_max;
+}
+
+static void print_intervals(FILE *f, const unsigned long *hist)
+{
+	unsigned int i;
+
+	for (i = 1; i < INT_BUCKETS; i++)
+		if (hist[i])
+			fprintf(f, " %u%s:%lu", i, i == INT_BUCKETS - 1 ? "+" : "",
+				hist[i]);
+	fprintf(f, "\n");
+}
+
+static void report(FILE *f, const struct pacing *pc, double now)
+{
+	unsigned long hour[C_COUNT] = { 0 }, missed, missed_hour;
+	unsigned int i, c;
+
+	for (i = 0; i < HOUR_MINUTES; i++)
+		for (c = 0; c < C_COUNT; c++)
+			hour[c] += pc->minutes[i][c];
+	missed = pc->counters[C_MISSED_APP] + pc->counters[C_MISSED_COMMIT] +
+		 pc->counters[C_MISSED_RETUNE];
+	missed_hour = hour[C_MISSED_APP] + hour[C_MISSED_COMMIT] +
+		      hour[C_MISSED_RETUNE];
+
+	fprintf(f, "# counters: total last_hour\n");
+	fprintf(f, "crtc %d\n", pc->crtc);
+	fprintf(f, "uptime_s %.0f\n", now - pc->start);
+	fprintf(f, "refresh_hz %.3f\n", pc->period ? 1 / pc->period : 0);
+	for (c = 0; c < C_COUNT; c++) {
+		fprintf(f, "%s %lu %lu\n", counter_names[c], pc->counters[c],
+			hour[c]);
+		if (c == C_FLIPS)
+			fprintf(f, "missed %lu %lu\n", missed, missed_hour);
+	}
+	fprintf(f, "retune_last_ms %.3f\n", pc->retune_last * 1e3);
+
+	fprintf(f, "latency_ms p50=%.2f p90=%.2f p99=%.2f max=%.2f\n",
+		latency_percentile(pc, 0.5) * 1e3,
+		latency_percentile(pc, 0.9) * 1e3,
+		latency_percentile(pc, 0.99) * 1e3, pc->latency_max * 1e3);
+	fprintf(f, "latency_eighths");
+	for (i = 0; i < LAT_BUCKETS; i++)
+		if (pc->latency[i])
+			fprintf(f, " %u%s:%lu", i, i == LAT_BUCKETS - 1 ? "+" : "",
+				pc->latency[i]);
+	fprintf(f, "\n");
+	fprintf(f, "interval_vblanks");
+	print_intervals(f, pc->intervals);
+
+	for (i = 0; i < pc->nclients; i++) {
+		const struct client *cl = &pc->clients[i];
+
+		if (!cl->counters[C_FLIPS])
+			continue;
+		fprintf(f, "client pid=%d comm=%s flips=%lu missed_app=%lu "
+			"missed_commit=%lu missed_retune=%lu interval_vblanks",
+			cl->pid, cl->comm, cl->counters[C_FLIPS],
+			cl->counters[C_MISSED_APP],
+			cl->counters[C_MISSED_COMMIT],
+			cl->counters[C_MISSED_RETUNE]);
+		print_intervals(f, cl->intervals);
+	}
+}
+
+/* Written next to the target and renamed, so readers never see half */
+static void write_report(const struct pacing *pc, const char *path)
+{
+	char tmp[256];
+	FILE *f;
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	f = fopen(tmp, "w");
+	if (!f)
+		return;
+	report(f, pc, now_sec());
+	if (fclose(f) || rename(tmp, path))
+		unlink(tmp);
+}
+
+static void serve_report(const struct pacing *pc, int listen_fd)
+{
+	char *buf = NULL;
+	size_t len = 0;
+	FILE *f;
+	int fd;
+
+	fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+	if (fd < 0)
+		return;
+	f = open_memstream(&buf, &len);
+	if (f) {
+		report(f, pc, now_sec());
+		fclose(f);
+		if (write(fd, buf, len) < 0 && pc->verbose)
+			perror("report");
+		free(buf);
+	}
+	close(fd);
+}
+
+static int listen_socket(const char *path)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	int fd;
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "socket path too long\n");
+		return -ENAMETOOLONG;
+	}
+	strcpy(addr.sun_path, path);
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+	if (fd < 0)
+		return -errno;
+	unlink(path);
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) || listen(fd, 4)) {
+		fprintf(stderr, "cannot listen on %s: %s\n", path,
+			strerror(errno));
+		close(fd);
+		return -errno;
+	}
+	chmod(path, 0666);
+
+	return fd;
+}
+
+/* tracefs */
+
+static int trace_write(const char *rel, const char *val, int append)
+{
+	char path[256];
+	ssize_t len = strlen(val);
+	int fd, ret = 0;
+
+	snprintf(path, sizeof(path), "%s/%s", tracefs, rel);
+	fd = open(path, O_WRONLY | O_CLOEXEC | (append ? O_APPEND : O_TRUNC));
+	if (fd < 0)
+		return -errno;
+	if (write(fd, val, len) != len)
+		ret = -errno;
+	close(fd);
+	return ret;
+}
+
+static int find_tracefs(void)
+{
+	static const char *const roots[] = {
+		"/sys/kernel/tracing", "/sys/kernel/debug/tracing",
+	};
+	char path[128];
+	unsigned int i;
+
+	for (i = 0; i < sizeof(roots) / sizeof(roots[0]); i++) {
+		snprintf(path, sizeof(path), "%s/instances", roots[i]);
+		if (!access(path, F_OK)) {
+			strcpy(tracefs, roots[i]);
+			return 0;
+		}
+	}
+	return -ENOENT;
+}
+
+/* Removes the instance and the probes, also what a killed run left */
+static void trace_cleanup(void)
+{
+	char path[256], line[512], name[64];
+	FILE *f;
+
+	trace_write("instances/" INSTANCE "/events/enable", "0", 0);
+	snprintf(path, sizeof(path), "%s/instances/" INSTANCE, tracefs);
+	rmdir(path);
+
+	snprintf(path, sizeof(path), "%s/kprobe_events", tracefs);
+	f = fopen(path, "r");
+	if (!f)
+		return;
+	while (fgets(line, sizeof(line), f)) {
+		if (sscanf(line, "%*[pr]:" GROUP "/%63s", name) != 1)
+			continue;
+		snprintf(line, sizeof(line), "-:" GROUP "/%s\n", name);
+		trace_write("kprobe_events", line, 1);
+	}
+	fclose(f);
+}
+
+static int add_probe(const char *type, const char *event, const char *sym,
+		     const char *args)
+{
+	char def[256];
+	int ret;
+
+	snprintf(def, sizeof(def), "%s:" GROUP "/%s %s%s%s\n", type, event,
+		 sym, args ? " " : "", args ? args : "");
+	ret = trace_write("kprobe_events", def, 1);
+	if (ret)
+		fprintf(stderr, "no probe on %s: %s\n", sym, strerror(-ret));
+	return ret;
+}
+
+static int trace_setup(int crtc, const char *const *retune,
+		       unsigned int nretune)
+{
+	const char *ptr = sizeof(void *) == 8 ? "x64" : "x32";
+	char path[256], args[128], name[24];
+	unsigned int i;
+	int ret;
+
+	if (find_tracefs()) {
+		fprintf(stderr, "tracefs not mounted\n");
+		return -ENOENT;
+	}
+	trace_cleanup();
+
+	/* flip submits with their drm_file, struct drm_mode_atomic.flags
+	 * and struct drm_mode_crtc_page_flip.flags */
+	snprintf(args, sizeof(args), "file=$arg3:%s flags=+0($arg2):x32", ptr);
+	add_probe("p", "submit", "drm_mode_atomic_ioctl", args);
+	snprintf(args, sizeof(args), "file=$arg3:%s flags=+8($arg2):x32", ptr);
+	add_probe("p", "legacy", "drm_mode_page_flip_ioctl", args);
+	add_probe("p", "latch", "xlnx_pl_disp_plane_atomic_update", NULL);
+	/* module probes stay pending until the module loads */
+	for (i = 0; i < nretune; i++) {
+		snprintf(name, sizeof(name), "retune_%u", i);
+		add_probe("p", name, retune[i], NULL);
+		snprintf(name, sizeof(name), "retuned_%u", i);
+		add_probe("r", name, retune[i], NULL);
+	}
+
+	snprintf(path, sizeof(path), "%s/instances/" INSTANCE, tracefs);
+	if (mkdir(path, 0700) && errno != EEXIST) {
+		ret = -errno;
+		fprintf(stderr, "cannot create %s: %s\n", path, strerror(errno));
+		return ret;
+	}
+
+	/* timestamps on the clock of the vblank times; raw file pointers */
+	trace_write("instances/" INSTANCE "/trace_clock", "mono", 0);
+	trace_write("instances/" INSTANCE "/trace_options", "nohash-ptr", 0);
+	trace_write("instances/" INSTANCE "/buffer_size_kb", "64", 0);
+
+	snprintf(args, sizeof(args), "crtc == %d", crtc);
+	trace_write("instances/" INSTANCE "/events/drm/drm_vblank_event/filter",
+		    args, 0);
+	trace_write("instances/" INSTANCE
+		    "/events/drm/drm_vblank_event_delivered/filter", args, 0);
+	ret = trace_write("instances/" INSTANCE
+			  "/events/drm/drm_vblank_event/enable", "1", 0);
+	if (!ret)
+		ret = trace_write("instances/" INSTANCE
+				  "/events/drm/drm_vblank_event_delivered/enable",
+				  "1", 0);
+	if (ret) {
+		fprintf(stderr, "no drm trace events: %s\n", strerror(-ret));
+		return ret;
+	}
+	if (trace_write("instances/" INSTANCE "/events/" GROUP "/enable", "1", 0))
+		fprintf(stderr, "no kprobes, counting flips without latency\n");
+
+	snprintf(path, sizeof(path), "%s/instances/" INSTANCE "/trace_pipe",
+		 tracefs);
+	ret = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	if (ret < 0) {
+		ret = -errno;
+		fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+	}
+	return ret;
+}
+
+/* Feeds whole lines from fd to the parser; 0 at end of file */
+static int read_trace(struct pacing *pc, int fd, char *buf, size_t size,
+		      size_t *fill)
+{
+	char *line, *nl;
+	ssize_t n;
+
+	n = read(fd, buf + *fill, size - *fill - 1);
+	if (n < 0)
+		return errno == EAGAIN || errno == EINTR ? 1 : -errno;
+	if (!n)
+		return 0;
+	*fill += n;
+	buf[*fill] = '\0';
+
+	for (line = buf; (nl = strchr(line, '\n')); line = nl + 1) {
+		*nl = '\0';
+		handle_line(pc, line);
+	}
+	*fill -= line - buf;
+	memmove(buf, line, *fill);
+	/* a line longer than the buffer is dropped */
+	if (*fill == size - 1)
+		*fill = 0;
+	return 1;
+}
+
+static void on_signal(int sig)
+{
+	(void)sig;
+	quit = 1;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  -c <index>    CRTC index (default 0)\n"
+		"  -o <file>     report file (default %s)\n"
+		"  -s <path>     report socket (default %s)\n"
+		"  -i <seconds>  report file interval (default 10)\n"
+		"  -k <[mod:]symbol>  more encoder mode set functions to\n"
+		"                count as clock retunes\n"
+		"  -r <file>     read a saved trace instead, print the report\n"
+		"  -v            print every flip\n"
+		"  -h            this help\n",
+		prog, DEFAULT_REPORT, DEFAULT_SOCKET);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *retune[MAX_RETUNE], *out = DEFAULT_REPORT;
+	const char *sock = DEFAULT_SOCKET, *replay = NULL;
+	static struct pacing pc;
+	static char buf[16384];
+	struct itimerspec its = { { 1, 0 }, { 1, 0 } };
+	struct pollfd pfd[3];
+	unsigned int nretune = 0, interval = 10, ticks = 0, i;
+	size_t fill = 0;
+	uint64_t expired;
+	int opt, fd, listen_fd, timer_fd, ret;
+
+	for (i = 0; i < sizeof(retune_default) / sizeof(retune_default[0]); i++)
+		retune[nretune++] = retune_default[i];
+
+	while ((opt = getopt(argc, argv, "c:o:s:i:k:r:vh")) != -1) {
+		switch (opt) {
+		case 'c':
+			pc.crtc = atoi(optarg);
+			break;
+		case 'o':
+			out = optarg;
+			break;
+		case 's':
+			sock = optarg;
+			break;
+		case 'i':
+			interval = strtoul(optarg, NULL, 0);
+			break;
+		case 'k':
+			if (nretune == MAX_RETUNE) {
+				fprintf(stderr, "too many -k\n");
+				return 1;
+			}
+			retune[nretune++] = optarg;
+			break;
+		case 'r':
+			replay = optarg;
+			break;
+		case 'v':
+			pc.verbose = 1;
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (!interval)
+		interval = 1;
+
+	/* offline: a trace_pipe capture, timed by its own timestamps */
+	if (replay) {
+		fd = open(replay, O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			perror(replay);
+			return 1;
+		}
+		pc.start = -1;
+		while ((ret = read_trace(&pc, fd, buf, sizeof(buf), &fill)) > 0)
+			;
+		close(fd);
+		report(stdout, &pc, pc.vbl_time);
+		return ret < 0;
+	}
+
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+	signal(SIGPIPE, SIG_IGN);
+
+	pc.start = pc.minute_start = now_sec();
+	fd = trace_setup(pc.crtc, retune, nretune);
+	if (fd < 0) {
+		trace_cleanup();
+		return 1;
+	}
+	listen_fd = listen_socket(sock);
+	timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+	if (listen_fd < 0 || timer_fd < 0 ||
+	    timerfd_settime(timer_fd, 0, &its, NULL)) {
+		trace_cleanup();
+		return 1;
+	}
+
+	fprintf(stderr, "CRTC %d, trace instance %s/instances/%s, report %s, "
+		"socket %s\n", pc.crtc, tracefs, INSTANCE, out, sock);
+
+	while (!quit) {
+		pfd[0].fd = fd;
+		pfd[0].events = POLLIN;
+		pfd[1].fd = listen_fd;
+		pfd[1].events = POLLIN;
+		pfd[2].fd = timer_fd;
+		pfd[2].events = POLLIN;
+
+		ret = poll(pfd, 3, -1);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("poll");
+			break;
+		}
+
+		if (pfd[0].revents & POLLIN) {
+			ret = read_trace(&pc, fd, buf, sizeof(buf), &fill);
+			if (ret < 0) {
+				fprintf(stderr, "trace_pipe: %s\n",
+					strerror(-ret));
+				break;
+			}
+		}
+		if (pfd[1].revents & POLLIN)
+			serve_report(&pc, listen_fd);
+		if ((pfd[2].revents & POLLIN) &&
+		    read(timer_fd, &expired, sizeof(expired)) > 0) {
+			roll_minutes(&pc, now_sec());
+			if (++ticks % interval == 0)
+				write_report(&pc, out);
+		}
+	}
+
+	write_report(&pc, out);
+	close(fd);
+	trace_cleanup();
+	close(listen_fd);
+	unlink(sock);
+	return 0;
+}
@@ -0,0 +1,381 @@
+/*
+ * pl-compositor-demo - example pl-compositor client
+ *
+ * Allocates two dumb buffers on the DRM device, exports them as dma-bufs
+ * and hands them to pl-compositor, then animates a bar across its surface.
+ * Each frame is drawn when the compositor's frame event arrives, into the
+ * buffer it has released, and only the old and the new bar positions are
+ * reported as damage. Run several with different geometries to stack
+ * surfaces; an opaque surface the size of the output is scanned out
+ * directly.
+ *
+ * Copyright (C) 2026
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <linux/dma-buf.h>
+
+#include <drm_fourcc.h>
+#include <xf86drm.h>
+
+#include "pl-compositor.h"
+
+#define NUM_BUFFERS		2
+#define BAR_WIDTH		16
+
+struct demo_buf {
+	uint32_t handle;
+	int fd;
+	uint32_t pitch;
+	uint64_t size;
+	uint8_t *map;
+	int busy;
+	int sent;
+	int bar;		/* bar position drawn in the buffer, -1 none */
+};
+
+struct demo {
+	int drm_fd;
+	int sock;
+	uint32_t width, height;
+	int x, y;
+	uint32_t z;
+	uint32_t format;
+	unsigned int cpp;
+	uint32_t color;
+	struct demo_buf bufs[NUM_BUFFERS];
+	int bar;		/* on screen */
+};
+
+static int buf_create(struct demo *d, struct demo_buf *buf)
+{
+	struct drm_mode_create_dumb create = { 0 };
+
+	create.width = d->width;
+	create.height = d->height;
+	create.bpp = d->cpp * 8;
+	if (drmIoctl(d->drm_fd, DRM_IOCTL_MODE_CREATE_DUMB, &create)) {
+		fprintf(stderr, "cannot create dumb buffer: %s\n", strerror(errno));
+		return -errno;
+	}
+	buf->handle = create.handle;
+	buf->pitch = create.pitch;
+	buf->size = create.size;
+	buf->bar = -1;
+
+	if (drmPrimeHandleToFD(d->drm_fd, buf->handle, DRM_CLOEXEC | DRM_RDWR,
+			       &buf->fd)) {
+		fprintf(stderr, "cannot export buffer: %s\n", strerror(errno));
+		return -errno;
+	}
+	buf->map = mmap(NULL, buf->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			buf->fd, 0);
+	if (buf->map == MAP_FAILED) {
+		buf->map = NULL;
+		fprintf(stderr, "cannot mmap buffer: %s\n", strerror(errno));
+		return -errno;
+	}
+
+	return 0;
+}
+
+static void buf_sync(struct demo_buf *buf, uint64_t flags)
+{
+	struct dma_buf_sync sync = { .flags = flags | DMA_BUF_SYNC_WRITE };
+
+	while (ioctl(buf->fd, DMA_BUF_IOCTL_SYNC, &sync) && errno == EINTR)
+		;
+}
+
+static void put_pixel(struct demo *d, uint8_t *p, uint32_t argb)
+{
+	if (d->cpp == 4) {
+		memcpy(p, &argb, 4);
+	} else {
+		p[0] = argb;
+		p[1] = argb >> 8;
+		p[2] = argb >> 16;
+	}
+}
+
+/* Columns [x1, x2) in the background or the bar colour */
+static void fill_columns(struct demo *d, struct demo_buf *buf, int x1, int x2,
+			 uint32_t argb)
+{
+	uint32_t y;
+	int x;
+
+	if (x1 < 0)
+		x1 = 0;
+	if (x2 > (int)d->width)
+		x2 = d->width;
+	for (y = 0; y < d->height; y++)
+		for (x = x1; x < x2; x++)
+			put_pixel(d, buf->map + y * buf->pitch + x * d->cpp, argb);
+}
+
+/* Background; premultiplied half transparent for ARGB */
+static uint32_t background(struct demo *d)
+{
+	return d->format == DRM_FORMAT_ARGB8888 ? 0x80000040 : 0xff202020;
+}
+
+static void draw(struct demo *d, struct demo_buf *buf, int bar)
+{
+	buf_sync(buf, DMA_BUF_SYNC_START);
+	if (buf->bar < 0)
+		fill_columns(d, buf, 0, d->width, background(d));
+	else
+		fill_columns(d, buf, buf->bar, buf->bar + BAR_WIDTH,
+			     background(d));
+	fill_columns(d, buf, bar, bar + BAR_WIDTH, d->color);
+	buf_sync(buf, DMA_BUF_SYNC_END);
+	buf->bar = bar;
+}
+
+static int commit(struct demo *d, unsigned int index, int bar)
+{
+	struct demo_buf *buf = &d->bufs[index];
+	struct pl_compositor_commit m = {
+		.type = PL_COMPOSITOR_COMMIT,
+		.buffer = index + 1,
+		.width = d->width,
+		.height = d->height,
+		.stride = buf->pitch,
+		.format = d->format,
+		.x = d->x,
+		.y = d->y,
+		.z = d->z,
+		.flags = PL_COMPOSITOR_WANT_FRAME,
+	};
+	union {
+		char buf[CMSG_SPACE(sizeof(int))];
+		struct cmsghdr align;
+	} ctrl;
+	struct iovec iov = { &m, sizeof(m) };
+	struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1 };
+	struct cmsghdr *cmsg;
+
+	/* The bar moved from d->bar to bar; the first commit damages all */
+	if (d->bar >= 0) {
+		m.ndamage = 2;
+		m.damage[0] = (struct pl_compositor_rect){ d->bar, 0, BAR_WIDTH,
+							   d->height };
+		m.damage[1] = (struct pl_compositor_rect){ bar, 0, BAR_WIDTH,
+							   d->height };
+	}
+
+	if (!buf->sent) {
+		msg.msg_control = ctrl.buf;
+		msg.msg_controllen = sizeof(ctrl.buf);
+		cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(cmsg), &buf->fd, sizeof(int));
+	}
+
+	if (sendmsg(d->sock, &msg, MSG_NOSIGNAL) < 0) {
+		fprintf(stderr, "cannot commit: %s\n", strerror(errno));
+		return -errno;
+	}
+	buf->sent = 1;
+	buf->busy = 1;
+	d->bar = bar;
+
+	return 0;
+}
+
+static int connect_socket(const char *path)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	int fd;
+
+	if (strlen(path) >= sizeof(addr.sun_path))
+		return -ENAMETOOLONG;
+	strcpy(addr.sun_path, path);
+
+	fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		return -errno;
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+		fprintf(stderr, "cannot connect to %s: %s\n", path,
+			strerror(errno));
+		close(fd);
+		return -errno;
+	}
+
+	return fd;
+}
+
+static double now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  -D <device>   DRM device to allocate from (default /dev/dri/card0)\n"
+		"  -s <path>     compositor socket (default %s)\n"
+		"  -g <WxH+X+Y>  surface geometry (default 320x240+0+0)\n"
+		"  -z <z>        stacking order, higher on top (default 0)\n"
+		"  -f <format>   AR24, XR24 or RG24 (default AR24)\n"
+		"  -c <rgb>      bar colour (default 0xffff00)\n"
+		"  -n <frames>   frames to draw, 0 for ever (default 0)\n"
+		"  -h            this help\n",
+		prog, PL_COMPOSITOR_SOCKET);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *device = "/dev/dri/card0";
+	const char *sock = PL_COMPOSITOR_SOCKET;
+	struct demo d = {
+		.width = 320,
+		.height = 240,
+		.format = DRM_FORMAT_ARGB8888,
+		.cpp = 4,
+		.color = 0xffffff00,
+		.bar = -1,
+	};
+	struct pl_compositor_event ev;
+	struct pollfd pfd;
+	unsigned long frames = 0, limit = 0;
+	unsigned int i, next = 0;
+	int opt, pending = 0, bar = 0, step = 4;
+	double start;
+
+	while ((opt = getopt(argc, argv, "D:s:g:z:f:c:n:h")) != -1) {
+		switch (opt) {
+		case 'D':
+			device = optarg;
+			break;
+		case 's':
+			sock = optarg;
+			break;
+		case 'g':
+			if (sscanf(optarg, "%ux%u+%d+%d", &d.width, &d.height,
+				   &d.x, &d.y) < 2) {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'z':
+			d.z = strtoul(optarg, NULL, 0);
+			break;
+		case 'f':
+			if (!strcmp(optarg, "XR24")) {
+				d.format = DRM_FORMAT_XRGB8888;
+			} else if (!strcmp(optarg, "RG24")) {
+				d.format = DRM_FORMAT_RGB888;
+				d.cpp = 3;
+			} else if (strcmp(optarg, "AR24")) {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'c':
+			d.color = 0xff000000 | strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			limit = strtoul(optarg, NULL, 0);
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (d.width < BAR_WIDTH || !d.height) {
+		fprintf(stderr, "surface too small\n");
+		return 1;
+	}
+
+	d.drm_fd = open(device, O_RDWR | O_CLOEXEC);
+	if (d.drm_fd < 0) {
+		fprintf(stderr, "cannot open %s: %s\n", device, strerror(errno));
+		return 1;
+	}
+	for (i = 0; i < NUM_BUFFERS; i++)
+		if (buf_create(&d, &d.bufs[i]))
+			return 1;
+
+	d.sock = connect_socket(sock);
+	if (d.sock < 0)
+		return 1;
+
+	start = now_sec();
+	draw(&d, &d.bufs[next], bar);
+	if (commit(&d, next, bar))
+		return 1;
+	pending = 1;
+
+	pfd.fd = d.sock;
+	pfd.events = POLLIN;
+	while (!limit || frames < limit) {
+		if (poll(&pfd, 1, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		if (recv(d.sock, &ev, sizeof(ev), 0) != sizeof(ev)) {
+			fprintf(stderr, "compositor went away\n");
+			break;
+		}
+
+		if (ev.type == PL_COMPOSITOR_RELEASE && ev.buffer &&
+		    ev.buffer <= NUM_BUFFERS) {
+			d.bufs[ev.buffer - 1].busy = 0;
+		} else if (ev.type == PL_COMPOSITOR_FRAME) {
+			pending = 0;
+			frames++;
+		}
+
+		/* Next frame once the last one is shown and a buffer is free */
+		i = (next + 1) % NUM_BUFFERS;
+		if (pending || d.bufs[i].busy)
+			continue;
+		next = i;
+
+		if (bar + step < 0 || bar + step + BAR_WIDTH > (int)d.width)
+			step = -step;
+		bar += step;
+		draw(&d, &d.bufs[next], bar);
+		if (commit(&d, next, bar))
+			break;
+		pending = 1;
+	}
+
+	fprintf(stderr, "%lu frames, %.1f fps\n", frames,
+		frames / (now_sec() - start));
+
+	close(d.sock);
+	for (i = 0; i < NUM_BUFFERS; i++) {
+		munmap(d.bufs[i].map, d.bufs[i].size);
+		close(d.bufs[i].fd);
+	}
+	close(d.drm_fd);
+	return 0;
+}
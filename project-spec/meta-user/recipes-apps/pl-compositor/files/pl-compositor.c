@@ -0,0 +1,1452 @@
+/*
+ * pl-compositor - small KMS compositor for the PL display
+ *
+ * Clients hand over dma-buf buffers on a UNIX socket (pl-compositor.h).
+ * Each output frame is built in a cacheable shadow buffer, where only the
+ * damaged rectangles are redrawn: the topmost opaque surface covering a
+ * tile is copied and the surfaces above it are blended, split into row
+ * tiles across one worker per CPU, with the libplpixel kernels. The damage of
+ * this frame and of the previous one is then copied into the back scanout
+ * buffer and flipped with FB_DAMAGE_CLIPS, so the display driver only
+ * cleans those lines of a cached buffer.
+ *
+ * When the top surface is opaque, covers the whole output and is in a
+ * format the primary plane takes, its buffer is flipped to the plane
+ * directly and nothing is composited.
+ *
+ * Repaints are driven by page flip events: damage collected while a flip
+ * is pending is drawn when its event arrives, at the vblank of the PL
+ * timing controller, and frame events go back to the clients at the same
+ * time. Works with any atomic KMS driver, vkms included.
+ *
+ * Copyright (C) 2026
+ * SPDX-License-Identifier: MIT
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <linux/dma-buf.h>
+
+#include <drm_fourcc.h>
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+#include <plpixel.h>
+
+#include "pl-compositor.h"
+
+#define MAX_CLIENTS		16
+#define MAX_DAMAGE		16
+#define MAX_WORKERS		4
+#define TILE_ROWS		32
+#define BACKGROUND		0xff000000
+
+struct rect {
+	int x1, y1, x2, y2;
+};
+
+struct region {
+	unsigned int n;
+	struct rect r[MAX_DAMAGE];
+};
+
+struct comp_props {
+	uint32_t crtc_active;
+	uint32_t crtc_mode_id;
+	uint32_t conn_crtc_id;
+	uint32_t plane_fb_id;
+	uint32_t plane_crtc_id;
+	uint32_t plane_src_x, plane_src_y, plane_src_w, plane_src_h;
+	uint32_t plane_crtc_x, plane_crtc_y, plane_crtc_w, plane_crtc_h;
+	uint32_t plane_damage;
+};
+
+/* Compositor owned scanout buffer */
+struct comp_buf {
+	uint32_t handle;
+	uint32_t fb_id;
+	uint32_t pitch;
+	uint64_t size;
+	uint8_t *map;
+	struct pl_image img;
+};
+
+struct client;
+
+/* A client buffer, imported once and kept until the client goes away */
+struct client_buf {
+	struct client_buf *next;
+	struct client *owner;
+	uint32_t id;
+	int fd;
+	uint8_t *map;
+	size_t size;
+	uint32_t width, height, stride, format;
+	struct pl_image img;
+	uint32_t handle, fb_id;		/* direct scanout */
+	int no_scanout;
+	int release;			/* replaced while on screen */
+};
+
+struct client {
+	int fd;
+	struct client_buf *bufs;
+	struct client_buf *cur;
+	int x, y;
+	uint32_t z;
+	int mapped;
+	int frame_wanted;		/* committed, not repainted yet */
+	int frame_queued;		/* in the pending flip */
+};
+
+struct comp;
+
+typedef void (*job_fn)(struct comp *c, unsigned int part, unsigned int nparts);
+
+struct pool {
+	pthread_t threads[MAX_WORKERS];
+	unsigned int nthreads;
+	pthread_mutex_t lock;
+	pthread_cond_t start, done;
+	unsigned int generation;
+	unsigned int busy;
+	job_fn fn;
+	int quit;
+};
+
+struct comp {
+	int fd;
+	uint32_t conn_id;
+	uint32_t crtc_id;
+	uint32_t plane_id;
+	drmModePlane *plane;
+	drmModeModeInfo mode;
+	struct comp_props props;
+	uint32_t format;
+	unsigned int cpp;
+	int width, height;
+
+	struct comp_buf scanout[2];
+	int back;
+	uint32_t *shadow;
+	struct pl_image shadow_img;
+
+	struct region damage;		/* to redraw in the shadow */
+	struct region prev;		/* redrawn for the back buffer's last frame */
+	const struct region *job;
+	int full;
+	int flip_pending;
+	struct client_buf *on_screen;	/* bypass buffer being scanned out */
+	struct client_buf *flip_buf;	/* bypass buffer of the pending flip */
+	struct client_buf *zombies;	/* of gone clients, still on screen */
+
+	int listen_fd;
+	struct client *clients[MAX_CLIENTS];
+	unsigned int nclients;
+	struct client *order[MAX_CLIENTS];	/* visible, bottom to top */
+	unsigned int norder;
+
+	struct pool pool;
+	unsigned long frames, bypassed;
+	int verbose;
+};
+
+static volatile sig_atomic_t quit;
+
+/* Rectangles and regions */
+
+static int rect_empty(const struct rect *r)
+{
+	return r->x1 >= r->x2 || r->y1 >= r->y2;
+}
+
+static struct rect rect_intersect(const struct rect *a, const struct rect *b)
+{
+	struct rect r = {
+		a->x1 > b->x1 ? a->x1 : b->x1, a->y1 > b->y1 ? a->y1 : b->y1,
+		a->x2 < b->x2 ? a->x2 : b->x2, a->y2 < b->y2 ? a->y2 : b->y2,
+	};
+
+	return r;
+}
+
+static int rect_contains(const struct rect *a, const struct rect *b)
+{
+	return b->x1 >= a->x1 && b->y1 >= a->y1 &&
+	       b->x2 <= a->x2 && b->y2 <= a->y2;
+}
+
+static void rect_union(struct rect *a, const struct rect *b)
+{
+	if (b->x1 < a->x1)
+		a->x1 = b->x1;
+	if (b->y1 < a->y1)
+		a->y1 = b->y1;
+	if (b->x2 > a->x2)
+		a->x2 = b->x2;
+	if (b->y2 > a->y2)
+		a->y2 = b->y2;
+}
+
+/*
+ * Add r clipped to the output. Rectangles already covered are dropped and
+ * a full region collapses to its bounding box, which keeps the tile loops
+ * short when a client reports many small rectangles.
+ */
+static void region_add(struct comp *c, struct region *reg, struct rect r)
+{
+	struct rect out = { 0, 0, c->width, c->height };
+	unsigned int i;
+
+	r = rect_intersect(&r, &out);
+	if (rect_empty(&r))
+		return;
+
+	for (i = 0; i < reg->n; i++) {
+		if (rect_contains(&reg->r[i], &r))
+			return;
+		if (rect_contains(&r, &reg->r[i]))
+			reg->r[i--] = reg->r[--reg->n];
+	}
+
+	if (reg->n == MAX_DAMAGE) {
+		for (i = 1; i < reg->n; i++)
+			rect_union(&reg->r[0], &reg->r[i]);
+		rect_union(&reg->r[0], &r);
+		reg->n = 1;
+		return;
+	}
+	reg->r[reg->n++] = r;
+}
+
+static struct rect client_rect(const struct client *cl)
+{
+	struct rect r = {
+		cl->x, cl->y,
+		cl->x + (int)cl->cur->width, cl->y + (int)cl->cur->height,
+	};
+
+	return r;
+}
+
+static int client_opaque(const struct client *cl)
+{
+	return cl->cur->format != DRM_FORMAT_ARGB8888;
+}
+
+/* Compositing, run on every worker for its share of the tiles */
+
+static void compose_tile(struct comp *c, const struct rect *tile)
+{
+	unsigned int i, start = 0;
+	int base = 0;
+
+	/* Nothing below an opaque surface covering the tile is visible */
+	for (i = c->norder; i-- > 0;) {
+		struct client *cl = c->order[i];
+		struct rect r = client_rect(cl);
+
+		if (client_opaque(cl) && rect_contains(&r, tile)) {
+			start = i;
+			base = 1;
+			break;
+		}
+	}
+
+	if (!base)
+		pl_fill(&c->shadow_img, tile->x1, tile->y1, tile->x2 - tile->x1,
+			tile->y2 - tile->y1, BACKGROUND);
+
+	/* opaque formats are converted, ARGB is blended */
+	for (i = start; i < c->norder; i++) {
+		struct client *cl = c->order[i];
+		struct rect r = client_rect(cl);
+
+		r = rect_intersect(&r, tile);
+		if (rect_empty(&r))
+			continue;
+
+		pl_blend(&c->shadow_img, r.x1, r.y1, &cl->cur->img,
+			 r.x1 - cl->x, r.y1 - cl->y, r.x2 - r.x1, r.y2 - r.y1);
+	}
+}
+
+static void copy_tile(struct comp *c, const struct rect *tile)
+{
+	pl_convert(&c->scanout[c->back].img, tile->x1, tile->y1, &c->shadow_img,
+		   tile->x1, tile->y1, tile->x2 - tile->x1, tile->y2 - tile->y1);
+}
+
+/* Tiles of TILE_ROWS lines are dealt round robin over the workers */
+static void for_each_tile(struct comp *c, unsigned int part,
+			  unsigned int nparts,
+			  void (*fn)(struct comp *c, const struct rect *tile))
+{
+	const struct region *reg = c->job;
+	unsigned int i, n = 0;
+	struct rect tile;
+
+	for (i = 0; i < reg->n; i++) {
+		tile = reg->r[i];
+		for (tile.y1 = reg->r[i].y1; tile.y1 < reg->r[i].y2;
+		     tile.y1 += TILE_ROWS) {
+			if (n++ % nparts != part)
+				continue;
+			tile.y2 = tile.y1 + TILE_ROWS;
+			if (tile.y2 > reg->r[i].y2)
+				tile.y2 = reg->r[i].y2;
+			fn(c, &tile);
+		}
+	}
+}
+
+static void compose_job(struct comp *c, unsigned int part, unsigned int nparts)
+{
+	for_each_tile(c, part, nparts, compose_tile);
+}
+
+static void copy_job(struct comp *c, unsigned int part, unsigned int nparts)
+{
+	for_each_tile(c, part, nparts, copy_tile);
+}
+
+/* Worker pool; the calling thread takes part 0 */
+
+struct worker_arg {
+	struct comp *c;
+	unsigned int part;
+};
+
+static void *worker(void *data)
+{
+	struct worker_arg *arg = data;
+	struct comp *c = arg->c;
+	struct pool *p = &c->pool;
+	unsigned int part = arg->part, seen = 0;
+
+	free(arg);
+
+	for (;;) {
+		pthread_mutex_lock(&p->lock);
+		while (p->generation == seen && !p->quit)
+			pthread_cond_wait(&p->start, &p->lock);
+		if (p->quit) {
+			pthread_mutex_unlock(&p->lock);
+			return NULL;
+		}
+		seen = p->generation;
+		pthread_mutex_unlock(&p->lock);
+
+		p->fn(c, part, p->nthreads + 1);
+
+		pthread_mutex_lock(&p->lock);
+		if (!--p->busy)
+			pthread_cond_signal(&p->done);
+		pthread_mutex_unlock(&p->lock);
+	}
+}
+
+static void pool_run(struct comp *c, job_fn fn)
+{
+	struct pool *p = &c->pool;
+
+	if (!p->nthreads) {
+		fn(c, 0, 1);
+		return;
+	}
+
+	pthread_mutex_lock(&p->lock);
+	p->fn = fn;
+	p->busy = p->nthreads;
+	p->generation++;
+	pthread_cond_broadcast(&p->start);
+	pthread_mutex_unlock(&p->lock);
+
+	fn(c, 0, p->nthreads + 1);
+
+	pthread_mutex_lock(&p->lock);
+	while (p->busy)
+		pthread_cond_wait(&p->done, &p->lock);
+	pthread_mutex_unlock(&p->lock);
+}
+
+static int pool_init(struct comp *c, unsigned int nthreads)
+{
+	struct pool *p = &c->pool;
+	struct worker_arg *arg;
+	unsigned int i;
+
+	pthread_mutex_init(&p->lock, NULL);
+	pthread_cond_init(&p->start, NULL);
+	pthread_cond_init(&p->done, NULL);
+
+	for (i = 0; i < nthreads && i < MAX_WORKERS; i++) {
+		arg = malloc(sizeof(*arg));
+		if (!arg)
+			return -ENOMEM;
+		arg->c = c;
+		arg->part = i + 1;
+		if (pthread_create(&p->threads[i], NULL, worker, arg)) {
+			free(arg);
+			return -errno;
+		}
+		p->nthreads++;
+	}
+
+	return 0;
+}
+
+static void pool_fini(struct comp *c)
+{
+	struct pool *p = &c->pool;
+	unsigned int i;
+
+	pthread_mutex_lock(&p->lock);
+	p->quit = 1;
+	pthread_cond_broadcast(&p->start);
+	pthread_mutex_unlock(&p->lock);
+
+	for (i = 0; i < p->nthreads; i++)
+		pthread_join(p->threads[i], NULL);
+}
+
+/* KMS */
+
+static uint32_t prop_id(int fd, uint32_t obj_id, uint32_t obj_type,
+			const char *name)
+{
+	drmModeObjectProperties *props;
+	drmModePropertyRes *prop;
+	uint32_t id = 0, i;
+
+	props = drmModeObjectGetProperties(fd, obj_id, obj_type);
+	if (!props)
+		return 0;
+
+	for (i = 0; i < props->count_props && !id; i++) {
+		prop = drmModeGetProperty(fd, props->props[i]);
+		if (!prop)
+			continue;
+		if (!strcmp(prop->name, name))
+			id = prop->prop_id;
+		drmModeFreeProperty(prop);
+	}
+	drmModeFreeObjectProperties(props);
+
+	return id;
+}
+
+static uint64_t prop_value(int fd, uint32_t obj_id, uint32_t obj_type,
+			   const char *name)
+{
+	drmModeObjectProperties *props;
+	drmModePropertyRes *prop;
+	uint64_t val = 0;
+	uint32_t i;
+
+	props = drmModeObjectGetProperties(fd, obj_id, obj_type);
+	if (!props)
+		return 0;
+
+	for (i = 0; i < props->count_props; i++) {
+		prop = drmModeGetProperty(fd, props->props[i]);
+		if (!prop)
+			continue;
+		if (!strcmp(prop->name, name))
+			val = props->prop_values[i];
+		drmModeFreeProperty(prop);
+	}
+	drmModeFreeObjectProperties(props);
+
+	return val;
+}
+
+static int find_props(struct comp *c)
+{
+	struct comp_props *p = &c->props;
+	int fd = c->fd;
+
+	p->crtc_active = prop_id(fd, c->crtc_id, DRM_MODE_OBJECT_CRTC, "ACTIVE");
+	p->crtc_mode_id = prop_id(fd, c->crtc_id, DRM_MODE_OBJECT_CRTC, "MODE_ID");
+	p->conn_crtc_id = prop_id(fd, c->conn_id, DRM_MODE_OBJECT_CONNECTOR,
+				  "CRTC_ID");
+	p->plane_fb_id = prop_id(fd, c->plane_id, DRM_MODE_OBJECT_PLANE, "FB_ID");
+	p->plane_crtc_id = prop_id(fd, c->plane_id, DRM_MODE_OBJECT_PLANE,
+				   "CRTC_ID");
+	p->plane_src_x = prop_id(fd, c->plane_id, DRM_MODE_OBJECT_PLANE, "SRC_X");
+	p->plane_src_y = prop_id(fd, c->plane_id, DRM_MODE_OBJECT_PLANE, "SRC_Y");
+	p->plane_src_w = prop_id(fd, c->plane_id, DRM_MODE_OBJECT_PLANE, "SRC_W");
+	p->plane_src_h = prop_id(fd, c->plane_id, DRM_MODE_OBJECT_PLANE, "SRC_H");
+	p->plane_crtc_x = prop_id(fd, c->plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_X");
+	p->plane_crtc_y = prop_id(fd, c->plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_Y");
+	p->plane_crtc_w = prop_id(fd, c->plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_W");
+	p->plane_crtc_h = prop_id(fd, c->plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_H");
+	/* optional, the whole buffer is synced without it */
+	p->plane_damage = prop_id(fd, c->plane_id, DRM_MODE_OBJECT_PLANE,
+				  "FB_DAMAGE_CLIPS");
+
+	if (!p->crtc_active || !p->crtc_mode_id || !p->conn_crtc_id ||
+	    !p->plane_fb_id || !p->plane_crtc_id || !p->plane_crtc_h) {
+		fprintf(stderr, "missing atomic properties\n");
+		return -ENOENT;
+	}
+
+	return 0;
+}
+
+/* The primary plane that can feed the CRTC */
+static int find_plane(struct comp *c, int crtc_index)
+{
+	drmModePlaneRes *res;
+	drmModePlane *plane;
+	uint32_t i;
+
+	res = drmModeGetPlaneResources(c->fd);
+	if (!res) {
+		fprintf(stderr, "cannot get planes: %s\n", strerror(errno));
+		return -errno;
+	}
+
+	for (i = 0; i < res->count_planes && !c->plane; i++) {
+		plane = drmModeGetPlane(c->fd, res->planes[i]);
+		if (!plane)
+			continue;
+		if ((plane->possible_crtcs & (1 << crtc_index)) &&
+		    prop_value(c->fd, plane->plane_id, DRM_MODE_OBJECT_PLANE,
+			       "type") == DRM_PLANE_TYPE_PRIMARY) {
+			c->plane = plane;
+			c->plane_id = plane->plane_id;
+		} else {
+			drmModeFreePlane(plane);
+		}
+	}
+	drmModeFreePlaneResources(res);
+
+	if (!c->plane) {
+		fprintf(stderr, "no primary plane for CRTC %u\n", c->crtc_id);
+		return -ENODEV;
+	}
+
+	return 0;
+}
+
+static int plane_has_format(struct comp *c, uint32_t fourcc)
+{
+	uint32_t i;
+
+	for (i = 0; i < c->plane->count_formats; i++)
+		if (c->plane->formats[i] == fourcc)
+			return 1;
+	return 0;
+}
+
+/* Connected connector, its CRTC and primary plane, and the mode to use */
+static int dev_open(struct comp *c, const char *path, const char *mode_spec)
+{
+	drmModeRes *res;
+	drmModeConnector *conn = NULL;
+	drmModeEncoder *enc;
+	uint64_t cap;
+	char name[32];
+	int i, crtc_index = -1, found = 0;
+
+	c->fd = open(path, O_RDWR | O_CLOEXEC);
+	if (c->fd < 0) {
+		fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+		return -errno;
+	}
+
+	if (drmGetCap(c->fd, DRM_CAP_DUMB_BUFFER, &cap) || !cap) {
+		fprintf(stderr, "%s does not support dumb buffers\n", path);
+		return -EOPNOTSUPP;
+	}
+	if (drmSetClientCap(c->fd, DRM_CLIENT_CAP_UNIVERSAL_PLANES, 1) ||
+	    drmSetClientCap(c->fd, DRM_CLIENT_CAP_ATOMIC, 1)) {
+		fprintf(stderr, "%s does not support atomic modesetting\n", path);
+		return -EOPNOTSUPP;
+	}
+
+	res = drmModeGetResources(c->fd);
+	if (!res) {
+		fprintf(stderr, "cannot get DRM resources: %s\n", strerror(errno));
+		return -errno;
+	}
+
+	for (i = 0; i < res->count_connectors; i++) {
+		conn = drmModeGetConnector(c->fd, res->connectors[i]);
+		if (conn && conn->connection == DRM_MODE_CONNECTED &&
+		    conn->count_modes)
+			break;
+		drmModeFreeConnector(conn);
+		conn = NULL;
+	}
+	if (!conn) {
+		fprintf(stderr, "no connected connector\n");
+		drmModeFreeResources(res);
+		return -ENODEV;
+	}
+	c->conn_id = conn->connector_id;
+
+	/* The preferred mode unless one is asked for */
+	c->mode = conn->modes[0];
+	for (i = 0; i < conn->count_modes; i++) {
+		const drmModeModeInfo *m = &conn->modes[i];
+
+		if (mode_spec) {
+			snprintf(name, sizeof(name), "%ux%u@%u", m->hdisplay,
+				 m->vdisplay, m->vrefresh);
+			if (strcmp(mode_spec, m->name) && strcmp(mode_spec, name))
+				continue;
+		} else if (!(m->type & DRM_MODE_TYPE_PREFERRED)) {
+			continue;
+		}
+		c->mode = *m;
+		found = 1;
+		break;
+	}
+	if (mode_spec && !found) {
+		fprintf(stderr, "no mode %s\n", mode_spec);
+		drmModeFreeConnector(conn);
+		drmModeFreeResources(res);
+		return -EINVAL;
+	}
+	c->width = c->mode.hdisplay;
+	c->height = c->mode.vdisplay;
+
+	enc = conn->encoder_id ? drmModeGetEncoder(c->fd, conn->encoder_id) : NULL;
+	if (enc) {
+		c->crtc_id = enc->crtc_id;
+		drmModeFreeEncoder(enc);
+	}
+	drmModeFreeConnector(conn);
+	if (!c->crtc_id && res->count_crtcs)
+		c->crtc_id = res->crtcs[0];
+	for (i = 0; i < res->count_crtcs; i++)
+		if (res->crtcs[i] == c->crtc_id)
+			crtc_index = i;
+	drmModeFreeResources(res);
+
+	if (crtc_index < 0) {
+		fprintf(stderr, "no CRTC available\n");
+		return -ENODEV;
+	}
+
+	if (find_plane(c, crtc_index))
+		return -ENODEV;
+
+	return find_props(c);
+}
+
+static void buf_destroy(struct comp *c, struct comp_buf *buf)
+{
+	struct drm_mode_destroy_dumb destroy = { .handle = buf->handle };
+
+	if (buf->map)
+		munmap(buf->map, buf->size);
+	if (buf->fb_id)
+		drmModeRmFB(c->fd, buf->fb_id);
+	if (buf->handle)
+		drmIoctl(c->fd, DRM_IOCTL_MODE_DESTROY_DUMB, &destroy);
+	memset(buf, 0, sizeof(*buf));
+}
+
+static int buf_create(struct comp *c, struct comp_buf *buf)
+{
+	struct drm_mode_create_dumb create = { 0 };
+	struct drm_mode_map_dumb map = { 0 };
+	uint32_t handles[4] = { 0 }, pitches[4] = { 0 }, offsets[4] = { 0 };
+	int ret;
+
+	create.width = c->width;
+	create.height = c->height;
+	create.bpp = c->cpp * 8;
+	if (drmIoctl(c->fd, DRM_IOCTL_MODE_CREATE_DUMB, &create)) {
+		ret = -errno;
+		fprintf(stderr, "cannot create dumb buffer: %s\n", strerror(errno));
+		return ret;
+	}
+	buf->handle = create.handle;
+	buf->pitch = create.pitch;
+	buf->size = create.size;
+
+	handles[0] = buf->handle;
+	pitches[0] = buf->pitch;
+	if (drmModeAddFB2(c->fd, c->width, c->height, c->format, handles,
+			  pitches, offsets, &buf->fb_id, 0)) {
+		ret = -errno;
+		fprintf(stderr, "cannot add framebuffer: %s\n", strerror(errno));
+		goto err;
+	}
+
+	map.handle = buf->handle;
+	if (drmIoctl(c->fd, DRM_IOCTL_MODE_MAP_DUMB, &map)) {
+		ret = -errno;
+		fprintf(stderr, "cannot map dumb buffer: %s\n", strerror(errno));
+		goto err;
+	}
+	buf->map = mmap(NULL, buf->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			c->fd, map.offset);
+	if (buf->map == MAP_FAILED) {
+		buf->map = NULL;
+		ret = -errno;
+		fprintf(stderr, "cannot mmap dumb buffer: %s\n", strerror(errno));
+		goto err;
+	}
+	memset(buf->map, 0, buf->size);
+	pl_image_init(&buf->img, c->format, c->width, c->height, buf->map,
+		      buf->pitch);
+
+	return 0;
+
+err:
+	buf_destroy(c, buf);
+	return ret;
+}
+
+/* Put fb_id on the primary plane, with a modeset for the first frame */
+static int commit_fb(struct comp *c, uint32_t fb_id, const struct region *damage,
+		     int modeset)
+{
+	const struct comp_props *p = &c->props;
+	struct drm_mode_rect clips[MAX_DAMAGE];
+	drmModeAtomicReq *req;
+	uint32_t mode_blob = 0, damage_blob = 0, flags;
+	unsigned int i;
+	int ret;
+
+	req = drmModeAtomicAlloc();
+	if (!req)
+		return -ENOMEM;
+
+	if (modeset) {
+		if (drmModeCreatePropertyBlob(c->fd, &c->mode, sizeof(c->mode),
+					      &mode_blob)) {
+			ret = -errno;
+			goto out;
+		}
+		drmModeAtomicAddProperty(req, c->crtc_id, p->crtc_active, 1);
+		drmModeAtomicAddProperty(req, c->crtc_id, p->crtc_mode_id,
+					 mode_blob);
+		drmModeAtomicAddProperty(req, c->conn_id, p->conn_crtc_id,
+					 c->crtc_id);
+		drmModeAtomicAddProperty(req, c->plane_id, p->plane_crtc_id,
+					 c->crtc_id);
+		drmModeAtomicAddProperty(req, c->plane_id, p->plane_src_x, 0);
+		drmModeAtomicAddProperty(req, c->plane_id, p->plane_src_y, 0);
+		drmModeAtomicAddProperty(req, c->plane_id, p->plane_src_w,
+					 (uint64_t)c->width << 16);
+		drmModeAtomicAddProperty(req, c->plane_id, p->plane_src_h,
+					 (uint64_t)c->height << 16);
+		drmModeAtomicAddProperty(req, c->plane_id, p->plane_crtc_x, 0);
+		drmModeAtomicAddProperty(req, c->plane_id, p->plane_crtc_y, 0);
+		drmModeAtomicAddProperty(req, c->plane_id, p->plane_crtc_w,
+					 c->width);
+		drmModeAtomicAddProperty(req, c->plane_id, p->plane_crtc_h,
+					 c->height);
+	}
+	drmModeAtomicAddProperty(req, c->plane_id, p->plane_fb_id, fb_id);
+
+	if (p->plane_damage && damage && damage->n) {
+		for (i = 0; i < damage->n; i++) {
+			clips[i].x1 = damage->r[i].x1;
+			clips[i].y1 = damage->r[i].y1;
+			clips[i].x2 = damage->r[i].x2;
+			clips[i].y2 = damage->r[i].y2;
+		}
+		if (!drmModeCreatePropertyBlob(c->fd, clips,
+					       damage->n * sizeof(clips[0]),
+					       &damage_blob))
+			drmModeAtomicAddProperty(req, c->plane_id,
+						 p->plane_damage, damage_blob);
+	}
+
+	flags = modeset ? DRM_MODE_ATOMIC_ALLOW_MODESET :
+		DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT;
+	ret = drmModeAtomicCommit(c->fd, req, flags, c) ? -errno : 0;
+	if (!ret && !modeset)
+		c->flip_pending = 1;
+out:
+	drmModeAtomicFree(req);
+	if (mode_blob)
+		drmModeDestroyPropertyBlob(c->fd, mode_blob);
+	if (damage_blob)
+		drmModeDestroyPropertyBlob(c->fd, damage_blob);
+	return ret;
+}
+
+/* Clients */
+
+static void send_event(struct client *cl, uint32_t type, uint32_t buffer,
+		       unsigned int sequence, unsigned int sec, unsigned int usec)
+{
+	struct pl_compositor_event ev = {
+		.type = type,
+		.buffer = buffer,
+		.sequence = sequence,
+		.tv_sec = sec,
+		.tv_usec = usec,
+	};
+
+	/* a client that hung up is dropped when its socket is read */
+	if (cl && send(cl->fd, &ev, sizeof(ev), MSG_DONTWAIT | MSG_NOSIGNAL) < 0 &&
+	    errno != EAGAIN && errno != EPIPE && errno != ECONNRESET)
+		fprintf(stderr, "client %d: %s\n", cl->fd, strerror(errno));
+}
+
+static void cbuf_free(struct comp *c, struct client_buf *b)
+{
+	if (b->fb_id)
+		drmModeRmFB(c->fd, b->fb_id);
+	if (b->handle)
+		drmCloseBufferHandle(c->fd, b->handle);
+	if (b->map)
+		munmap(b->map, b->size);
+	close(b->fd);
+	free(b);
+}
+
+static void cbuf_sync(struct client_buf *b, uint64_t flags)
+{
+	struct dma_buf_sync sync = { .flags = flags | DMA_BUF_SYNC_READ };
+
+	while (ioctl(b->fd, DMA_BUF_IOCTL_SYNC, &sync) && errno == EINTR)
+		;
+}
+
+static struct client_buf *cbuf_import(struct client *cl,
+				      const struct pl_compositor_commit *m,
+				      int fd)
+{
+	struct client_buf *b;
+	unsigned int cpp;
+	off_t size;
+
+	switch (m->format) {
+	case DRM_FORMAT_ARGB8888:
+	case DRM_FORMAT_XRGB8888:
+		cpp = 4;
+		break;
+	case DRM_FORMAT_RGB888:
+		cpp = 3;
+		break;
+	default:
+		fprintf(stderr, "client %d: unsupported format %.4s\n", cl->fd,
+			(const char *)&m->format);
+		return NULL;
+	}
+
+	size = lseek(fd, 0, SEEK_END);
+	if (!m->width || !m->height || m->stride < m->width * cpp ||
+	    size < (off_t)m->stride * m->height) {
+		fprintf(stderr, "client %d: bad buffer %ux%u stride %u\n",
+			cl->fd, m->width, m->height, m->stride);
+		return NULL;
+	}
+
+	b = calloc(1, sizeof(*b));
+	if (!b)
+		return NULL;
+	b->owner = cl;
+	b->id = m->buffer;
+	b->fd = fd;
+	b->size = size;
+	b->width = m->width;
+	b->height = m->height;
+	b->stride = m->stride;
+	b->format = m->format;
+	b->map = mmap(NULL, b->size, PROT_READ, MAP_SHARED, fd, 0);
+	if (b->map == MAP_FAILED) {
+		fprintf(stderr, "client %d: cannot mmap buffer: %s\n", cl->fd,
+			strerror(errno));
+		free(b);
+		return NULL;
+	}
+	pl_image_init(&b->img, b->format, b->width, b->height, b->map,
+		      b->stride);
+
+	b->next = cl->bufs;
+	cl->bufs = b;
+	return b;
+}
+
+/* The buffer is replaced: hand it back now unless it is still on screen */
+static void cbuf_retire(struct comp *c, struct client_buf *b)
+{
+	if (b == c->on_screen || b == c->flip_buf)
+		b->release = 1;
+	else
+		send_event(b->owner, PL_COMPOSITOR_RELEASE, b->id, 0, 0, 0);
+}
+
+static int cmp_z(const void *a, const void *b)
+{
+	const struct client *x = *(struct client *const *)a;
+	const struct client *y = *(struct client *const *)b;
+
+	return x->z < y->z ? -1 : x->z > y->z;
+}
+
+static void update_order(struct comp *c)
+{
+	unsigned int i;
+
+	c->norder = 0;
+	for (i = 0; i < c->nclients; i++)
+		if (c->clients[i]->mapped)
+			c->order[c->norder++] = c->clients[i];
+	qsort(c->order, c->norder, sizeof(c->order[0]), cmp_z);
+}
+
+static void damage_client(struct comp *c, struct client *cl)
+{
+	if (cl->mapped)
+		region_add(c, &c->damage, client_rect(cl));
+}
+
+static void handle_commit(struct comp *c, struct client *cl,
+			  const struct pl_compositor_commit *m, int fd)
+{
+	struct client_buf *b;
+	unsigned int i, n;
+
+	for (b = cl->bufs; b; b = b->next)
+		if (b->id == m->buffer)
+			break;
+
+	if (fd >= 0) {
+		if (b || !m->buffer) {
+			fprintf(stderr, "client %d: buffer %u sent twice\n",
+				cl->fd, m->buffer);
+			close(fd);
+			return;
+		}
+		b = cbuf_import(cl, m, fd);
+		if (!b) {
+			close(fd);
+			return;
+		}
+	} else if (!b) {
+		fprintf(stderr, "client %d: unknown buffer %u\n", cl->fd,
+			m->buffer);
+		return;
+	}
+
+	if (cl->cur && cl->cur != b)
+		cbuf_retire(c, cl->cur);
+
+	if (!cl->cur || cl->cur != b || cl->x != m->x || cl->y != m->y ||
+	    cl->z != m->z || cl->mapped != !(m->flags & PL_COMPOSITOR_HIDDEN) ||
+	    !m->ndamage) {
+		/* moved, restacked, resized or fully damaged */
+		if (cl->cur)
+			damage_client(c, cl);
+		cl->cur = b;
+		cl->x = m->x;
+		cl->y = m->y;
+		cl->z = m->z;
+		cl->mapped = !(m->flags & PL_COMPOSITOR_HIDDEN);
+		damage_client(c, cl);
+		update_order(c);
+	} else if (cl->mapped) {
+		n = m->ndamage < PL_COMPOSITOR_MAX_DAMAGE ?
+		    m->ndamage : PL_COMPOSITOR_MAX_DAMAGE;
+		for (i = 0; i < n; i++) {
+			const struct pl_compositor_rect *d = &m->damage[i];
+			struct rect r = {
+				cl->x + d->x, cl->y + d->y,
+				cl->x + d->x + (int)d->width,
+				cl->y + d->y + (int)d->height,
+			};
+			struct rect s = client_rect(cl);
+
+			region_add(c, &c->damage, rect_intersect(&r, &s));
+		}
+	}
+
+	if (m->flags & PL_COMPOSITOR_WANT_FRAME)
+		cl->frame_wanted = 1;
+}
+
+static void client_add(struct comp *c)
+{
+	struct client *cl;
+	int fd;
+
+	fd = accept4(c->listen_fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+	if (fd < 0)
+		return;
+	if (c->nclients == MAX_CLIENTS) {
+		fprintf(stderr, "too many clients\n");
+		close(fd);
+		return;
+	}
+
+	cl = calloc(1, sizeof(*cl));
+	if (!cl) {
+		close(fd);
+		return;
+	}
+	cl->fd = fd;
+	c->clients[c->nclients++] = cl;
+	if (c->verbose)
+		fprintf(stderr, "client %d connected\n", fd);
+}
+
+static void client_remove(struct comp *c, unsigned int index)
+{
+	struct client *cl = c->clients[index];
+	struct client_buf *b, *next;
+
+	if (c->verbose)
+		fprintf(stderr, "client %d gone\n", cl->fd);
+
+	if (cl->cur)
+		damage_client(c, cl);
+	for (b = cl->bufs; b; b = next) {
+		next = b->next;
+		if (b == c->on_screen || b == c->flip_buf) {
+			/* freed once the plane no longer scans it out */
+			b->owner = NULL;
+			b->release = 0;
+			b->next = c->zombies;
+			c->zombies = b;
+		} else {
+			cbuf_free(c, b);
+		}
+	}
+	close(cl->fd);
+	free(cl);
+
+	c->clients[index] = c->clients[--c->nclients];
+	update_order(c);
+}
+
+/* Read one commit and the dma-buf fd that may come with it */
+static int client_read(struct comp *c, struct client *cl)
+{
+	struct pl_compositor_commit m;
+	union {
+		char buf[CMSG_SPACE(sizeof(int))];
+		struct cmsghdr align;
+	} ctrl;
+	struct iovec iov = { &m, sizeof(m) };
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = ctrl.buf,
+		.msg_controllen = sizeof(ctrl.buf),
+	};
+	struct cmsghdr *cmsg;
+	ssize_t len;
+	int fd = -1;
+
+	len = recvmsg(cl->fd, &msg, MSG_CMSG_CLOEXEC);
+	if (len < 0)
+		return errno == EAGAIN ? 0 : -errno;
+	if (!len)
+		return -EPIPE;
+
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+		if (cmsg->cmsg_level == SOL_SOCKET &&
+		    cmsg->cmsg_type == SCM_RIGHTS &&
+		    cmsg->cmsg_len == CMSG_LEN(sizeof(int)))
+			memcpy(&fd, CMSG_DATA(cmsg), sizeof(fd));
+
+	if ((size_t)len < sizeof(m) - sizeof(m.damage) ||
+	    m.type != PL_COMPOSITOR_COMMIT) {
+		fprintf(stderr, "client %d: bad message\n", cl->fd);
+		if (fd >= 0)
+			close(fd);
+		return -EPROTO;
+	}
+	if ((size_t)len < sizeof(m))
+		m.ndamage = 0;
+
+	handle_commit(c, cl, &m, fd);
+	return 0;
+}
+
+static int listen_socket(const char *path)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	int fd;
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "socket path too long\n");
+		return -ENAMETOOLONG;
+	}
+	strcpy(addr.sun_path, path);
+
+	fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+	if (fd < 0)
+		return -errno;
+	unlink(path);
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+	    listen(fd, MAX_CLIENTS)) {
+		fprintf(stderr, "cannot listen on %s: %s\n", path,
+			strerror(errno));
+		close(fd);
+		return -errno;
+	}
+	chmod(path, 0660);
+
+	return fd;
+}
+
+/* Repaint */
+
+/* Frame events for commits that changed nothing on screen */
+static void send_frames_now(struct comp *c)
+{
+	struct timespec ts;
+	unsigned int i;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	for (i = 0; i < c->nclients; i++) {
+		struct client *cl = c->clients[i];
+
+		if (!cl->frame_wanted)
+			continue;
+		cl->frame_wanted = 0;
+		send_event(cl, PL_COMPOSITOR_FRAME, 0, 0, ts.tv_sec,
+			   ts.tv_nsec / 1000);
+	}
+}
+
+static void queue_frames(struct comp *c)
+{
+	unsigned int i;
+
+	for (i = 0; i < c->nclients; i++) {
+		struct client *cl = c->clients[i];
+
+		cl->frame_queued |= cl->frame_wanted;
+		cl->frame_wanted = 0;
+	}
+}
+
+/*
+ * Flip the top surface's buffer to the plane when it covers the output on
+ * its own. Buffers the driver cannot import or scan out, like pages from
+ * a system heap on a display that needs contiguous memory, are marked and
+ * composited from then on.
+ */
+static int try_bypass(struct comp *c)
+{
+	struct client *top;
+	struct client_buf *b;
+	uint32_t handles[4] = { 0 }, pitches[4] = { 0 }, offsets[4] = { 0 };
+
+	if (!c->norder)
+		return 0;
+	top = c->order[c->norder - 1];
+	b = top->cur;
+	if (b->no_scanout || !client_opaque(top) || top->x || top->y ||
+	    (int)b->width != c->width || (int)b->height != c->height ||
+	    !plane_has_format(c, b->format))
+		return 0;
+
+	if (!b->fb_id) {
+		if (drmPrimeFDToHandle(c->fd, b->fd, &b->handle))
+			goto fail;
+		handles[0] = b->handle;
+		pitches[0] = b->stride;
+		if (drmModeAddFB2(c->fd, b->width, b->height, b->format, handles,
+				  pitches, offsets, &b->fb_id, 0))
+			goto fail;
+	}
+
+	if (commit_fb(c, b->fb_id, &c->damage, 0))
+		goto fail;
+
+	c->flip_buf = b;
+	c->bypassed++;
+	/* the shadow was not kept up to date */
+	c->full = 1;
+	return 1;
+
+fail:
+	if (c->verbose)
+		fprintf(stderr, "buffer %u of client %d not scanned out: %s\n",
+			b->id, top->fd, strerror(errno));
+	b->no_scanout = 1;
+	return 0;
+}
+
+static void repaint(struct comp *c)
+{
+	struct rect all = { 0, 0, c->width, c->height };
+	struct region copy;
+	unsigned int i;
+	int ret;
+
+	if (c->flip_pending)
+		return;
+	if (!c->damage.n) {
+		send_frames_now(c);
+		return;
+	}
+
+	if (try_bypass(c))
+		goto done;
+
+	if (c->full) {
+		c->damage.n = 0;
+		region_add(c, &c->damage, all);
+	}
+
+	/* The back buffer last showed the frame before the previous one */
+	copy = c->damage;
+	for (i = 0; i < c->prev.n; i++)
+		region_add(c, &copy, c->prev.r[i]);
+
+	for (i = 0; i < c->norder; i++)
+		cbuf_sync(c->order[i]->cur, DMA_BUF_SYNC_START);
+	c->job = &c->damage;
+	pool_run(c, compose_job);
+	for (i = 0; i < c->norder; i++)
+		cbuf_sync(c->order[i]->cur, DMA_BUF_SYNC_END);
+
+	c->job = &copy;
+	pool_run(c, copy_job);
+
+	ret = commit_fb(c, c->scanout[c->back].fb_id, &copy, 0);
+	if (ret) {
+		fprintf(stderr, "flip failed: %s\n", strerror(-ret));
+		return;
+	}
+
+	c->prev = c->damage;
+	c->back ^= 1;
+	c->full = 0;
+	c->flip_buf = NULL;
+done:
+	c->damage.n = 0;
+	c->frames++;
+	queue_frames(c);
+}
+
+static void flip_handler(int fd, unsigned int sequence, unsigned int tv_sec,
+			 unsigned int tv_usec, unsigned int crtc_id, void *data)
+{
+	struct comp *c = data;
+	struct client_buf *old = c->on_screen, *b, **pb;
+	unsigned int i;
+
+	(void)fd;
+	(void)crtc_id;
+
+	c->flip_pending = 0;
+	c->on_screen = c->flip_buf;
+	c->flip_buf = NULL;
+
+	if (old && old != c->on_screen && old->release) {
+		old->release = 0;
+		send_event(old->owner, PL_COMPOSITOR_RELEASE, old->id, 0, 0, 0);
+	}
+	for (pb = &c->zombies; (b = *pb);) {
+		if (b == c->on_screen) {
+			pb = &b->next;
+			continue;
+		}
+		*pb = b->next;
+		cbuf_free(c, b);
+	}
+
+	for (i = 0; i < c->nclients; i++) {
+		struct client *cl = c->clients[i];
+
+		if (!cl->frame_queued)
+			continue;
+		cl->frame_queued = 0;
+		send_event(cl, PL_COMPOSITOR_FRAME, 0, sequence, tv_sec, tv_usec);
+	}
+}
+
+static void on_signal(int sig)
+{
+	(void)sig;
+	quit = 1;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  -D <device>   DRM device (default /dev/dri/card0)\n"
+		"  -s <path>     client socket (default %s)\n"
+		"  -r <mode>     mode name or WxH@Hz (default preferred)\n"
+		"  -f <format>   output format RG24 or XR24 (default RG24 if the\n"
+		"                plane takes it)\n"
+		"  -j <n>        compositing threads (default online CPUs)\n"
+		"  -v            log clients and bypass decisions\n"
+		"  -h            this help\n",
+		prog, PL_COMPOSITOR_SOCKET);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *device = "/dev/dri/card0";
+	const char *sock = PL_COMPOSITOR_SOCKET;
+	const char *mode = NULL, *format = NULL;
+	struct comp c = { .listen_fd = -1 };
+	struct pollfd pfd[MAX_CLIENTS + 2];
+	drmEventContext evctx = {
+		.version = 3,
+		.page_flip_handler2 = flip_handler,
+	};
+	struct rect all;
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned int i, nthreads = cpus > 0 ? cpus : 1;
+	int opt, ret;
+
+	while ((opt = getopt(argc, argv, "D:s:r:f:j:vh")) != -1) {
+		switch (opt) {
+		case 'D':
+			device = optarg;
+			break;
+		case 's':
+			sock = optarg;
+			break;
+		case 'r':
+			mode = optarg;
+			break;
+		case 'f':
+			format = optarg;
+			break;
+		case 'j':
+			nthreads = strtoul(optarg, NULL, 0);
+			break;
+		case 'v':
+			c.verbose = 1;
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (!nthreads)
+		nthreads = 1;
+
+	if (dev_open(&c, device, mode))
+		return 1;
+
+	/* RG24 takes a quarter less frame buffer DMA bandwidth than XR24 */
+	if (!format) {
+		c.format = plane_has_format(&c, DRM_FORMAT_RGB888) ?
+			   DRM_FORMAT_RGB888 : DRM_FORMAT_XRGB8888;
+	} else if (!strcmp(format, "RG24")) {
+		c.format = DRM_FORMAT_RGB888;
+	} else if (!strcmp(format, "XR24")) {
+		c.format = DRM_FORMAT_XRGB8888;
+	} else {
+		fprintf(stderr, "unknown format %s\n", format);
+		return 1;
+	}
+	if (!plane_has_format(&c, c.format)) {
+		fprintf(stderr, "plane does not take %.4s\n",
+			(const char *)&c.format);
+		return 1;
+	}
+	c.cpp = c.format == DRM_FORMAT_RGB888 ? 3 : 4;
+
+	c.shadow = malloc((size_t)c.width * c.height * 4);
+	if (!c.shadow || buf_create(&c, &c.scanout[0]) ||
+	    buf_create(&c, &c.scanout[1]))
+		return 1;
+	pl_image_init(&c.shadow_img, DRM_FORMAT_XRGB8888, c.width, c.height,
+		      (uint8_t *)c.shadow, c.width * 4);
+
+	ret = commit_fb(&c, c.scanout[1].fb_id, NULL, 1);
+	if (ret) {
+		fprintf(stderr, "modeset failed: %s\n", strerror(-ret));
+		return 1;
+	}
+
+	c.listen_fd = listen_socket(sock);
+	if (c.listen_fd < 0)
+		return 1;
+
+	if (pool_init(&c, nthreads - 1))
+		fprintf(stderr, "cannot start all worker threads\n");
+
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+	signal(SIGPIPE, SIG_IGN);
+
+	fprintf(stderr, "%ux%u@%u %.4s on %s, %u threads, %s kernels, socket %s\n",
+		c.width, c.height, c.mode.vrefresh, (const char *)&c.format,
+		device, c.pool.nthreads + 1, pl_isa(), sock);
+
+	/* First frame: the background */
+	all = (struct rect){ 0, 0, c.width, c.height };
+	region_add(&c, &c.damage, all);
+	c.full = 1;
+	repaint(&c);
+
+	while (!quit) {
+		pfd[0].fd = c.fd;
+		pfd[0].events = POLLIN;
+		pfd[1].fd = c.listen_fd;
+		pfd[1].events = POLLIN;
+		for (i = 0; i < c.nclients; i++) {
+			pfd[i + 2].fd = c.clients[i]->fd;
+			pfd[i + 2].events = POLLIN;
+		}
+
+		ret = poll(pfd, c.nclients + 2, -1);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("poll");
+			break;
+		}
+
+		if (pfd[0].revents & POLLIN)
+			drmHandleEvent(c.fd, &evctx);
+		/* backwards, client_remove moves the last client into i */
+		for (i = c.nclients; i-- > 0;) {
+			if (!pfd[i + 2].revents)
+				continue;
+			if ((pfd[i + 2].revents & POLLIN) &&
+			    !client_read(&c, c.clients[i]))
+				continue;
+			client_remove(&c, i);
+		}
+		if (pfd[1].revents & POLLIN)
+			client_add(&c);
+
+		repaint(&c);
+	}
+
+	fprintf(stderr, "%lu frames, %lu direct scanout\n", c.frames,
+		c.bypassed);
+
+	pool_fini(&c);
+	while (c.nclients)
+		client_remove(&c, c.nclients - 1);
+	close(c.listen_fd);
+	unlink(sock);
+	return 0;
+}
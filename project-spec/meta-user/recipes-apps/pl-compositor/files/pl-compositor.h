@@ -0,0 +1,61 @@
+/*
+ * pl-compositor client protocol
+ *
+ * Clients connect a SOCK_SEQPACKET socket to PL_COMPOSITOR_SOCKET and own
+ * one surface each. A commit message places the surface and names its
+ * buffer; a buffer the compositor has not seen yet comes with its dma-buf
+ * fd as SCM_RIGHTS ancillary data. Buffers are ARGB8888 with premultiplied
+ * alpha, or XRGB8888 and RGB888, which are opaque.
+ *
+ * The compositor sends PL_COMPOSITOR_RELEASE once it no longer reads a
+ * buffer the client replaced, and PL_COMPOSITOR_FRAME when a commit that
+ * asked for it with PL_COMPOSITOR_WANT_FRAME is on screen, with the flip
+ * timestamp and CRTC sequence. Clients draw their next frame on it.
+ *
+ * Copyright (C) 2026
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef PL_COMPOSITOR_H
+#define PL_COMPOSITOR_H
+
+#include <stdint.h>
+
+#define PL_COMPOSITOR_SOCKET		"/run/pl-compositor"
+#define PL_COMPOSITOR_MAX_DAMAGE	8
+
+enum {
+	PL_COMPOSITOR_COMMIT = 1,
+	PL_COMPOSITOR_RELEASE,
+	PL_COMPOSITOR_FRAME,
+};
+
+/* commit flags */
+#define PL_COMPOSITOR_WANT_FRAME	(1 << 0)
+#define PL_COMPOSITOR_HIDDEN		(1 << 1)
+
+struct pl_compositor_rect {
+	int32_t x, y;
+	uint32_t width, height;
+};
+
+struct pl_compositor_commit {
+	uint32_t type;
+	uint32_t buffer;	/* client chosen id, not 0 */
+	uint32_t width, height, stride;
+	uint32_t format;	/* DRM fourcc */
+	int32_t x, y;		/* position on the output */
+	uint32_t z;		/* higher is on top */
+	uint32_t flags;
+	uint32_t ndamage;	/* 0 damages the whole surface */
+	struct pl_compositor_rect damage[PL_COMPOSITOR_MAX_DAMAGE];
+};
+
+struct pl_compositor_event {
+	uint32_t type;
+	uint32_t buffer;	/* PL_COMPOSITOR_RELEASE */
+	uint32_t sequence;	/* PL_COMPOSITOR_FRAME */
+	uint32_t tv_sec, tv_usec;
+};
+
+#endif
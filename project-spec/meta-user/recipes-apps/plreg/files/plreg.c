@@ -0,0 +1,564 @@
+/*
+ * plreg - PL display register access and sampling through pl-regmon
+ *
+ * Replaces peekpoke for the display IPs: the register windows are mapped
+ * once from /dev/pl-regmon instead of /dev/mem per access, and registers
+ * are named ("vtc.isr") or given as window and offset ("vtc+0x004").
+ *
+ * "plreg sample" has the driver sample a set of registers from a timer at
+ * up to 20 kHz, or on each frame of the VTC, and writes the samples as
+ * CSV with their timestamps. With -b only the last samples are kept, so
+ * it can run until a glitch shows and be stopped with Ctrl-C to keep what
+ * led up to it.
+ *
+ * Copyright (C) 2026
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <glob.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <pl-regmon.h>
+
+#define REGMON_SYSFS_GLOB	"/sys/bus/platform/drivers/pl-regmon/*"
+#define FPGA_STATE		"/sys/class/fpga_manager/fpga0/state"
+
+#define MAX_WINDOWS		4
+#define NAME_LEN		16
+#define READ_SAMPLES		64
+
+struct window {
+	char name[NAME_LEN];
+	unsigned long long phys, size, offset;
+	int irq;
+	volatile uint32_t *map;
+};
+
+struct reg {
+	unsigned int window;
+	uint32_t offset;
+	char label[2 * NAME_LEN];
+};
+
+static const struct reg_name {
+	const char *window;
+	const char *name;
+	uint32_t offset;
+} reg_names[] = {
+	/* clocking wizard, dynamic reconfiguration */
+	{ "clk", "reset", 0x000 },
+	{ "clk", "status", 0x004 },
+	{ "clk", "fbout", 0x200 },
+	{ "clk", "fbout_phase", 0x204 },
+	{ "clk", "out0_div", 0x208 },
+	{ "clk", "out0_phase", 0x20c },
+	{ "clk", "out0_duty", 0x210 },
+	{ "clk", "out1_div", 0x214 },
+	{ "clk", "load", 0x25c },
+	/* frame buffer read */
+	{ "frmbuf", "ctrl", 0x00 },
+	{ "frmbuf", "gie", 0x04 },
+	{ "frmbuf", "ier", 0x08 },
+	{ "frmbuf", "isr", 0x0c },
+	{ "frmbuf", "width", 0x10 },
+	{ "frmbuf", "height", 0x18 },
+	{ "frmbuf", "stride", 0x20 },
+	{ "frmbuf", "format", 0x28 },
+	{ "frmbuf", "addr", 0x30 },
+	{ "frmbuf", "addr2", 0x3c },
+	/* video timing controller */
+	{ "vtc", "ctl", 0x000 },
+	{ "vtc", "isr", 0x004 },
+	{ "vtc", "error", 0x008 },
+	{ "vtc", "ier", 0x00c },
+	{ "vtc", "version", 0x010 },
+	{ "vtc", "gasize", 0x060 },
+	{ "vtc", "genc", 0x068 },
+	{ "vtc", "gpol", 0x06c },
+	{ "vtc", "ghsize", 0x070 },
+	{ "vtc", "gvsize", 0x074 },
+	{ "vtc", "ghsync", 0x078 },
+	{ "vtc", "gvbhoff", 0x07c },
+	{ "vtc", "gvsync", 0x080 },
+	{ "vtc", "gvshoff", 0x084 },
+	{ "vtc", "fs00", 0x100 },
+};
+
+struct plreg {
+	char sysfs[256];
+	int fd;
+	struct window win[MAX_WINDOWS];
+	unsigned int nwin;
+};
+
+static volatile sig_atomic_t quit;
+
+static void on_signal(int sig)
+{
+	(void)sig;
+	quit = 1;
+}
+
+static int sysfs_write(struct plreg *p, const char *attr, const char *val)
+{
+	char path[300];
+	int fd, ret = 0;
+
+	snprintf(path, sizeof(path), "%s/%s", p->sysfs, attr);
+	fd = open(path, O_WRONLY);
+	if (fd < 0 || write(fd, val, strlen(val)) < 0)
+		ret = -errno;
+	if (fd >= 0)
+		close(fd);
+	if (ret)
+		fprintf(stderr, "%s: %s\n", path, strerror(-ret));
+	return ret;
+}
+
+/* Reading a PL that is not configured hangs the AXI bus */
+static int pl_configured(void)
+{
+	char state[32] = "";
+	FILE *f = fopen(FPGA_STATE, "r");
+
+	if (!f)
+		return 1;
+	if (!fgets(state, sizeof(state), f))
+		state[0] = 0;
+	fclose(f);
+	return !strncmp(state, "operating", 9);
+}
+
+static int plreg_open(struct plreg *p, int force)
+{
+	char line[128], path[300];
+	struct window *w;
+	glob_t g;
+	FILE *f;
+
+	if (!force && !pl_configured()) {
+		fprintf(stderr, "the PL is not configured (%s), -f to go on\n",
+			FPGA_STATE);
+		return -1;
+	}
+
+	if (glob(REGMON_SYSFS_GLOB "/windows", 0, NULL, &g) || !g.gl_pathc) {
+		fprintf(stderr, "no pl-regmon device, is pl-display.dtbo applied?\n");
+		return -1;
+	}
+	snprintf(p->sysfs, sizeof(p->sysfs), "%s", g.gl_pathv[0]);
+	*strrchr(p->sysfs, '/') = 0;
+	globfree(&g);
+
+	snprintf(path, sizeof(path), "%s/windows", p->sysfs);
+	f = fopen(path, "r");
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+	while (p->nwin < MAX_WINDOWS && fgets(line, sizeof(line), f)) {
+		w = &p->win[p->nwin];
+		if (sscanf(line, "%15s %llx %llx %llx %d", w->name, &w->phys,
+			   &w->size, &w->offset, &w->irq) == 5)
+			p->nwin++;
+	}
+	fclose(f);
+
+	p->fd = open(PL_REGMON_DEV, O_RDWR);
+	if (p->fd < 0) {
+		perror(PL_REGMON_DEV);
+		return -1;
+	}
+	return 0;
+}
+
+static volatile uint32_t *window_map(struct plreg *p, struct window *w)
+{
+	void *map;
+
+	if (w->map)
+		return w->map;
+	map = mmap(NULL, w->size, PROT_READ | PROT_WRITE, MAP_SHARED, p->fd,
+		   w->offset);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "cannot map %s: %s\n", w->name, strerror(errno));
+		return NULL;
+	}
+	w->map = map;
+	return w->map;
+}
+
+static int find_window(struct plreg *p, const char *name, size_t len)
+{
+	unsigned int i;
+
+	for (i = 0; i < p->nwin; i++)
+		if (strlen(p->win[i].name) == len &&
+		    !strncmp(p->win[i].name, name, len))
+			return i;
+	return -1;
+}
+
+/* "vtc.isr" or "vtc+0x004" */
+static int parse_reg(struct plreg *p, const char *arg, struct reg *r)
+{
+	const char *sep = strpbrk(arg, ".+");
+	unsigned int i;
+	char *end;
+	int win;
+
+	win = sep ? find_window(p, arg, sep - arg) : -1;
+	if (win < 0) {
+		fprintf(stderr, "%s: no such window\n", arg);
+		return -1;
+	}
+	r->window = win;
+
+	if (*sep == '+') {
+		r->offset = strtoul(sep + 1, &end, 0);
+		if (*end || r->offset & 3 || r->offset >= p->win[win].size) {
+			fprintf(stderr, "%s: bad offset\n", arg);
+			return -1;
+		}
+	} else {
+		for (i = 0; i < sizeof(reg_names) / sizeof(reg_names[0]); i++)
+			if (!strcmp(reg_names[i].window, p->win[win].name) &&
+			    !strcmp(reg_names[i].name, sep + 1))
+				break;
+		if (i == sizeof(reg_names) / sizeof(reg_names[0])) {
+			fprintf(stderr, "%s: unknown register, see plreg list\n",
+				arg);
+			return -1;
+		}
+		r->offset = reg_names[i].offset;
+	}
+	snprintf(r->label, sizeof(r->label), "%s", arg);
+	return 0;
+}
+
+static int cmd_list(struct plreg *p)
+{
+	unsigned int i, j;
+
+	for (i = 0; i < p->nwin; i++) {
+		const struct window *w = &p->win[i];
+
+		printf("%-8s 0x%08llx 0x%llx irq %d:", w->name, w->phys,
+		       w->size, w->irq);
+		for (j = 0; j < sizeof(reg_names) / sizeof(reg_names[0]); j++)
+			if (!strcmp(reg_names[j].window, w->name))
+				printf(" %s", reg_names[j].name);
+		printf("\n");
+	}
+	return 0;
+}
+
+static int cmd_peek(struct plreg *p, int argc, char **argv)
+{
+	volatile uint32_t *map;
+	struct reg r;
+	int i;
+
+	for (i = 0; i < argc; i++) {
+		if (parse_reg(p, argv[i], &r))
+			return 1;
+		map = window_map(p, &p->win[r.window]);
+		if (!map)
+			return 1;
+		printf("%-16s 0x%08x\n", r.label, map[r.offset / 4]);
+	}
+	return 0;
+}
+
+static int cmd_poke(struct plreg *p, int argc, char **argv)
+{
+	volatile uint32_t *map;
+	struct reg r;
+
+	if (argc != 2 || parse_reg(p, argv[0], &r))
+		return 1;
+	map = window_map(p, &p->win[r.window]);
+	if (!map)
+		return 1;
+	map[r.offset / 4] = strtoul(argv[1], NULL, 0);
+	return 0;
+}
+
+static int cmd_dump(struct plreg *p, int argc, char **argv)
+{
+	volatile uint32_t *map;
+	unsigned long size = 0x100, off;
+	int win;
+
+	if (argc < 1)
+		return 1;
+	win = find_window(p, argv[0], strlen(argv[0]));
+	if (win < 0) {
+		fprintf(stderr, "%s: no such window\n", argv[0]);
+		return 1;
+	}
+	if (argc > 1)
+		size = strtoul(argv[1], NULL, 0);
+	if (size > p->win[win].size)
+		size = p->win[win].size;
+	map = window_map(p, &p->win[win]);
+	if (!map)
+		return 1;
+
+	for (off = 0; off < size; off += 4) {
+		if (!(off % 16))
+			printf("%s0x%03lx:", off ? "\n" : "", off);
+		printf(" %08x", map[off / 4]);
+	}
+	printf("\n");
+	return 0;
+}
+
+struct sample_stats {
+	uint64_t first_ns, last_ns;
+	uint64_t min_ns, max_ns;
+	unsigned long count, lost;
+	uint32_t last_seq;
+};
+
+static void write_sample(FILE *out, const struct pl_regmon_sample *s,
+			 uint64_t t0)
+{
+	unsigned int i;
+
+	fprintf(out, "%.3f,%u", (s->time_ns - t0) / 1e3, s->seq);
+	for (i = 0; i < s->nregs; i++)
+		fprintf(out, ",0x%08x", s->val[i]);
+	fprintf(out, "\n");
+}
+
+static void account(struct sample_stats *st, const struct pl_regmon_sample *s)
+{
+	uint64_t dt;
+
+	if (st->count) {
+		dt = s->time_ns - st->last_ns;
+		if (dt < st->min_ns)
+			st->min_ns = dt;
+		if (dt > st->max_ns)
+			st->max_ns = dt;
+		st->lost += s->seq - st->last_seq - 1;
+	} else {
+		st->first_ns = s->time_ns;
+		st->min_ns = UINT64_MAX;
+	}
+	st->last_ns = s->time_ns;
+	st->last_seq = s->seq;
+	st->count++;
+}
+
+static int cmd_sample(struct plreg *p, int argc, char **argv)
+{
+	const char *trigger = "timer", *output = NULL;
+	unsigned long count = 0, keep = 0, i, first = 0;
+	struct reg regs[PL_REGMON_MAX_REGS];
+	struct sample_stats st = { 0 };
+	char list[PL_REGMON_MAX_REGS * 24] = "", num[16];
+	unsigned int rate = 1000, nregs = 0;
+	double duration = 0;
+	uint8_t *buf, *ring = NULL;
+	struct sigaction sa = { .sa_handler = on_signal };
+	size_t size;
+	FILE *out = stdout;
+	ssize_t len;
+	int opt, ret = 1;
+
+	optind = 1;
+	while ((opt = getopt(argc, argv, "t:r:n:d:b:o:")) != -1) {
+		switch (opt) {
+		case 't':
+			trigger = optarg;
+			break;
+		case 'r':
+			rate = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			count = strtoul(optarg, NULL, 0);
+			break;
+		case 'd':
+			duration = strtod(optarg, NULL);
+			break;
+		case 'b':
+			keep = strtoul(optarg, NULL, 0);
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		default:
+			return 1;
+		}
+	}
+
+	for (; optind < argc; optind++) {
+		if (nregs == PL_REGMON_MAX_REGS) {
+			fprintf(stderr, "at most %d registers\n",
+				PL_REGMON_MAX_REGS);
+			return 1;
+		}
+		if (parse_reg(p, argv[optind], &regs[nregs]))
+			return 1;
+		snprintf(list + strlen(list), sizeof(list) - strlen(list),
+			 "%s%s+0x%x", nregs ? " " : "",
+			 p->win[regs[nregs].window].name, regs[nregs].offset);
+		nregs++;
+	}
+	if (!nregs) {
+		fprintf(stderr, "no registers to sample\n");
+		return 1;
+	}
+
+	size = PL_REGMON_SAMPLE_SIZE(nregs);
+	buf = malloc(size * READ_SAMPLES);
+	if (keep)
+		ring = malloc(size * keep);
+	if (!buf || (keep && !ring)) {
+		fprintf(stderr, "out of memory\n");
+		goto out;
+	}
+	if (output) {
+		out = fopen(output, "w");
+		if (!out) {
+			perror(output);
+			goto out;
+		}
+	}
+
+	snprintf(num, sizeof(num), "%u", rate);
+	if (sysfs_write(p, "trigger", "off") || sysfs_write(p, "regs", list) ||
+	    (!strcmp(trigger, "timer") && sysfs_write(p, "rate", num)))
+		goto out;
+
+	/* no SA_RESTART: a signal ends the blocking read */
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	sigaction(SIGALRM, &sa, NULL);
+	/* also ends a wait for an interrupt that never comes */
+	if (duration)
+		alarm((unsigned int)duration + 1);
+
+	if (sysfs_write(p, "trigger", trigger))
+		goto out;
+
+	while (!quit && (!count || st.count < count)) {
+		len = read(p->fd, buf, size * READ_SAMPLES);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("read");
+			break;
+		}
+		for (i = 0; i + size <= (size_t)len; i += size) {
+			const struct pl_regmon_sample *s = (void *)(buf + i);
+
+			account(&st, s);
+			if (keep)
+				memcpy(ring + (st.count - 1) % keep * size, s,
+				       size);
+			else
+				write_sample(out, s, st.first_ns);
+			if (st.count == count)
+				break;
+		}
+		if (duration && st.last_ns - st.first_ns >= duration * 1e9)
+			break;
+	}
+	sysfs_write(p, "trigger", "off");
+
+	if (keep) {
+		if (st.count > keep)
+			first = st.count - keep;
+		for (i = first; i < st.count; i++)
+			write_sample(out, (void *)(ring + i % keep * size),
+				     st.first_ns);
+	}
+
+	fprintf(stderr, "%lu samples, %lu lost", st.count, st.lost);
+	if (st.count > 1)
+		fprintf(stderr, ", interval min %.1f avg %.1f max %.1f us",
+			st.min_ns / 1e3,
+			(st.last_ns - st.first_ns) / 1e3 / (st.count - 1),
+			st.max_ns / 1e3);
+	fprintf(stderr, "\n");
+	ret = 0;
+
+out:
+	if (out != stdout && out)
+		fclose(out);
+	free(ring);
+	free(buf);
+	return ret;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-f] <command> [args]\n"
+		"  list                       windows and register names\n"
+		"  peek <reg>...              read registers\n"
+		"  poke <reg> <value>         write a register\n"
+		"  dump <window> [<bytes>]    hex dump (default 0x100 bytes)\n"
+		"  sample [options] <reg>...  sample registers as CSV\n"
+		"    -t <trigger>  timer (default) or vtc for each frame\n"
+		"    -r <hz>       timer rate, up to %d (default 1000)\n"
+		"    -n <count>    stop after this many samples\n"
+		"    -d <seconds>  stop after this long\n"
+		"    -b <count>    keep the last <count> samples, write them at the end\n"
+		"    -o <file>     output file (default stdout)\n"
+		"A register is <window>.<name> or <window>+<offset>, for example\n"
+		"vtc.isr or frmbuf+0x30. -f skips the check that the PL is\n"
+		"configured.\n",
+		prog, PL_REGMON_MAX_RATE);
+}
+
+int main(int argc, char *argv[])
+{
+	struct plreg p = { .fd = -1 };
+	int force = 0, ret;
+	const char *cmd;
+
+	if (argc > 1 && !strcmp(argv[1], "-f")) {
+		force = 1;
+		argc--;
+		argv++;
+	}
+	if (argc < 2 || !strcmp(argv[1], "-h")) {
+		usage(argv[0]);
+		return argc < 2;
+	}
+	cmd = argv[1];
+
+	if (plreg_open(&p, force))
+		return 1;
+
+	if (!strcmp(cmd, "list"))
+		ret = cmd_list(&p);
+	else if (!strcmp(cmd, "peek"))
+		ret = cmd_peek(&p, argc - 2, argv + 2);
+	else if (!strcmp(cmd, "poke"))
+		ret = cmd_poke(&p, argc - 2, argv + 2);
+	else if (!strcmp(cmd, "dump"))
+		ret = cmd_dump(&p, argc - 2, argv + 2);
+	else if (!strcmp(cmd, "sample"))
+		ret = cmd_sample(&p, argc - 1, argv + 1);
+	else {
+		usage(argv[0]);
+		ret = 1;
+	}
+
+	close(p.fd);
+	return ret;
+}
@@ -0,0 +1,118 @@
+/*
+ * fb-ops - CPU access patterns on a mapped frame buffer
+ *
+ * The operations scanout-bench and display-bench time on dumb buffers,
+ * each on a rectangle of the buffer:
+ *
+ *   fill    streaming write of a solid line pattern
+ *   blit    copy from a system memory image, as a software decoder would
+ *   blend   read-modify-write, 50% blend of the image over the buffer
+ *   scroll  buffer to buffer copy, the rectangle moves up by one line
+ *
+ * The image is one line from fb_op_image(); each iteration starts every
+ * line at a different pixel of it.
+ *
+ * Copyright (C) 2026
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef FB_OPS_H
+#define FB_OPS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct fb_op_rect {
+	unsigned int x, y, w, h;
+};
+
+typedef void (*fb_op_fn)(uint8_t *map, unsigned int pitch,
+			 const struct fb_op_rect *r, unsigned int cpp,
+			 const uint8_t *img, unsigned int iter);
+
+static inline uint8_t *fb_op_line(uint8_t *map, unsigned int pitch,
+				  const struct fb_op_rect *r, unsigned int cpp,
+				  unsigned int y)
+{
+	return map + (r->y + y) * pitch + r->x * cpp;
+}
+
+static void fb_op_fill(uint8_t *map, unsigned int pitch,
+		       const struct fb_op_rect *r, unsigned int cpp,
+		       const uint8_t *img, unsigned int iter)
+{
+	unsigned int y;
+
+	for (y = 0; y < r->h; y++)
+		memset(fb_op_line(map, pitch, r, cpp, y), (y + iter) & 0xff,
+		       r->w * cpp);
+}
+
+static void fb_op_blit(uint8_t *map, unsigned int pitch,
+		       const struct fb_op_rect *r, unsigned int cpp,
+		       const uint8_t *img, unsigned int iter)
+{
+	unsigned int y;
+
+	for (y = 0; y < r->h; y++)
+		memcpy(fb_op_line(map, pitch, r, cpp, y),
+		       img + ((y + iter) & 0xff) * cpp, r->w * cpp);
+}
+
+static void fb_op_blend(uint8_t *map, unsigned int pitch,
+			const struct fb_op_rect *r, unsigned int cpp,
+			const uint8_t *img, unsigned int iter)
+{
+	unsigned int x, y, n = r->w * cpp;
+
+	for (y = 0; y < r->h; y++) {
+		uint8_t *d = fb_op_line(map, pitch, r, cpp, y);
+		const uint8_t *s = img + ((y + iter) & 0xff) * cpp;
+
+		for (x = 0; x < n; x++)
+			d[x] = (d[x] + s[x] + 1) >> 1;
+	}
+}
+
+static void fb_op_scroll(uint8_t *map, unsigned int pitch,
+			 const struct fb_op_rect *r, unsigned int cpp,
+			 const uint8_t *img, unsigned int iter)
+{
+	unsigned int y;
+	uint8_t *d;
+
+	for (y = 0; y + 1 < r->h; y++) {
+		d = fb_op_line(map, pitch, r, cpp, y);
+		memcpy(d, d + pitch, r->w * cpp);
+	}
+	memcpy(fb_op_line(map, pitch, r, cpp, r->h - 1),
+	       img + (iter & 0xff) * cpp, r->w * cpp);
+}
+
+static const struct {
+	const char *name;
+	fb_op_fn fn;
+	unsigned int passes;	/* bytes moved per touched byte */
+} fb_ops[] = {
+	{ "fill",   fb_op_fill,   1 },
+	{ "blit",   fb_op_blit,   1 },
+	{ "blend",  fb_op_blend,  2 },
+	{ "scroll", fb_op_scroll, 2 },
+};
+
+#define FB_OPS_COUNT	(sizeof(fb_ops) / sizeof(fb_ops[0]))
+
+/* Image line for width pixels, with 256 pixels of slack for the offsets */
+static inline uint8_t *fb_op_image(unsigned int width, unsigned int cpp)
+{
+	size_t i, n = (size_t)(width + 256) * cpp;
+	uint8_t *img = malloc(n);
+
+	if (img)
+		for (i = 0; i < n; i++)
+			img[i] = i * 7;
+	return img;
+}
+
+#endif
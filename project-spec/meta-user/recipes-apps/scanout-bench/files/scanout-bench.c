@@ -0,0 +1,750 @@
+/*
+ * scanout-bench - CPU access throughput on scanout buffers
+ *
+ * Compares fill, blit, blend and scroll throughput (fb-ops.h) on a dumb
+ * buffer that is being scanned out, mapped either write-combined (the default) or cacheable with
+ * an explicit damage flush (xlnx_drm.dumb_cached=1). For cached buffers every
+ * iteration ends with DRM_IOCTL_MODE_DIRTYFB on the touched rectangle, so the
+ * cache clean done by the commit path is part of the measured time.
+ *
+ * The ddr test measures CPU memcpy bandwidth with the display off and while
+ * the frame buffer DMA scans out a buffer with a tight pitch and with the
+ * DDR page aligned pitch (xlnx_drm.dumb_ddr_pitch), and reports the DDR
+ * headroom left for scanout against the nominal DDR bandwidth.
+ *
+ * The afi test floods the DDR with memcpy threads while the display scans
+ * out, and samples the read data FIFO level of the HP port (zynq-afi-qos
+ * sysfs) for each read QoS given. An empty FIFO means the frame buffer DMA
+ * is waiting on DDR; the worst frame shows how close scanout gets to an
+ * underrun.
+ *
+ * Copyright (C) 2026
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <glob.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <drm_fourcc.h>
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+#include "fb-ops.h"
+
+#define DUMB_CACHED_PARAM	"/sys/module/xlnx_drm/parameters/dumb_cached"
+#define DUMB_DDR_PITCH_PARAM	"/sys/module/xlnx_drm/parameters/dumb_ddr_pitch"
+
+/* DDR3-1066 on the 16-bit bus configured by ps7_init */
+#define DDR_NOMINAL_MBPS	2133.0
+#define MEMCPY_SIZE		(16 << 20)
+#define AFI_SYSFS_GLOB		"/sys/bus/platform/drivers/zynq-afi-qos/*"
+#define AFI_MAX_QOS		16
+#define AFI_MAX_THREADS		8
+
+enum bench_map {
+	MAP_WC,
+	MAP_CACHED,
+};
+
+struct bench_dev {
+	int fd;
+	uint32_t conn_id;
+	uint32_t crtc_id;
+	drmModeModeInfo mode;
+	drmModeCrtc *saved_crtc;
+};
+
+struct bench_buf {
+	uint32_t handle;
+	uint32_t fb_id;
+	uint32_t pitch;
+	uint64_t size;
+	uint8_t *map;
+	enum bench_map map_type;
+};
+
+struct bench_opts {
+	const char *device;
+	uint32_t format;
+	unsigned int cpp;
+	unsigned int loops;
+	unsigned int rect_w, rect_h;
+	int map_wc;
+	int map_cached;
+	int test_cpu;
+	int test_ddr;
+	double ddr_mbps;
+	double seconds;
+	int test_afi;
+	const char *afi_dir;
+	unsigned int threads;
+	unsigned int nqos;
+	unsigned int qos[AFI_MAX_QOS];
+};
+
+struct flood {
+	pthread_t thread;
+	volatile int *stop;
+	uint8_t *a, *b;
+	unsigned long copies;
+};
+
+static double now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int read_param(const char *path, char *val)
+{
+	FILE *f = fopen(path, "r");
+	int ret;
+
+	if (!f)
+		return -errno;
+	ret = fscanf(f, "%c", val) == 1 ? 0 : -EIO;
+	fclose(f);
+	return ret;
+}
+
+static int write_param(const char *path, char val)
+{
+	FILE *f = fopen(path, "w");
+	int ret;
+
+	if (!f)
+		return -errno;
+	ret = fprintf(f, "%c\n", val) == 2 ? 0 : -EIO;
+	if (fclose(f))
+		ret = -errno;
+	return ret;
+}
+
+static int dev_open(struct bench_dev *dev, const char *path)
+{
+	drmModeRes *res;
+	drmModeConnector *conn = NULL;
+	drmModeEncoder *enc;
+	uint64_t cap;
+	int i;
+
+	dev->fd = open(path, O_RDWR | O_CLOEXEC);
+	if (dev->fd < 0) {
+		fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+		return -errno;
+	}
+
+	if (drmGetCap(dev->fd, DRM_CAP_DUMB_BUFFER, &cap) || !cap) {
+		fprintf(stderr, "%s does not support dumb buffers\n", path);
+		return -EOPNOTSUPP;
+	}
+
+	res = drmModeGetResources(dev->fd);
+	if (!res) {
+		fprintf(stderr, "cannot get DRM resources: %s\n", strerror(errno));
+		return -errno;
+	}
+
+	for (i = 0; i < res->count_connectors; i++) {
+		conn = drmModeGetConnector(dev->fd, res->connectors[i]);
+		if (conn && conn->connection == DRM_MODE_CONNECTED &&
+		    conn->count_modes)
+			break;
+		drmModeFreeConnector(conn);
+		conn = NULL;
+	}
+	if (!conn) {
+		fprintf(stderr, "no connected connector\n");
+		drmModeFreeResources(res);
+		return -ENODEV;
+	}
+
+	dev->conn_id = conn->connector_id;
+	dev->mode = conn->modes[0];
+	for (i = 0; i < conn->count_modes; i++) {
+		if (conn->modes[i].type & DRM_MODE_TYPE_PREFERRED) {
+			dev->mode = conn->modes[i];
+			break;
+		}
+	}
+
+	dev->crtc_id = 0;
+	enc = conn->encoder_id ? drmModeGetEncoder(dev->fd, conn->encoder_id) : NULL;
+	if (enc) {
+		dev->crtc_id = enc->crtc_id;
+		drmModeFreeEncoder(enc);
+	}
+	if (!dev->crtc_id && res->count_crtcs)
+		dev->crtc_id = res->crtcs[0];
+
+	drmModeFreeConnector(conn);
+	drmModeFreeResources(res);
+
+	if (!dev->crtc_id) {
+		fprintf(stderr, "no CRTC available\n");
+		return -ENODEV;
+	}
+
+	dev->saved_crtc = drmModeGetCrtc(dev->fd, dev->crtc_id);
+	return 0;
+}
+
+static void dev_close(struct bench_dev *dev)
+{
+	drmModeCrtc *c = dev->saved_crtc;
+
+	if (c) {
+		drmModeSetCrtc(dev->fd, c->crtc_id, c->buffer_id, c->x, c->y,
+			       &dev->conn_id, 1, &c->mode);
+		drmModeFreeCrtc(c);
+	}
+	close(dev->fd);
+}
+
+static void buf_destroy(struct bench_dev *dev, struct bench_buf *buf)
+{
+	struct drm_mode_destroy_dumb destroy = { .handle = buf->handle };
+
+	if (buf->map)
+		munmap(buf->map, buf->size);
+	if (buf->fb_id)
+		drmModeRmFB(dev->fd, buf->fb_id);
+	if (buf->handle)
+		drmIoctl(dev->fd, DRM_IOCTL_MODE_DESTROY_DUMB, &destroy);
+	memset(buf, 0, sizeof(*buf));
+}
+
+static int buf_create(struct bench_dev *dev, struct bench_buf *buf,
+		      const struct bench_opts *opts, enum bench_map map_type)
+{
+	struct drm_mode_create_dumb create = { 0 };
+	struct drm_mode_map_dumb map = { 0 };
+	uint32_t handles[4] = { 0 }, pitches[4] = { 0 }, offsets[4] = { 0 };
+	int ret;
+
+	memset(buf, 0, sizeof(*buf));
+	buf->map_type = map_type;
+
+	/* The mapping is latched by the driver when the buffer is allocated */
+	ret = write_param(DUMB_CACHED_PARAM, map_type == MAP_CACHED ? 'Y' : 'N');
+	if (ret && map_type == MAP_CACHED) {
+		fprintf(stderr, "cannot select cached mapping (%s): %s\n",
+			DUMB_CACHED_PARAM, strerror(-ret));
+		return ret;
+	}
+
+	create.width = dev->mode.hdisplay;
+	create.height = dev->mode.vdisplay;
+	create.bpp = opts->cpp * 8;
+	if (drmIoctl(dev->fd, DRM_IOCTL_MODE_CREATE_DUMB, &create)) {
+		ret = -errno;
+		fprintf(stderr, "cannot create dumb buffer: %s\n", strerror(errno));
+		return ret;
+	}
+	buf->handle = create.handle;
+	buf->pitch = create.pitch;
+	buf->size = create.size;
+
+	handles[0] = buf->handle;
+	pitches[0] = buf->pitch;
+	if (drmModeAddFB2(dev->fd, create.width, create.height, opts->format,
+			  handles, pitches, offsets, &buf->fb_id, 0)) {
+		ret = -errno;
+		fprintf(stderr, "cannot add framebuffer: %s\n", strerror(errno));
+		goto err;
+	}
+
+	map.handle = buf->handle;
+	if (drmIoctl(dev->fd, DRM_IOCTL_MODE_MAP_DUMB, &map)) {
+		ret = -errno;
+		fprintf(stderr, "cannot map dumb buffer: %s\n", strerror(errno));
+		goto err;
+	}
+	buf->map = mmap(NULL, buf->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			dev->fd, map.offset);
+	if (buf->map == MAP_FAILED) {
+		buf->map = NULL;
+		ret = -errno;
+		fprintf(stderr, "cannot mmap dumb buffer: %s\n", strerror(errno));
+		goto err;
+	}
+	memset(buf->map, 0, buf->size);
+
+	if (drmModeSetCrtc(dev->fd, dev->crtc_id, buf->fb_id, 0, 0,
+			   &dev->conn_id, 1, &dev->mode)) {
+		ret = -errno;
+		fprintf(stderr, "cannot set CRTC: %s\n", strerror(errno));
+		goto err;
+	}
+
+	return 0;
+
+err:
+	buf_destroy(dev, buf);
+	return ret;
+}
+
+static int run_map(struct bench_dev *dev, const struct bench_opts *opts,
+		   enum bench_map map_type, const uint8_t *src)
+{
+	struct bench_buf buf;
+	struct fb_op_rect r;
+	drmModeClip clip;
+	unsigned int i, n;
+	double t0, dt, bytes;
+	int ret;
+
+	ret = buf_create(dev, &buf, opts, map_type);
+	if (ret)
+		return ret;
+
+	r.w = opts->rect_w && opts->rect_w < dev->mode.hdisplay ?
+	      opts->rect_w : dev->mode.hdisplay;
+	r.h = opts->rect_h && opts->rect_h < dev->mode.vdisplay ?
+	      opts->rect_h : dev->mode.vdisplay;
+	r.x = (dev->mode.hdisplay - r.w) / 2;
+	r.y = (dev->mode.vdisplay - r.h) / 2;
+
+	clip.x1 = r.x;
+	clip.y1 = r.y;
+	clip.x2 = r.x + r.w;
+	clip.y2 = r.y + r.h;
+
+	for (i = 0; i < FB_OPS_COUNT; i++) {
+		t0 = now_sec();
+		for (n = 0; n < opts->loops; n++) {
+			fb_ops[i].fn(buf.map, buf.pitch, &r, opts->cpp, src, n);
+			if (map_type == MAP_CACHED &&
+			    drmModeDirtyFB(dev->fd, buf.fb_id, &clip, 1)) {
+				ret = -errno;
+				fprintf(stderr, "dirtyfb failed: %s\n",
+					strerror(-ret));
+				goto out;
+			}
+		}
+		dt = now_sec() - t0;
+		bytes = (double)r.w * r.h * opts->cpp * fb_ops[i].passes *
+			opts->loops;
+
+		printf("%-7s %-6s %4ux%-4u %8.3f ms/iter %9.1f MB/s\n",
+		       map_type == MAP_CACHED ? "cached" : "wc",
+		       fb_ops[i].name, r.w, r.h, dt * 1e3 / opts->loops,
+		       bytes / dt / 1e6);
+	}
+
+out:
+	buf_destroy(dev, &buf);
+	return ret;
+}
+
+/* CPU memcpy rate between two buffers well beyond the L2 cache */
+static double memcpy_mbps(uint8_t *a, uint8_t *b, double seconds)
+{
+	double t0 = now_sec(), dt;
+	unsigned long n = 0;
+
+	do {
+		memcpy(n & 1 ? a : b, n & 1 ? b : a, MEMCPY_SIZE);
+		n++;
+		dt = now_sec() - t0;
+	} while (dt < seconds);
+
+	return (double)n * MEMCPY_SIZE / dt / 1e6;
+}
+
+static void *flood_thread(void *arg)
+{
+	struct flood *f = arg;
+
+	while (!*f->stop) {
+		memcpy(f->copies & 1 ? f->a : f->b, f->copies & 1 ? f->b : f->a,
+		       MEMCPY_SIZE);
+		f->copies++;
+	}
+
+	return NULL;
+}
+
+static int read_sysfs_uint(int fd, unsigned int *val)
+{
+	char buf[16];
+	ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+
+	if (n <= 0)
+		return -EIO;
+	buf[n] = 0;
+	*val = strtoul(buf, NULL, 0);
+	return 0;
+}
+
+/* Sample the HP port read FIFO while memcpy threads flood the DDR */
+static int afi_stress(struct bench_dev *dev, const struct bench_opts *opts,
+		      int level_fd, const char *qos_label)
+{
+	struct flood floods[AFI_MAX_THREADS] = { 0 };
+	volatile int stop = 0;
+	double frame = 1.0 / (dev->mode.vrefresh ? dev->mode.vrefresh : 60);
+	double t0, t, win_start, worst = 0, copied = 0;
+	unsigned long samples = 0, empty = 0, sum = 0;
+	unsigned long win_samples = 0, win_empty = 0;
+	unsigned int i, level, min = ~0u;
+	int ret = 0;
+
+	for (i = 0; i < opts->threads; i++) {
+		floods[i].stop = &stop;
+		floods[i].a = malloc(MEMCPY_SIZE);
+		floods[i].b = malloc(MEMCPY_SIZE);
+		if (!floods[i].a || !floods[i].b) {
+			ret = -ENOMEM;
+			goto out;
+		}
+		memset(floods[i].a, 0x5a, MEMCPY_SIZE);
+		memset(floods[i].b, 0xa5, MEMCPY_SIZE);
+	}
+	for (i = 0; i < opts->threads; i++) {
+		if (pthread_create(&floods[i].thread, NULL, flood_thread,
+				   &floods[i])) {
+			ret = -errno;
+			stop = 1;
+			while (i--)
+				pthread_join(floods[i].thread, NULL);
+			goto out;
+		}
+	}
+
+	t0 = win_start = now_sec();
+	do {
+		if (read_sysfs_uint(level_fd, &level)) {
+			ret = -EIO;
+			break;
+		}
+		samples++;
+		win_samples++;
+		sum += level;
+		if (level < min)
+			min = level;
+		if (!level) {
+			empty++;
+			win_empty++;
+		}
+
+		t = now_sec();
+		if (t - win_start >= frame) {
+			if ((double)win_empty / win_samples > worst)
+				worst = (double)win_empty / win_samples;
+			win_start = t;
+			win_samples = win_empty = 0;
+		}
+	} while (t - t0 < opts->seconds);
+
+	stop = 1;
+	for (i = 0; i < opts->threads; i++) {
+		pthread_join(floods[i].thread, NULL);
+		copied += floods[i].copies;
+	}
+
+	if (!ret && samples)
+		printf("afi     rd_qos %-7s memcpy %8.1f MB/s, rd fifo min %u avg %.1f, empty %.1f%%, worst frame %.1f%% empty\n",
+		       qos_label, copied * MEMCPY_SIZE / (t - t0) / 1e6, min,
+		       (double)sum / samples, empty * 100.0 / samples,
+		       worst * 100);
+
+out:
+	for (i = 0; i < opts->threads; i++) {
+		free(floods[i].a);
+		free(floods[i].b);
+	}
+	return ret;
+}
+
+static int run_afi(struct bench_dev *dev, const struct bench_opts *opts,
+		   const uint8_t *src)
+{
+	struct fb_op_rect r = { 0, 0, dev->mode.hdisplay, dev->mode.vdisplay };
+	char path[256], label[16], saved_qos[16] = "";
+	struct bench_buf buf;
+	const char *dir = opts->afi_dir;
+	glob_t g = { 0 };
+	unsigned int i;
+	int level_fd, qos_fd, ret;
+	ssize_t n;
+
+	if (!dir) {
+		if (glob(AFI_SYSFS_GLOB "/rd_fifo_level", 0, NULL, &g) ||
+		    !g.gl_pathc) {
+			fprintf(stderr, "no zynq-afi-qos device, use -A\n");
+			globfree(&g);
+			return -ENODEV;
+		}
+		*strrchr(g.gl_pathv[0], '/') = 0;
+		dir = g.gl_pathv[0];
+	}
+
+	snprintf(path, sizeof(path), "%s/rd_fifo_level", dir);
+	level_fd = open(path, O_RDONLY);
+	snprintf(path, sizeof(path), "%s/rd_qos", dir);
+	qos_fd = open(path, O_RDWR);
+	if (level_fd < 0 || qos_fd < 0) {
+		ret = -errno;
+		fprintf(stderr, "cannot open %s sysfs: %s\n", dir, strerror(-ret));
+		goto out_fd;
+	}
+	n = pread(qos_fd, saved_qos, sizeof(saved_qos) - 1, 0);
+	if (n > 0)
+		saved_qos[n] = 0;
+
+	ret = buf_create(dev, &buf, opts, MAP_WC);
+	if (ret)
+		goto out_fd;
+	fb_op_blit(buf.map, buf.pitch, &r, opts->cpp, src, 0);
+
+	printf("afi     %s, %u memcpy threads\n", dir, opts->threads);
+	if (!opts->nqos) {
+		snprintf(label, sizeof(label), "%u", (unsigned int)atoi(saved_qos));
+		ret = afi_stress(dev, opts, level_fd, label);
+	}
+	for (i = 0; !ret && i < opts->nqos; i++) {
+		n = snprintf(label, sizeof(label), "%u", opts->qos[i]);
+		if (pwrite(qos_fd, label, n, 0) != n) {
+			ret = -errno;
+			fprintf(stderr, "cannot set rd_qos %s\n", label);
+			break;
+		}
+		ret = afi_stress(dev, opts, level_fd, label);
+	}
+
+	if (saved_qos[0])
+		pwrite(qos_fd, saved_qos, strlen(saved_qos), 0);
+	buf_destroy(dev, &buf);
+out_fd:
+	if (level_fd >= 0)
+		close(level_fd);
+	if (qos_fd >= 0)
+		close(qos_fd);
+	globfree(&g);
+	return ret;
+}
+
+static int run_ddr(struct bench_dev *dev, const struct bench_opts *opts,
+		   const uint8_t *src)
+{
+	static const struct {
+		const char *name;
+		char param;
+	} pitches[] = {
+		{ "tight", 'N' },
+		{ "ddr",   'Y' },
+	};
+	struct fb_op_rect r = { 0, 0, dev->mode.hdisplay, dev->mode.vdisplay };
+	struct bench_buf buf;
+	double idle, busy, scanout, headroom;
+	uint8_t *a, *b;
+	unsigned int i;
+	int ret = 0;
+
+	a = malloc(MEMCPY_SIZE);
+	b = malloc(MEMCPY_SIZE);
+	if (!a || !b) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	memset(a, 0x5a, MEMCPY_SIZE);
+	memset(b, 0xa5, MEMCPY_SIZE);
+
+	/* The frame buffer DMA fetches the active bytes of every line */
+	scanout = (double)dev->mode.hdisplay * opts->cpp * dev->mode.vdisplay *
+		  dev->mode.vrefresh / 1e6;
+
+	drmModeSetCrtc(dev->fd, dev->crtc_id, 0, 0, 0, NULL, 0, NULL);
+	idle = memcpy_mbps(a, b, opts->seconds);
+	printf("ddr     scanout off          memcpy %8.1f MB/s\n", idle);
+
+	for (i = 0; i < sizeof(pitches) / sizeof(pitches[0]); i++) {
+		if (write_param(DUMB_DDR_PITCH_PARAM, pitches[i].param)) {
+			fprintf(stderr, "cannot select %s pitch (%s)\n",
+				pitches[i].name, DUMB_DDR_PITCH_PARAM);
+			continue;
+		}
+
+		ret = buf_create(dev, &buf, opts, MAP_WC);
+		if (ret)
+			goto out;
+		fb_op_blit(buf.map, buf.pitch, &r, opts->cpp, src, 0);
+
+		busy = memcpy_mbps(a, b, opts->seconds);
+		/* memcpy moves every byte twice: one read, one write */
+		headroom = opts->ddr_mbps - 2 * busy - scanout;
+
+		printf("ddr     scanout %-5s %5u  memcpy %8.1f MB/s (%+.1f%%), scanout %.1f MB/s, headroom %.1f MB/s (%.0f%% of scanout)\n",
+		       pitches[i].name, buf.pitch, busy,
+		       (busy - idle) * 100 / idle, scanout, headroom,
+		       headroom * 100 / scanout);
+
+		buf_destroy(dev, &buf);
+	}
+
+out:
+	free(a);
+	free(b);
+	return ret;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  -D <device>   DRM device (default /dev/dri/card0)\n"
+		"  -f <format>   RG24 or XR24 (default RG24)\n"
+		"  -m <map>      wc, cached or both (default both)\n"
+		"  -n <loops>    iterations per test (default 20)\n"
+		"  -r <WxH>      centred damage rectangle (default full screen)\n"
+		"  -t <test>     cpu, ddr, afi or all (default cpu)\n"
+		"  -B <MB/s>     nominal DDR bandwidth for ddr (default %.0f)\n"
+		"  -s <seconds>  memcpy run time for ddr and afi (default 2)\n"
+		"  -A <dir>      zynq-afi-qos sysfs directory for afi\n"
+		"  -j <threads>  memcpy threads for afi (default 2)\n"
+		"  -q <list>     read QoS values to compare for afi, e.g. 0,15\n",
+		prog, DDR_NOMINAL_MBPS);
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench_opts opts = {
+		.device = "/dev/dri/card0",
+		.format = DRM_FORMAT_RGB888,
+		.cpp = 3,
+		.loops = 20,
+		.map_wc = 1,
+		.map_cached = 1,
+		.test_cpu = 1,
+		.ddr_mbps = DDR_NOMINAL_MBPS,
+		.seconds = 2,
+		.threads = 2,
+	};
+	struct bench_dev dev = { .fd = -1 };
+	uint8_t *src;
+	char saved = 0, saved_pitch = 0;
+	int opt, ret = 0;
+	char *tok;
+
+	while ((opt = getopt(argc, argv, "A:B:D:f:j:m:n:q:r:s:t:h")) != -1) {
+		switch (opt) {
+		case 'A':
+			opts.afi_dir = optarg;
+			break;
+		case 'B':
+			opts.ddr_mbps = strtod(optarg, NULL);
+			break;
+		case 'D':
+			opts.device = optarg;
+			break;
+		case 'f':
+			if (!strcmp(optarg, "RG24")) {
+				opts.format = DRM_FORMAT_RGB888;
+				opts.cpp = 3;
+			} else if (!strcmp(optarg, "XR24")) {
+				opts.format = DRM_FORMAT_XRGB8888;
+				opts.cpp = 4;
+			} else {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'j':
+			opts.threads = strtoul(optarg, NULL, 0);
+			if (!opts.threads || opts.threads > AFI_MAX_THREADS)
+				opts.threads = 2;
+			break;
+		case 'q':
+			for (tok = strtok(optarg, ","); tok && opts.nqos < AFI_MAX_QOS;
+			     tok = strtok(NULL, ","))
+				opts.qos[opts.nqos++] = strtoul(tok, NULL, 0);
+			break;
+		case 'm':
+			opts.map_wc = !strcmp(optarg, "wc") || !strcmp(optarg, "both");
+			opts.map_cached = !strcmp(optarg, "cached") ||
+					  !strcmp(optarg, "both");
+			if (!opts.map_wc && !opts.map_cached) {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'n':
+			opts.loops = strtoul(optarg, NULL, 0);
+			if (!opts.loops)
+				opts.loops = 1;
+			break;
+		case 'r':
+			if (sscanf(optarg, "%ux%u", &opts.rect_w, &opts.rect_h) != 2) {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 's':
+			opts.seconds = strtod(optarg, NULL);
+			break;
+		case 't':
+			opts.test_cpu = !strcmp(optarg, "cpu") || !strcmp(optarg, "all");
+			opts.test_ddr = !strcmp(optarg, "ddr") || !strcmp(optarg, "all");
+			opts.test_afi = !strcmp(optarg, "afi") || !strcmp(optarg, "all");
+			if (!opts.test_cpu && !opts.test_ddr && !opts.test_afi) {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (dev_open(&dev, opts.device)) {
+		if (dev.fd >= 0)
+			close(dev.fd);
+		return 1;
+	}
+
+	src = fb_op_image(dev.mode.hdisplay, opts.cpp);
+	if (!src) {
+		dev_close(&dev);
+		return 1;
+	}
+
+	read_param(DUMB_CACHED_PARAM, &saved);
+	read_param(DUMB_DDR_PITCH_PARAM, &saved_pitch);
+
+	printf("%s: %ux%u@%u, %u bytes/pixel, %u iterations\n", opts.device,
+	       dev.mode.hdisplay, dev.mode.vdisplay, dev.mode.vrefresh,
+	       opts.cpp, opts.loops);
+
+	if (opts.test_cpu && opts.map_wc && run_map(&dev, &opts, MAP_WC, src))
+		ret = 1;
+	if (opts.test_cpu && opts.map_cached &&
+	    run_map(&dev, &opts, MAP_CACHED, src))
+		ret = 1;
+	if (opts.test_ddr && run_ddr(&dev, &opts, src))
+		ret = 1;
+	if (opts.test_afi && run_afi(&dev, &opts, src))
+		ret = 1;
+
+	if (saved)
+		write_param(DUMB_CACHED_PARAM, saved);
+	if (saved_pitch)
+		write_param(DUMB_DDR_PITCH_PARAM, saved_pitch);
+
+	free(src);
+	dev_close(&dev);
+	return ret;
+}
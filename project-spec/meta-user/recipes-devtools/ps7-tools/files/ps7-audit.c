@@ -0,0 +1,591 @@
+/*
+ * ps7-audit - decode the PS clock tree and check the scanout bandwidth
+ *
+ * Reads the SLCR PLL and clock registers, the DDRC bus width, the HP port
+ * (AFI) setup and the frame buffer read and VTC registers of the display
+ * pipeline, either live through /dev/mem or from the register file that
+ * ps7_init leaves behind in the simulator. From the decoded clocks it
+ * derives the ceilings the scanout runs into: the frame buffer engine on
+ * its AXI clock, the HP port on the PL and the DDR side, and the DDR bus,
+ * each with its headroom over the mode being scanned out.
+ *
+ * PL registers are only read when the PL is configured, the level shifters
+ * are enabled and the fabric clock of the display is out of reset; an AXI
+ * access to an unconfigured PL hangs the interconnect.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "ps7-sim.h"
+
+#define SLCR_ARM_PLL_CTRL	0xF8000100
+#define SLCR_DDR_PLL_CTRL	0xF8000104
+#define SLCR_IO_PLL_CTRL	0xF8000108
+#define SLCR_PLL_STATUS		0xF800010C
+#define SLCR_ARM_CLK_CTRL	0xF8000120
+#define SLCR_DDR_CLK_CTRL	0xF8000124
+#define SLCR_FPGA_CLK_CTRL(n)	(0xF8000170 + (n) * 0x10)
+#define SLCR_CLK_621_TRUE	0xF80001C4
+#define SLCR_FPGA_RST_CTRL	0xF8000240
+#define SLCR_LVL_SHFTR_EN	0xF8000900
+#define DDRC_CTRL		0xF8006000
+#define DEVCFG_INT_STS		0xF800700C
+#define AFI_BASE(n)		(0xF8008000 + (n) * 0x1000)
+
+#define PLL_CTRL_RESET		(1U << 0)
+#define PLL_CTRL_PWRDWN		(1U << 1)
+#define PLL_CTRL_BYPASS_FORCE	(1U << 4)
+#define PLL_CTRL_FDIV(v)	(((v) >> 12) & 0x7F)
+#define CLK_SRCSEL(v)		(((v) >> 4) & 0x3)
+#define CLK_DIV0(v)		(((v) >> 8) & 0x3F)
+#define CLK_DIV1(v)		(((v) >> 20) & 0x3F)
+#define DDR_CLK_3X_DIV(v)	(((v) >> 20) & 0x3F)
+#define DDR_CLK_2X_DIV(v)	(((v) >> 26) & 0x3F)
+#define DDRC_CTRL_BUS_WIDTH(v)	(((v) >> 2) & 0x3)
+#define DEVCFG_PCFG_DONE	(1U << 2)
+
+#define AFI_RDCHAN_CTRL		0x00
+#define AFI_RDCHAN_ISSUINGCAP	0x04
+#define AFI_RDQOS		0x08
+#define AFI_CHAN_CTRL_32BIT	(1U << 0)
+#define AFI_CHAN_CTRL_FABRIC_QOS_EN (1U << 1)
+
+/* display pipeline of this design, see system-user.dtsi */
+#define FRMBUF_BASE		0x43C10000
+#define VTC_BASE		0x43C20000
+
+/* Video Frame Buffer Read, as in xilinx_frmbuf.c */
+#define XFB_CTRL		0x00
+#define XFB_WIDTH		0x10
+#define XFB_HEIGHT		0x18
+#define XFB_STRIDE		0x20
+#define XFB_FMT			0x28
+#define XFB_CTRL_AP_START	(1U << 0)
+#define XFB_CTRL_AUTO_RESTART	(1U << 7)
+
+/* Video Timing Controller generator, as in xlnx_vtc.c */
+#define XVTC_CTL		0x000
+#define XVTC_GASIZE		0x060
+#define XVTC_GHSIZE		0x070
+#define XVTC_GVSIZE		0x074
+#define XVTC_CTL_GE		(1U << 2)
+
+#define PAGE_MASK		0xFFFU
+#define MAX_MAPS		8
+
+enum pll { PLL_ARM, PLL_DDR, PLL_IO };
+
+static const char *const pll_names[] = { "ARM", "DDR", "IO" };
+
+/* ARM_CLK_CTRL and FPGAn_CLK_CTRL SRCSEL to PLL */
+static const enum pll cpu_srcsel[] = { PLL_ARM, PLL_ARM, PLL_DDR, PLL_IO };
+static const enum pll fpga_srcsel[] = { PLL_IO, PLL_IO, PLL_ARM, PLL_DDR };
+
+/* Frame buffer memory formats, bytes per pixel summed over the planes */
+static const struct {
+	unsigned int id;
+	const char *name;
+	double bpp;
+} xfb_formats[] = {
+	{ 10, "rgbx8", 4 }, { 11, "yuvx8", 4 }, { 12, "yuyv8", 2 },
+	{ 13, "rgba8", 4 }, { 14, "yuva8", 4 }, { 15, "rgbx10", 4 },
+	{ 16, "yuvx10", 4 }, { 18, "y_uv8", 2 }, { 19, "y_uv8_420", 1.5 },
+	{ 20, "rgb8", 3 }, { 21, "yuv8", 3 }, { 24, "y8", 1 },
+	{ 26, "bgra8", 4 }, { 27, "bgrx8", 4 }, { 28, "uyvy8", 2 },
+	{ 29, "bgr8", 3 },
+};
+
+/* CEA-861 timings, to size -m and to find the pixel clock of the VTC */
+static const struct mode {
+	const char *name;
+	unsigned int hactive, vactive, htotal, vtotal;
+	double pixclk_hz;
+} modes[] = {
+	{ "640x480", 640, 480, 800, 525, 25.175e6 },
+	{ "800x600", 800, 600, 1056, 628, 40e6 },
+	{ "1280x720", 1280, 720, 1650, 750, 74.25e6 },
+	{ "1280x1024", 1280, 1024, 1688, 1066, 108e6 },
+	{ "1920x1080", 1920, 1080, 2200, 1125, 148.5e6 },
+};
+
+/* clock registers compared against ps7_init with -c */
+static const struct {
+	uint32_t addr;
+	const char *name;
+} clock_regs[] = {
+	{ SLCR_ARM_PLL_CTRL, "ARM_PLL_CTRL" },
+	{ SLCR_DDR_PLL_CTRL, "DDR_PLL_CTRL" },
+	{ SLCR_IO_PLL_CTRL, "IO_PLL_CTRL" },
+	{ SLCR_ARM_CLK_CTRL, "ARM_CLK_CTRL" },
+	{ SLCR_DDR_CLK_CTRL, "DDR_CLK_CTRL" },
+	{ SLCR_FPGA_CLK_CTRL(0), "FPGA0_CLK_CTRL" },
+	{ SLCR_FPGA_CLK_CTRL(1), "FPGA1_CLK_CTRL" },
+	{ SLCR_FPGA_CLK_CTRL(2), "FPGA2_CLK_CTRL" },
+	{ SLCR_FPGA_CLK_CTRL(3), "FPGA3_CLK_CTRL" },
+	{ SLCR_CLK_621_TRUE, "CLK_621_TRUE" },
+	{ SLCR_FPGA_RST_CTRL, "FPGA_RST_CTRL" },
+	{ SLCR_LVL_SHFTR_EN, "LVL_SHFTR_EN" },
+	{ DDRC_CTRL, "DDRC_CTRL" },
+};
+
+#define ARRAY_SIZE(a)	(sizeof(a) / sizeof((a)[0]))
+
+/* Register source: /dev/mem, or the simulator after ps7_init */
+struct regs {
+	int fd;
+	struct {
+		uint32_t base;
+		volatile uint32_t *ptr;
+	} maps[MAX_MAPS];
+	unsigned int nmaps;
+	struct ps7_sim *sim;
+};
+
+static int regs_open_live(struct regs *r)
+{
+	memset(r, 0, sizeof(*r));
+	r->fd = open("/dev/mem", O_RDONLY | O_SYNC);
+	if (r->fd < 0) {
+		fprintf(stderr, "cannot open /dev/mem: %s\n", strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+static void regs_close(struct regs *r)
+{
+	unsigned int i;
+
+	for (i = 0; i < r->nmaps; i++)
+		munmap((void *)r->maps[i].ptr, PAGE_MASK + 1);
+	if (!r->sim && r->fd >= 0)
+		close(r->fd);
+}
+
+/* 0xFFFFFFFF if the page cannot be mapped */
+static uint32_t reg_read(struct regs *r, uint32_t addr)
+{
+	uint32_t base = addr & ~PAGE_MASK;
+	void *ptr;
+	unsigned int i;
+
+	if (r->sim)
+		return ps7_sim_read(r->sim, addr);
+
+	for (i = 0; i < r->nmaps; i++)
+		if (r->maps[i].base == base)
+			return r->maps[i].ptr[(addr & PAGE_MASK) / 4];
+
+	if (r->nmaps == MAX_MAPS)
+		return 0xFFFFFFFF;
+
+	ptr = mmap(NULL, PAGE_MASK + 1, PROT_READ, MAP_SHARED, r->fd, base);
+	if (ptr == MAP_FAILED)
+		return 0xFFFFFFFF;
+
+	r->maps[r->nmaps].base = base;
+	r->maps[r->nmaps].ptr = ptr;
+	r->nmaps++;
+
+	return r->maps[r->nmaps - 1].ptr[(addr & PAGE_MASK) / 4];
+}
+
+static int regs_run_ps7_init(struct ps7_sim *sim, int rev)
+{
+	int phase, ret = PS7_INIT_SUCCESS;
+	int i;
+
+	/* AFI reset values; ps7_init leaves the HP ports alone */
+	for (i = 0; i < 4; i++)
+		ps7_sim_write(sim, AFI_BASE(i) + AFI_RDCHAN_ISSUINGCAP, 0x7);
+
+	for (phase = 0; phase < PS7_INIT_PHASES && ret == PS7_INIT_SUCCESS;
+	     phase++)
+		ret = ps7_sim_run(sim, ps7_phase_names[phase],
+				  ps7_table(rev, phase), NULL);
+
+	return ret;
+}
+
+struct clocks {
+	double ps_clk;
+	double pll[3];
+	double cpu_6x4x, cpu_3x2x, cpu_2x, cpu_1x;
+	double ddr_3x, ddr_2x;
+	unsigned int ddr_bytes;
+	double fclk[4];
+};
+
+static double pll_hz(struct regs *r, struct clocks *c, enum pll pll)
+{
+	uint32_t ctrl = reg_read(r, SLCR_ARM_PLL_CTRL + pll * 4);
+	uint32_t status = reg_read(r, SLCR_PLL_STATUS);
+	double hz = c->ps_clk * PLL_CTRL_FDIV(ctrl);
+	const char *state = "locked";
+
+	if (ctrl & (PLL_CTRL_RESET | PLL_CTRL_PWRDWN)) {
+		hz = 0;
+		state = ctrl & PLL_CTRL_PWRDWN ? "powered down" : "in reset";
+	} else if (ctrl & PLL_CTRL_BYPASS_FORCE) {
+		hz = c->ps_clk;
+		state = "bypassed";
+	} else if (!(status & (1U << pll))) {
+		state = "NOT LOCKED";
+	}
+
+	printf("%-3s PLL     x%-3u %10.3f MHz  %s\n", pll_names[pll],
+	       PLL_CTRL_FDIV(ctrl), hz / 1e6, state);
+
+	return hz;
+}
+
+static void decode_clocks(struct regs *r, struct clocks *c)
+{
+	uint32_t arm = reg_read(r, SLCR_ARM_CLK_CTRL);
+	uint32_t ddr = reg_read(r, SLCR_DDR_CLK_CTRL);
+	uint32_t ddrc = reg_read(r, DDRC_CTRL);
+	int six_two_one = reg_read(r, SLCR_CLK_621_TRUE) & 1;
+	uint32_t fpga, rst = reg_read(r, SLCR_FPGA_RST_CTRL);
+	unsigned int i;
+
+	printf("PS_CLK           %10.3f MHz\n", c->ps_clk / 1e6);
+	for (i = 0; i < 3; i++)
+		c->pll[i] = pll_hz(r, c, i);
+
+	c->cpu_6x4x = CLK_DIV0(arm) ?
+		      c->pll[cpu_srcsel[CLK_SRCSEL(arm)]] / CLK_DIV0(arm) : 0;
+	c->cpu_3x2x = c->cpu_6x4x / 2;
+	c->cpu_2x = c->cpu_6x4x / (six_two_one ? 3 : 2);
+	c->cpu_1x = c->cpu_6x4x / (six_two_one ? 6 : 4);
+	printf("CPU 6x4x         %10.3f MHz  %s PLL /%u, %s; 3x2x %.3f, 2x %.3f, 1x %.3f\n",
+	       c->cpu_6x4x / 1e6, pll_names[cpu_srcsel[CLK_SRCSEL(arm)]],
+	       CLK_DIV0(arm), six_two_one ? "6:2:1" : "4:2:1",
+	       c->cpu_3x2x / 1e6, c->cpu_2x / 1e6, c->cpu_1x / 1e6);
+
+	c->ddr_3x = DDR_CLK_3X_DIV(ddr) ?
+		    c->pll[PLL_DDR] / DDR_CLK_3X_DIV(ddr) : 0;
+	c->ddr_2x = DDR_CLK_2X_DIV(ddr) ?
+		    c->pll[PLL_DDR] / DDR_CLK_2X_DIV(ddr) : 0;
+	c->ddr_bytes = DDRC_CTRL_BUS_WIDTH(ddrc) == 1 ? 2 : 4;
+	printf("DDR 3x           %10.3f MHz  DDR PLL /%u; 2x %.3f MHz, %u-bit bus\n",
+	       c->ddr_3x / 1e6, DDR_CLK_3X_DIV(ddr), c->ddr_2x / 1e6,
+	       c->ddr_bytes * 8);
+
+	for (i = 0; i < 4; i++) {
+		fpga = reg_read(r, SLCR_FPGA_CLK_CTRL(i));
+		c->fclk[i] = CLK_DIV0(fpga) && CLK_DIV1(fpga) ?
+			     c->pll[fpga_srcsel[CLK_SRCSEL(fpga)]] /
+			     CLK_DIV0(fpga) / CLK_DIV1(fpga) : 0;
+		printf("FCLK%u            %10.3f MHz  %s PLL /%u /%u%s\n", i,
+		       c->fclk[i] / 1e6, pll_names[fpga_srcsel[CLK_SRCSEL(fpga)]],
+		       CLK_DIV0(fpga), CLK_DIV1(fpga),
+		       rst & (1U << i) ? ", FCLK_RESET asserted" : "");
+	}
+
+	printf("ps7_init.h       APU_FREQ %.3f MHz, DDR_FREQ %.3f MHz\n",
+	       APU_FREQ / 1e6, DDR_FREQ / 1e6);
+	if (c->cpu_6x4x < APU_FREQ * 0.99 || c->cpu_6x4x > APU_FREQ * 1.01)
+		printf("  CPU clock differs from APU_FREQ\n");
+	if (c->ddr_3x < DDR_FREQ * 0.99 || c->ddr_3x > DDR_FREQ * 1.01)
+		printf("  DDR clock differs from DDR_FREQ\n");
+}
+
+struct scanout {
+	unsigned int hactive, vactive, htotal, vtotal;
+	double pixclk_hz;
+	double bpp;
+	const char *source;
+};
+
+static const struct mode *find_mode(const char *name, unsigned int htotal,
+				    unsigned int vtotal)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(modes); i++)
+		if (name ? !strcmp(modes[i].name, name) :
+		    modes[i].htotal == htotal && modes[i].vtotal == vtotal)
+			return &modes[i];
+
+	return NULL;
+}
+
+/* PL side: frame buffer and VTC state, 0 if they could be read */
+static int read_pipeline(struct regs *r, struct scanout *s, int axi_fclk)
+{
+	uint32_t ctrl, fmt, gasize, vtc_ctl;
+	const struct mode *mode;
+	unsigned int i;
+
+	if (!(reg_read(r, DEVCFG_INT_STS) & DEVCFG_PCFG_DONE)) {
+		printf("PL               not configured\n");
+		return -1;
+	}
+	if ((reg_read(r, SLCR_LVL_SHFTR_EN) & 0xF) != 0xF) {
+		printf("PL               level shifters disabled\n");
+		return -1;
+	}
+	if (reg_read(r, SLCR_FPGA_RST_CTRL) & (1U << axi_fclk)) {
+		printf("PL               FCLK_RESET%d asserted\n", axi_fclk);
+		return -1;
+	}
+
+	ctrl = reg_read(r, FRMBUF_BASE + XFB_CTRL);
+	fmt = reg_read(r, FRMBUF_BASE + XFB_FMT);
+	for (i = 0; i < ARRAY_SIZE(xfb_formats); i++)
+		if (xfb_formats[i].id == fmt)
+			break;
+	printf("frmbuf           %s, %ux%u stride %u, format %u (%s)\n",
+	       ctrl & XFB_CTRL_AUTO_RESTART ? "running" :
+	       ctrl & XFB_CTRL_AP_START ? "one frame" : "stopped",
+	       reg_read(r, FRMBUF_BASE + XFB_WIDTH),
+	       reg_read(r, FRMBUF_BASE + XFB_HEIGHT),
+	       reg_read(r, FRMBUF_BASE + XFB_STRIDE), fmt,
+	       i < ARRAY_SIZE(xfb_formats) ? xfb_formats[i].name : "unknown");
+	if (i < ARRAY_SIZE(xfb_formats))
+		s->bpp = xfb_formats[i].bpp;
+	if (reg_read(r, FRMBUF_BASE + XFB_STRIDE) <
+	    reg_read(r, FRMBUF_BASE + XFB_WIDTH) * s->bpp)
+		printf("  stride is shorter than a line\n");
+
+	vtc_ctl = reg_read(r, VTC_BASE + XVTC_CTL);
+	gasize = reg_read(r, VTC_BASE + XVTC_GASIZE);
+	s->hactive = gasize & 0x1FFF;
+	s->vactive = (gasize >> 16) & 0x1FFF;
+	s->htotal = reg_read(r, VTC_BASE + XVTC_GHSIZE) & 0x1FFF;
+	s->vtotal = reg_read(r, VTC_BASE + XVTC_GVSIZE) & 0x1FFF;
+	printf("VTC              generator %s, %ux%u active, %ux%u total\n",
+	       vtc_ctl & XVTC_CTL_GE ? "on" : "off", s->hactive, s->vactive,
+	       s->htotal, s->vtotal);
+
+	if (!(vtc_ctl & XVTC_CTL_GE) || !s->htotal || !s->vtotal)
+		return -1;
+
+	mode = find_mode(NULL, s->htotal, s->vtotal);
+	if (mode && !s->pixclk_hz)
+		s->pixclk_hz = mode->pixclk_hz;
+	s->source = "VTC";
+
+	return 0;
+}
+
+static void print_afi(struct regs *r, int port, unsigned int *bytes)
+{
+	uint32_t base = AFI_BASE(port);
+	uint32_t ctrl = reg_read(r, base + AFI_RDCHAN_CTRL);
+
+	*bytes = ctrl & AFI_CHAN_CTRL_32BIT ? 4 : 8;
+	printf("HP%d              %u-bit, read issuing cap %u, read QoS %u%s\n",
+	       port, *bytes * 8,
+	       (reg_read(r, base + AFI_RDCHAN_ISSUINGCAP) & 0x7) + 1,
+	       reg_read(r, base + AFI_RDQOS) & 0xF,
+	       ctrl & AFI_CHAN_CTRL_FABRIC_QOS_EN ? " (from fabric)" : "");
+}
+
+/* headroom of ceiling over need; returns 1 if the ceiling is below it */
+static int ceiling(const char *name, double bytes_s, double need)
+{
+	double headroom = need > 0 ? (bytes_s / need - 1) * 100 : 0;
+
+	printf("  %-34s %9.1f MB/s %+8.1f%%%s\n", name, bytes_s / 1e6,
+	       headroom, headroom < 0 ? "  STARVED" :
+	       headroom < 20 ? "  low" : "");
+
+	return headroom < 0;
+}
+
+static int compare_ps7_init(struct regs *live, struct ps7_sim *sim)
+{
+	uint32_t a, b;
+	unsigned int i;
+	int n = 0;
+
+	printf("\nclock registers, live against ps7_init:\n");
+	for (i = 0; i < ARRAY_SIZE(clock_regs); i++) {
+		a = reg_read(live, clock_regs[i].addr);
+		b = ps7_sim_read(sim, clock_regs[i].addr);
+		if (a == b)
+			continue;
+		printf("  %08X %-15s %08X  ps7_init %08X\n",
+		       clock_regs[i].addr, clock_regs[i].name, a, b);
+		n++;
+	}
+	if (!n)
+		printf("  no differences\n");
+
+	return n;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  -s              audit the registers ps7_init leaves, not the live ones\n"
+		"  -c              compare the live clock registers with ps7_init\n"
+		"  -r <rev>        silicon revision for -s and -c (default 3)\n"
+		"  -i <file>       with -s, preload registers from \"addr value\" lines\n"
+		"  -P <MHz>        PS_CLK frequency (default 33.333333)\n"
+		"  -a <n>          FCLK of the frame buffer AXI clocks (default 0)\n"
+		"  -p <n>          HP port of the frame buffer (default 0)\n"
+		"  -m <mode>       mode to check instead of the VTC's: 640x480, 800x600,\n"
+		"                  1280x720, 1280x1024 or 1920x1080\n"
+		"  -f <MHz>        pixel clock (default: CEA clock of the mode)\n"
+		"  -b <bytes>      bytes per pixel with -m (default 3, RG24)\n"
+		"  -x <n>          pixels per clock of the frame buffer (default 1)\n",
+		prog);
+}
+
+int main(int argc, char *argv[])
+{
+	struct scanout s = { .bpp = 3 };
+	struct clocks c = { .ps_clk = 33333333 };
+	const char *mode_name = NULL, *preload = NULL;
+	int sim_only = 0, compare = 0, rev = 3, axi_fclk = 0, port = 0;
+	unsigned int ppc = 1, hp_bytes;
+	const struct mode *mode;
+	double need, engine;
+	struct ps7_sim sim;
+	char name[48];
+	struct regs r;
+	int opt, ret, starved = 0;
+
+	while ((opt = getopt(argc, argv, "scr:i:P:a:p:m:f:b:x:h")) != -1) {
+		switch (opt) {
+		case 's':
+			sim_only = 1;
+			break;
+		case 'c':
+			compare = 1;
+			break;
+		case 'r':
+			rev = atoi(optarg);
+			if (rev < 1 || rev > PS7_NUM_REVS) {
+				fprintf(stderr, "invalid revision %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'i':
+			preload = optarg;
+			break;
+		case 'P':
+			c.ps_clk = strtod(optarg, NULL) * 1e6;
+			break;
+		case 'a':
+			axi_fclk = atoi(optarg) & 3;
+			break;
+		case 'p':
+			port = atoi(optarg) & 3;
+			break;
+		case 'm':
+			mode_name = optarg;
+			if (!find_mode(mode_name, 0, 0)) {
+				fprintf(stderr, "unknown mode %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'f':
+			s.pixclk_hz = strtod(optarg, NULL) * 1e6;
+			break;
+		case 'b':
+			s.bpp = strtod(optarg, NULL);
+			break;
+		case 'x':
+			ppc = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (sim_only || compare) {
+		if (ps7_sim_init(&sim)) {
+			fprintf(stderr, "out of memory\n");
+			return 1;
+		}
+		sim.cost.ps_clk_hz = c.ps_clk;
+		if (preload && sim_only) {
+			ret = ps7_sim_preload(&sim, preload);
+			if (ret) {
+				fprintf(stderr, "cannot load %s: %s\n", preload,
+					strerror(-ret));
+				return 1;
+			}
+		}
+		ret = regs_run_ps7_init(&sim, rev);
+		if (ret != PS7_INIT_SUCCESS) {
+			fprintf(stderr, "ps7_init failed: %s\n",
+				getPS7MessageInfo(ret));
+			return 1;
+		}
+	}
+
+	if (sim_only) {
+		memset(&r, 0, sizeof(r));
+		r.sim = &sim;
+		printf("registers after ps7_init, silicon %d.0\n", rev);
+	} else if (regs_open_live(&r)) {
+		return 1;
+	}
+
+	decode_clocks(&r, &c);
+	print_afi(&r, port, &hp_bytes);
+
+	if (mode_name || r.sim || read_pipeline(&r, &s, axi_fclk)) {
+		mode = find_mode(mode_name ? mode_name : "1280x720", 0, 0);
+		s.hactive = mode->hactive;
+		s.vactive = mode->vactive;
+		s.htotal = mode->htotal;
+		s.vtotal = mode->vtotal;
+		if (!s.pixclk_hz)
+			s.pixclk_hz = mode->pixclk_hz;
+		s.source = mode->name;
+	}
+
+	if (!s.pixclk_hz) {
+		fprintf(stderr, "unknown pixel clock for %ux%u, use -f\n",
+			s.htotal, s.vtotal);
+		regs_close(&r);
+		return 1;
+	}
+
+	/* the frame buffer fetches at the pixel rate while a line is active */
+	need = s.pixclk_hz * s.bpp;
+	printf("\nscanout %ux%u@%.2f Hz (%s), %.3f MHz, %.1f bytes/pixel\n",
+	       s.hactive, s.vactive,
+	       s.pixclk_hz / ((double)s.htotal * s.vtotal), s.source,
+	       s.pixclk_hz / 1e6, s.bpp);
+	printf("  %-34s %9.1f MB/s\n", "frame average",
+	       s.hactive * s.vactive * s.bpp * s.pixclk_hz /
+	       ((double)s.htotal * s.vtotal) / 1e6);
+	printf("  %-34s %9.1f MB/s\n", "during active lines", need / 1e6);
+
+	printf("\nceilings over the active line rate:\n");
+	engine = c.fclk[axi_fclk] * ppc;
+	snprintf(name, sizeof(name), "frmbuf, %u pixel/clk on FCLK%d", ppc,
+		 axi_fclk);
+	starved |= ceiling(name, engine * s.bpp, need);
+	snprintf(name, sizeof(name), "HP%d PL side, %u-bit on FCLK%d", port,
+		 hp_bytes * 8, axi_fclk);
+	starved |= ceiling(name, c.fclk[axi_fclk] * hp_bytes, need);
+	snprintf(name, sizeof(name), "HP%d DDR side, 64-bit on DDR 2x", port);
+	starved |= ceiling(name, c.ddr_2x * 8, need);
+	snprintf(name, sizeof(name), "DDR, %u-bit at 2 x DDR 3x (shared)",
+		 c.ddr_bytes * 8);
+	starved |= ceiling(name, c.ddr_3x * 2 * c.ddr_bytes, need);
+
+	if (compare && !sim_only)
+		compare_ps7_init(&r, &sim);
+
+	regs_close(&r);
+	if (sim_only || compare)
+		ps7_sim_free(&sim);
+
+	return starved ? 2 : 0;
+}
@@ -0,0 +1,170 @@
+/*
+ * ps7-emu - replay the ps7_init tables against a simulated register file
+ *
+ * Runs the opcode streams generated into ps7_init.c for one silicon
+ * revision the way ps7_init() does, but on the host. Every entry is traced
+ * with its result, estimated CPU cycles and time, so boot-time register
+ * programming can be profiled and diffed against a known good trace in CI.
+ *
+ * Trace columns: phase, entry index, opcode, address, mask, value, register
+ * value after the entry, poll iterations or delay, CPU cycles, entry time
+ * in us and simulated time since the start in us.
+ */
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ps7-sim.h"
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [options] [phase...]\n"
+		"  -r <rev>        silicon revision 1, 2 or 3 (default 3)\n"
+		"  -l <event=us>   event latency, -1 never completes; events:\n"
+		"                  arm_pll ddr_pll io_pll (default LOCK_CNT), dci, ddr_init\n"
+		"  -i <file>       preload registers from \"addr value\" lines\n"
+		"  -P <MHz>        PS_CLK frequency (default 33.333333)\n"
+		"  -c <cycles>     CPU cycles per table entry (default 12)\n"
+		"  -R <ns>         register read latency (default 120)\n"
+		"  -W <ns>         register write latency (default 60)\n"
+		"  -o <file>       write the trace to a file\n"
+		"  -q              summary only, no trace\n"
+		"  -d              dump the register file at the end\n"
+		"phases: mio pll clock ddr peripherals post_config debug\n"
+		"        (default: the ps7_init() sequence)\n",
+		prog);
+}
+
+static int set_latency(struct ps7_sim *sim, char *arg)
+{
+	char *eq = strchr(arg, '=');
+	double us;
+
+	if (!eq)
+		return -EINVAL;
+	*eq = 0;
+	us = strtod(eq + 1, NULL);
+	return ps7_sim_set_latency(sim, arg, us < 0 ? PS7_SIM_NEVER : us * 1e3);
+}
+
+int main(int argc, char *argv[])
+{
+	struct ps7_sim_stats stats[PS7_NUM_PHASES] = { 0 }, total = { 0 };
+	int phases[PS7_NUM_PHASES * 2];
+	int nphases = 0, rev = 3, quiet = 0, dump = 0;
+	const char *out = NULL;
+	struct ps7_sim sim;
+	int opt, i, ret = 0;
+
+	if (ps7_sim_init(&sim)) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	while ((opt = getopt(argc, argv, "r:l:i:P:c:R:W:o:qdh")) != -1) {
+		switch (opt) {
+		case 'r':
+			rev = atoi(optarg);
+			if (rev < 1 || rev > PS7_NUM_REVS) {
+				fprintf(stderr, "invalid revision %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'l':
+			if (set_latency(&sim, optarg)) {
+				fprintf(stderr, "invalid latency %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'i':
+			ret = ps7_sim_preload(&sim, optarg);
+			if (ret) {
+				fprintf(stderr, "cannot load %s: %s\n", optarg,
+					strerror(-ret));
+				return 1;
+			}
+			break;
+		case 'P':
+			sim.cost.ps_clk_hz = strtod(optarg, NULL) * 1e6;
+			break;
+		case 'c':
+			sim.cost.decode_cycles = strtoul(optarg, NULL, 0);
+			break;
+		case 'R':
+			sim.cost.read_ns = strtod(optarg, NULL);
+			break;
+		case 'W':
+			sim.cost.write_ns = strtod(optarg, NULL);
+			break;
+		case 'o':
+			out = optarg;
+			break;
+		case 'q':
+			quiet = 1;
+			break;
+		case 'd':
+			dump = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	for (i = optind; i < argc && nphases < PS7_NUM_PHASES * 2; i++) {
+		phases[nphases] = ps7_phase_lookup(argv[i]);
+		if (phases[nphases] < 0) {
+			fprintf(stderr, "unknown phase %s\n", argv[i]);
+			return 1;
+		}
+		nphases++;
+	}
+	if (!nphases)
+		for (nphases = 0; nphases < PS7_INIT_PHASES; nphases++)
+			phases[nphases] = nphases;
+
+	if (!quiet) {
+		sim.trace = out ? fopen(out, "w") : stdout;
+		if (!sim.trace) {
+			fprintf(stderr, "cannot open %s: %s\n", out,
+				strerror(errno));
+			return 1;
+		}
+	}
+
+	for (i = 0; i < nphases && ret == PS7_INIT_SUCCESS; i++)
+		ret = ps7_sim_run(&sim, ps7_phase_names[phases[i]],
+				  ps7_table(rev, phases[i]), &stats[phases[i]]);
+
+	printf("\nsilicon %d.0, %s\n", rev, getPS7MessageInfo(ret));
+	printf("%-11s %6s %6s %5s %10s %12s %12s\n", "phase", "ops", "writes",
+	       "polls", "cycles", "time us", "poll us");
+	for (i = 0; i < PS7_NUM_PHASES; i++) {
+		if (!stats[i].ops)
+			continue;
+		printf("%-11s %6lu %6lu %5lu %10.0f %12.3f %12.3f\n",
+		       ps7_phase_names[i], stats[i].ops, stats[i].writes,
+		       stats[i].polls, stats[i].cycles, stats[i].ns / 1e3,
+		       stats[i].poll_ns / 1e3);
+		total.ops += stats[i].ops;
+		total.writes += stats[i].writes;
+		total.polls += stats[i].polls;
+		total.cycles += stats[i].cycles;
+		total.ns += stats[i].ns;
+		total.poll_ns += stats[i].poll_ns;
+	}
+	printf("%-11s %6lu %6lu %5lu %10.0f %12.3f %12.3f\n", "total",
+	       total.ops, total.writes, total.polls, total.cycles,
+	       total.ns / 1e3, total.poll_ns / 1e3);
+
+	if (dump)
+		ps7_sim_dump(&sim, stdout);
+
+	if (sim.trace && sim.trace != stdout)
+		fclose(sim.trace);
+	ps7_sim_free(&sim);
+	return ret;
+}
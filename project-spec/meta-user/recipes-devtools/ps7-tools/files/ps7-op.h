@@ -0,0 +1,25 @@
+/*
+ * ps7-op.h - one decoded ps7_init table entry
+ *
+ * Shared by the host tools and the packed table interpreter, which is
+ * built into the boot loader, so it only needs stdint.h.
+ */
+#ifndef PS7_OP_H
+#define PS7_OP_H
+
+#include <stdint.h>
+
+/*
+ * opcode is one of the OPCODE_* values from ps7_init.h. A WRITE has an
+ * all-ones mask, a CLEAR a zero value, and for MASKPOLL and MASKDELAY the
+ * second argument is in mask.
+ */
+struct ps7_op {
+	unsigned int opcode;
+	unsigned int numargs;
+	uint32_t addr;
+	uint32_t mask;
+	uint32_t val;
+};
+
+#endif
@@ -0,0 +1,73 @@
+/*
+ * ps7-pack-verify.c - checks of packed ps7_init tables against ps7_init.c
+ */
+#include "ps7-tables.h"
+#include "ps7-pack.h"
+
+_Static_assert(PS7_NUM_PHASES == PS7_PACKED_PHASES &&
+	       PS7_NUM_REVS == PS7_PACKED_REVS,
+	       "ps7-packed.h out of step with ps7-tables.h");
+
+/* Store op the way the EMIT_* macros lay it out, returns the word count */
+static unsigned int ps7_pack_words(const struct ps7_op *op, unsigned long *w)
+{
+	unsigned int n = 0;
+
+	w[n++] = (op->opcode << 4) | op->numargs;
+	if (op->opcode == OPCODE_EXIT)
+		return n;
+	w[n++] = op->addr;
+	if (op->opcode == OPCODE_MASKWRITE || op->opcode == OPCODE_MASKPOLL ||
+	    op->opcode == OPCODE_MASKDELAY)
+		w[n++] = op->mask;
+	if (op->opcode == OPCODE_MASKWRITE || op->opcode == OPCODE_WRITE)
+		w[n++] = op->val;
+	return n;
+}
+
+static int ps7_pack_verify_one(const struct ps7_packed_table *table, int rev,
+			       int phase, FILE *f)
+{
+	const unsigned long *orig = ps7_table(rev, phase);
+	struct ps7_packed_cursor cur;
+	unsigned long words[4], pos = 0;
+	unsigned int i, n;
+	struct ps7_op op;
+
+	ps7_packed_open(&cur, table, rev);
+	do {
+		if (ps7_packed_next(&cur, &op)) {
+			fprintf(f, "%s %d.0: corrupt data at word %lu\n",
+				ps7_phase_names[phase], rev, pos);
+			return 1;
+		}
+		n = ps7_pack_words(&op, words);
+		for (i = 0; i < n; i++, pos++) {
+			if (words[i] != orig[pos]) {
+				fprintf(f, "%s %d.0: word %lu is 0x%08lx, expected 0x%08lx\n",
+					ps7_phase_names[phase], rev, pos,
+					words[i], orig[pos]);
+				return 1;
+			}
+		}
+	} while (op.opcode != OPCODE_EXIT);
+
+	if (cur.copy || cur.skip || cur.insert || cur.patch.run || cur.patch.p != cur.patch.end) {
+		fprintf(f, "%s %d.0: patch not consumed at EXIT\n",
+			ps7_phase_names[phase], rev);
+		return 1;
+	}
+
+	return 0;
+}
+
+int ps7_pack_verify(const struct ps7_packed_table *tables, FILE *f)
+{
+	int rev, phase, bad = 0;
+
+	for (phase = 0; phase < PS7_NUM_PHASES; phase++)
+		for (rev = 1; rev <= PS7_NUM_REVS; rev++)
+			bad += ps7_pack_verify_one(&tables[phase], rev, phase, f);
+
+	return bad;
+}
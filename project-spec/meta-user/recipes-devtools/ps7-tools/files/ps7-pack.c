@@ -0,0 +1,438 @@
+/*
+ * ps7-pack - generate the packed form of the ps7_init tables
+ *
+ * Encodes each phase of the base revision as bytecode (see ps7-packed.h)
+ * and every other revision as a patch list against it, found with a
+ * longest common subsequence over the table entries. The result is
+ * expanded again and checked word for word against ps7_init.c before
+ * anything is written; a mismatch is an error.
+ */
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ps7-tables.h"
+#include "ps7-pack.h"
+
+struct pack_buf {
+	unsigned char *data;
+	size_t len;
+	size_t size;
+};
+
+/* Encoder side of struct ps7_packed_stream */
+struct pack_state {
+	struct ps7_op last;
+};
+
+struct pack_ops {
+	struct ps7_op *op;
+	size_t n;
+};
+
+static void pack_byte(struct pack_buf *b, unsigned int byte)
+{
+	if (b->len == b->size) {
+		b->size = b->size ? b->size * 2 : 1024;
+		b->data = realloc(b->data, b->size);
+		if (!b->data) {
+			fprintf(stderr, "out of memory\n");
+			exit(1);
+		}
+	}
+	b->data[b->len++] = byte;
+}
+
+static void pack_leb(struct pack_buf *b, uint32_t v)
+{
+	while (v >= 0x80) {
+		pack_byte(b, (v & 0x7F) | 0x80);
+		v >>= 7;
+	}
+	pack_byte(b, v);
+}
+
+static void pack_state_init(struct pack_state *s)
+{
+	memset(s, 0, sizeof(*s));
+	s->last.opcode = OPCODE_EXIT;
+	s->last.addr = PS7_PACKED_START_ADDR;
+}
+
+static int pack_load(int rev, int phase, struct pack_ops *ops)
+{
+	const unsigned long *table = ps7_table(rev, phase);
+	unsigned long pos = 0;
+	struct ps7_op op;
+	size_t size = 0;
+
+	ops->op = NULL;
+	ops->n = 0;
+	do {
+		if (ps7_decode(table, &pos, &op)) {
+			fprintf(stderr, "%s %d.0: bad entry at word %lu\n",
+				ps7_phase_names[phase], rev, pos);
+			return -EINVAL;
+		}
+		if (ops->n == size) {
+			size = size ? size * 2 : 256;
+			ops->op = realloc(ops->op, size * sizeof(op));
+			if (!ops->op)
+				return -ENOMEM;
+		}
+		ops->op[ops->n++] = op;
+	} while (op.opcode != OPCODE_EXIT);
+
+	return 0;
+}
+
+static int pack_same_op(const struct ps7_op *a, const struct ps7_op *b)
+{
+	return a->opcode == b->opcode && a->addr == b->addr &&
+	       a->mask == b->mask && a->val == b->val;
+}
+
+/* op continues a run after prev: same write kind, next register, same mask */
+static int pack_chains(const struct ps7_op *prev, const struct ps7_op *op)
+{
+	return (op->opcode == OPCODE_WRITE || op->opcode == OPCODE_MASKWRITE) &&
+	       op->opcode == prev->opcode && op->addr == prev->addr + 4 &&
+	       op->mask == prev->mask;
+}
+
+static void pack_one(struct pack_buf *b, struct pack_state *s,
+		     const struct ps7_op *op)
+{
+	int32_t delta = (int32_t)(op->addr - s->last.addr) / 4;
+	unsigned int amode = PS7_PACKED_ADDR_FULL;
+	unsigned int mmode = PS7_PACKED_MASK_PREV;
+	unsigned int vmode = 0, i;
+	int has_mask = op->opcode == OPCODE_MASKWRITE ||
+		       op->opcode == OPCODE_MASKPOLL ||
+		       op->opcode == OPCODE_MASKDELAY;
+	int has_val = op->opcode == OPCODE_WRITE ||
+		      op->opcode == OPCODE_MASKWRITE;
+
+	if (op->opcode == OPCODE_EXIT) {
+		pack_byte(b, PS7_PACKED_HDR(OPCODE_EXIT, 0, 0, 0));
+		s->last.opcode = OPCODE_EXIT;
+		return;
+	}
+
+	if (op->addr == s->last.addr + 4)
+		amode = PS7_PACKED_ADDR_NEXT;
+	else if (!((op->addr - s->last.addr) & 3) && delta >= -128 && delta < 128)
+		amode = PS7_PACKED_ADDR_DELTA8;
+	else if (!((op->addr - s->last.addr) & 3) && delta >= -32768 &&
+		 delta < 32768)
+		amode = PS7_PACKED_ADDR_DELTA16;
+
+	if (has_mask && op->mask != s->last.mask)
+		mmode = op->mask == 0xFFFFFFFF ? PS7_PACKED_MASK_ONES :
+						 PS7_PACKED_MASK_LEB;
+	if (has_val && op->val != s->last.val)
+		vmode = 1;
+
+	pack_byte(b, PS7_PACKED_HDR(op->opcode, amode, mmode, vmode));
+	if (amode == PS7_PACKED_ADDR_DELTA8)
+		pack_byte(b, delta & 0xFF);
+	else if (amode == PS7_PACKED_ADDR_DELTA16)
+		for (i = 0; i < 2; i++)
+			pack_byte(b, (delta >> (8 * i)) & 0xFF);
+	else if (amode == PS7_PACKED_ADDR_FULL)
+		for (i = 0; i < 4; i++)
+			pack_byte(b, (op->addr >> (8 * i)) & 0xFF);
+	if (mmode == PS7_PACKED_MASK_LEB)
+		pack_leb(b, op->mask);
+	if (vmode)
+		pack_leb(b, op->val);
+
+	s->last.opcode = op->opcode;
+	s->last.addr = op->addr;
+	if (has_mask)
+		s->last.mask = op->mask;
+	if (has_val)
+		s->last.val = op->val;
+}
+
+/*
+ * Encode n entries. A chain of registers written with the value of the
+ * previous one becomes a RUN_SAME; any other chain becomes a RUN_VALS up
+ * to where a RUN_SAME would start.
+ */
+static void pack_ops(struct pack_buf *b, struct pack_state *s,
+		     const struct ps7_op *ops, size_t n)
+{
+	size_t i = 0, same, chain, k;
+
+	while (i < n) {
+		if (i == 0 || !pack_chains(&ops[i - 1], &ops[i])) {
+			pack_one(b, s, &ops[i++]);
+			continue;
+		}
+
+		for (same = 0; i + same < n && same < PS7_PACKED_RUN_MAX &&
+		     pack_chains(&ops[i + same - 1], &ops[i + same]) &&
+		     ops[i + same].val == s->last.val; same++)
+			;
+		if (same >= 2) {
+			pack_byte(b, PS7_PACKED_RUN(PS7_PACKED_RUN_SAME, same));
+			s->last.addr += 4 * same;
+			i += same;
+			continue;
+		}
+
+		for (chain = 0; i + chain < n && chain < PS7_PACKED_RUN_MAX &&
+		     pack_chains(&ops[i + chain - 1], &ops[i + chain]);) {
+			k = i + chain++;
+			if (k + 2 < n && pack_chains(&ops[k], &ops[k + 1]) &&
+			    pack_chains(&ops[k + 1], &ops[k + 2]) &&
+			    ops[k + 1].val == ops[k].val &&
+			    ops[k + 2].val == ops[k].val)
+				break;
+		}
+		if (chain < 2) {
+			pack_one(b, s, &ops[i++]);
+			continue;
+		}
+
+		pack_byte(b, PS7_PACKED_RUN(PS7_PACKED_RUN_VALS, chain));
+		for (; chain; chain--, i++) {
+			pack_leb(b, ops[i].val);
+			s->last.addr = ops[i].addr;
+			s->last.val = ops[i].val;
+		}
+	}
+}
+
+/* Patch list turning base into rev, from an LCS of the two entry lists */
+static void pack_patch(struct pack_buf *b, const struct pack_ops *base,
+		       const struct pack_ops *rev)
+{
+	size_t n = base->n, m = rev->n, i, j, copy = 0, skip, insert;
+	unsigned int *lcs = calloc((n + 1) * (m + 1), sizeof(*lcs));
+	struct pack_state s;
+
+	if (!lcs) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+#define LCS(i, j) lcs[(i) * (m + 1) + (j)]
+	for (i = n; i-- > 0;)
+		for (j = m; j-- > 0;)
+			LCS(i, j) = pack_same_op(&base->op[i], &rev->op[j]) ?
+				    LCS(i + 1, j + 1) + 1 :
+				    LCS(i + 1, j) > LCS(i, j + 1) ?
+				    LCS(i + 1, j) : LCS(i, j + 1);
+
+	pack_state_init(&s);
+	for (i = j = 0; i < n || j < m;) {
+		if (i < n && j < m && pack_same_op(&base->op[i], &rev->op[j])) {
+			copy++;
+			i++;
+			j++;
+			continue;
+		}
+
+		for (skip = insert = 0; i < n || j < m;) {
+			if (i < n && j < m &&
+			    pack_same_op(&base->op[i], &rev->op[j]))
+				break;
+			if (j == m || (i < n && LCS(i + 1, j) >= LCS(i, j + 1))) {
+				skip++;
+				i++;
+			} else {
+				insert++;
+				j++;
+			}
+		}
+
+		pack_leb(b, copy);
+		pack_leb(b, skip);
+		pack_leb(b, insert);
+		pack_ops(b, &s, &rev->op[j - insert], insert);
+		copy = 0;
+	}
+#undef LCS
+
+	free(lcs);
+}
+
+static void pack_blob(struct ps7_packed_blob *blob, struct pack_buf *b)
+{
+	blob->data = b->data;
+	blob->len = b->len;
+}
+
+static void pack_write_blob(FILE *f, const struct ps7_packed_blob *blob,
+			    const unsigned char *data)
+{
+	if (!blob->len)
+		fprintf(f, "{ 0, 0 }");
+	else
+		fprintf(f, "{ ps7_packed_data + %ld, %lu }",
+			(long)(blob->data - data), blob->len);
+}
+
+static int pack_write(const char *path, struct ps7_packed_table *tables,
+		      int base_rev)
+{
+	struct ps7_packed_blob *blobs[PS7_NUM_PHASES * (PS7_NUM_REVS + 1)];
+	unsigned char *data, *p;
+	size_t len = 0, i, nblobs = 0;
+	int phase, rev;
+	FILE *f;
+
+	for (phase = 0; phase < PS7_NUM_PHASES; phase++) {
+		blobs[nblobs++] = &tables[phase].base;
+		for (rev = 0; rev < PS7_NUM_REVS; rev++)
+			blobs[nblobs++] = &tables[phase].patch[rev];
+	}
+
+	/* one array for everything, blobs point into it */
+	for (i = 0; i < nblobs; i++)
+		len += blobs[i]->len;
+	data = p = malloc(len ? len : 1);
+	if (!data)
+		return -ENOMEM;
+	for (i = 0; i < nblobs; i++) {
+		memcpy(p, blobs[i]->data, blobs[i]->len);
+		blobs[i]->data = p;
+		p += blobs[i]->len;
+	}
+
+	f = fopen(path, "w");
+	if (!f)
+		return -errno;
+
+	fprintf(f, "/*\n"
+		" * Generated by ps7-pack from ps7_init.c, do not edit.\n"
+		" * Base silicon revision %d.0, patch lists for the others.\n"
+		" */\n"
+		"#include \"ps7-packed.h\"\n\n"
+		"static const unsigned char ps7_packed_data[%zu] = {", base_rev, len);
+	for (i = 0; i < len; i++)
+		fprintf(f, "%s0x%02x,", i % 12 ? " " : "\n\t", data[i]);
+	fprintf(f, "\n};\n\n"
+		"const struct ps7_packed_table ps7_packed_tables[PS7_PACKED_PHASES] = {\n");
+	for (phase = 0; phase < PS7_NUM_PHASES; phase++) {
+		fprintf(f, "\t/* %s */\n\t{ ", ps7_phase_names[phase]);
+		pack_write_blob(f, &tables[phase].base, data);
+		fprintf(f, ", {\n");
+		for (rev = 0; rev < PS7_NUM_REVS; rev++) {
+			fprintf(f, "\t\t");
+			pack_write_blob(f, &tables[phase].patch[rev], data);
+			fprintf(f, ",\n");
+		}
+		fprintf(f, "\t} },\n");
+	}
+	fprintf(f, "};\n");
+
+	if (fclose(f))
+		return -errno;
+	return 0;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-b <rev>] [-o <file>] [-q]\n"
+		"  -b <rev>    base silicon revision (default 3)\n"
+		"  -o <file>   write the packed tables as C source\n"
+		"  -q          no size report\n",
+		prog);
+}
+
+int main(int argc, char *argv[])
+{
+	static struct pack_buf bufs[PS7_NUM_PHASES][PS7_NUM_REVS + 1];
+	struct ps7_packed_table tables[PS7_NUM_PHASES] = { 0 };
+	struct pack_ops ops[PS7_NUM_REVS + 1];
+	unsigned long orig = 0, packed = 0, words;
+	int opt, rev, phase, base_rev = 3, quiet = 0;
+	const char *out = NULL;
+	struct pack_state s;
+	size_t i;
+
+	while ((opt = getopt(argc, argv, "b:o:qh")) != -1) {
+		switch (opt) {
+		case 'b':
+			base_rev = atoi(optarg);
+			if (base_rev < 1 || base_rev > PS7_NUM_REVS) {
+				fprintf(stderr, "invalid revision %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'o':
+			out = optarg;
+			break;
+		case 'q':
+			quiet = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (!quiet)
+		printf("%-11s %4s %8s %8s\n", "phase", "rev", "words B", "packed B");
+
+	for (phase = 0; phase < PS7_NUM_PHASES; phase++) {
+		for (rev = 1; rev <= PS7_NUM_REVS; rev++)
+			if (pack_load(rev, phase, &ops[rev]))
+				return 1;
+
+		pack_state_init(&s);
+		pack_ops(&bufs[phase][0], &s, ops[base_rev].op, ops[base_rev].n);
+		pack_blob(&tables[phase].base, &bufs[phase][0]);
+
+		for (rev = 1; rev <= PS7_NUM_REVS; rev++) {
+			if (rev != base_rev) {
+				pack_patch(&bufs[phase][rev], &ops[base_rev],
+					   &ops[rev]);
+				pack_blob(&tables[phase].patch[rev - 1],
+					  &bufs[phase][rev]);
+			}
+
+			/* 32-bit words on the target */
+			for (words = 0, i = 0; i < ops[rev].n; i++)
+				words += ops[rev].op[i].numargs + 1;
+			orig += words * 4;
+			packed += rev == base_rev ? tables[phase].base.len :
+						    tables[phase].patch[rev - 1].len;
+			if (!quiet)
+				printf("%-11s %2d.0 %8lu %8lu%s\n",
+				       ps7_phase_names[phase], rev, words * 4,
+				       rev == base_rev ? tables[phase].base.len :
+				       tables[phase].patch[rev - 1].len,
+				       rev == base_rev ? " (base)" : "");
+		}
+
+		for (rev = 1; rev <= PS7_NUM_REVS; rev++)
+			free(ops[rev].op);
+	}
+
+	if (!quiet)
+		printf("%-11s      %8lu %8lu\n", "total", orig, packed);
+
+	if (ps7_pack_verify(tables, stderr)) {
+		fprintf(stderr, "packed tables do not match ps7_init.c\n");
+		return 1;
+	}
+
+	if (out) {
+		int ret = pack_write(out, tables, base_rev);
+
+		if (ret) {
+			fprintf(stderr, "cannot write %s: %s\n", out,
+				strerror(-ret));
+			return 1;
+		}
+	}
+
+	return 0;
+}
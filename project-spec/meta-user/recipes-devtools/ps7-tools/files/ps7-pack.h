@@ -0,0 +1,19 @@
+/*
+ * ps7-pack.h - checks of packed ps7_init tables against ps7_init.c
+ */
+#ifndef PS7_PACK_H
+#define PS7_PACK_H
+
+#include <stdio.h>
+
+#include "ps7-packed.h"
+
+/*
+ * Expand every phase for every revision and compare it word for word with
+ * the EMIT_* table in ps7_init.c, through the EXIT entry, and check that
+ * each patch list is consumed exactly. Mismatches are reported to f.
+ * Returns the number of tables that differ.
+ */
+int ps7_pack_verify(const struct ps7_packed_table *tables, FILE *f);
+
+#endif
@@ -0,0 +1,17 @@
+/*
+ * ps7-packcheck - check a generated ps7_init_packed.c against ps7_init.c
+ *
+ * Links the packed tables as the FSBL would and expands every phase for
+ * every silicon revision through the same interpreter.
+ */
+#include <stdio.h>
+
+#include "ps7-pack.h"
+
+int main(void)
+{
+	int bad = ps7_pack_verify(ps7_packed_tables, stderr);
+
+	printf("ps7_init_packed.c: %s\n", bad ? "MISMATCH" : "matches ps7_init.c");
+	return bad ? 1 : 0;
+}
@@ -0,0 +1,45 @@
+/*
+ * ps7-packed-init.c - ps7_init() and ps7_post_config() over the packed
+ * tables generated into ps7_init_packed.c
+ */
+#include "ps7_init.h"
+#include "ps7-packed.h"
+
+/* ps7_init.c, not declared in its header */
+unsigned long ps7GetSiliconVersion(void);
+
+/* ps7_init() picks the 3.0 tables for anything newer than 2.0 as well */
+static int ps7_packed_rev(void)
+{
+	unsigned long si_ver = ps7GetSiliconVersion();
+
+	if (si_ver == PCW_SILICON_VERSION_1)
+		return 1;
+	if (si_ver == PCW_SILICON_VERSION_2)
+		return 2;
+	return 3;
+}
+
+int ps7_packed_init(void)
+{
+	int rev = ps7_packed_rev();
+	int phase, ret;
+
+	ps7_boot_begin();
+
+	/* mio, pll, clock, ddr, peripherals, timed like ps7_init() */
+	for (phase = 0; phase < PS7_BOOT_PHASES; phase++) {
+		ps7_boot_phase_begin(phase);
+		ret = ps7_boot_phase_end(ps7_packed_config(&ps7_packed_tables[phase],
+							   rev));
+		if (ret != PS7_INIT_SUCCESS)
+			return ps7_boot_end(ret);
+	}
+
+	return ps7_boot_end(PS7_INIT_SUCCESS);
+}
+
+int ps7_packed_post_config(void)
+{
+	return ps7_packed_config(&ps7_packed_tables[5], ps7_packed_rev());
+}
@@ -0,0 +1,225 @@
+/*
+ * ps7-packed.c - interpreter for the packed ps7_init tables
+ */
+#include "ps7_init.h"
+#include "ps7-packed.h"
+
+static int ps7_packed_leb(struct ps7_packed_stream *s, uint32_t *val)
+{
+	unsigned int shift = 0;
+	uint32_t v = 0;
+
+	do {
+		if (s->p == s->end || shift > 28)
+			return -1;
+		v |= (uint32_t)(*s->p & 0x7F) << shift;
+		shift += 7;
+	} while (*s->p++ & 0x80);
+
+	*val = v;
+	return 0;
+}
+
+static int ps7_packed_addr(struct ps7_packed_stream *s, unsigned int mode)
+{
+	uint32_t addr = s->last.addr + 4;
+	unsigned int i, n = mode == PS7_PACKED_ADDR_DELTA8 ? 1 :
+			    mode == PS7_PACKED_ADDR_DELTA16 ? 2 :
+			    mode == PS7_PACKED_ADDR_FULL ? 4 : 0;
+	uint32_t v = 0;
+
+	if (s->end - s->p < (long)n)
+		return -1;
+	for (i = 0; i < n; i++)
+		v |= (uint32_t)*s->p++ << (8 * i);
+
+	if (mode == PS7_PACKED_ADDR_DELTA8)
+		addr = s->last.addr + (uint32_t)(int32_t)(int8_t)v * 4;
+	else if (mode == PS7_PACKED_ADDR_DELTA16)
+		addr = s->last.addr + (uint32_t)(int32_t)(int16_t)v * 4;
+	else if (mode == PS7_PACKED_ADDR_FULL)
+		addr = v;
+
+	s->last.addr = addr;
+	return 0;
+}
+
+static int ps7_packed_stream_next(struct ps7_packed_stream *s,
+				  struct ps7_op *op)
+{
+	unsigned int hdr, opcode, mode;
+	uint32_t mask = s->last.mask, val = s->last.val;
+
+	if (!s->run) {
+		if (s->p == s->end)
+			return -1;
+		hdr = *s->p++;
+		opcode = hdr >> 5;
+
+		if (opcode == PS7_PACKED_RUN_SAME ||
+		    opcode == PS7_PACKED_RUN_VALS) {
+			if (s->last.opcode != OPCODE_WRITE &&
+			    s->last.opcode != OPCODE_MASKWRITE)
+				return -1;
+			s->run = (hdr & 0x1F) + 1;
+			s->run_vals = opcode == PS7_PACKED_RUN_VALS;
+		} else {
+			if (opcode > OPCODE_MASKDELAY)
+				return -1;
+			if (opcode != OPCODE_EXIT &&
+			    ps7_packed_addr(s, (hdr >> 3) & 3))
+				return -1;
+
+			mode = (hdr >> 1) & 3;
+			if (mode == PS7_PACKED_MASK_ONES)
+				mask = 0xFFFFFFFF;
+			else if (mode == PS7_PACKED_MASK_LEB &&
+				 ps7_packed_leb(s, &mask))
+				return -1;
+			if ((hdr & 1) && ps7_packed_leb(s, &val))
+				return -1;
+
+			op->opcode = opcode;
+			op->addr = s->last.addr;
+			op->mask = 0;
+			op->val = 0;
+			switch (opcode) {
+			case OPCODE_EXIT:
+				op->addr = 0;
+				break;
+			case OPCODE_WRITE:
+				op->mask = 0xFFFFFFFF;
+				op->val = s->last.val = val;
+				break;
+			case OPCODE_MASKWRITE:
+				op->mask = s->last.mask = mask;
+				op->val = s->last.val = val;
+				break;
+			case OPCODE_MASKPOLL:
+			case OPCODE_MASKDELAY:
+				op->mask = s->last.mask = mask;
+				break;
+			}
+			op->numargs = opcode == OPCODE_EXIT ? 0 :
+				      opcode == OPCODE_CLEAR ? 1 :
+				      opcode == OPCODE_MASKWRITE ? 3 : 2;
+			s->last.opcode = opcode;
+			return 0;
+		}
+	}
+
+	/* one register of a run */
+	s->run--;
+	s->last.addr += 4;
+	if (s->run_vals && ps7_packed_leb(s, &s->last.val))
+		return -1;
+
+	op->opcode = s->last.opcode;
+	op->numargs = op->opcode == OPCODE_MASKWRITE ? 3 : 2;
+	op->addr = s->last.addr;
+	op->mask = op->opcode == OPCODE_MASKWRITE ? s->last.mask : 0xFFFFFFFF;
+	op->val = s->last.val;
+	return 0;
+}
+
+static void ps7_packed_stream_init(struct ps7_packed_stream *s,
+				   const struct ps7_packed_blob *blob)
+{
+	s->p = blob->data;
+	s->end = blob->data + blob->len;
+	s->last.opcode = OPCODE_EXIT;
+	s->last.numargs = 0;
+	s->last.addr = PS7_PACKED_START_ADDR;
+	s->last.mask = 0;
+	s->last.val = 0;
+	s->run = 0;
+	s->run_vals = 0;
+}
+
+void ps7_packed_open(struct ps7_packed_cursor *cur,
+		     const struct ps7_packed_table *table, int rev)
+{
+	static const struct ps7_packed_blob none;
+
+	ps7_packed_stream_init(&cur->base, &table->base);
+	ps7_packed_stream_init(&cur->patch, rev >= 1 && rev <= PS7_PACKED_REVS ?
+			       &table->patch[rev - 1] : &none);
+	cur->copy = 0;
+	cur->skip = 0;
+	cur->insert = 0;
+}
+
+int ps7_packed_next(struct ps7_packed_cursor *cur, struct ps7_op *op)
+{
+	struct ps7_op skipped;
+	uint32_t copy, skip, insert;
+
+	for (;;) {
+		if (cur->copy) {
+			cur->copy--;
+			return ps7_packed_stream_next(&cur->base, op);
+		}
+		for (; cur->skip; cur->skip--)
+			if (ps7_packed_stream_next(&cur->base, &skipped))
+				return -1;
+		if (cur->insert) {
+			cur->insert--;
+			return ps7_packed_stream_next(&cur->patch, op);
+		}
+		if (cur->patch.p == cur->patch.end)
+			return ps7_packed_stream_next(&cur->base, op);
+
+		/* next hunk; runs never cross a hunk boundary */
+		if (cur->patch.run || ps7_packed_leb(&cur->patch, &copy) ||
+		    ps7_packed_leb(&cur->patch, &skip) ||
+		    ps7_packed_leb(&cur->patch, &insert))
+			return -1;
+		cur->copy = copy;
+		cur->skip = skip;
+		cur->insert = insert;
+	}
+}
+
+int ps7_packed_config(const struct ps7_packed_table *table, int rev)
+{
+	struct ps7_packed_cursor cur;
+	volatile unsigned long *addr;
+	struct ps7_op op;
+
+	ps7_packed_open(&cur, table, rev);
+
+	for (;;) {
+		if (ps7_packed_next(&cur, &op))
+			return PS7_INIT_CORRUPT;
+
+		addr = (volatile unsigned long *)(unsigned long)op.addr;
+		switch (op.opcode) {
+		case OPCODE_EXIT:
+			return PS7_INIT_SUCCESS;
+
+		case OPCODE_CLEAR:
+			*addr = 0;
+			break;
+
+		case OPCODE_WRITE:
+			*addr = op.val;
+			ps7_time_sync(op.addr);
+			break;
+
+		case OPCODE_MASKWRITE:
+			*addr = (op.val & op.mask) | (*addr & ~op.mask);
+			ps7_time_sync(op.addr);
+			break;
+
+		/* same timing and boot record as ps7_config() */
+		case OPCODE_MASKPOLL:
+			if (mask_poll(op.addr, op.mask) < 0)
+				return PS7_INIT_TIMEOUT;
+			break;
+
+		case OPCODE_MASKDELAY:
+			mask_delay(op.mask);
+			break;
+		}
+	}
+}
@@ -0,0 +1,102 @@
+/*
+ * ps7-packed.h - compact bytecode form of the ps7_init tables
+ *
+ * ps7-pack turns the EMIT_* word tables of ps7_init.c into a byte stream
+ * per phase for one base silicon revision, plus a patch list per other
+ * revision, and writes them out as ps7_init_packed.c. The interpreter in
+ * ps7-packed.c expands them one entry at a time and runs them like
+ * ps7_config(); it needs nothing from the C library and can replace the
+ * word tables in the FSBL.
+ *
+ * Every entry starts with a header byte:
+ *
+ *   7..5  opcode, OPCODE_* from ps7_init.h, or a run (below)
+ *   4..3  address: 0 previous + 4, 1 signed 8-bit word delta,
+ *         2 signed 16-bit word delta, 3 full 32-bit little endian
+ *   2..1  mask: 0 previous mask, 1 all ones, 2 LEB128
+ *   0     value: 0 previous value, 1 LEB128
+ *
+ * followed by the address, mask and value for the fields the opcode has.
+ * A run header (opcode 6 or 7, count - 1 in bits 4..0) repeats the
+ * previous WRITE or MASKWRITE on the next 1 to 32 registers with the same
+ * mask: RUN_SAME also keeps the value, RUN_VALS reads a LEB128 value for
+ * each register.
+ *
+ * A patch list is a sequence of hunks: the number of entries to copy from
+ * the base, the number to skip in it, and the number to insert, each in
+ * LEB128, followed by the inserted entries. The base is copied to its end
+ * after the last hunk. Inserted entries form a stream of their own, with
+ * their own previous address, mask and value.
+ */
+#ifndef PS7_PACKED_H
+#define PS7_PACKED_H
+
+#include "ps7-op.h"
+
+#define PS7_PACKED_RUN_SAME	6U
+#define PS7_PACKED_RUN_VALS	7U
+#define PS7_PACKED_RUN_MAX	32
+
+#define PS7_PACKED_ADDR_NEXT	0U
+#define PS7_PACKED_ADDR_DELTA8	1U
+#define PS7_PACKED_ADDR_DELTA16	2U
+#define PS7_PACKED_ADDR_FULL	3U
+#define PS7_PACKED_MASK_PREV	0U
+#define PS7_PACKED_MASK_ONES	1U
+#define PS7_PACKED_MASK_LEB	2U
+
+#define PS7_PACKED_HDR(op, a, m, v)	(((op) << 5) | ((a) << 3) | ((m) << 1) | (v))
+#define PS7_PACKED_RUN(op, n)		(((op) << 5) | ((n) - 1))
+
+/* Previous address, mask and value start here */
+#define PS7_PACKED_START_ADDR	0xF8000000U
+
+/* Revisions and phases, in the order of ps7-tables.h */
+#define PS7_PACKED_REVS		3
+#define PS7_PACKED_PHASES	7
+
+struct ps7_packed_blob {
+	const unsigned char *data;
+	unsigned long len;
+};
+
+/* patch[] of the base revision is empty */
+struct ps7_packed_table {
+	struct ps7_packed_blob base;
+	struct ps7_packed_blob patch[PS7_PACKED_REVS];
+};
+
+struct ps7_packed_stream {
+	const unsigned char *p;
+	const unsigned char *end;
+	struct ps7_op last;
+	unsigned int run;
+	unsigned int run_vals;
+};
+
+struct ps7_packed_cursor {
+	struct ps7_packed_stream base;
+	struct ps7_packed_stream patch;
+	unsigned long copy;
+	unsigned long skip;
+	unsigned long insert;
+};
+
+/* Generated into ps7_init_packed.c, indexed by phase */
+extern const struct ps7_packed_table ps7_packed_tables[PS7_PACKED_PHASES];
+
+/* rev is the silicon revision, 1 to 3 */
+void ps7_packed_open(struct ps7_packed_cursor *cur,
+		     const struct ps7_packed_table *table, int rev);
+
+/* Expand the next entry. Returns 0, or -1 if the data is corrupt. */
+int ps7_packed_next(struct ps7_packed_cursor *cur, struct ps7_op *op);
+
+/* ps7_config() over a packed table, returns a PS7_INIT_* code */
+int ps7_packed_config(const struct ps7_packed_table *table, int rev);
+
+/* ps7_init() and ps7_post_config() over ps7_packed_tables */
+int ps7_packed_init(void);
+int ps7_packed_post_config(void);
+
+#endif
@@ -0,0 +1,721 @@
+/*
+ * ps7-reduce - remove redundant writes from the ps7_init tables
+ *
+ * The generated tables write some registers several times in a row and
+ * lock and unlock the SLCR around every table. ps7-reduce rewrites the
+ * tables of one silicon revision with:
+ *
+ *   merge   a write folded into the next write to the same register, as
+ *           one read-modify-write with the union of both masks
+ *   drop    a write whose mask the next write to the register covers
+ *   nop     a MASKWRITE with an empty mask
+ *   write   a MASKWRITE with a full mask turned into a WRITE, no read
+ *   lock    a lock/unlock pair with no SLCR write in between, also across
+ *           the tables ps7_init() runs back to back
+ *
+ * A write only moves forward over writes to other plain registers. Polls,
+ * delays and writes to registers where each write is an action (PLL and
+ * DCI control, resets, level shifters, DDRC soft reset, anything outside
+ * the SLCR and the DDRC) are barriers. A write to such an ordered register
+ * is only merged into the next write to it if it leaves its trigger bits
+ * alone, and it is never dropped, converted or merged with one that does.
+ * Every ordered write is listed in the report with the reason.
+ *
+ * The reduced tables are replayed in lockstep with the original ones:
+ * after every barrier both register files must be equal except for the
+ * lock registers, every SLCR write of the reduced tables must happen with
+ * the SLCR unlocked, and every group must end with it locked again. A
+ * table whose reduced replay is not faster than the original is put back
+ * as it was, with both halves of the lock/unlock pairs it shares with its
+ * neighbours, and the replay is run again.
+ */
+#include <errno.h>
+#include <getopt.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ps7-sim.h"
+
+#define SLCR_BASE		0xF8000000
+#define SLCR_END		0xF8000FFF
+#define SLCR_LOCK		0xF8000004
+#define SLCR_UNLOCK		0xF8000008
+#define SLCR_LOCK_KEY		0x767B
+#define SLCR_UNLOCK_KEY		0xDF0D
+#define DDRC_BASE		0xF8006000
+#define DDRC_END		0xF8006FFF
+
+struct reduce_ordered {
+	uint32_t first;
+	uint32_t last;
+	uint32_t trigger;	/* bits whose every write is an action */
+	const char *why;
+};
+
+static const struct reduce_ordered reduce_ordered[] = {
+	{ SLCR_LOCK, SLCR_LOCK, ~0U, "SLCR lock" },
+	{ SLCR_UNLOCK, SLCR_UNLOCK, ~0U, "SLCR unlock" },
+	{ 0xF8000100, 0xF8000108, 0x11, "PLL reset/bypass sequence" },
+	{ 0xF8000120, 0xF8000120, 0x30, "CPU clock source switch" },
+	{ 0xF8000200, 0xF800024C, ~0U, "reset control" },
+	{ 0xF8000900, 0xF8000900, ~0U, "PS-PL level shifters" },
+	{ 0xF8000B70, 0xF8000B70, 0x01, "DCI reset and calibration" },
+	{ 0xF8006000, 0xF8006000, 0x01, "DDRC soft reset" },
+};
+
+static const struct reduce_ordered reduce_device = {
+	0, ~0U, ~0U, "device register, access may have side effects",
+};
+
+static const uint32_t reduce_lock_regs[] = { SLCR_LOCK, SLCR_UNLOCK };
+
+struct reduce_entry {
+	struct ps7_op orig;
+	struct ps7_op op;	/* after merging */
+	int phase;
+	unsigned long index;	/* entry index in the original table */
+	int removed;
+	struct reduce_entry *pair;	/* other half of a dropped lock pair */
+};
+
+/* tables that run back to back and are reduced as one stream */
+struct reduce_group {
+	const char *name;
+	int first;
+	int last;
+};
+
+static const struct reduce_group reduce_groups[] = {
+	{ "ps7_init", PS7_PHASE_MIO, PS7_PHASE_PERIPHERALS },
+	{ "ps7_post_config", PS7_PHASE_POST_CONFIG, PS7_PHASE_POST_CONFIG },
+	{ "ps7_debug", PS7_PHASE_DEBUG, PS7_PHASE_DEBUG },
+};
+
+#define REDUCE_NUM_GROUPS	(sizeof(reduce_groups) / sizeof(reduce_groups[0]))
+
+struct reduce_counts {
+	unsigned long merge, drop, nop, write, lock, ordered, undone;
+};
+
+struct reduce {
+	struct reduce_entry *e;
+	size_t n;
+	int rev;
+	FILE *report;
+	struct reduce_counts count;
+};
+
+static int reduce_is_write(const struct ps7_op *op)
+{
+	return op->opcode == OPCODE_WRITE || op->opcode == OPCODE_MASKWRITE ||
+	       op->opcode == OPCODE_CLEAR;
+}
+
+static int reduce_in_slcr(uint32_t addr)
+{
+	return addr >= SLCR_BASE && addr <= SLCR_END;
+}
+
+/* NULL for a plain configuration register */
+static const struct reduce_ordered *reduce_order(uint32_t addr)
+{
+	unsigned int i;
+
+	for (i = 0; i < sizeof(reduce_ordered) / sizeof(reduce_ordered[0]); i++)
+		if (addr >= reduce_ordered[i].first &&
+		    addr <= reduce_ordered[i].last)
+			return &reduce_ordered[i];
+	if (reduce_in_slcr(addr) || (addr >= DDRC_BASE && addr <= DDRC_END))
+		return NULL;
+	return &reduce_device;
+}
+
+static int reduce_is_barrier(const struct ps7_op *op)
+{
+	return !reduce_is_write(op) || reduce_order(op->addr);
+}
+
+static void reduce_note(struct reduce *r, const struct reduce_entry *e,
+			const char *what, const char *fmt, ...)
+	__attribute__((format(printf, 4, 5)));
+
+static void reduce_note(struct reduce *r, const struct reduce_entry *e,
+			const char *what, const char *fmt, ...)
+{
+	va_list ap;
+
+	if (!r->report)
+		return;
+	fprintf(r->report, "%-11s %4lu  %-9s 0x%08x  %-7s ",
+		ps7_phase_names[e->phase], e->index,
+		ps7_opcode_names[e->op.opcode], e->op.addr, what);
+	va_start(ap, fmt);
+	vfprintf(r->report, fmt, ap);
+	va_end(ap);
+	fputc('\n', r->report);
+}
+
+static int reduce_load(struct reduce *r)
+{
+	const unsigned long *table;
+	unsigned long pos, index;
+	struct ps7_op op;
+	size_t size = 0;
+	int phase;
+
+	for (phase = 0; phase < PS7_NUM_PHASES; phase++) {
+		table = ps7_table(r->rev, phase);
+		for (pos = 0, index = 0;; index++) {
+			if (ps7_decode(table, &pos, &op)) {
+				fprintf(stderr, "%s %d.0: bad entry at word %lu\n",
+					ps7_phase_names[phase], r->rev, pos);
+				return -EINVAL;
+			}
+			if (op.opcode == OPCODE_CLEAR) {
+				op.mask = 0xFFFFFFFF;
+				op.val = 0;
+			}
+			if (r->n == size) {
+				size = size ? size * 2 : 256;
+				r->e = realloc(r->e, size * sizeof(*r->e));
+				if (!r->e)
+					return -ENOMEM;
+			}
+			r->e[r->n].orig = op;
+			r->e[r->n].op = op;
+			r->e[r->n].phase = phase;
+			r->e[r->n].index = index;
+			r->e[r->n].removed = 0;
+			r->e[r->n].pair = NULL;
+			r->n++;
+			/* kept as the barrier that ends the table */
+			if (op.opcode == OPCODE_EXIT)
+				break;
+		}
+	}
+	return 0;
+}
+
+/* Fold entry i into the next write to its register, within its table */
+static void reduce_merge_one(struct reduce *r, size_t i)
+{
+	struct reduce_entry *a = &r->e[i], *b;
+	const struct reduce_ordered *ord = reduce_order(a->op.addr);
+	uint32_t mask, val;
+	size_t j;
+
+	for (j = i + 1; j < r->n && r->e[j].phase == a->phase; j++) {
+		b = &r->e[j];
+		if (b->removed)
+			continue;
+		if (b->op.addr != a->op.addr || !reduce_is_write(&b->op)) {
+			if (reduce_is_barrier(&b->op))
+				return;
+			continue;
+		}
+
+		/* an ordered write may only carry configuration into the next */
+		if (ord && (a->op.mask & ord->trigger))
+			return;
+
+		mask = a->op.mask | b->op.mask;
+		val = ((a->op.val & a->op.mask & ~b->op.mask) |
+		       (b->op.val & b->op.mask)) & mask;
+		if (!(a->op.mask & ~b->op.mask)) {
+			reduce_note(r, a, "drop", "mask covered by %s %lu",
+				    ps7_phase_names[b->phase], b->index);
+			r->count.drop++;
+		} else {
+			reduce_note(r, a, "merge", "into %s %lu, mask 0x%08x%s",
+				    ps7_phase_names[b->phase], b->index, mask,
+				    ord ? ", configuration only" : "");
+			r->count.merge++;
+		}
+		b->op.mask = mask;
+		b->op.val = val;
+		if (b->op.opcode == OPCODE_CLEAR && val)
+			b->op.opcode = OPCODE_WRITE;
+		if (b->op.opcode == OPCODE_WRITE && mask != 0xFFFFFFFF)
+			b->op.opcode = OPCODE_MASKWRITE;
+		a->removed = 1;
+		return;
+	}
+}
+
+static void reduce_writes(struct reduce *r)
+{
+	const struct reduce_ordered *ord;
+	struct reduce_entry *e;
+	size_t i;
+
+	for (i = 0; i < r->n; i++) {
+		e = &r->e[i];
+		if (!reduce_is_write(&e->op))
+			continue;
+		ord = reduce_order(e->op.addr);
+		if (!ord && !e->op.mask) {
+			reduce_note(r, e, "nop", "empty mask");
+			r->count.nop++;
+			e->removed = 1;
+			continue;
+		}
+		reduce_merge_one(r, i);
+	}
+
+	for (i = 0; i < r->n; i++) {
+		e = &r->e[i];
+		if (e->removed || e->op.opcode != OPCODE_MASKWRITE ||
+		    e->op.mask != 0xFFFFFFFF || reduce_order(e->op.addr))
+			continue;
+		reduce_note(r, e, "write", "full mask, no read");
+		r->count.write++;
+		e->op.opcode = e->op.val ? OPCODE_WRITE : OPCODE_CLEAR;
+	}
+}
+
+static int reduce_is_key(const struct ps7_op *op, uint32_t addr, uint32_t key)
+{
+	return reduce_is_write(op) && op->addr == addr &&
+	       (op->val & 0xFFFF) == key;
+}
+
+/* Drop lock/unlock pairs with no SLCR write in between */
+static void reduce_locks(struct reduce *r, const struct reduce_group *g)
+{
+	struct reduce_entry *a, *b;
+	size_t i, j;
+
+	for (i = 0; i < r->n; i++) {
+		a = &r->e[i];
+		if (a->removed || a->phase < g->first || a->phase > g->last ||
+		    !reduce_is_key(&a->op, SLCR_LOCK, SLCR_LOCK_KEY))
+			continue;
+
+		for (j = i + 1; j < r->n && r->e[j].phase <= g->last; j++) {
+			b = &r->e[j];
+			if (b->removed || !reduce_is_write(&b->op) ||
+			    !reduce_in_slcr(b->op.addr))
+				continue;
+			if (reduce_is_key(&b->op, SLCR_UNLOCK, SLCR_UNLOCK_KEY)) {
+				reduce_note(r, a, "lock", "with unlock %s %lu",
+					    ps7_phase_names[b->phase], b->index);
+				reduce_note(r, b, "lock", "with lock %s %lu",
+					    ps7_phase_names[a->phase], a->index);
+				r->count.lock += 2;
+				a->removed = 1;
+				b->removed = 1;
+				a->pair = b;
+				b->pair = a;
+			}
+			break;
+		}
+	}
+}
+
+static void reduce_list_ordered(struct reduce *r)
+{
+	const struct reduce_ordered *ord;
+	size_t i;
+
+	for (i = 0; i < r->n; i++) {
+		if (r->e[i].removed || !reduce_is_write(&r->e[i].op))
+			continue;
+		ord = reduce_order(r->e[i].op.addr);
+		if (!ord)
+			continue;
+		reduce_note(r, &r->e[i], "ordered", "%s", ord->why);
+		r->count.ordered++;
+	}
+}
+
+/*
+ * Replay one group in lockstep: before each barrier that is left in the
+ * reduced tables, the original entries up to and including it, then the
+ * barrier on the reduced side, and compare. Returns the failed checks.
+ */
+static int reduce_check(struct reduce *r, const struct reduce_group *g,
+			FILE *report, struct ps7_sim *orig, struct ps7_sim *red,
+			struct ps7_sim_stats *before,
+			struct ps7_sim_stats *after)
+{
+	int unlocked = 0, fail = 0, barrier, ret;
+	size_t i, o, start, end, barriers = 0;
+	struct reduce_entry *e;
+
+	for (start = 0; start < r->n && r->e[start].phase < g->first; start++)
+		;
+	for (end = start; end < r->n && r->e[end].phase <= g->last; end++)
+		;
+
+	for (i = o = start; i <= end; i++) {
+		e = &r->e[i];
+		barrier = i == end || reduce_is_barrier(&e->op);
+		if (i < end && e->removed)
+			continue;
+
+		for (; barrier && o < end && o <= i; o++) {
+			ret = ps7_sim_exec(orig, ps7_phase_names[r->e[o].phase],
+					   r->e[o].index, &r->e[o].orig,
+					   &before[r->e[o].phase]);
+			if (ret > PS7_INIT_SUCCESS) {
+				fprintf(stderr, "original %s %lu: %s\n",
+					ps7_phase_names[r->e[o].phase],
+					r->e[o].index, getPS7MessageInfo(ret));
+				return fail + 1;
+			}
+		}
+		if (i == end)
+			break;
+
+		if (reduce_is_write(&e->op) && reduce_in_slcr(e->op.addr) &&
+		    e->op.addr != SLCR_UNLOCK && !unlocked) {
+			fprintf(stderr, "%s %lu: SLCR write while locked\n",
+				ps7_phase_names[e->phase], e->index);
+			fail++;
+		}
+		if (reduce_is_key(&e->op, SLCR_UNLOCK, SLCR_UNLOCK_KEY))
+			unlocked = 1;
+		if (reduce_is_key(&e->op, SLCR_LOCK, SLCR_LOCK_KEY))
+			unlocked = 0;
+
+		ret = ps7_sim_exec(red, ps7_phase_names[e->phase], e->index,
+				   &e->op, &after[e->phase]);
+		if (ret > PS7_INIT_SUCCESS) {
+			fprintf(stderr, "%s %lu: %s\n", ps7_phase_names[e->phase],
+				e->index, getPS7MessageInfo(ret));
+			return fail + 1;
+		}
+
+		if (barrier) {
+			barriers++;
+			if (ps7_sim_compare(orig, red, reduce_lock_regs, 2,
+					    stderr)) {
+				fprintf(stderr, "%s %lu: register files differ\n",
+					ps7_phase_names[e->phase], e->index);
+				fail++;
+			}
+		}
+	}
+
+	if (ps7_sim_compare(orig, red, reduce_lock_regs, 2, stderr)) {
+		fprintf(stderr, "%s: final register files differ\n", g->name);
+		fail++;
+	}
+	if (unlocked) {
+		fprintf(stderr, "%s: leaves the SLCR unlocked\n", g->name);
+		fail++;
+	}
+	if (report)
+		fprintf(report, "%-15s %zu barriers compared, %s\n", g->name,
+			barriers, fail ? "FAILED" : "register files equal");
+	return fail;
+}
+
+/*
+ * Each group from reset, as the FSBL runs them in separate steps. Returns
+ * the failed checks, or -ENOMEM.
+ */
+static int reduce_replay(struct reduce *r, FILE *report,
+			 struct ps7_sim_stats *before,
+			 struct ps7_sim_stats *after)
+{
+	struct ps7_sim orig, red;
+	int fail = 0;
+	unsigned int i;
+
+	memset(before, 0, PS7_NUM_PHASES * sizeof(*before));
+	memset(after, 0, PS7_NUM_PHASES * sizeof(*after));
+	for (i = 0; i < REDUCE_NUM_GROUPS; i++) {
+		if (ps7_sim_init(&orig) || ps7_sim_init(&red))
+			return -ENOMEM;
+		fail += reduce_check(r, &reduce_groups[i], report, &orig, &red,
+				     before, after);
+		ps7_sim_free(&orig);
+		ps7_sim_free(&red);
+	}
+	return fail;
+}
+
+static int reduce_changed(const struct reduce_entry *e)
+{
+	return e->removed || e->op.opcode != e->orig.opcode ||
+	       e->op.mask != e->orig.mask || e->op.val != e->orig.val;
+}
+
+static void reduce_undo(struct reduce *r, struct reduce_entry *e)
+{
+	if (!reduce_changed(e))
+		return;
+	e->op = e->orig;
+	e->removed = 0;
+	r->count.undone++;
+}
+
+/*
+ * Put back every table that has changes but whose reduced replay is not
+ * faster. Returns the number of tables put back.
+ */
+static int reduce_keep(struct reduce *r, const struct ps7_sim_stats *before,
+		       const struct ps7_sim_stats *after)
+{
+	struct reduce_entry *e;
+	int phase, kept = 0;
+	size_t k;
+
+	for (phase = 0; phase < PS7_NUM_PHASES; phase++) {
+		if (after[phase].ns < before[phase].ns)
+			continue;
+		for (k = 0; k < r->n; k++)
+			if (r->e[k].phase == phase && reduce_changed(&r->e[k]))
+				break;
+		if (k == r->n)
+			continue;
+
+		if (r->report)
+			fprintf(r->report, "%s%-11s reduced %.3f us, original "
+				"%.3f us, kept as it was\n",
+				r->count.undone ? "" : "\n", ps7_phase_names[phase],
+				after[phase].ns / 1e3, before[phase].ns / 1e3);
+		for (k = 0; k < r->n; k++) {
+			e = &r->e[k];
+			if (e->phase != phase)
+				continue;
+			if (e->pair) {
+				reduce_undo(r, e->pair);
+				e->pair->pair = NULL;
+				e->pair = NULL;
+			}
+			reduce_undo(r, e);
+		}
+		kept++;
+	}
+	return kept;
+}
+
+static int reduce_write(const char *path, struct reduce *r)
+{
+	const struct reduce_group *g;
+	unsigned int i;
+	int phase;
+	size_t k;
+	FILE *f;
+
+	f = fopen(path, "w");
+	if (!f)
+		return -errno;
+
+	fprintf(f, "/*\n"
+		" * Generated by ps7-reduce from ps7_init.c, silicon %d.0. Do not edit.\n"
+		" *\n"
+		" * The ps7_init.c tables with redundant writes merged or dropped.\n"
+		" * The ps7_init tables only work in sequence, as ps7_init_reduced()\n"
+		" * runs them: the SLCR is not locked between them.\n"
+		" */\n"
+		"#include \"ps7_init.h\"\n\n"
+		"/* ps7_init.c, not declared in its header */\n"
+		"unsigned long ps7GetSiliconVersion(void);\n\n"
+		"int ps7_init_reduced(void);\n"
+		"int ps7_post_config_reduced(void);\n"
+		"int ps7_debug_reduced(void);\n",
+		r->rev);
+
+	for (phase = 0; phase < PS7_NUM_PHASES; phase++) {
+		fprintf(f, "\nstatic unsigned long ps7_%s_reduced_%d_0[] = {\n",
+			ps7_phase_names[phase], r->rev);
+		for (k = 0; k < r->n; k++)
+			if (r->e[k].phase == phase && !r->e[k].removed)
+				ps7_print_op(f, &r->e[k].op);
+		fprintf(f, "};\n");
+	}
+
+	fprintf(f, "\n/* ps7_init() picks these for anything newer than 2.0 as well */\n"
+		"static int ps7_reduced_rev(void)\n"
+		"{\n"
+		"\tunsigned long si_ver = ps7GetSiliconVersion();\n\n"
+		"\tif (si_ver == PCW_SILICON_VERSION_1)\n"
+		"\t\treturn 1;\n"
+		"\tif (si_ver == PCW_SILICON_VERSION_2)\n"
+		"\t\treturn 2;\n"
+		"\treturn 3;\n"
+		"}\n");
+
+	fprintf(f, "\n/* ps7_init() with the reduced tables, timed the same way */\n"
+		"int ps7_init_reduced(void)\n"
+		"{\n"
+		"\tstatic unsigned long *const tables[] = {\n");
+	for (phase = 0; phase < PS7_INIT_PHASES; phase++)
+		fprintf(f, "\t\tps7_%s_reduced_%d_0,\n", ps7_phase_names[phase],
+			r->rev);
+	fprintf(f, "\t};\n"
+		"\tint phase, ret;\n\n"
+		"\tif (ps7_reduced_rev() != %d)\n"
+		"\t\treturn ps7_init();\n\n"
+		"\tps7_boot_begin();\n"
+		"\tfor (phase = 0; phase < PS7_BOOT_PHASES; phase++) {\n"
+		"\t\tps7_boot_phase_begin(phase);\n"
+		"\t\tret = ps7_boot_phase_end(ps7_config(tables[phase]));\n"
+		"\t\tif (ret != PS7_INIT_SUCCESS) {\n"
+		"\t\t\t/* the SLCR may have been left unlocked in between */\n"
+		"\t\t\tmask_write(0x%08X, 0xFFFFFFFF, 0x%04X);\n"
+		"\t\t\treturn ps7_boot_end(ret);\n"
+		"\t\t}\n"
+		"\t}\n\n"
+		"\treturn ps7_boot_end(PS7_INIT_SUCCESS);\n"
+		"}\n", r->rev, SLCR_LOCK, SLCR_LOCK_KEY);
+
+	for (i = 1; i < REDUCE_NUM_GROUPS; i++) {
+		g = &reduce_groups[i];
+		fprintf(f, "\nint %s_reduced(void)\n"
+			"{\n"
+			"\tif (ps7_reduced_rev() != %d)\n"
+			"\t\treturn %s();\n"
+			"\treturn ps7_config(ps7_%s_reduced_%d_0);\n"
+			"}\n", g->name, r->rev, g->name,
+			ps7_phase_names[g->first], r->rev);
+	}
+
+	if (fclose(f))
+		return -errno;
+	return 0;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  -r <rev>        silicon revision 1, 2 or 3 (default 3)\n"
+		"  -o <file>       write the reduced tables as C source\n"
+		"  -p <file>       write the report to a file instead of stdout\n"
+		"  -q              no report\n",
+		prog);
+}
+
+int main(int argc, char *argv[])
+{
+	struct ps7_sim_stats before[PS7_NUM_PHASES] = { 0 };
+	struct ps7_sim_stats after[PS7_NUM_PHASES] = { 0 };
+	const char *out = NULL, *report = NULL;
+	struct reduce r = { .rev = 3 };
+	unsigned long n_before, n_after;
+	int opt, quiet = 0, fail = 0, phase, ret;
+	unsigned int i;
+	size_t k;
+
+	while ((opt = getopt(argc, argv, "r:o:p:qh")) != -1) {
+		switch (opt) {
+		case 'r':
+			r.rev = atoi(optarg);
+			if (r.rev < 1 || r.rev > PS7_NUM_REVS) {
+				fprintf(stderr, "invalid revision %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'o':
+			out = optarg;
+			break;
+		case 'p':
+			report = optarg;
+			break;
+		case 'q':
+			quiet = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (!quiet) {
+		r.report = report ? fopen(report, "w") : stdout;
+		if (!r.report) {
+			fprintf(stderr, "cannot open %s: %s\n", report,
+				strerror(errno));
+			return 1;
+		}
+	}
+
+	if (reduce_load(&r)) {
+		fprintf(stderr, "cannot load the silicon %d.0 tables\n", r.rev);
+		return 1;
+	}
+
+	if (r.report)
+		fprintf(r.report, "silicon %d.0\n\n%-11s %4s  %-9s %-10s  %-7s %s\n",
+			r.rev, "table", "idx", "opcode", "address", "action",
+			"reason");
+	reduce_writes(&r);
+	for (i = 0; i < REDUCE_NUM_GROUPS; i++)
+		reduce_locks(&r, &reduce_groups[i]);
+	reduce_list_ordered(&r);
+
+	/* until every table left reduced replays faster */
+	do {
+		fail = reduce_replay(&r, NULL, before, after);
+	} while (fail == 0 && reduce_keep(&r, before, after));
+	if (fail >= 0 && r.report) {
+		fputc('\n', r.report);
+		fail = reduce_replay(&r, r.report, before, after);
+	}
+	if (fail < 0) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	if (r.report) {
+		fprintf(r.report, "\n%-11s %8s %8s %12s %12s\n", "table",
+			"entries", "reduced", "time us", "reduced us");
+		for (phase = 0; phase < PS7_NUM_PHASES; phase++) {
+			n_before = n_after = 0;
+			for (k = 0; k < r.n; k++) {
+				if (r.e[k].phase != phase ||
+				    r.e[k].op.opcode == OPCODE_EXIT)
+					continue;
+				n_before++;
+				n_after += !r.e[k].removed;
+			}
+			fprintf(r.report, "%-11s %8lu %8lu %12.3f %12.3f\n",
+				ps7_phase_names[phase], n_before, n_after,
+				before[phase].ns / 1e3, after[phase].ns / 1e3);
+		}
+		/* a poll absorbs what its table and the ones before it save */
+		for (i = 0; i < REDUCE_NUM_GROUPS; i++) {
+			const struct reduce_group *g = &reduce_groups[i];
+			double t_before = 0, t_after = 0;
+
+			if (g->first == g->last)
+				continue;
+			for (phase = g->first; phase <= g->last; phase++) {
+				t_before += before[phase].ns;
+				t_after += after[phase].ns;
+			}
+			fprintf(r.report, "%-29s %12.3f %12.3f\n", g->name,
+				t_before / 1e3, t_after / 1e3);
+		}
+		fprintf(r.report, "\n%lu merged, %lu dropped, %lu empty, "
+			"%lu without read, %lu lock/unlock, %lu ordered writes kept, "
+			"%lu put back\n",
+			r.count.merge, r.count.drop, r.count.nop, r.count.write,
+			r.count.lock, r.count.ordered, r.count.undone);
+	}
+
+	if (fail) {
+		fprintf(stderr, "%d checks failed, nothing written\n", fail);
+		return 1;
+	}
+
+	if (out) {
+		ret = reduce_write(out, &r);
+		if (ret) {
+			fprintf(stderr, "cannot write %s: %s\n", out,
+				strerror(-ret));
+			return 1;
+		}
+	}
+
+	if (r.report && r.report != stdout)
+		fclose(r.report);
+	free(r.e);
+	return 0;
+}
@@ -0,0 +1,648 @@
+/*
+ * ps7-sched - reorder the ps7_init tables to overlap writes with polls
+ *
+ * ps7_init() runs the mio, pll, clock, ddr and peripherals tables strictly
+ * one after the other, and most of its time is spent in MASKPOLL loops
+ * waiting for the PLLs to lock and the DDR controller to come out of
+ * initialization. ps7-sched treats the five tables as one stream, builds
+ * a dependency graph between its entries from the registers they touch,
+ * and list-schedules it against the simulator: whenever the most urgent
+ * entry is a poll that cannot pass yet, an independent write is issued
+ * instead. The result is replayed from reset and must leave exactly the
+ * register file of the original order behind.
+ *
+ * Entries are classified by address:
+ *
+ *   lock    SLCR_LOCK/SLCR_UNLOCK
+ *   mio     MIO_PIN_xx and the SD write protect/card detect selects
+ *   clk     PLL, clock generator and reset control in the SLCR
+ *   ddriob  DDR I/O buffers and DCI in the SLCR
+ *   ddrc    DDR controller
+ *   dev     I/O peripherals (UART, QSPI, SD, ...)
+ *   sys     everything else: the rest of the SLCR, devcfg, mpcore, debug
+ *
+ * Two entries on the same address always keep their order. Otherwise only
+ * the pairs in class_indep may pass each other: pin muxing is independent
+ * of clocks and DDR, the DDR controller and the peripherals are outside
+ * the SLCR, and sys entries and MASKDELAYs are barriers. Pin muxing needs
+ * the SLCR unlocked, so an mio entry is only issued while the stream has
+ * it unlocked, whichever unlock that is, and always before the last lock.
+ * Peripherals stay behind the clock and pin setup they were written after.
+ *
+ * With the default latencies this saves about 1 us of ps7_init(), 0.1%:
+ * DCI calibration and DDR initialization are the critical path and
+ * cannot overlap. ps7-sched is kept as an analysis tool; its output is
+ * not part of the build.
+ */
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ps7-sim.h"
+
+#define SLCR_LOCK		0xF8000004
+#define SLCR_UNLOCK		0xF8000008
+#define SLCR_LOCK_KEY		0x767B
+#define SLCR_UNLOCK_KEY		0xDF0D
+
+enum sched_class {
+	CLASS_LOCK,
+	CLASS_MIO,
+	CLASS_CLK,
+	CLASS_DDRIOB,
+	CLASS_DDRC,
+	CLASS_DEV,
+	CLASS_SYS,
+	NUM_CLASSES,
+};
+
+static const char *const class_names[NUM_CLASSES] = {
+	"lock", "mio", "clk", "ddriob", "ddrc", "dev", "sys",
+};
+
+/* Class pairs whose entries may be reordered, on different addresses */
+static const unsigned char class_indep[NUM_CLASSES][NUM_CLASSES] = {
+	[CLASS_LOCK][CLASS_MIO] = 1,
+	[CLASS_LOCK][CLASS_DDRC] = 1,
+	[CLASS_LOCK][CLASS_DEV] = 1,
+	[CLASS_MIO][CLASS_LOCK] = 1,
+	[CLASS_MIO][CLASS_MIO] = 1,
+	[CLASS_MIO][CLASS_CLK] = 1,
+	[CLASS_MIO][CLASS_DDRIOB] = 1,
+	[CLASS_MIO][CLASS_DDRC] = 1,
+	[CLASS_CLK][CLASS_MIO] = 1,
+	[CLASS_DDRIOB][CLASS_MIO] = 1,
+	[CLASS_DDRIOB][CLASS_DEV] = 1,
+	[CLASS_DDRC][CLASS_LOCK] = 1,
+	[CLASS_DDRC][CLASS_MIO] = 1,
+	[CLASS_DDRC][CLASS_DEV] = 1,
+	[CLASS_DEV][CLASS_LOCK] = 1,
+	[CLASS_DEV][CLASS_DDRIOB] = 1,
+	[CLASS_DEV][CLASS_DDRC] = 1,
+};
+
+struct sched_entry {
+	struct ps7_op op;
+	int phase;		/* table it came from */
+	unsigned long index;	/* entry index in that table */
+	enum sched_class class;
+	double ns;		/* time in the original order */
+	double prio;		/* longest time to the end of the stream */
+	unsigned int npred;	/* unscheduled predecessors */
+	int done;
+	int moved;		/* passed an earlier entry or changed table */
+};
+
+struct sched {
+	struct sched_entry *e;
+	size_t n;
+	/* dep[i * n + j]: entry j must wait for entry i */
+	unsigned char *dep;
+	/* scheduled order and the table each entry ends up in */
+	size_t *order;
+	int *phase;
+	unsigned long moved;
+};
+
+/* -l overrides, applied to every simulator run */
+#define SCHED_MAX_LATENCIES	8
+
+static struct {
+	char name[16];
+	double ns;
+} sched_latency[SCHED_MAX_LATENCIES];
+static unsigned int sched_nlatencies;
+
+static int sched_add_latency(const char *arg)
+{
+	const char *eq = strchr(arg, '=');
+	double us;
+
+	if (!eq || eq - arg >= (long)sizeof(sched_latency[0].name) ||
+	    sched_nlatencies == SCHED_MAX_LATENCIES)
+		return -EINVAL;
+	memcpy(sched_latency[sched_nlatencies].name, arg, eq - arg);
+	us = strtod(eq + 1, NULL);
+	sched_latency[sched_nlatencies++].ns = us < 0 ? PS7_SIM_NEVER : us * 1e3;
+	return 0;
+}
+
+static int sched_sim_init(struct ps7_sim *sim)
+{
+	unsigned int i;
+	int ret;
+
+	ret = ps7_sim_init(sim);
+	for (i = 0; !ret && i < sched_nlatencies; i++)
+		ret = ps7_sim_set_latency(sim, sched_latency[i].name,
+					  sched_latency[i].ns);
+	return ret;
+}
+
+static enum sched_class sched_classify(const struct ps7_op *op)
+{
+	uint32_t a = op->addr;
+
+	if (op->opcode == OPCODE_MASKDELAY)
+		return CLASS_SYS;
+	if (a == SLCR_LOCK || a == SLCR_UNLOCK)
+		return CLASS_LOCK;
+	if ((a >= 0xF8000700 && a <= 0xF80007FC) ||
+	    a == 0xF8000830 || a == 0xF8000834)
+		return CLASS_MIO;
+	if (a >= 0xF8000100 && a <= 0xF80002FC)
+		return CLASS_CLK;
+	if (a >= 0xF8000B40 && a <= 0xF8000B7C)
+		return CLASS_DDRIOB;
+	if (a >= 0xF8006000 && a <= 0xF8006FFF)
+		return CLASS_DDRC;
+	if (a >= 0xE0000000 && a <= 0xE02FFFFF)
+		return CLASS_DEV;
+	return CLASS_SYS;
+}
+
+static int sched_is_write(const struct ps7_op *op)
+{
+	return op->opcode == OPCODE_WRITE || op->opcode == OPCODE_MASKWRITE ||
+	       op->opcode == OPCODE_CLEAR;
+}
+
+static int sched_load(struct sched *s, int rev)
+{
+	const unsigned long *table;
+	unsigned long pos, index;
+	struct ps7_op op;
+	size_t size = 0;
+	int phase;
+
+	memset(s, 0, sizeof(*s));
+	for (phase = 0; phase < PS7_INIT_PHASES; phase++) {
+		table = ps7_table(rev, phase);
+		for (pos = 0, index = 0;; index++) {
+			if (ps7_decode(table, &pos, &op)) {
+				fprintf(stderr, "%s %d.0: bad entry at word %lu\n",
+					ps7_phase_names[phase], rev, pos);
+				return -EINVAL;
+			}
+			if (op.opcode == OPCODE_EXIT)
+				break;
+			if (s->n == size) {
+				size = size ? size * 2 : 256;
+				s->e = realloc(s->e, size * sizeof(*s->e));
+				if (!s->e)
+					return -ENOMEM;
+			}
+			memset(&s->e[s->n], 0, sizeof(*s->e));
+			s->e[s->n].op = op;
+			s->e[s->n].phase = phase;
+			s->e[s->n].index = index;
+			s->e[s->n].class = sched_classify(&op);
+			s->n++;
+		}
+	}
+
+	s->dep = calloc(s->n * s->n, 1);
+	s->order = calloc(s->n, sizeof(*s->order));
+	s->phase = calloc(s->n, sizeof(*s->phase));
+	if (!s->dep || !s->order || !s->phase)
+		return -ENOMEM;
+	return 0;
+}
+
+static void sched_free(struct sched *s)
+{
+	free(s->e);
+	free(s->dep);
+	free(s->order);
+	free(s->phase);
+}
+
+static void sched_build_deps(struct sched *s)
+{
+	struct sched_entry *a, *b;
+	size_t i, j, last_lock = s->n;
+
+	for (i = 0; i < s->n; i++)
+		if (s->e[i].op.addr == SLCR_LOCK && sched_is_write(&s->e[i].op))
+			last_lock = i;
+
+	for (j = 0; j < s->n; j++) {
+		b = &s->e[j];
+		for (i = 0; i < j; i++) {
+			a = &s->e[i];
+			if (a->op.addr == b->op.addr ||
+			    !class_indep[a->class][b->class])
+				s->dep[i * s->n + j] = 1;
+		}
+		if (b->class == CLASS_MIO && j < last_lock)
+			s->dep[j * s->n + last_lock] = 1;
+	}
+}
+
+/* Original order: time every entry, then the longest path to the end */
+static int sched_weigh(struct sched *s, struct ps7_sim *sim)
+{
+	struct ps7_sim_stats stats = { 0 };
+	struct sched_entry *e;
+	double start, best;
+	size_t i, j;
+	int ret;
+
+	for (i = 0; i < s->n; i++) {
+		e = &s->e[i];
+		start = sim->now;
+		ret = ps7_sim_exec(sim, ps7_phase_names[e->phase], e->index,
+				   &e->op, &stats);
+		if (ret >= 0) {
+			fprintf(stderr, "%s entry %lu: %s\n",
+				ps7_phase_names[e->phase], e->index,
+				getPS7MessageInfo(ret));
+			return ret;
+		}
+		e->ns = sim->now - start;
+	}
+
+	for (i = s->n; i-- > 0;) {
+		best = 0;
+		for (j = i + 1; j < s->n; j++)
+			if (s->dep[i * s->n + j] && s->e[j].prio > best)
+				best = s->e[j].prio;
+		s->e[i].prio = s->e[i].ns + best;
+	}
+	return 0;
+}
+
+static void sched_reset(struct sched *s)
+{
+	size_t i, j;
+
+	s->moved = 0;
+	for (j = 0; j < s->n; j++) {
+		s->e[j].done = 0;
+		s->e[j].npred = 0;
+		for (i = 0; i < j; i++)
+			s->e[j].npred += s->dep[i * s->n + j];
+	}
+}
+
+/*
+ * List scheduling against a fresh simulator run: take the ready entry
+ * with the longest path to the end, unless it is a poll that would still
+ * spin for at least min_wait, in which case the best ready entry that
+ * does not goes first. Returns the simulated time of the new order.
+ */
+static double sched_run(struct sched *s, double min_wait)
+{
+	struct ps7_sim_stats stats = { 0 };
+	int unlocked = 0, phase = 0, ret;
+	struct sched_entry *e;
+	size_t k, i, pick, wait, last = 0;
+	struct ps7_sim sim;
+	double ns = -1;
+
+	if (sched_sim_init(&sim))
+		return -1;
+	sched_reset(s);
+
+	for (k = 0; k < s->n; k++) {
+		pick = wait = s->n;
+		for (i = 0; i < s->n; i++) {
+			e = &s->e[i];
+			if (e->done || e->npred)
+				continue;
+			if (e->class == CLASS_MIO && !unlocked)
+				continue;
+			if (e->op.opcode == OPCODE_MASKPOLL &&
+			    ps7_sim_poll_wait(&sim, e->op.addr, e->op.mask) >= min_wait) {
+				if (wait == s->n || e->prio > s->e[wait].prio)
+					wait = i;
+				continue;
+			}
+			if (pick == s->n || e->prio > s->e[pick].prio)
+				pick = i;
+		}
+		if (pick == s->n)
+			pick = wait;
+		if (pick == s->n) {
+			fprintf(stderr, "no entry can be issued after %zu\n", k);
+			goto out;
+		}
+
+		e = &s->e[pick];
+		ret = ps7_sim_exec(&sim, ps7_phase_names[e->phase], e->index,
+				   &e->op, &stats);
+		if (ret >= 0) {
+			fprintf(stderr, "%s entry %lu: %s\n",
+				ps7_phase_names[e->phase], e->index,
+				getPS7MessageInfo(ret));
+			goto out;
+		}
+
+		if (e->op.addr == SLCR_UNLOCK && (e->op.val & 0xFFFF) == SLCR_UNLOCK_KEY)
+			unlocked = 1;
+		if (e->op.addr == SLCR_LOCK && (e->op.val & 0xFFFF) == SLCR_LOCK_KEY)
+			unlocked = 0;
+
+		e->done = 1;
+		for (i = pick + 1; i < s->n; i++)
+			s->e[i].npred -= s->dep[pick * s->n + i];
+
+		/* an entry never moves back into an earlier table */
+		if (e->phase > phase)
+			phase = e->phase;
+		s->order[k] = pick;
+		s->phase[k] = phase;
+		e->moved = pick < last || phase != e->phase;
+		s->moved += e->moved;
+		if (pick > last)
+			last = pick;
+	}
+	ns = sim.now;
+out:
+	ps7_sim_free(&sim);
+	return ns;
+}
+
+/*
+ * Writes moved into a poll run at the clock of that moment, which is the
+ * bypass clock while the ARM PLL locks, so filling every wait is not
+ * always best. Try filling only waits above each of the poll times of the
+ * original order and keep the fastest; returns the threshold.
+ */
+static double sched_search(struct sched *s)
+{
+	double best_ns = -1, best = 0, ns;
+	size_t i;
+
+	for (i = 0; i <= s->n; i++) {
+		if (i < s->n && s->e[i].op.opcode != OPCODE_MASKPOLL)
+			continue;
+		ns = sched_run(s, i < s->n ? s->e[i].ns + 1 : 0);
+		if (ns >= 0 && (best_ns < 0 || ns < best_ns)) {
+			best_ns = ns;
+			best = i < s->n ? s->e[i].ns + 1 : 0;
+		}
+	}
+	return best_ns < 0 ? -1 : best;
+}
+
+/* Rebuild EXIT terminated word tables from the scheduled order */
+static unsigned long *sched_table(struct sched *s, int phase)
+{
+	unsigned long *t = malloc((s->n * 4 + 1) * sizeof(*t));
+	struct ps7_op exit_op = { .opcode = OPCODE_EXIT };
+	size_t k, w = 0;
+
+	if (!t)
+		return NULL;
+	for (k = 0; k < s->n; k++)
+		if (s->phase[k] == phase)
+			w += ps7_encode(&s->e[s->order[k]].op, t + w);
+	ps7_encode(&exit_op, t + w);
+	return t;
+}
+
+static void sched_print(const char *title, struct ps7_sim_stats *stats)
+{
+	struct ps7_sim_stats total = { 0 };
+	int i;
+
+	printf("\n%s\n", title);
+	printf("%-11s %6s %6s %5s %10s %12s %12s\n", "phase", "ops", "writes",
+	       "polls", "cycles", "time us", "poll us");
+	for (i = 0; i < PS7_INIT_PHASES; i++) {
+		printf("%-11s %6lu %6lu %5lu %10.0f %12.3f %12.3f\n",
+		       ps7_phase_names[i], stats[i].ops, stats[i].writes,
+		       stats[i].polls, stats[i].cycles, stats[i].ns / 1e3,
+		       stats[i].poll_ns / 1e3);
+		total.ops += stats[i].ops;
+		total.writes += stats[i].writes;
+		total.polls += stats[i].polls;
+		total.cycles += stats[i].cycles;
+		total.ns += stats[i].ns;
+		total.poll_ns += stats[i].poll_ns;
+	}
+	printf("%-11s %6lu %6lu %5lu %10.0f %12.3f %12.3f\n", "total",
+	       total.ops, total.writes, total.polls, total.cycles,
+	       total.ns / 1e3, total.poll_ns / 1e3);
+}
+
+static void sched_report(struct sched *s)
+{
+	const struct sched_entry *e;
+	size_t k;
+
+	printf("%-11s %5s  %-11s %5s  %-9s %-10s %s\n", "table", "index",
+	       "from", "index", "opcode", "address", "class");
+	for (k = 0; k < s->n; k++) {
+		e = &s->e[s->order[k]];
+		printf("%-11s %5zu  %-11s %5lu  %-9s 0x%08x %s%s\n",
+		       ps7_phase_names[s->phase[k]], k,
+		       ps7_phase_names[e->phase], e->index,
+		       ps7_opcode_names[e->op.opcode], e->op.addr,
+		       class_names[e->class], e->moved ? "  moved" : "");
+	}
+}
+
+static int sched_write(const char *path, struct sched *s, int rev)
+{
+	int phase;
+	size_t k;
+	FILE *f;
+
+	f = fopen(path, "w");
+	if (!f)
+		return -errno;
+
+	fprintf(f, "/*\n"
+		" * Generated by ps7-sched from ps7_init.c, silicon %d.0. Do not edit.\n"
+		" *\n"
+		" * The ps7_init() tables with independent writes moved into the\n"
+		" * PLL lock and DDR initialization polls; %lu of %zu entries moved.\n"
+		" */\n"
+		"#include \"ps7_init.h\"\n\n"
+		"/* ps7_init.c, not declared in its header */\n"
+		"unsigned long ps7GetSiliconVersion(void);\n\n"
+		"int ps7_init_sched(void);\n",
+		rev, s->moved, s->n);
+
+	for (phase = 0; phase < PS7_INIT_PHASES; phase++) {
+		fprintf(f, "\nstatic unsigned long ps7_%s_init_data_sched_%d_0[] = {\n",
+			ps7_phase_names[phase], rev);
+		for (k = 0; k < s->n; k++)
+			if (s->phase[k] == phase)
+				ps7_print_op(f, &s->e[s->order[k]].op);
+		fprintf(f, "\tEMIT_EXIT(),\n};\n");
+	}
+
+	fprintf(f, "\nstatic unsigned long *const ps7_sched_tables[] = {\n");
+	for (phase = 0; phase < PS7_INIT_PHASES; phase++)
+		fprintf(f, "\tps7_%s_init_data_sched_%d_0,\n",
+			ps7_phase_names[phase], rev);
+	fprintf(f, "};\n\n");
+
+	fprintf(f, "/* ps7_init() with the reordered tables, timed the same way */\n"
+		"int ps7_init_sched(void)\n"
+		"{\n"
+		"\tunsigned long si_ver = ps7GetSiliconVersion();\n"
+		"\tint phase, ret;\n\n");
+	if (rev == 3)
+		fprintf(f, "\tif (si_ver == PCW_SILICON_VERSION_1 ||\n"
+			"\t    si_ver == PCW_SILICON_VERSION_2)\n");
+	else
+		fprintf(f, "\tif (si_ver != PCW_SILICON_VERSION_%d)\n", rev);
+	fprintf(f, "\t\treturn ps7_init();\n\n"
+		"\tps7_boot_begin();\n"
+		"\tfor (phase = 0; phase < PS7_BOOT_PHASES; phase++) {\n"
+		"\t\tps7_boot_phase_begin(phase);\n"
+		"\t\tret = ps7_boot_phase_end(ps7_config(ps7_sched_tables[phase]));\n"
+		"\t\tif (ret != PS7_INIT_SUCCESS)\n"
+		"\t\t\treturn ps7_boot_end(ret);\n"
+		"\t}\n\n"
+		"\treturn ps7_boot_end(PS7_INIT_SUCCESS);\n"
+		"}\n");
+
+	if (fclose(f))
+		return -errno;
+	return 0;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  -r <rev>        silicon revision 1, 2 or 3 (default 3)\n"
+		"  -l <event=us>   event latency as for ps7-emu, to schedule for\n"
+		"                  latencies measured on the board\n"
+		"  -o <file>       write the reordered tables as C source\n"
+		"  -t <file>       write the simulator trace of the reordered tables\n"
+		"  -v              list every entry with its class and origin\n"
+		"  -q              no summary\n",
+		prog);
+}
+
+int main(int argc, char *argv[])
+{
+	struct ps7_sim_stats before[PS7_INIT_PHASES] = { 0 };
+	struct ps7_sim_stats after[PS7_INIT_PHASES] = { 0 };
+	unsigned long *tables[PS7_INIT_PHASES] = { 0 };
+	double t_before = 0, t_after = 0, min_wait;
+	const char *out = NULL, *trace = NULL;
+	int rev = 3, quiet = 0, verbose = 0;
+	struct ps7_sim orig, check;
+	struct sched s;
+	int opt, i, ret;
+
+	while ((opt = getopt(argc, argv, "r:l:o:t:vqh")) != -1) {
+		switch (opt) {
+		case 'r':
+			rev = atoi(optarg);
+			if (rev < 1 || rev > PS7_NUM_REVS) {
+				fprintf(stderr, "invalid revision %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'l':
+			if (sched_add_latency(optarg)) {
+				fprintf(stderr, "invalid latency %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'o':
+			out = optarg;
+			break;
+		case 't':
+			trace = optarg;
+			break;
+		case 'v':
+			verbose = 1;
+			break;
+		case 'q':
+			quiet = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (sched_sim_init(&orig) || sched_sim_init(&check) ||
+	    sched_load(&s, rev)) {
+		fprintf(stderr, "cannot set up silicon %d.0, unknown event?\n",
+			rev);
+		return 1;
+	}
+
+	sched_build_deps(&s);
+	if (sched_weigh(&s, &orig))
+		return 1;
+	min_wait = sched_search(&s);
+	if (min_wait < 0 || sched_run(&s, min_wait) < 0)
+		return 1;
+
+	/* replay both from reset through ps7_config()'s table path */
+	ps7_sim_free(&orig);
+	sched_sim_init(&orig);
+	if (trace) {
+		check.trace = fopen(trace, "w");
+		if (!check.trace) {
+			fprintf(stderr, "cannot open %s: %s\n", trace,
+				strerror(errno));
+			return 1;
+		}
+	}
+	for (i = 0; i < PS7_INIT_PHASES; i++) {
+		tables[i] = sched_table(&s, i);
+		if (!tables[i]) {
+			fprintf(stderr, "out of memory\n");
+			return 1;
+		}
+		ret = ps7_sim_run(&orig, ps7_phase_names[i], ps7_table(rev, i),
+				  &before[i]);
+		ret |= ps7_sim_run(&check, ps7_phase_names[i], tables[i],
+				   &after[i]);
+		if (ret != PS7_INIT_SUCCESS) {
+			fprintf(stderr, "%s: replay failed\n",
+				ps7_phase_names[i]);
+			return 1;
+		}
+		t_before += before[i].ns;
+		t_after += after[i].ns;
+	}
+	if (check.trace)
+		fclose(check.trace);
+
+	if (ps7_sim_compare(&orig, &check, NULL, 0, stderr)) {
+		fprintf(stderr, "reordered tables leave a different register file\n");
+		return 1;
+	}
+
+	if (verbose)
+		sched_report(&s);
+	if (!quiet) {
+		sched_print("original order", before);
+		sched_print("reordered", after);
+		printf("\n%lu of %zu entries moved into polls of %.3f us or more,"
+		       " %.3f us saved (%.1f%%)\n", s.moved, s.n, min_wait / 1e3,
+		       (t_before - t_after) / 1e3,
+		       100 * (t_before - t_after) / t_before);
+	}
+
+	if (out) {
+		ret = sched_write(out, &s, rev);
+		if (ret) {
+			fprintf(stderr, "cannot write %s: %s\n", out,
+				strerror(-ret));
+			return 1;
+		}
+	}
+
+	for (i = 0; i < PS7_INIT_PHASES; i++)
+		free(tables[i]);
+	sched_free(&s);
+	ps7_sim_free(&orig);
+	ps7_sim_free(&check);
+	return 0;
+}
@@ -0,0 +1,447 @@
+/*
+ * ps7-sim.c - simulated SLCR/DDRC register file for replaying ps7_init
+ */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ps7-sim.h"
+
+#define SLCR_ARM_PLL_CTRL	0xF8000100
+#define SLCR_DDR_PLL_CTRL	0xF8000104
+#define SLCR_IO_PLL_CTRL	0xF8000108
+#define SLCR_PLL_STATUS		0xF800010C
+#define SLCR_ARM_PLL_CFG	0xF8000110
+#define SLCR_DDR_PLL_CFG	0xF8000114
+#define SLCR_IO_PLL_CFG		0xF8000118
+#define SLCR_ARM_CLK_CTRL	0xF8000120
+#define SLCR_DDRIOB_DCI_CTRL	0xF8000B70
+#define SLCR_DDRIOB_DCI_STATUS	0xF8000B74
+#define DDRC_CTRL		0xF8006000
+#define DDRC_MODE_STS		0xF8006054
+
+#define PLL_CTRL_RESET		(1U << 0)
+#define PLL_CTRL_BYPASS_FORCE	(1U << 4)
+#define PLL_CTRL_FDIV(v)	(((v) >> 12) & 0x7F)
+#define PLL_CFG_LOCK_CNT(v)	(((v) >> 12) & 0x3FF)
+#define ARM_CLK_CTRL_SRCSEL(v)	(((v) >> 4) & 0x3)
+#define ARM_CLK_CTRL_DIV(v)	(((v) >> 8) & 0x3F)
+
+/*
+ * Register state the BootROM hands over: reset values, with the PLLs
+ * running and locked as it leaves them on a non-bypass boot.
+ */
+static const struct ps7_sim_reg ps7_sim_reset[] = {
+	{ SLCR_ARM_PLL_CTRL, 0x0001A008 },
+	{ SLCR_DDR_PLL_CTRL, 0x0001A008 },
+	{ SLCR_IO_PLL_CTRL, 0x0001A008 },
+	{ SLCR_PLL_STATUS, 0x0000003F },
+	{ SLCR_ARM_PLL_CFG, 0x00177EA0 },
+	{ SLCR_DDR_PLL_CFG, 0x00177EA0 },
+	{ SLCR_IO_PLL_CFG, 0x00177EA0 },
+	{ SLCR_ARM_CLK_CTRL, 0x1F000400 },
+	{ DDRC_CTRL, 0x00000200 },
+};
+
+static const struct ps7_sim_event ps7_sim_events[] = {
+	{ "arm_pll", SLCR_ARM_PLL_CTRL, PLL_CTRL_RESET, 0,
+	  SLCR_PLL_STATUS, 1U << 0, SLCR_ARM_PLL_CFG, 0 },
+	{ "ddr_pll", SLCR_DDR_PLL_CTRL, PLL_CTRL_RESET, 0,
+	  SLCR_PLL_STATUS, 1U << 1, SLCR_DDR_PLL_CFG, 0 },
+	{ "io_pll", SLCR_IO_PLL_CTRL, PLL_CTRL_RESET, 0,
+	  SLCR_PLL_STATUS, 1U << 2, SLCR_IO_PLL_CFG, 0 },
+	/* calibration starts when RESET goes back to 1 */
+	{ "dci", SLCR_DDRIOB_DCI_CTRL, 1U << 0, 1U << 0,
+	  SLCR_DDRIOB_DCI_STATUS, 1U << 13, 0, 100e3 },
+	/* DDR3 power-up and ZQ init after reg_ddrc_soft_rstb */
+	{ "ddr_init", DDRC_CTRL, 1U << 0, 1U << 0,
+	  DDRC_MODE_STS, 1U << 0, 0, 750e3 },
+};
+
+static const struct ps7_sim_cost ps7_sim_default_cost = {
+	.ps_clk_hz = 33333333,
+	.decode_cycles = 12,
+	.loop_cycles = 4,
+	.read_ns = 120,
+	.write_ns = 60,
+};
+
+static struct ps7_sim_reg *ps7_sim_find(struct ps7_sim *sim, uint32_t addr,
+					size_t *slot)
+{
+	size_t lo = 0, hi = sim->nregs, mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (sim->regs[mid].addr == addr)
+			return &sim->regs[mid];
+		if (sim->regs[mid].addr < addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (slot)
+		*slot = lo;
+	return NULL;
+}
+
+static int ps7_sim_store(struct ps7_sim *sim, uint32_t addr, uint32_t val)
+{
+	struct ps7_sim_reg *reg;
+	size_t slot;
+
+	reg = ps7_sim_find(sim, addr, &slot);
+	if (reg) {
+		reg->val = val;
+		return 0;
+	}
+
+	if (sim->nregs == sim->size) {
+		size_t size = sim->size ? sim->size * 2 : 256;
+
+		reg = realloc(sim->regs, size * sizeof(*reg));
+		if (!reg)
+			return -ENOMEM;
+		sim->regs = reg;
+		sim->size = size;
+	}
+	memmove(&sim->regs[slot + 1], &sim->regs[slot],
+		(sim->nregs - slot) * sizeof(*sim->regs));
+	sim->regs[slot].addr = addr;
+	sim->regs[slot].val = val;
+	sim->nregs++;
+	return 0;
+}
+
+static uint32_t ps7_sim_peek(struct ps7_sim *sim, uint32_t addr)
+{
+	struct ps7_sim_reg *reg = ps7_sim_find(sim, addr, NULL);
+
+	return reg ? reg->val : 0;
+}
+
+int ps7_sim_init(struct ps7_sim *sim)
+{
+	unsigned int i;
+	int ret;
+
+	memset(sim, 0, sizeof(*sim));
+	sim->cost = ps7_sim_default_cost;
+
+	sim->nevents = sizeof(ps7_sim_events) / sizeof(ps7_sim_events[0]);
+	sim->events = malloc(sizeof(ps7_sim_events));
+	if (!sim->events)
+		return -ENOMEM;
+	memcpy(sim->events, ps7_sim_events, sizeof(ps7_sim_events));
+	for (i = 0; i < sim->nevents; i++)
+		sim->events[i].ready = PS7_SIM_NEVER;
+
+	for (i = 0; i < sizeof(ps7_sim_reset) / sizeof(ps7_sim_reset[0]); i++) {
+		ret = ps7_sim_store(sim, ps7_sim_reset[i].addr,
+				    ps7_sim_reset[i].val);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+void ps7_sim_free(struct ps7_sim *sim)
+{
+	free(sim->regs);
+	free(sim->events);
+	sim->regs = NULL;
+	sim->events = NULL;
+}
+
+uint32_t ps7_sim_read(struct ps7_sim *sim, uint32_t addr)
+{
+	struct ps7_sim_event *ev;
+	uint32_t val = ps7_sim_peek(sim, addr);
+	unsigned int i;
+
+	for (i = 0; i < sim->nevents; i++) {
+		ev = &sim->events[i];
+		if (ev->addr == addr && ev->ready >= 0 && sim->now >= ev->ready)
+			val |= ev->bits;
+	}
+	if (val != ps7_sim_peek(sim, addr))
+		ps7_sim_store(sim, addr, val);
+	return val;
+}
+
+int ps7_sim_write(struct ps7_sim *sim, uint32_t addr, uint32_t val)
+{
+	uint32_t old = ps7_sim_read(sim, addr);
+	struct ps7_sim_event *ev;
+	unsigned int i;
+	double ns;
+	int ret;
+
+	ret = ps7_sim_store(sim, addr, val);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < sim->nevents; i++) {
+		ev = &sim->events[i];
+		if (ev->trig_addr != addr || !((old ^ val) & ev->trig_mask))
+			continue;
+
+		/* any change of the trigger field drops the status first */
+		ps7_sim_store(sim, ev->addr,
+			      ps7_sim_peek(sim, ev->addr) & ~ev->bits);
+		ev->ready = PS7_SIM_NEVER;
+		if ((val & ev->trig_mask) != ev->trig_val)
+			continue;
+
+		if (ev->lock_cfg)
+			ns = PLL_CFG_LOCK_CNT(ps7_sim_peek(sim, ev->lock_cfg)) *
+			     1e9 / sim->cost.ps_clk_hz;
+		else
+			ns = ev->latency_ns;
+		if (ns >= 0)
+			ev->ready = sim->now + ns;
+	}
+
+	return 0;
+}
+
+int ps7_sim_set_latency(struct ps7_sim *sim, const char *name, double ns)
+{
+	unsigned int i;
+
+	for (i = 0; i < sim->nevents; i++) {
+		if (!strcmp(sim->events[i].name, name)) {
+			sim->events[i].latency_ns = ns;
+			sim->events[i].lock_cfg = 0;
+			return 0;
+		}
+	}
+	return -ENOENT;
+}
+
+int ps7_sim_preload(struct ps7_sim *sim, const char *path)
+{
+	unsigned long addr, val;
+	char line[256];
+	FILE *f;
+	int ret = 0;
+
+	f = fopen(path, "r");
+	if (!f)
+		return -errno;
+
+	while (!ret && fgets(line, sizeof(line), f)) {
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		if (sscanf(line, "%lx %lx", &addr, &val) != 2)
+			ret = -EINVAL;
+		else
+			ret = ps7_sim_store(sim, addr, val);
+	}
+
+	fclose(f);
+	return ret;
+}
+
+/* CPU_6x4x: the ARM_CLK_CTRL source PLL, or PS_CLK while it is not locked */
+double ps7_sim_cpu_hz(struct ps7_sim *sim)
+{
+	static const uint32_t pll_ctrl[] = {
+		SLCR_ARM_PLL_CTRL, SLCR_ARM_PLL_CTRL,
+		SLCR_DDR_PLL_CTRL, SLCR_IO_PLL_CTRL,
+	};
+	static const uint32_t pll_lock[] = { 1U << 0, 1U << 0, 1U << 1, 1U << 2 };
+	uint32_t clk = ps7_sim_peek(sim, SLCR_ARM_CLK_CTRL);
+	unsigned int src = ARM_CLK_CTRL_SRCSEL(clk);
+	unsigned int div = ARM_CLK_CTRL_DIV(clk);
+	uint32_t ctrl = ps7_sim_peek(sim, pll_ctrl[src]);
+	double hz = sim->cost.ps_clk_hz;
+
+	if (!(ctrl & (PLL_CTRL_RESET | PLL_CTRL_BYPASS_FORCE)) &&
+	    (ps7_sim_read(sim, SLCR_PLL_STATUS) & pll_lock[src]))
+		hz *= PLL_CTRL_FDIV(ctrl);
+
+	return hz / (div ? div : 1);
+}
+
+/* Earliest time a poll on addr/mask can succeed, PS7_SIM_NEVER if not */
+static double ps7_sim_poll_ready(struct ps7_sim *sim, uint32_t addr,
+				 uint32_t mask)
+{
+	double ready = PS7_SIM_NEVER;
+	struct ps7_sim_event *ev;
+	unsigned int i;
+
+	for (i = 0; i < sim->nevents; i++) {
+		ev = &sim->events[i];
+		if (ev->addr != addr || !(ev->bits & mask) || ev->ready < 0)
+			continue;
+		if (ready < 0 || ev->ready < ready)
+			ready = ev->ready;
+	}
+	return ready;
+}
+
+static void ps7_sim_trace(struct ps7_sim *sim, const char *name,
+			  unsigned long index, const struct ps7_op *op,
+			  uint32_t result, const char *note, double ns,
+			  double cycles)
+{
+	if (!sim->trace)
+		return;
+
+	fprintf(sim->trace, "%-11s %5lu  %-9s 0x%08x 0x%08x 0x%08x -> 0x%08x %-14s %10.0f %10.3f %12.3f\n",
+		name, index, ps7_opcode_names[op->opcode], op->addr, op->mask,
+		op->val, result, note, cycles, ns / 1e3, sim->now / 1e3);
+}
+
+/*
+ * Wait until a poll on addr/mask succeeds: 0 if it would pass now, the
+ * time left in ns, or PS7_SIM_NEVER if nothing pending sets the bits.
+ */
+double ps7_sim_poll_wait(struct ps7_sim *sim, uint32_t addr, uint32_t mask)
+{
+	double ready;
+
+	if (ps7_sim_read(sim, addr) & mask)
+		return 0;
+	ready = ps7_sim_poll_ready(sim, addr, mask);
+	return ready < 0 ? PS7_SIM_NEVER : ready - sim->now;
+}
+
+int ps7_sim_exec(struct ps7_sim *sim, const char *name, unsigned long index,
+		 const struct ps7_op *op, struct ps7_sim_stats *stats)
+{
+	const struct ps7_sim_cost *c = &sim->cost;
+	double start, hz, iter_ns, ready;
+	unsigned long iters;
+	uint32_t result = 0;
+	char note[32] = "";
+	int ret = -1;
+
+	start = sim->now;
+	hz = ps7_sim_cpu_hz(sim);
+	sim->now += c->decode_cycles * 1e9 / hz;
+
+	switch (op->opcode) {
+	case OPCODE_EXIT:
+		ret = PS7_INIT_SUCCESS;
+		break;
+
+	case OPCODE_CLEAR:
+	case OPCODE_WRITE:
+		sim->now += c->write_ns;
+		ps7_sim_write(sim, op->addr, op->val);
+		result = op->val;
+		stats->writes++;
+		break;
+
+	case OPCODE_MASKWRITE:
+		result = ps7_sim_read(sim, op->addr);
+		sim->now += c->read_ns + c->write_ns;
+		result = (op->val & op->mask) | (result & ~op->mask);
+		ps7_sim_write(sim, op->addr, result);
+		stats->writes++;
+		break;
+
+	case OPCODE_MASKPOLL:
+		/* mask_poll() gives up after PS7_MASK_POLL_TIMEOUT_US */
+		iter_ns = c->read_ns + c->loop_cycles * 1e9 / hz;
+		iters = 1;
+		if (!(ps7_sim_read(sim, op->addr) & op->mask)) {
+			ready = ps7_sim_poll_ready(sim, op->addr, op->mask);
+			if (ready < 0 ||
+			    ready - sim->now > PS7_MASK_POLL_TIMEOUT_US * 1e3) {
+				ready = sim->now + PS7_MASK_POLL_TIMEOUT_US * 1e3;
+				ret = PS7_INIT_TIMEOUT;
+			}
+			iters += (unsigned long)((ready - sim->now) / iter_ns);
+		}
+		sim->now += iters * iter_ns;
+		result = ps7_sim_read(sim, op->addr);
+		snprintf(note, sizeof(note), "%s%lu",
+			 ret == PS7_INIT_TIMEOUT ? "TIMEOUT " : "iters ",
+			 iters);
+		stats->polls++;
+		stats->poll_iters += iters;
+		stats->poll_ns += sim->now - start;
+		break;
+
+	case OPCODE_MASKDELAY:
+		/* the mask is the delay in ms, timed by the global timer */
+		sim->now += op->mask * 1e6;
+		snprintf(note, sizeof(note), "delay %ums", op->mask);
+		break;
+	}
+
+	sim->cycles += (sim->now - start) * hz / 1e9;
+	stats->cycles += (sim->now - start) * hz / 1e9;
+	stats->ns += sim->now - start;
+	stats->ops++;
+	ps7_sim_trace(sim, name, index, op, result, note, sim->now - start,
+		      (sim->now - start) * hz / 1e9);
+	return ret;
+}
+
+int ps7_sim_run(struct ps7_sim *sim, const char *name,
+		const unsigned long *ops, struct ps7_sim_stats *stats)
+{
+	struct ps7_sim_stats local = { 0 };
+	unsigned long pos = 0, index = 0;
+	struct ps7_op op;
+	int ret = -1;
+
+	if (!stats)
+		stats = &local;
+
+	while (ret < 0) {
+		if (ps7_decode(ops, &pos, &op))
+			return PS7_INIT_CORRUPT;
+		ret = ps7_sim_exec(sim, name, index++, &op, stats);
+	}
+
+	return ret;
+}
+
+int ps7_sim_compare(struct ps7_sim *a, struct ps7_sim *b,
+		    const uint32_t *skip, size_t nskip, FILE *f)
+{
+	size_t i = 0, j = 0, k;
+	int diff = 0;
+	uint32_t addr;
+
+	while (i < a->nregs || j < b->nregs) {
+		if (j == b->nregs ||
+		    (i < a->nregs && a->regs[i].addr < b->regs[j].addr))
+			addr = a->regs[i].addr;
+		else
+			addr = b->regs[j].addr;
+
+		for (k = 0; k < nskip && skip[k] != addr; k++)
+			;
+		if (k == nskip &&
+		    ps7_sim_peek(a, addr) != ps7_sim_peek(b, addr)) {
+			if (f)
+				fprintf(f, "0x%08x: 0x%08x, 0x%08x\n", addr,
+					ps7_sim_peek(a, addr),
+					ps7_sim_peek(b, addr));
+			diff++;
+		}
+
+		if (i < a->nregs && a->regs[i].addr == addr)
+			i++;
+		if (j < b->nregs && b->regs[j].addr == addr)
+			j++;
+	}
+	return diff;
+}
+
+void ps7_sim_dump(struct ps7_sim *sim, FILE *f)
+{
+	size_t i;
+
+	for (i = 0; i < sim->nregs; i++)
+		fprintf(f, "0x%08x 0x%08x\n", sim->regs[i].addr,
+			sim->regs[i].val);
+}
@@ -0,0 +1,132 @@
+/*
+ * ps7-sim.h - simulated SLCR/DDRC register file for replaying ps7_init
+ *
+ * The simulator executes the same opcode streams as ps7_config() against
+ * a sparse register file instead of physical addresses. Status bits the
+ * tables poll on (PLL lock, DCI done, DDRC operating mode) are set by
+ * events that fire a configurable time after the write that starts them,
+ * and every access is costed with a simple bus/CPU timing model that
+ * follows the CPU clock as the tables reprogram it.
+ */
+#ifndef PS7_SIM_H
+#define PS7_SIM_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "ps7-tables.h"
+
+#define PS7_SIM_NEVER		(-1.0)
+
+struct ps7_sim_reg {
+	uint32_t addr;
+	uint32_t val;
+};
+
+/**
+ * struct ps7_sim_event - a status change started by a register write
+ * @name: name used to override the latency
+ * @trig_addr: register whose write starts or cancels the event
+ * @trig_mask: field of @trig_addr that is watched
+ * @trig_val: value of the field that starts the event, any other cancels it
+ * @addr: status register
+ * @bits: bits set in @addr when the event completes
+ * @lock_cfg: PLL_CFG register to take LOCK_CNT reference cycles from,
+ *	      0 to use @latency_ns
+ * @latency_ns: time to completion, PS7_SIM_NEVER to never complete
+ * @ready: completion time, PS7_SIM_NEVER when not started
+ */
+struct ps7_sim_event {
+	const char *name;
+	uint32_t trig_addr;
+	uint32_t trig_mask;
+	uint32_t trig_val;
+	uint32_t addr;
+	uint32_t bits;
+	uint32_t lock_cfg;
+	double latency_ns;
+	double ready;
+};
+
+/**
+ * struct ps7_sim_cost - timing model
+ * @ps_clk_hz: PS reference clock
+ * @decode_cycles: CPU cycles to fetch and decode one table entry
+ * @loop_cycles: CPU cycles per poll loop iteration besides the read
+ * @read_ns: register read latency over the interconnect
+ * @write_ns: register write latency
+ */
+struct ps7_sim_cost {
+	double ps_clk_hz;
+	unsigned int decode_cycles;
+	unsigned int loop_cycles;
+	double read_ns;
+	double write_ns;
+};
+
+struct ps7_sim_stats {
+	unsigned long ops;
+	unsigned long writes;
+	unsigned long polls;
+	unsigned long poll_iters;
+	double ns;
+	double poll_ns;
+	double cycles;
+};
+
+struct ps7_sim {
+	struct ps7_sim_reg *regs;
+	size_t nregs;
+	size_t size;
+	struct ps7_sim_event *events;
+	unsigned int nevents;
+	struct ps7_sim_cost cost;
+	/* simulated time since the start of the first table, in ns */
+	double now;
+	double cycles;
+	/* per-entry trace, NULL to disable */
+	FILE *trace;
+};
+
+int ps7_sim_init(struct ps7_sim *sim);
+void ps7_sim_free(struct ps7_sim *sim);
+
+uint32_t ps7_sim_read(struct ps7_sim *sim, uint32_t addr);
+int ps7_sim_write(struct ps7_sim *sim, uint32_t addr, uint32_t val);
+
+/* Override an event latency by name, in ns; PS7_SIM_NEVER never completes */
+int ps7_sim_set_latency(struct ps7_sim *sim, const char *name, double ns);
+
+/* Load "addr value" lines over the reset values */
+int ps7_sim_preload(struct ps7_sim *sim, const char *path);
+
+double ps7_sim_cpu_hz(struct ps7_sim *sim);
+
+/* Time in ns until a poll on addr/mask passes, 0 now, or PS7_SIM_NEVER */
+double ps7_sim_poll_wait(struct ps7_sim *sim, uint32_t addr, uint32_t mask);
+
+/*
+ * Execute a single entry; returns -1 to continue with the next one or the
+ * PS7_INIT_* code that ends the stream. index labels the trace line.
+ */
+int ps7_sim_exec(struct ps7_sim *sim, const char *name, unsigned long index,
+		 const struct ps7_op *op, struct ps7_sim_stats *stats);
+
+/*
+ * Run one opcode stream like ps7_config() and return its PS7_INIT_* code.
+ * stats may be NULL; name labels the trace lines.
+ */
+int ps7_sim_run(struct ps7_sim *sim, const char *name,
+		const unsigned long *ops, struct ps7_sim_stats *stats);
+
+/*
+ * Compare two register files, an address never written reading as 0, and
+ * return the number of differences, each printed to f unless it is NULL.
+ * The nskip addresses in skip are left out.
+ */
+int ps7_sim_compare(struct ps7_sim *a, struct ps7_sim *b,
+		    const uint32_t *skip, size_t nskip, FILE *f);
+
+void ps7_sim_dump(struct ps7_sim *sim, FILE *f);
+
+#endif
@@ -0,0 +1,151 @@
+/*
+ * ps7-tables.c - access to the generated ps7_init opcode tables
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "ps7-tables.h"
+
+#define PS7_REV_TABLES(r)						\
+	{								\
+		ps7_mio_init_data_##r, ps7_pll_init_data_##r,		\
+		ps7_clock_init_data_##r, ps7_ddr_init_data_##r,		\
+		ps7_peripherals_init_data_##r, ps7_post_config_##r,	\
+		ps7_debug_##r,						\
+	}
+
+/* Defined by ps7_init.c, which does not declare them in its header */
+#define PS7_REV_EXTERNS(r)						\
+	extern unsigned long ps7_mio_init_data_##r[];			\
+	extern unsigned long ps7_pll_init_data_##r[];			\
+	extern unsigned long ps7_clock_init_data_##r[];			\
+	extern unsigned long ps7_ddr_init_data_##r[];			\
+	extern unsigned long ps7_peripherals_init_data_##r[];		\
+	extern unsigned long ps7_post_config_##r[];			\
+	extern unsigned long ps7_debug_##r[]
+
+PS7_REV_EXTERNS(1_0);
+PS7_REV_EXTERNS(2_0);
+PS7_REV_EXTERNS(3_0);
+
+static unsigned long *const ps7_tables[PS7_NUM_REVS][PS7_NUM_PHASES] = {
+	PS7_REV_TABLES(1_0),
+	PS7_REV_TABLES(2_0),
+	PS7_REV_TABLES(3_0),
+};
+
+const char *const ps7_phase_names[PS7_NUM_PHASES] = {
+	[PS7_PHASE_MIO] = "mio",
+	[PS7_PHASE_PLL] = "pll",
+	[PS7_PHASE_CLOCK] = "clock",
+	[PS7_PHASE_DDR] = "ddr",
+	[PS7_PHASE_PERIPHERALS] = "peripherals",
+	[PS7_PHASE_POST_CONFIG] = "post_config",
+	[PS7_PHASE_DEBUG] = "debug",
+};
+
+const char *const ps7_opcode_names[] = {
+	[OPCODE_EXIT] = "EXIT",
+	[OPCODE_CLEAR] = "CLEAR",
+	[OPCODE_WRITE] = "WRITE",
+	[OPCODE_MASKWRITE] = "MASKWRITE",
+	[OPCODE_MASKPOLL] = "MASKPOLL",
+	[OPCODE_MASKDELAY] = "MASKDELAY",
+};
+
+/* Number of arguments each opcode is emitted with */
+static const unsigned int ps7_opcode_args[] = {
+	[OPCODE_EXIT] = 0,
+	[OPCODE_CLEAR] = 1,
+	[OPCODE_WRITE] = 2,
+	[OPCODE_MASKWRITE] = 3,
+	[OPCODE_MASKPOLL] = 2,
+	[OPCODE_MASKDELAY] = 2,
+};
+
+int ps7_phase_lookup(const char *name)
+{
+	int i;
+
+	for (i = 0; i < PS7_NUM_PHASES; i++)
+		if (!strcmp(name, ps7_phase_names[i]))
+			return i;
+	return -1;
+}
+
+/* rev is the silicon revision, 1 to 3 */
+unsigned long *ps7_table(int rev, enum ps7_phase phase)
+{
+	if (rev < 1 || rev > PS7_NUM_REVS || phase >= PS7_NUM_PHASES)
+		return NULL;
+	return ps7_tables[rev - 1][phase];
+}
+
+int ps7_decode(const unsigned long *ops, unsigned long *pos, struct ps7_op *op)
+{
+	const unsigned long *p = ops + *pos;
+
+	memset(op, 0, sizeof(*op));
+	op->opcode = p[0] >> 4;
+	op->numargs = p[0] & 0xF;
+	if (op->opcode > OPCODE_MASKDELAY ||
+	    op->numargs != ps7_opcode_args[op->opcode])
+		return -1;
+
+	if (op->numargs > 0)
+		op->addr = p[1];
+	if (op->opcode == OPCODE_MASKWRITE) {
+		op->mask = p[2];
+		op->val = p[3];
+	} else if (op->opcode == OPCODE_WRITE) {
+		op->mask = 0xFFFFFFFF;
+		op->val = p[2];
+	} else if (op->numargs > 1) {
+		op->mask = p[2];
+	}
+
+	*pos += op->numargs + 1;
+	return 0;
+}
+
+unsigned long ps7_encode(const struct ps7_op *op, unsigned long *ops)
+{
+	unsigned long n = 0;
+
+	ops[n++] = (op->opcode << 4) | ps7_opcode_args[op->opcode];
+	if (op->opcode != OPCODE_EXIT)
+		ops[n++] = op->addr;
+	if (op->opcode == OPCODE_MASKWRITE || op->opcode == OPCODE_MASKPOLL ||
+	    op->opcode == OPCODE_MASKDELAY)
+		ops[n++] = op->mask;
+	if (op->opcode == OPCODE_MASKWRITE || op->opcode == OPCODE_WRITE)
+		ops[n++] = op->val;
+	return n;
+}
+
+/* Same spelling as the generated ps7_init.c */
+void ps7_print_op(FILE *f, const struct ps7_op *op)
+{
+	switch (op->opcode) {
+	case OPCODE_EXIT:
+		fprintf(f, "\tEMIT_EXIT(),\n");
+		break;
+	case OPCODE_CLEAR:
+		fprintf(f, "\tEMIT_CLEAR(0X%08X),\n", op->addr);
+		break;
+	case OPCODE_WRITE:
+		fprintf(f, "\tEMIT_WRITE(0X%08X, 0x%08XU),\n", op->addr, op->val);
+		break;
+	case OPCODE_MASKWRITE:
+		fprintf(f, "\tEMIT_MASKWRITE(0X%08X, 0x%08XU ,0x%08XU),\n",
+			op->addr, op->mask, op->val);
+		break;
+	case OPCODE_MASKPOLL:
+		fprintf(f, "\tEMIT_MASKPOLL(0X%08X, 0x%08XU),\n", op->addr,
+			op->mask);
+		break;
+	case OPCODE_MASKDELAY:
+		fprintf(f, "\tEMIT_MASKDELAY(0X%08X, %u),\n", op->addr, op->mask);
+		break;
+	}
+}
@@ -0,0 +1,51 @@
+/*
+ * ps7-tables.h - access to the generated ps7_init opcode tables
+ *
+ * The tables in ps7_init.c are plain arrays of EMIT_* words, one set per
+ * silicon revision. The ps7 tools link ps7_init.c as is and look the
+ * tables up by revision and phase.
+ */
+#ifndef PS7_TABLES_H
+#define PS7_TABLES_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "ps7_init.h"
+#include "ps7-op.h"
+
+#define PS7_NUM_REVS	3
+
+/* ps7_init() runs the first five in this order, post_config runs later */
+enum ps7_phase {
+	PS7_PHASE_MIO,
+	PS7_PHASE_PLL,
+	PS7_PHASE_CLOCK,
+	PS7_PHASE_DDR,
+	PS7_PHASE_PERIPHERALS,
+	PS7_PHASE_POST_CONFIG,
+	PS7_PHASE_DEBUG,
+	PS7_NUM_PHASES,
+};
+
+#define PS7_INIT_PHASES	(PS7_PHASE_PERIPHERALS + 1)
+
+extern const char *const ps7_phase_names[PS7_NUM_PHASES];
+extern const char *const ps7_opcode_names[];
+
+int ps7_phase_lookup(const char *name);
+unsigned long *ps7_table(int rev, enum ps7_phase phase);
+
+/*
+ * Decode the entry at ops[*pos] and advance *pos past it. Returns 0, or
+ * -1 for an unknown opcode or an argument count that does not match it.
+ */
+int ps7_decode(const unsigned long *ops, unsigned long *pos, struct ps7_op *op);
+
+/* Encode op at ops, which has room for four words; returns the count */
+unsigned long ps7_encode(const struct ps7_op *op, unsigned long *ops);
+
+/* Print op as an EMIT_* table line */
+void ps7_print_op(FILE *f, const struct ps7_op *op);
+
+#endif
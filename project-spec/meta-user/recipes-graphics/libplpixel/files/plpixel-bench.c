@@ -0,0 +1,276 @@
+/*
+ * plpixel-bench - per kernel and resolution timings of libplpixel
+ *
+ * Runs every operation at each resolution with each kernel set the CPU
+ * has and prints one row per operation and resolution: milliseconds per
+ * frame for every set, and the speed-up of the best one over C. The
+ * output of every set is compared with the C output; a mismatch is marked
+ * with '!' and makes the exit status non-zero.
+ *
+ * Copyright (C) 2026
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <drm_fourcc.h>
+
+#include "plpixel.h"
+
+#define MAX_SIZES		8
+
+enum {
+	OP_FILL,
+	OP_CONVERT,
+	OP_BLEND,
+	OP_NEAREST,
+	OP_BILINEAR,
+};
+
+static const struct bench_kernel {
+	const char *name;
+	int op;
+	uint32_t src, dst;
+} kernels[] = {
+	{ "fill RG24",             OP_FILL,     0, DRM_FORMAT_RGB888 },
+	{ "fill XR24",             OP_FILL,     0, DRM_FORMAT_XRGB8888 },
+	{ "fill YUYV",             OP_FILL,     0, DRM_FORMAT_YUYV },
+	{ "fill NV12",             OP_FILL,     0, DRM_FORMAT_NV12 },
+	{ "copy RG24",             OP_CONVERT,  DRM_FORMAT_RGB888, DRM_FORMAT_RGB888 },
+	{ "XR24 > RG24",           OP_CONVERT,  DRM_FORMAT_XRGB8888, DRM_FORMAT_RGB888 },
+	{ "XR24 > BG24",           OP_CONVERT,  DRM_FORMAT_XRGB8888, DRM_FORMAT_BGR888 },
+	{ "RG24 > XR24",           OP_CONVERT,  DRM_FORMAT_RGB888, DRM_FORMAT_XRGB8888 },
+	{ "BG24 > RG24",           OP_CONVERT,  DRM_FORMAT_BGR888, DRM_FORMAT_RGB888 },
+	{ "XR24 > YUYV",           OP_CONVERT,  DRM_FORMAT_XRGB8888, DRM_FORMAT_YUYV },
+	{ "XR24 > UYVY",           OP_CONVERT,  DRM_FORMAT_XRGB8888, DRM_FORMAT_UYVY },
+	{ "XR24 > NV12",           OP_CONVERT,  DRM_FORMAT_XRGB8888, DRM_FORMAT_NV12 },
+	{ "RG24 > NV12",           OP_CONVERT,  DRM_FORMAT_RGB888, DRM_FORMAT_NV12 },
+	{ "blend AR24 on XR24",    OP_BLEND,    DRM_FORMAT_ARGB8888, DRM_FORMAT_XRGB8888 },
+	{ "blend AR24 on RG24",    OP_BLEND,    DRM_FORMAT_ARGB8888, DRM_FORMAT_RGB888 },
+	{ "nearest XR24 > RG24",   OP_NEAREST,  DRM_FORMAT_XRGB8888, DRM_FORMAT_RGB888 },
+	{ "bilinear XR24 > RG24",  OP_BILINEAR, DRM_FORMAT_XRGB8888, DRM_FORMAT_RGB888 },
+	{ "bilinear RG24 > NV12",  OP_BILINEAR, DRM_FORMAT_RGB888, DRM_FORMAT_NV12 },
+};
+
+static const char *const isas[] = { "c", "neon", "ssse3", "avx2" };
+
+struct buffer {
+	struct pl_image img;
+	uint8_t *mem;
+	size_t size;
+};
+
+static double now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int buffer_alloc(struct buffer *b, uint32_t format, unsigned int w,
+			unsigned int h)
+{
+	uint32_t pitch = (w * pl_format_cpp(format) + 15) & ~15;
+	size_t i;
+
+	b->size = (size_t)pitch * h;
+	if (format == DRM_FORMAT_NV12)
+		b->size += b->size / 2;
+	b->mem = malloc(b->size);
+	if (!b->mem)
+		return -ENOMEM;
+	/* reproducible noise */
+	for (i = 0; i < b->size; i++)
+		b->mem[i] = (i * 2654435761u) >> 13;
+	pl_image_init(&b->img, format, w, h, b->mem, pitch);
+	return 0;
+}
+
+static int run(const struct bench_kernel *k, struct buffer *dst,
+	       struct buffer *src)
+{
+	const struct pl_image *d = &dst->img, *s = src ? &src->img : NULL;
+
+	switch (k->op) {
+	case OP_FILL:
+		return pl_fill(d, 0, 0, d->width, d->height, 0xff3366cc);
+	case OP_CONVERT:
+		return pl_convert(d, 0, 0, s, 0, 0, d->width, d->height);
+	case OP_BLEND:
+		return pl_blend(d, 0, 0, s, 0, 0, d->width, d->height);
+	case OP_NEAREST:
+		return pl_scale(d, 0, 0, d->width, d->height, s, 0, 0,
+				s->width, s->height, PL_FILTER_NEAREST);
+	case OP_BILINEAR:
+		return pl_scale(d, 0, 0, d->width, d->height, s, 0, 0,
+				s->width, s->height, PL_FILTER_BILINEAR);
+	}
+	return -EINVAL;
+}
+
+/* ms per frame of one kernel set, or < 0 on error; leaves dst for checking */
+static double time_kernel(const struct bench_kernel *k, struct buffer *dst,
+			  struct buffer *src, const uint8_t *init,
+			  double min_time)
+{
+	unsigned int n = 0;
+	double t0, dt;
+
+	memcpy(dst->mem, init, dst->size);
+	if (run(k, dst, src))
+		return -1;
+
+	t0 = now_sec();
+	do {
+		run(k, dst, src);
+		n++;
+		dt = now_sec() - t0;
+	} while (dt < min_time || n < 3);
+
+	/* blend works in place: redo one frame from the same start */
+	memcpy(dst->mem, init, dst->size);
+	run(k, dst, src);
+
+	return dt * 1e3 / n;
+}
+
+static int bench(const struct bench_kernel *k, unsigned int w, unsigned int h,
+		 const char *const *sets, unsigned int nsets, double min_time)
+{
+	struct buffer dst, src = { 0 };
+	uint8_t *init = NULL, *ref = NULL;
+	unsigned int i, sw = w, sh = h, best = 0;
+	double ms[4] = { 0 };
+	int bad = 0, diff;
+
+	/* scale from three quarters of the output size */
+	if (k->op == OP_NEAREST || k->op == OP_BILINEAR) {
+		sw = w * 3 / 4 & ~1;
+		sh = h * 3 / 4 & ~1;
+	}
+
+	if (buffer_alloc(&dst, k->dst, w, h) ||
+	    (k->src && buffer_alloc(&src, k->src, sw, sh)))
+		return -ENOMEM;
+	init = malloc(dst.size);
+	ref = malloc(dst.size);
+	if (!init || !ref) {
+		bad = -ENOMEM;
+		goto out;
+	}
+	memcpy(init, dst.mem, dst.size);
+
+	printf("%-22s %4ux%-4u", k->name, w, h);
+	for (i = 0; i < nsets; i++) {
+		pl_set_isa(sets[i]);
+		ms[i] = time_kernel(k, &dst, k->src ? &src : NULL, init,
+				    min_time);
+		if (ms[i] < 0) {
+			printf(" %9s", "n/a");
+			bad = 1;
+			continue;
+		}
+		if (!i)
+			memcpy(ref, dst.mem, dst.size);
+		diff = i && memcmp(ref, dst.mem, dst.size);
+		bad |= diff;
+		printf(" %8.3f%c", ms[i], diff ? '!' : ' ');
+		if (ms[i] < ms[best])
+			best = i;
+	}
+	printf(" %6s %5.1fx %7.1f\n", sets[best], ms[0] / ms[best],
+	       w * h / ms[best] / 1e3);
+
+out:
+	free(init);
+	free(ref);
+	free(dst.mem);
+	free(src.mem);
+	return bad;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  -r <WxH>      resolution, repeat for more (default 640x480,\n"
+		"                1280x720 and 1920x1080)\n"
+		"  -k <name>     only kernels whose name contains this\n"
+		"  -t <seconds>  minimum time per measurement (default 0.2)\n"
+		"  -h            this help\n",
+		prog);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int widths[MAX_SIZES] = { 640, 1280, 1920 };
+	unsigned int heights[MAX_SIZES] = { 480, 720, 1080 };
+	unsigned int nsizes = 0, nsets = 0, i, j;
+	const char *sets[4], *filter = NULL;
+	double min_time = 0.2;
+	int opt, ret = 0;
+
+	while ((opt = getopt(argc, argv, "r:k:t:h")) != -1) {
+		switch (opt) {
+		case 'r':
+			if (nsizes == MAX_SIZES ||
+			    sscanf(optarg, "%ux%u", &widths[nsizes],
+				   &heights[nsizes]) != 2 ||
+			    (widths[nsizes] | heights[nsizes]) & 1 ||
+			    !widths[nsizes] || !heights[nsizes]) {
+				fprintf(stderr, "bad resolution %s\n", optarg);
+				return 1;
+			}
+			nsizes++;
+			break;
+		case 'k':
+			filter = optarg;
+			break;
+		case 't':
+			min_time = strtod(optarg, NULL);
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (!nsizes)
+		nsizes = 3;
+
+	for (i = 0; i < sizeof(isas) / sizeof(isas[0]); i++)
+		if (!pl_set_isa(isas[i]))
+			sets[nsets++] = isas[i];
+
+	printf("%-22s %9s", "kernel", "size");
+	for (i = 0; i < nsets; i++)
+		printf(" %6s ms", sets[i]);
+	printf(" %6s %6s %7s\n", "best", "gain", "Mpix/s");
+
+	for (i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i++) {
+		if (filter && !strstr(kernels[i].name, filter))
+			continue;
+		for (j = 0; j < nsizes; j++) {
+			int bad = bench(&kernels[i], widths[j], heights[j],
+					sets, nsets, min_time);
+
+			if (bad < 0) {
+				fprintf(stderr, "out of memory\n");
+				return 1;
+			}
+			ret |= bad;
+		}
+	}
+
+	if (ret)
+		fprintf(stderr, "kernel sets disagree with C, see '!'\n");
+	return ret;
+}
@@ -0,0 +1,264 @@
+/*
+ * plpixel - NEON kernels
+ *
+ * Built when the compiler targets NEON, as for the Cortex-A9 with
+ * -mfpu=neon. The structure loads (vld3/vld4) deinterleave packed RGB
+ * and XRGB for free, which is most of the work for the 24 bpp formats of
+ * the frame buffer. Tails shorter than a vector go through the C kernels.
+ *
+ * Copyright (C) 2026
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stddef.h>
+
+#include "plpixel-private.h"
+
+#ifdef __ARM_NEON
+
+#include <arm_neon.h>
+
+static void blend_neon(uint32_t *dst, const uint32_t *src, unsigned int n)
+{
+	for (; n >= 8; n -= 8, dst += 8, src += 8) {
+		uint8x8x4_t s = vld4_u8((const uint8_t *)src);
+		uint8x8x4_t d = vld4_u8((const uint8_t *)dst);
+		uint8x8_t ia = vmvn_u8(s.val[3]);
+		uint16x8_t t;
+		int k;
+
+		for (k = 0; k < 3; k++) {
+			t = vmull_u8(d.val[k], ia);
+			/* exact t / 255, rounded */
+			d.val[k] = vqadd_u8(s.val[k],
+					    vraddhn_u16(t, vrshrq_n_u16(t, 8)));
+		}
+		d.val[3] = vdup_n_u8(0xff);
+		vst4_u8((uint8_t *)dst, d);
+	}
+	pl_ops_c.blend(dst, src, n);
+}
+
+static void fill32_neon(uint32_t *dst, uint32_t val, unsigned int n)
+{
+	uint32x4_t v = vdupq_n_u32(val);
+
+	for (; n >= 8; n -= 8, dst += 8) {
+		vst1q_u32(dst, v);
+		vst1q_u32(dst + 4, v);
+	}
+	pl_ops_c.fill32(dst, val, n);
+}
+
+static void to_24_neon(uint8_t *dst, const uint32_t *src, unsigned int n,
+		       int swap)
+{
+	for (; n >= 16; n -= 16, dst += 48, src += 16) {
+		uint8x16x4_t s = vld4q_u8((const uint8_t *)src);
+		uint8x16x3_t d;
+
+		d.val[0] = s.val[swap ? 2 : 0];
+		d.val[1] = s.val[1];
+		d.val[2] = s.val[swap ? 0 : 2];
+		vst3q_u8(dst, d);
+	}
+	if (swap)
+		pl_ops_c.to_bg24(dst, src, n);
+	else
+		pl_ops_c.to_rg24(dst, src, n);
+}
+
+static void to_rg24_neon(uint8_t *dst, const uint32_t *src, unsigned int n)
+{
+	to_24_neon(dst, src, n, 0);
+}
+
+static void to_bg24_neon(uint8_t *dst, const uint32_t *src, unsigned int n)
+{
+	to_24_neon(dst, src, n, 1);
+}
+
+static void from_24_neon(uint32_t *dst, const uint8_t *src, unsigned int n,
+			 int swap)
+{
+	for (; n >= 16; n -= 16, dst += 16, src += 48) {
+		uint8x16x3_t s = vld3q_u8(src);
+		uint8x16x4_t d;
+
+		d.val[0] = s.val[swap ? 2 : 0];
+		d.val[1] = s.val[1];
+		d.val[2] = s.val[swap ? 0 : 2];
+		d.val[3] = vdupq_n_u8(0xff);
+		vst4q_u8((uint8_t *)dst, d);
+	}
+	if (swap)
+		pl_ops_c.from_bg24(dst, src, n);
+	else
+		pl_ops_c.from_rg24(dst, src, n);
+}
+
+static void from_rg24_neon(uint32_t *dst, const uint8_t *src, unsigned int n)
+{
+	from_24_neon(dst, src, n, 0);
+}
+
+static void from_bg24_neon(uint32_t *dst, const uint8_t *src, unsigned int n)
+{
+	from_24_neon(dst, src, n, 1);
+}
+
+/* PL_Y of 8 pixels */
+static uint8x8_t luma8(uint8x8_t r, uint8x8_t g, uint8x8_t b)
+{
+	uint16x8_t t = vmull_u8(r, vdup_n_u8(66));
+
+	t = vmlal_u8(t, g, vdup_n_u8(129));
+	t = vmlal_u8(t, b, vdup_n_u8(25));
+	return vadd_u8(vrshrn_n_u16(t, 8), vdup_n_u8(16));
+}
+
+static uint8x16_t luma16(uint8x16_t r, uint8x16_t g, uint8x16_t b)
+{
+	return vcombine_u8(luma8(vget_low_u8(r), vget_low_u8(g),
+				 vget_low_u8(b)),
+			   luma8(vget_high_u8(r), vget_high_u8(g),
+				 vget_high_u8(b)));
+}
+
+/* PL_U or PL_V of 8 averaged pixels */
+static uint8x8_t chroma8(int16x8_t r, int16x8_t g, int16x8_t b,
+			 int16_t kr, int16_t kg, int16_t kb)
+{
+	int16x8_t t = vmulq_n_s16(r, kr);
+
+	t = vmlaq_n_s16(t, g, kg);
+	t = vmlaq_n_s16(t, b, kb);
+	t = vshrq_n_s16(vaddq_s16(t, vdupq_n_s16(128)), 8);
+	return vqmovun_s16(vaddq_s16(t, vdupq_n_s16(128)));
+}
+
+/* Average of horizontal pairs of 16 pixels, (a + b + 1) >> 1 */
+static int16x8_t pair_avg(uint8x16_t v)
+{
+	return vreinterpretq_s16_u16(vrshrq_n_u16(vpaddlq_u8(v), 1));
+}
+
+static void to_422_neon(uint8_t *dst, const uint32_t *src, unsigned int n,
+			int uyvy)
+{
+	for (; n >= 16; n -= 16, dst += 32, src += 16) {
+		uint8x16x4_t p = vld4q_u8((const uint8_t *)src);
+		uint8x16_t y = luma16(p.val[2], p.val[1], p.val[0]);
+		uint8x8x2_t yy = vuzp_u8(vget_low_u8(y), vget_high_u8(y));
+		int16x8_t r = pair_avg(p.val[2]);
+		int16x8_t g = pair_avg(p.val[1]);
+		int16x8_t b = pair_avg(p.val[0]);
+		uint8x8_t u = chroma8(r, g, b, -38, -74, 112);
+		uint8x8_t v = chroma8(r, g, b, 112, -94, -18);
+		uint8x8x4_t out;
+
+		if (uyvy) {
+			out.val[0] = u;
+			out.val[1] = yy.val[0];
+			out.val[2] = v;
+			out.val[3] = yy.val[1];
+		} else {
+			out.val[0] = yy.val[0];
+			out.val[1] = u;
+			out.val[2] = yy.val[1];
+			out.val[3] = v;
+		}
+		vst4_u8(dst, out);
+	}
+	if (uyvy)
+		pl_ops_c.to_uyvy(dst, src, n);
+	else
+		pl_ops_c.to_yuyv(dst, src, n);
+}
+
+static void to_yuyv_neon(uint8_t *dst, const uint32_t *src, unsigned int n)
+{
+	to_422_neon(dst, src, n, 0);
+}
+
+static void to_uyvy_neon(uint8_t *dst, const uint32_t *src, unsigned int n)
+{
+	to_422_neon(dst, src, n, 1);
+}
+
+/* Average of 2x2 blocks of two rows of 16 pixels, (sum + 2) >> 2 */
+static int16x8_t quad_avg(uint8x16_t a, uint8x16_t b)
+{
+	uint16x8_t t = vaddq_u16(vpaddlq_u8(a), vpaddlq_u8(b));
+
+	return vreinterpretq_s16_u16(vrshrq_n_u16(t, 2));
+}
+
+static void to_nv12_neon(uint8_t *y0, uint8_t *y1, uint8_t *uv,
+			 const uint32_t *src0, const uint32_t *src1,
+			 unsigned int n)
+{
+	for (; n >= 16; n -= 16, y0 += 16, y1 += 16, uv += 16,
+	     src0 += 16, src1 += 16) {
+		uint8x16x4_t p = vld4q_u8((const uint8_t *)src0);
+		uint8x16x4_t q = vld4q_u8((const uint8_t *)src1);
+		int16x8_t r = quad_avg(p.val[2], q.val[2]);
+		int16x8_t g = quad_avg(p.val[1], q.val[1]);
+		int16x8_t b = quad_avg(p.val[0], q.val[0]);
+		uint8x8x2_t c;
+
+		vst1q_u8(y0, luma16(p.val[2], p.val[1], p.val[0]));
+		vst1q_u8(y1, luma16(q.val[2], q.val[1], q.val[0]));
+		c.val[0] = chroma8(r, g, b, -38, -74, 112);
+		c.val[1] = chroma8(r, g, b, 112, -94, -18);
+		vst2_u8(uv, c);
+	}
+	pl_ops_c.to_nv12(y0, y1, uv, src0, src1, n);
+}
+
+static void lerp_neon(uint32_t *dst, const uint32_t *a, const uint32_t *b,
+		      unsigned int f, unsigned int n)
+{
+	uint8x8_t wa = vdup_n_u8(256 - f), wb = vdup_n_u8(f);
+
+	for (; n >= 4; n -= 4, dst += 4, a += 4, b += 4) {
+		uint8x16_t va = vld1q_u8((const uint8_t *)a);
+		uint8x16_t vb = vld1q_u8((const uint8_t *)b);
+		uint16x8_t lo = vmull_u8(vget_low_u8(va), wa);
+		uint16x8_t hi = vmull_u8(vget_high_u8(va), wa);
+
+		lo = vmlal_u8(lo, vget_low_u8(vb), wb);
+		hi = vmlal_u8(hi, vget_high_u8(vb), wb);
+		vst1q_u8((uint8_t *)dst, vcombine_u8(vrshrn_n_u16(lo, 8),
+						     vrshrn_n_u16(hi, 8)));
+	}
+	pl_ops_c.lerp(dst, a, b, f, n);
+}
+
+static const struct pl_ops ops_neon = {
+	.name = "neon",
+	.blend = blend_neon,
+	.fill32 = fill32_neon,
+	.to_rg24 = to_rg24_neon,
+	.to_bg24 = to_bg24_neon,
+	.from_rg24 = from_rg24_neon,
+	.from_bg24 = from_bg24_neon,
+	.to_yuyv = to_yuyv_neon,
+	.to_uyvy = to_uyvy_neon,
+	.to_nv12 = to_nv12_neon,
+	.lerp = lerp_neon,
+};
+
+const struct pl_ops *pl_ops_neon(void)
+{
+	return &ops_neon;
+}
+
+#else
+
+const struct pl_ops *pl_ops_neon(void)
+{
+	return NULL;
+}
+
+#endif
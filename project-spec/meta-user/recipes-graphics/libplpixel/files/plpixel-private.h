@@ -0,0 +1,52 @@
+/*
+ * plpixel row kernels
+ *
+ * Each kernel set fills in the rows it accelerates and takes the C
+ * versions for the rest. Rows of XRGB8888 are the common format: the
+ * API converts sources into it and out of it in chunks.
+ *
+ * Copyright (C) 2026
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef PLPIXEL_PRIVATE_H
+#define PLPIXEL_PRIVATE_H
+
+#include <stdint.h>
+
+struct pl_ops {
+	const char *name;
+	/* premultiplied ARGB over XRGB, X of the result is 0xff */
+	void (*blend)(uint32_t *dst, const uint32_t *src, unsigned int n);
+	void (*fill32)(uint32_t *dst, uint32_t val, unsigned int n);
+	/* XRGB8888 to RG24 (B G R) and BG24 (R G B) */
+	void (*to_rg24)(uint8_t *dst, const uint32_t *src, unsigned int n);
+	void (*to_bg24)(uint8_t *dst, const uint32_t *src, unsigned int n);
+	/* RG24 and BG24 to XRGB8888 with X 0xff */
+	void (*from_rg24)(uint32_t *dst, const uint8_t *src, unsigned int n);
+	void (*from_bg24)(uint32_t *dst, const uint8_t *src, unsigned int n);
+	/* n even */
+	void (*to_yuyv)(uint8_t *dst, const uint32_t *src, unsigned int n);
+	void (*to_uyvy)(uint8_t *dst, const uint32_t *src, unsigned int n);
+	/* two rows, n even */
+	void (*to_nv12)(uint8_t *y0, uint8_t *y1, uint8_t *uv,
+			const uint32_t *src0, const uint32_t *src1,
+			unsigned int n);
+	/* per byte (a * (256 - f) + b * f + 128) >> 8, 0 < f < 256 */
+	void (*lerp)(uint32_t *dst, const uint32_t *a, const uint32_t *b,
+		     unsigned int f, unsigned int n);
+};
+
+extern const struct pl_ops pl_ops_c;
+
+/* NULL when the build or the CPU does not have them */
+const struct pl_ops *pl_ops_neon(void);
+const struct pl_ops *pl_ops_ssse3(void);
+const struct pl_ops *pl_ops_avx2(void);
+
+/* BT.601 limited range, the same integer maths in every kernel set */
+#define PL_Y(r, g, b)	((((66 * (r) + 129 * (g) + 25 * (b) + 128) >> 8)) + 16)
+#define PL_U(r, g, b)	(((-38 * (r) - 74 * (g) + 112 * (b) + 128) >> 8) + 128)
+#define PL_V(r, g, b)	(((112 * (r) - 94 * (g) - 18 * (b) + 128) >> 8) + 128)
+
+#endif
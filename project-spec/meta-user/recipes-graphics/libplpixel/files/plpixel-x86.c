@@ -0,0 +1,306 @@
+/*
+ * plpixel - SSSE3 and AVX2 kernels
+ *
+ * For building and benchmarking the library and its users on an x86
+ * host. Functions carry their own target attribute, so the file builds
+ * without -m flags and the set is picked from cpuid at run time. The
+ * byte shuffles for 24 bpp are SSSE3 in both sets, AVX2 widens blend,
+ * fill and lerp. The YUV packers stay in C here.
+ *
+ * Copyright (C) 2026
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stddef.h>
+
+#include "plpixel-private.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+#define SSSE3	__attribute__((target("ssse3")))
+#define AVX2	__attribute__((target("avx2")))
+
+/* (t + ((t + 128) >> 8) + 128) >> 8 on 16-bit lanes, exact t / 255 */
+#define DIV255_SSE(t) ({						\
+	__m128i __t = _mm_add_epi16((t), _mm_set1_epi16(128));		\
+	_mm_srli_epi16(_mm_add_epi16(__t, _mm_srli_epi16(__t, 8)), 8);	\
+})
+
+#define DIV255_AVX(t) ({						\
+	__m256i __t = _mm256_add_epi16((t), _mm256_set1_epi16(128));	\
+	_mm256_srli_epi16(_mm256_add_epi16(__t, _mm256_srli_epi16(__t, 8)), 8); \
+})
+
+/* dst * (255 - alpha) / 255 for two pixels in 16-bit lanes */
+SSSE3 static __m128i blend_half_sse(__m128i d, __m128i s)
+{
+	__m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xff), 0xff);
+
+	a = _mm_sub_epi16(_mm_set1_epi16(255), a);
+	return DIV255_SSE(_mm_mullo_epi16(d, a));
+}
+
+SSSE3 static void blend_sse(uint32_t *dst, const uint32_t *src, unsigned int n)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alpha = _mm_set1_epi32(0xff000000);
+
+	for (; n >= 4; n -= 4, dst += 4, src += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i *)src);
+		__m128i d = _mm_loadu_si128((const __m128i *)dst);
+		__m128i lo = blend_half_sse(_mm_unpacklo_epi8(d, zero),
+					    _mm_unpacklo_epi8(s, zero));
+		__m128i hi = blend_half_sse(_mm_unpackhi_epi8(d, zero),
+					    _mm_unpackhi_epi8(s, zero));
+
+		d = _mm_adds_epu8(s, _mm_packus_epi16(lo, hi));
+		_mm_storeu_si128((__m128i *)dst, _mm_or_si128(d, alpha));
+	}
+	pl_ops_c.blend(dst, src, n);
+}
+
+SSSE3 static void fill32_sse(uint32_t *dst, uint32_t val, unsigned int n)
+{
+	__m128i v = _mm_set1_epi32(val);
+
+	for (; n >= 4; n -= 4, dst += 4)
+		_mm_storeu_si128((__m128i *)dst, v);
+	pl_ops_c.fill32(dst, val, n);
+}
+
+/* 16 XRGB pixels to 48 bytes, through a shuffle per 4 pixels */
+SSSE3 static void to_24_sse(uint8_t *dst, const uint32_t *src, unsigned int n,
+			    __m128i mask)
+{
+	for (; n >= 16; n -= 16, dst += 48, src += 16) {
+		__m128i p0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)src), mask);
+		__m128i p1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)src + 1), mask);
+		__m128i p2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)src + 2), mask);
+		__m128i p3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)src + 3), mask);
+
+		_mm_storeu_si128((__m128i *)dst,
+				 _mm_or_si128(p0, _mm_slli_si128(p1, 12)));
+		_mm_storeu_si128((__m128i *)dst + 1,
+				 _mm_or_si128(_mm_srli_si128(p1, 4),
+					      _mm_slli_si128(p2, 8)));
+		_mm_storeu_si128((__m128i *)dst + 2,
+				 _mm_or_si128(_mm_srli_si128(p2, 8),
+					      _mm_slli_si128(p3, 4)));
+	}
+}
+
+SSSE3 static void to_rg24_sse(uint8_t *dst, const uint32_t *src, unsigned int n)
+{
+	const __m128i mask = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10,
+					   12, 13, 14, -1, -1, -1, -1);
+
+	to_24_sse(dst, src, n & ~15, mask);
+	pl_ops_c.to_rg24(dst + (n & ~15) * 3, src + (n & ~15), n & 15);
+}
+
+SSSE3 static void to_bg24_sse(uint8_t *dst, const uint32_t *src, unsigned int n)
+{
+	const __m128i mask = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8,
+					   14, 13, 12, -1, -1, -1, -1);
+
+	to_24_sse(dst, src, n & ~15, mask);
+	pl_ops_c.to_bg24(dst + (n & ~15) * 3, src + (n & ~15), n & 15);
+}
+
+/* 48 bytes to 16 XRGB pixels, realigning each group of 4 pixels */
+SSSE3 static void from_24_sse(uint32_t *dst, const uint8_t *src, unsigned int n,
+			      __m128i mask)
+{
+	const __m128i alpha = _mm_set1_epi32(0xff000000);
+
+	for (; n >= 16; n -= 16, dst += 16, src += 48) {
+		__m128i i0 = _mm_loadu_si128((const __m128i *)src);
+		__m128i i1 = _mm_loadu_si128((const __m128i *)src + 1);
+		__m128i i2 = _mm_loadu_si128((const __m128i *)src + 2);
+
+		_mm_storeu_si128((__m128i *)dst,
+				 _mm_or_si128(_mm_shuffle_epi8(i0, mask), alpha));
+		_mm_storeu_si128((__m128i *)dst + 1,
+				 _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(i1, i0, 12),
+							       mask), alpha));
+		_mm_storeu_si128((__m128i *)dst + 2,
+				 _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(i2, i1, 8),
+							       mask), alpha));
+		_mm_storeu_si128((__m128i *)dst + 3,
+				 _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(i2, 4),
+							       mask), alpha));
+	}
+}
+
+SSSE3 static void from_rg24_sse(uint32_t *dst, const uint8_t *src, unsigned int n)
+{
+	const __m128i mask = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1,
+					   6, 7, 8, -1, 9, 10, 11, -1);
+
+	from_24_sse(dst, src, n & ~15, mask);
+	pl_ops_c.from_rg24(dst + (n & ~15), src + (n & ~15) * 3, n & 15);
+}
+
+SSSE3 static void from_bg24_sse(uint32_t *dst, const uint8_t *src, unsigned int n)
+{
+	const __m128i mask = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1,
+					   8, 7, 6, -1, 11, 10, 9, -1);
+
+	from_24_sse(dst, src, n & ~15, mask);
+	pl_ops_c.from_bg24(dst + (n & ~15), src + (n & ~15) * 3, n & 15);
+}
+
+SSSE3 static void lerp_sse(uint32_t *dst, const uint32_t *a, const uint32_t *b,
+			   unsigned int f, unsigned int n)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i wa = _mm_set1_epi16(256 - f), wb = _mm_set1_epi16(f);
+	const __m128i half = _mm_set1_epi16(128);
+
+	for (; n >= 4; n -= 4, dst += 4, a += 4, b += 4) {
+		__m128i va = _mm_loadu_si128((const __m128i *)a);
+		__m128i vb = _mm_loadu_si128((const __m128i *)b);
+		__m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(va, zero), wa),
+					   _mm_mullo_epi16(_mm_unpacklo_epi8(vb, zero), wb));
+		__m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(va, zero), wa),
+					   _mm_mullo_epi16(_mm_unpackhi_epi8(vb, zero), wb));
+
+		lo = _mm_srli_epi16(_mm_add_epi16(lo, half), 8);
+		hi = _mm_srli_epi16(_mm_add_epi16(hi, half), 8);
+		_mm_storeu_si128((__m128i *)dst, _mm_packus_epi16(lo, hi));
+	}
+	pl_ops_c.lerp(dst, a, b, f, n);
+}
+
+AVX2 static __m256i blend_half_avx(__m256i d, __m256i s)
+{
+	__m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, 0xff), 0xff);
+
+	a = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+	return DIV255_AVX(_mm256_mullo_epi16(d, a));
+}
+
+AVX2 static void blend_avx2(uint32_t *dst, const uint32_t *src, unsigned int n)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i alpha = _mm256_set1_epi32(0xff000000);
+
+	for (; n >= 8; n -= 8, dst += 8, src += 8) {
+		__m256i s = _mm256_loadu_si256((const __m256i *)src);
+		__m256i d = _mm256_loadu_si256((const __m256i *)dst);
+		__m256i lo = blend_half_avx(_mm256_unpacklo_epi8(d, zero),
+					    _mm256_unpacklo_epi8(s, zero));
+		__m256i hi = blend_half_avx(_mm256_unpackhi_epi8(d, zero),
+					    _mm256_unpackhi_epi8(s, zero));
+
+		/* unpack and pack both work per 128-bit lane, the order holds */
+		d = _mm256_adds_epu8(s, _mm256_packus_epi16(lo, hi));
+		_mm256_storeu_si256((__m256i *)dst, _mm256_or_si256(d, alpha));
+	}
+	blend_sse(dst, src, n);
+}
+
+AVX2 static void fill32_avx2(uint32_t *dst, uint32_t val, unsigned int n)
+{
+	__m256i v = _mm256_set1_epi32(val);
+
+	for (; n >= 8; n -= 8, dst += 8)
+		_mm256_storeu_si256((__m256i *)dst, v);
+	pl_ops_c.fill32(dst, val, n);
+}
+
+AVX2 static void lerp_avx2(uint32_t *dst, const uint32_t *a, const uint32_t *b,
+			   unsigned int f, unsigned int n)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i wa = _mm256_set1_epi16(256 - f), wb = _mm256_set1_epi16(f);
+	const __m256i half = _mm256_set1_epi16(128);
+
+	for (; n >= 8; n -= 8, dst += 8, a += 8, b += 8) {
+		__m256i va = _mm256_loadu_si256((const __m256i *)a);
+		__m256i vb = _mm256_loadu_si256((const __m256i *)b);
+		__m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(va, zero), wa),
+					      _mm256_mullo_epi16(_mm256_unpacklo_epi8(vb, zero), wb));
+		__m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(va, zero), wa),
+					      _mm256_mullo_epi16(_mm256_unpackhi_epi8(vb, zero), wb));
+
+		lo = _mm256_srli_epi16(_mm256_add_epi16(lo, half), 8);
+		hi = _mm256_srli_epi16(_mm256_add_epi16(hi, half), 8);
+		_mm256_storeu_si256((__m256i *)dst, _mm256_packus_epi16(lo, hi));
+	}
+	lerp_sse(dst, a, b, f, n);
+}
+
+/* The YUV packers are the C ones */
+static void to_yuyv_x86(uint8_t *dst, const uint32_t *src, unsigned int n)
+{
+	pl_ops_c.to_yuyv(dst, src, n);
+}
+
+static void to_uyvy_x86(uint8_t *dst, const uint32_t *src, unsigned int n)
+{
+	pl_ops_c.to_uyvy(dst, src, n);
+}
+
+static void to_nv12_x86(uint8_t *y0, uint8_t *y1, uint8_t *uv,
+			const uint32_t *src0, const uint32_t *src1,
+			unsigned int n)
+{
+	pl_ops_c.to_nv12(y0, y1, uv, src0, src1, n);
+}
+
+static const struct pl_ops ops_ssse3 = {
+	.name = "ssse3",
+	.blend = blend_sse,
+	.fill32 = fill32_sse,
+	.to_rg24 = to_rg24_sse,
+	.to_bg24 = to_bg24_sse,
+	.from_rg24 = from_rg24_sse,
+	.from_bg24 = from_bg24_sse,
+	.to_yuyv = to_yuyv_x86,
+	.to_uyvy = to_uyvy_x86,
+	.to_nv12 = to_nv12_x86,
+	.lerp = lerp_sse,
+};
+
+static const struct pl_ops ops_avx2 = {
+	.name = "avx2",
+	.blend = blend_avx2,
+	.fill32 = fill32_avx2,
+	.to_rg24 = to_rg24_sse,
+	.to_bg24 = to_bg24_sse,
+	.from_rg24 = from_rg24_sse,
+	.from_bg24 = from_bg24_sse,
+	.to_yuyv = to_yuyv_x86,
+	.to_uyvy = to_uyvy_x86,
+	.to_nv12 = to_nv12_x86,
+	.lerp = lerp_avx2,
+};
+
+const struct pl_ops *pl_ops_ssse3(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("ssse3") ? &ops_ssse3 : NULL;
+}
+
+const struct pl_ops *pl_ops_avx2(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") ? &ops_avx2 : NULL;
+}
+
+#else
+
+const struct pl_ops *pl_ops_ssse3(void)
+{
+	return NULL;
+}
+
+const struct pl_ops *pl_ops_avx2(void)
+{
+	return NULL;
+}
+
+#endif
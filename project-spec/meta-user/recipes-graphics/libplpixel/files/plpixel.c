@@ -0,0 +1,601 @@
+/*
+ * plpixel - C kernels, kernel set selection and the image operations
+ *
+ * Copyright (C) 2026
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <drm_fourcc.h>
+
+#include "plpixel.h"
+#include "plpixel-private.h"
+
+/* Pixels per row chunk for conversions through XRGB8888 on the stack */
+#define CHUNK		256
+
+/* C kernels, the reference for the others */
+
+static void blend_c(uint32_t *dst, const uint32_t *src, unsigned int n)
+{
+	for (; n; n--, dst++, src++) {
+		uint32_t s = *src, d = *dst, a = s >> 24, out = 0xff000000;
+		unsigned int shift, t;
+
+		if (a == 0xff) {
+			*dst = s;
+			continue;
+		}
+		if (!(s & 0xffffff) && !a) {
+			*dst = d | 0xff000000;
+			continue;
+		}
+		for (shift = 0; shift < 24; shift += 8) {
+			t = ((d >> shift) & 0xff) * (255 - a);
+			/* exact t / 255, rounded */
+			t = (t + ((t + 128) >> 8) + 128) >> 8;
+			t += (s >> shift) & 0xff;
+			out |= (t > 255 ? 255 : t) << shift;
+		}
+		*dst = out;
+	}
+}
+
+static void fill32_c(uint32_t *dst, uint32_t val, unsigned int n)
+{
+	while (n--)
+		*dst++ = val;
+}
+
+static void to_rg24_c(uint8_t *dst, const uint32_t *src, unsigned int n)
+{
+	for (; n; n--, dst += 3, src++) {
+		dst[0] = *src;
+		dst[1] = *src >> 8;
+		dst[2] = *src >> 16;
+	}
+}
+
+static void to_bg24_c(uint8_t *dst, const uint32_t *src, unsigned int n)
+{
+	for (; n; n--, dst += 3, src++) {
+		dst[0] = *src >> 16;
+		dst[1] = *src >> 8;
+		dst[2] = *src;
+	}
+}
+
+static void from_rg24_c(uint32_t *dst, const uint8_t *src, unsigned int n)
+{
+	for (; n; n--, dst++, src += 3)
+		*dst = 0xff000000 | src[2] << 16 | src[1] << 8 | src[0];
+}
+
+static void from_bg24_c(uint32_t *dst, const uint8_t *src, unsigned int n)
+{
+	for (; n; n--, dst++, src += 3)
+		*dst = 0xff000000 | src[0] << 16 | src[1] << 8 | src[2];
+}
+
+#define R(p)	(((p) >> 16) & 0xff)
+#define G(p)	(((p) >> 8) & 0xff)
+#define B(p)	((p) & 0xff)
+
+/* Y of each pixel, Cb and Cr of the pair average */
+static void to_422_c(uint8_t *dst, const uint32_t *src, unsigned int n,
+		     int uyvy)
+{
+	unsigned int i;
+	int r, g, b;
+
+	for (i = 0; i + 1 < n; i += 2, dst += 4) {
+		uint32_t p0 = src[i], p1 = src[i + 1];
+		uint8_t y0 = PL_Y(R(p0), G(p0), B(p0));
+		uint8_t y1 = PL_Y(R(p1), G(p1), B(p1));
+
+		r = (R(p0) + R(p1) + 1) >> 1;
+		g = (G(p0) + G(p1) + 1) >> 1;
+		b = (B(p0) + B(p1) + 1) >> 1;
+		if (uyvy) {
+			dst[0] = PL_U(r, g, b);
+			dst[1] = y0;
+			dst[2] = PL_V(r, g, b);
+			dst[3] = y1;
+		} else {
+			dst[0] = y0;
+			dst[1] = PL_U(r, g, b);
+			dst[2] = y1;
+			dst[3] = PL_V(r, g, b);
+		}
+	}
+}
+
+static void to_yuyv_c(uint8_t *dst, const uint32_t *src, unsigned int n)
+{
+	to_422_c(dst, src, n, 0);
+}
+
+static void to_uyvy_c(uint8_t *dst, const uint32_t *src, unsigned int n)
+{
+	to_422_c(dst, src, n, 1);
+}
+
+static void to_nv12_c(uint8_t *y0, uint8_t *y1, uint8_t *uv,
+		      const uint32_t *src0, const uint32_t *src1,
+		      unsigned int n)
+{
+	unsigned int i;
+	int r, g, b;
+
+	for (i = 0; i < n; i++) {
+		y0[i] = PL_Y(R(src0[i]), G(src0[i]), B(src0[i]));
+		y1[i] = PL_Y(R(src1[i]), G(src1[i]), B(src1[i]));
+	}
+	for (i = 0; i + 1 < n; i += 2, uv += 2) {
+		r = (R(src0[i]) + R(src0[i + 1]) + R(src1[i]) +
+		     R(src1[i + 1]) + 2) >> 2;
+		g = (G(src0[i]) + G(src0[i + 1]) + G(src1[i]) +
+		     G(src1[i + 1]) + 2) >> 2;
+		b = (B(src0[i]) + B(src0[i + 1]) + B(src1[i]) +
+		     B(src1[i + 1]) + 2) >> 2;
+		uv[0] = PL_U(r, g, b);
+		uv[1] = PL_V(r, g, b);
+	}
+}
+
+static void lerp_c(uint32_t *dst, const uint32_t *a, const uint32_t *b,
+		   unsigned int f, unsigned int n)
+{
+	const uint8_t *pa = (const uint8_t *)a, *pb = (const uint8_t *)b;
+	uint8_t *pd = (uint8_t *)dst;
+	unsigned int i;
+
+	for (i = 0; i < n * 4; i++)
+		pd[i] = (pa[i] * (256 - f) + pb[i] * f + 128) >> 8;
+}
+
+const struct pl_ops pl_ops_c = {
+	.name = "c",
+	.blend = blend_c,
+	.fill32 = fill32_c,
+	.to_rg24 = to_rg24_c,
+	.to_bg24 = to_bg24_c,
+	.from_rg24 = from_rg24_c,
+	.from_bg24 = from_bg24_c,
+	.to_yuyv = to_yuyv_c,
+	.to_uyvy = to_uyvy_c,
+	.to_nv12 = to_nv12_c,
+	.lerp = lerp_c,
+};
+
+/* Kernel set selection */
+
+static const struct pl_ops *ops;
+static pthread_once_t ops_once = PTHREAD_ONCE_INIT;
+
+static const struct pl_ops *find_ops(const char *name)
+{
+	if (!strcmp(name, "c"))
+		return &pl_ops_c;
+	if (!strcmp(name, "neon"))
+		return pl_ops_neon();
+	if (!strcmp(name, "ssse3"))
+		return pl_ops_ssse3();
+	if (!strcmp(name, "avx2"))
+		return pl_ops_avx2();
+	return NULL;
+}
+
+static void select_ops(void)
+{
+	const char *env = getenv("PL_PIXEL_ISA");
+
+	if (env)
+		ops = find_ops(env);
+	if (!ops)
+		ops = pl_ops_neon();
+	if (!ops)
+		ops = pl_ops_avx2();
+	if (!ops)
+		ops = pl_ops_ssse3();
+	if (!ops)
+		ops = &pl_ops_c;
+}
+
+static const struct pl_ops *get_ops(void)
+{
+	pthread_once(&ops_once, select_ops);
+	return ops;
+}
+
+const char *pl_isa(void)
+{
+	return get_ops()->name;
+}
+
+int pl_set_isa(const char *name)
+{
+	const struct pl_ops *o = find_ops(name);
+
+	if (!o)
+		return -ENOTSUP;
+	get_ops();
+	ops = o;
+	return 0;
+}
+
+/* Images */
+
+unsigned int pl_format_cpp(uint32_t format)
+{
+	switch (format) {
+	case DRM_FORMAT_XRGB8888:
+	case DRM_FORMAT_ARGB8888:
+		return 4;
+	case DRM_FORMAT_RGB888:
+	case DRM_FORMAT_BGR888:
+		return 3;
+	case DRM_FORMAT_YUYV:
+	case DRM_FORMAT_UYVY:
+		return 2;
+	case DRM_FORMAT_NV12:
+		return 1;
+	}
+	return 0;
+}
+
+void pl_image_init(struct pl_image *img, uint32_t format, uint32_t width,
+		   uint32_t height, void *data, uint32_t pitch)
+{
+	memset(img, 0, sizeof(*img));
+	img->format = format;
+	img->width = width;
+	img->height = height;
+	img->data[0] = data;
+	img->pitch[0] = pitch;
+	if (format == DRM_FORMAT_NV12) {
+		img->data[1] = (uint8_t *)data + (size_t)pitch * height;
+		img->pitch[1] = pitch;
+	}
+}
+
+static int is_rgb(uint32_t format)
+{
+	return pl_format_cpp(format) >= 3;
+}
+
+static int rect_ok(const struct pl_image *img, int x, int y,
+		   unsigned int w, unsigned int h)
+{
+	if (!pl_format_cpp(img->format) || x < 0 || y < 0 ||
+	    (uint64_t)x + w > img->width || (uint64_t)y + h > img->height)
+		return 0;
+
+	switch (img->format) {
+	case DRM_FORMAT_YUYV:
+	case DRM_FORMAT_UYVY:
+		return !(x & 1) && !(w & 1);
+	case DRM_FORMAT_NV12:
+		return !((x | y) & 1) && !((w | h) & 1);
+	}
+	return 1;
+}
+
+static uint8_t *at(const struct pl_image *img, int x, int y)
+{
+	return img->data[0] + (size_t)y * img->pitch[0] +
+	       (size_t)x * pl_format_cpp(img->format);
+}
+
+/*
+ * Row of n XRGB8888 pixels at x, y of an RGB image: a pointer into the
+ * image for 32 bpp, or converted into tmp.
+ */
+static const uint32_t *read_row(const struct pl_ops *o,
+				const struct pl_image *img, int x, int y,
+				unsigned int n, uint32_t *tmp)
+{
+	const uint8_t *p = at(img, x, y);
+
+	switch (img->format) {
+	case DRM_FORMAT_RGB888:
+		o->from_rg24(tmp, p, n);
+		return tmp;
+	case DRM_FORMAT_BGR888:
+		o->from_bg24(tmp, p, n);
+		return tmp;
+	}
+	return (const uint32_t *)p;
+}
+
+/*
+ * Store rows at x, y; NV12 takes two rows at a time. The rows are ARGB8888
+ * when alpha is set, else XRGB8888 and made opaque for an ARGB image.
+ */
+static void write_rows(const struct pl_ops *o, const struct pl_image *img,
+		       int x, int y, unsigned int n, const uint32_t *row0,
+		       const uint32_t *row1, int alpha)
+{
+	uint8_t *p = at(img, x, y);
+	uint32_t *d = (uint32_t *)p;
+	unsigned int i;
+
+	switch (img->format) {
+	case DRM_FORMAT_ARGB8888:
+		if (!alpha) {
+			for (i = 0; i < n; i++)
+				d[i] = row0[i] | 0xff000000;
+			break;
+		}
+		/* fall through */
+	case DRM_FORMAT_XRGB8888:
+		if (d != row0)
+			memcpy(d, row0, n * 4);
+		break;
+	case DRM_FORMAT_RGB888:
+		o->to_rg24(p, row0, n);
+		break;
+	case DRM_FORMAT_BGR888:
+		o->to_bg24(p, row0, n);
+		break;
+	case DRM_FORMAT_YUYV:
+		o->to_yuyv(p, row0, n);
+		break;
+	case DRM_FORMAT_UYVY:
+		o->to_uyvy(p, row0, n);
+		break;
+	case DRM_FORMAT_NV12:
+		o->to_nv12(p, p + img->pitch[0],
+			   img->data[1] + (size_t)(y / 2) * img->pitch[1] + x,
+			   row0, row1, n);
+		break;
+	}
+}
+
+static void copy_plane(uint8_t *dst, uint32_t dpitch, const uint8_t *src,
+		       uint32_t spitch, size_t bytes, unsigned int rows)
+{
+	while (rows--) {
+		memcpy(dst, src, bytes);
+		dst += dpitch;
+		src += spitch;
+	}
+}
+
+int pl_fill(const struct pl_image *dst, int x, int y, unsigned int width,
+	    unsigned int height, uint32_t argb)
+{
+	const struct pl_ops *o = get_ops();
+	uint32_t xrgb[CHUNK], val = argb;
+	uint8_t row[CHUNK * 3];
+	int r = R(argb), g = G(argb), b = B(argb);
+	unsigned int i, j, n;
+	uint8_t *p;
+
+	if (!rect_ok(dst, x, y, width, height))
+		return -EINVAL;
+
+	switch (dst->format) {
+	case DRM_FORMAT_RGB888:
+	case DRM_FORMAT_BGR888:
+		n = width < CHUNK ? width : CHUNK;
+		o->fill32(xrgb, argb, n);
+		if (dst->format == DRM_FORMAT_RGB888)
+			o->to_rg24(row, xrgb, n);
+		else
+			o->to_bg24(row, xrgb, n);
+		for (j = 0; j < height; j++)
+			for (i = 0; i < width; i += n)
+				memcpy(at(dst, x + i, y + j), row,
+				       (width - i < n ? width - i : n) * 3);
+		return 0;
+	case DRM_FORMAT_YUYV:
+	case DRM_FORMAT_UYVY:
+		p = (uint8_t *)&val;
+		p[dst->format == DRM_FORMAT_YUYV ? 0 : 1] = PL_Y(r, g, b);
+		p[dst->format == DRM_FORMAT_YUYV ? 2 : 3] = PL_Y(r, g, b);
+		p[dst->format == DRM_FORMAT_YUYV ? 1 : 0] = PL_U(r, g, b);
+		p[dst->format == DRM_FORMAT_YUYV ? 3 : 2] = PL_V(r, g, b);
+		width /= 2;
+		break;
+	case DRM_FORMAT_NV12:
+		for (j = 0; j < height; j++)
+			memset(at(dst, x, y + j), PL_Y(r, g, b), width);
+		for (j = 0; j < height / 2; j++) {
+			p = dst->data[1] + (size_t)(y / 2 + j) * dst->pitch[1] + x;
+			for (i = 0; i < width; i += 2) {
+				p[i] = PL_U(r, g, b);
+				p[i + 1] = PL_V(r, g, b);
+			}
+		}
+		return 0;
+	case DRM_FORMAT_XRGB8888:
+		val |= 0xff000000;
+		break;
+	}
+
+	for (j = 0; j < height; j++)
+		o->fill32((uint32_t *)at(dst, x, y + j), val, width);
+	return 0;
+}
+
+int pl_convert(const struct pl_image *dst, int dx, int dy,
+	       const struct pl_image *src, int sx, int sy,
+	       unsigned int width, unsigned int height)
+{
+	const struct pl_ops *o = get_ops();
+	uint32_t tmp0[CHUNK], tmp1[CHUNK];
+	const uint32_t *r0, *r1 = NULL;
+	unsigned int i, j, n, rows;
+
+	if (!rect_ok(dst, dx, dy, width, height) ||
+	    !rect_ok(src, sx, sy, width, height))
+		return -EINVAL;
+
+	if (src->format == dst->format) {
+		copy_plane(at(dst, dx, dy), dst->pitch[0], at(src, sx, sy),
+			   src->pitch[0],
+			   (size_t)width * pl_format_cpp(src->format), height);
+		if (src->format == DRM_FORMAT_NV12)
+			copy_plane(dst->data[1] + (size_t)(dy / 2) * dst->pitch[1] + dx,
+				   dst->pitch[1],
+				   src->data[1] + (size_t)(sy / 2) * src->pitch[1] + sx,
+				   src->pitch[1], width, height / 2);
+		return 0;
+	}
+	if (!is_rgb(src->format))
+		return -EINVAL;
+
+	rows = dst->format == DRM_FORMAT_NV12 ? 2 : 1;
+	for (j = 0; j < height; j += rows) {
+		for (i = 0; i < width; i += n) {
+			n = width - i < CHUNK ? width - i : CHUNK;
+			/* 24 to 32 bpp goes straight into the destination */
+			r0 = read_row(o, src, sx + i, sy + j, n,
+				      dst->format == DRM_FORMAT_XRGB8888 ?
+				      (uint32_t *)at(dst, dx + i, dy + j) : tmp0);
+			if (rows == 2)
+				r1 = read_row(o, src, sx + i, sy + j + 1, n, tmp1);
+			write_rows(o, dst, dx + i, dy + j, n, r0, r1,
+				   src->format == DRM_FORMAT_ARGB8888);
+		}
+	}
+
+	return 0;
+}
+
+int pl_blend(const struct pl_image *dst, int dx, int dy,
+	     const struct pl_image *src, int sx, int sy,
+	     unsigned int width, unsigned int height)
+{
+	const struct pl_ops *o = get_ops();
+	uint32_t tmp[CHUNK];
+	unsigned int i, j, n;
+
+	if (src->format != DRM_FORMAT_ARGB8888)
+		return pl_convert(dst, dx, dy, src, sx, sy, width, height);
+	if (!is_rgb(dst->format) || !rect_ok(dst, dx, dy, width, height) ||
+	    !rect_ok(src, sx, sy, width, height))
+		return -EINVAL;
+
+	for (j = 0; j < height; j++) {
+		const uint32_t *s = (const uint32_t *)at(src, sx, sy + j);
+
+		if (pl_format_cpp(dst->format) == 4) {
+			o->blend((uint32_t *)at(dst, dx, dy + j), s, width);
+			continue;
+		}
+		for (i = 0; i < width; i += n) {
+			n = width - i < CHUNK ? width - i : CHUNK;
+			read_row(o, dst, dx + i, dy + j, n, tmp);
+			o->blend(tmp, s + i, n);
+			write_rows(o, dst, dx + i, dy + j, n, tmp, NULL, 0);
+		}
+	}
+
+	return 0;
+}
+
+/* Source position of destination pixel i in 24.8 fixed point, centred */
+static unsigned int scale_pos(unsigned int i, unsigned int sn, unsigned int dn)
+{
+	int64_t pos = ((2 * (int64_t)i + 1) * sn * 256) / (2 * dn) - 128;
+
+	if (pos < 0)
+		return 0;
+	if (pos > (int64_t)(sn - 1) * 256)
+		return (sn - 1) * 256;
+	return pos;
+}
+
+static void scale_row(const struct pl_ops *o, uint32_t *out,
+		      const struct pl_image *src, int sx, int sy,
+		      unsigned int sw, unsigned int sh, unsigned int dh,
+		      unsigned int j, const unsigned int *xpos,
+		      unsigned int dw, enum pl_filter filter, uint32_t *tmp)
+{
+	const uint32_t *r0, *r1;
+	unsigned int i, y, f, x0, x1, c;
+
+	if (filter == PL_FILTER_NEAREST) {
+		r0 = read_row(o, src, sx, sy + (2 * j + 1) * sh / (2 * dh), sw,
+			      tmp);
+		for (i = 0; i < dw; i++)
+			out[i] = r0[(2 * i + 1) * sw / (2 * dw)];
+		return;
+	}
+
+	/* Vertical pass over the source row, then horizontal */
+	y = scale_pos(j, sh, dh);
+	f = y & 0xff;
+	r0 = read_row(o, src, sx, sy + (y >> 8), sw, tmp);
+	if (f) {
+		r1 = read_row(o, src, sx, sy + (y >> 8) + 1, sw, tmp + sw);
+		o->lerp(tmp + 2 * sw, r0, r1, f, sw);
+		r0 = tmp + 2 * sw;
+	}
+
+	for (i = 0; i < dw; i++) {
+		uint32_t a, b, p = 0;
+
+		x0 = xpos[i] >> 8;
+		f = xpos[i] & 0xff;
+		x1 = x0 + 1 < sw ? x0 + 1 : x0;
+		a = r0[x0];
+		b = r0[x1];
+		for (c = 0; c < 32; c += 8)
+			p |= ((((a >> c) & 0xff) * (256 - f) +
+			       ((b >> c) & 0xff) * f + 128) >> 8) << c;
+		out[i] = p;
+	}
+}
+
+int pl_scale(const struct pl_image *dst, int dx, int dy, unsigned int dw,
+	     unsigned int dh, const struct pl_image *src, int sx, int sy,
+	     unsigned int sw, unsigned int sh, enum pl_filter filter)
+{
+	const struct pl_ops *o = get_ops();
+	unsigned int *xpos, i, j, rows;
+	uint32_t *buf, *out0, *out1;
+
+	if (sw == dw && sh == dh)
+		return pl_convert(dst, dx, dy, src, sx, sy, dw, dh);
+	if (!is_rgb(src->format) || !rect_ok(dst, dx, dy, dw, dh) ||
+	    !rect_ok(src, sx, sy, sw, sh))
+		return -EINVAL;
+	if (!dw || !dh)
+		return 0;
+
+	/* three source rows of scratch and two output rows */
+	xpos = malloc(dw * sizeof(*xpos));
+	buf = malloc((3 * (size_t)sw + 2 * (size_t)dw) * sizeof(*buf));
+	if (!xpos || !buf) {
+		free(xpos);
+		free(buf);
+		return -ENOMEM;
+	}
+	out0 = buf + 3 * sw;
+	out1 = out0 + dw;
+
+	for (i = 0; i < dw; i++)
+		xpos[i] = scale_pos(i, sw, dw);
+
+	rows = dst->format == DRM_FORMAT_NV12 ? 2 : 1;
+	for (j = 0; j < dh; j += rows) {
+		scale_row(o, out0, src, sx, sy, sw, sh, dh, j, xpos, dw,
+			  filter, buf);
+		if (rows == 2)
+			scale_row(o, out1, src, sx, sy, sw, sh, dh, j + 1, xpos,
+				  dw, filter, buf);
+		write_rows(o, dst, dx, dy + j, dw, out0, out1,
+			   src->format == DRM_FORMAT_ARGB8888);
+	}
+
+	free(xpos);
+	free(buf);
+	return 0;
+}
@@ -0,0 +1,95 @@
+/*
+ * plpixel - pixel conversion, fill, blend and scale into the frmbuf formats
+ *
+ * Images are described by a DRM fourcc, a size and up to two planes. The
+ * destination formats are the ones in the frmbuf's xlnx,vid-formats:
+ *
+ *   DRM_FORMAT_RGB888    RG24, B G R in memory
+ *   DRM_FORMAT_BGR888    BG24, R G B in memory
+ *   DRM_FORMAT_XRGB8888  XR24
+ *   DRM_FORMAT_ARGB8888  AR24, premultiplied alpha
+ *   DRM_FORMAT_YUYV      YUYV, BT.601 limited range
+ *   DRM_FORMAT_UYVY      UYVY
+ *   DRM_FORMAT_NV12      NV12, Y plane and interleaved CbCr plane
+ *
+ * Sources are the four RGB formats; a YUV source only copies into the
+ * same format. YUV destinations need an even x and width, NV12 an even y
+ * and height as well.
+ *
+ * The kernels come in C and, chosen at run time, NEON on ARM and SSSE3 or
+ * AVX2 on x86, so the same calls can be benchmarked on a host. All
+ * variants give the same bytes. The functions are thread safe and may run
+ * on disjoint parts of one image at the same time.
+ *
+ * Copyright (C) 2026
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef PLPIXEL_H
+#define PLPIXEL_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct pl_image {
+	uint32_t format;
+	uint32_t width, height;
+	uint8_t *data[2];
+	uint32_t pitch[2];
+};
+
+enum pl_filter {
+	PL_FILTER_NEAREST,
+	PL_FILTER_BILINEAR,
+};
+
+/* Single plane image, or NV12 with the CbCr plane right after the Y plane */
+void pl_image_init(struct pl_image *img, uint32_t format, uint32_t width,
+		   uint32_t height, void *data, uint32_t pitch);
+
+/* Bytes per pixel of the first plane, 0 if the format is not handled */
+unsigned int pl_format_cpp(uint32_t format);
+
+/*
+ * All operations return 0, or -EINVAL for a format they do not handle or
+ * a rectangle that is not inside both images.
+ */
+
+/* Fill with an ARGB8888 colour, converted to the destination format */
+int pl_fill(const struct pl_image *dst, int x, int y, unsigned int width,
+	    unsigned int height, uint32_t argb);
+
+/* Copy a rectangle, converting between formats */
+int pl_convert(const struct pl_image *dst, int dx, int dy,
+	       const struct pl_image *src, int sx, int sy,
+	       unsigned int width, unsigned int height);
+
+/*
+ * Blend a premultiplied ARGB8888 rectangle over an RGB destination;
+ * opaque sources are converted instead.
+ */
+int pl_blend(const struct pl_image *dst, int dx, int dy,
+	     const struct pl_image *src, int sx, int sy,
+	     unsigned int width, unsigned int height);
+
+/* Scale a source rectangle to a destination rectangle */
+int pl_scale(const struct pl_image *dst, int dx, int dy, unsigned int dw,
+	     unsigned int dh, const struct pl_image *src, int sx, int sy,
+	     unsigned int sw, unsigned int sh, enum pl_filter filter);
+
+/*
+ * Kernel set in use: "c", "neon", "ssse3" or "avx2". The best one the CPU
+ * has is picked on first use, or the one named by PL_PIXEL_ISA.
+ * pl_set_isa() returns -ENOTSUP for a set the CPU or the build lacks.
+ */
+const char *pl_isa(void);
+int pl_set_isa(const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -9,348 +9,37 @@
 #include <linux/module.h>
 #include <linux/err.h>
 #include <linux/kernel.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/string.h>
 
-#define CLK_BIT_WEDGE 13
-#define CLK_BIT_NOCOUNT 12
-
-#define ERR_CLKCOUNTCALC 0xFFFFFFFF //This value is used to signal an error
-#define ERR_CLKDIVIDER (1 << CLK_BIT_WEDGE | 1 << CLK_BIT_NOCOUNT)
-
-#define DYNCLK_DIV_1_REGMASK 0x1041
-#define DYNCLK_DEFAULT_FREQ 125000 //25 MHz (125 KHz / 5)
-
-#define MMCM_FREQ_VCOMIN 600000
-#define MMCM_FREQ_VCOMAX 1200000
-#define MMCM_FREQ_PFDMIN 10000
-#define MMCM_FREQ_PFDMAX 450000
-#define MMCM_FREQ_OUTMIN 4000
-#define MMCM_FREQ_OUTMAX 800000
-#define MMCM_DIV_MAX 106
-#define MMCM_FB_MIN 2
-#define MMCM_FB_MAX 64
-#define MMCM_CLKDIV_MAX 128
-#define MMCM_CLKDIV_MIN 1
-
-#define OFST_DISPLAY_CTRL 0x0
-#define OFST_DISPLAY_STATUS 0x4
-#define OFST_DISPLAY_CLK_L 0x8
-#define OFST_DISPLAY_FB_L 0x0C
-#define OFST_DISPLAY_FB_H_CLK_H 0x10
-#define OFST_DISPLAY_DIV 0x14
-#define OFST_DISPLAY_LOCK_L 0x18
-#define OFST_DISPLAY_FLTR_LOCK_H 0x1C
-
-static const u64 lock_lookup[64] = {
-   0b0011000110111110100011111010010000000001,
-   0b0011000110111110100011111010010000000001,
-   0b0100001000111110100011111010010000000001,
-   0b0101101011111110100011111010010000000001,
-   0b0111001110111110100011111010010000000001,
-   0b1000110001111110100011111010010000000001,
-   0b1001110011111110100011111010010000000001,
-   0b1011010110111110100011111010010000000001,
-   0b1100111001111110100011111010010000000001,
-   0b1110011100111110100011111010010000000001,
-   0b1111111111111000010011111010010000000001,
-   0b1111111111110011100111111010010000000001,
-   0b1111111111101110111011111010010000000001,
-   0b1111111111101011110011111010010000000001,
-   0b1111111111101000101011111010010000000001,
-   0b1111111111100111000111111010010000000001,
-   0b1111111111100011111111111010010000000001,
-   0b1111111111100010011011111010010000000001,
-   0b1111111111100000110111111010010000000001,
-   0b1111111111011111010011111010010000000001,
-   0b1111111111011101101111111010010000000001,
-   0b1111111111011100001011111010010000000001,
-   0b1111111111011010100111111010010000000001,
-   0b1111111111011001000011111010010000000001,
-   0b1111111111011001000011111010010000000001,
-   0b1111111111010111011111111010010000000001,
-   0b1111111111010101111011111010010000000001,
-   0b1111111111010101111011111010010000000001,
-   0b1111111111010100010111111010010000000001,
-   0b1111111111010100010111111010010000000001,
-   0b1111111111010010110011111010010000000001,
-   0b1111111111010010110011111010010000000001,
-   0b1111111111010010110011111010010000000001,
-   0b1111111111010001001111111010010000000001,
-   0b1111111111010001001111111010010000000001,
-   0b1111111111010001001111111010010000000001,
-   0b1111111111001111101011111010010000000001,
-   0b1111111111001111101011111010010000000001,
-   0b1111111111001111101011111010010000000001,
-   0b1111111111001111101011111010010000000001,
-   0b1111111111001111101011111010010000000001,
-   0b1111111111001111101011111010010000000001,
-   0b1111111111001111101011111010010000000001,
-   0b1111111111001111101011111010010000000001,
-   0b1111111111001111101011111010010000000001,
-   0b1111111111001111101011111010010000000001,
-   0b1111111111001111101011111010010000000001,
-   0b1111111111001111101011111010010000000001,
-   0b1111111111001111101011111010010000000001,
-   0b1111111111001111101011111010010000000001,
-   0b1111111111001111101011111010010000000001,
-   0b1111111111001111101011111010010000000001,
-   0b1111111111001111101011111010010000000001,
-   0b1111111111001111101011111010010000000001,
-   0b1111111111001111101011111010010000000001,
-   0b1111111111001111101011111010010000000001,
-   0b1111111111001111101011111010010000000001,
-   0b1111111111001111101011111010010000000001,
-   0b1111111111001111101011111010010000000001,
-   0b1111111111001111101011111010010000000001,
-   0b1111111111001111101011111010010000000001,
-   0b1111111111001111101011111010010000000001,
-   0b1111111111001111101011111010010000000001,
-   0b1111111111001111101011111010010000000001
-};
+#include "dglnt-dynclk.h"
 
-static const u32 filter_lookup_low[64] = {
-	 0b0001011111,
-	 0b0001010111,
-	 0b0001111011,
-	 0b0001011011,
-	 0b0001101011,
-	 0b0001110011,
-	 0b0001110011,
-	 0b0001110011,
-	 0b0001110011,
-	 0b0001001011,
-	 0b0001001011,
-	 0b0001001011,
-	 0b0010110011,
-	 0b0001010011,
-	 0b0001010011,
-	 0b0001010011,
-	 0b0001010011,
-	 0b0001010011,
-	 0b0001010011,
-	 0b0001010011,
-	 0b0001010011,
-	 0b0001010011,
-	 0b0001010011,
-	 0b0001100011,
-	 0b0001100011,
-	 0b0001100011,
-	 0b0001100011,
-	 0b0001100011,
-	 0b0001100011,
-	 0b0001100011,
-	 0b0001100011,
-	 0b0001100011,
-	 0b0001100011,
-	 0b0001100011,
-	 0b0001100011,
-	 0b0001100011,
-	 0b0001100011,
-	 0b0010010011,
-	 0b0010010011,
-	 0b0010010011,
-	 0b0010010011,
-	 0b0010010011,
-	 0b0010010011,
-	 0b0010010011,
-	 0b0010010011,
-	 0b0010010011,
-	 0b0010010011,
-	 0b0010100011,
-	 0b0010100011,
-	 0b0010100011,
-	 0b0010100011,
-	 0b0010100011,
-	 0b0010100011,
-	 0b0010100011,
-	 0b0010100011,
-	 0b0010100011,
-	 0b0010100011,
-	 0b0010100011,
-	 0b0010100011,
-	 0b0010100011,
-	 0b0010100011,
-	 0b0010100011,
-	 0b0010100011,
-	 0b0010100011
+static const char * const dglnt_dynclk_objectives[] = {
+	[DGLNT_DYNCLK_MIN_ERROR] = "error",
+	[DGLNT_DYNCLK_MIN_JITTER] = "jitter",
+	[DGLNT_DYNCLK_MIN_POWER] = "power",
 };
 
-struct dglnt_dynclk_reg;
-struct dglnt_dynclk_mode;
-struct dglnt_dynclk;
-
-struct dglnt_dynclk_reg{
-		u32 clk0L;
-		u32 clkFBL;
-		u32 clkFBH_clk0H;
-		u32 divclk;
-		u32 lockL;
-		u32 fltr_lockH;
-};
+static char *objective;
+module_param(objective, charp, 0444);
+MODULE_PARM_DESC(objective, "Solver objective, error, jitter or power (overrides dglnt,objective)");
 
-struct dglnt_dynclk_mode{
-		u32 freq;
-		u32 fbmult;
-		u32 clkdiv;
-		u32 maindiv;
-};
+static int objective_ppm = -1;
+module_param(objective_ppm, int, 0444);
+MODULE_PARM_DESC(objective_ppm, "Extra error in ppm the objective may trade (overrides dglnt,objective-ppm)");
 
 struct dglnt_dynclk {
 	void __iomem *base;
 	struct clk_hw clk_hw;
    unsigned long freq;
+	enum dglnt_dynclk_objective objective;
+	u32 objective_ppm;
+	unsigned long req_rate;		/* Hz, last rate asked for */
+	u32 parent_khz;
+	struct dglnt_dynclk_mode mode;	/* last mode programmed or adopted */
 };
 
-static u32 dglnt_dynclk_divider(u32 divide)
-{
-	u32 output = 0;
-	u32 highTime = 0;
-	u32 lowTime = 0;
-
-	if ((divide < 1) || (divide > 128))
-		return ERR_CLKDIVIDER;
-
-	if (divide == 1)
-		return DYNCLK_DIV_1_REGMASK;
-
-	highTime = divide / 2;
-	if (divide & 0b1) //if divide is odd
-	{
-		lowTime = highTime + 1;
-		output = 1 << CLK_BIT_WEDGE;
-	}
-	else
-	{
-		lowTime = highTime;
-	}
-
-	output |= 0x03F & lowTime;
-	output |= 0xFC0 & (highTime << 6);
-	return output;
-}
-
-static u32 dglnt_dynclk_count_calc(u32 divide)
-{
-	u32 output = 0;
-	u32 divCalc = 0;
-
-	divCalc = dglnt_dynclk_divider(divide);
-	if (divCalc == ERR_CLKDIVIDER)
-		output = ERR_CLKCOUNTCALC;
-	else
-		output = (0xFFF & divCalc) | ((divCalc << 10) & 0x00C00000);
-	return output;
-}
-
-
-static int dglnt_dynclk_find_reg (struct dglnt_dynclk_reg *regValues, struct dglnt_dynclk_mode *clkParams)
-{
-	if ((clkParams->fbmult < 2) || clkParams->fbmult > 64 )
-		return -EINVAL;
-
-	regValues->clk0L = dglnt_dynclk_count_calc(clkParams->clkdiv);
-	if (regValues->clk0L == ERR_CLKCOUNTCALC)
-		return -EINVAL;
-
-	regValues->clkFBL = dglnt_dynclk_count_calc(clkParams->fbmult);
-	if (regValues->clkFBL == ERR_CLKCOUNTCALC)
-		return -EINVAL;
-
-	regValues->clkFBH_clk0H = 0;
-
-	regValues->divclk = dglnt_dynclk_divider(clkParams->maindiv);
-	if (regValues->divclk == ERR_CLKDIVIDER)
-		return -EINVAL;
-
-	regValues->lockL = (u32) (lock_lookup[clkParams->fbmult - 1] & 0xFFFFFFFF);
-
-	regValues->fltr_lockH = (u32) ((lock_lookup[clkParams->fbmult - 1] >> 32) & 0x000000FF);
-	regValues->fltr_lockH |= ((filter_lookup_low[clkParams->fbmult - 1] << 16) & 0x03FF0000);
-
-	return 0;
-}
-
-static void dglnt_dynclk_write_reg (struct dglnt_dynclk_reg *regValues, void __iomem *baseaddr)
-{
-   writel(regValues->clk0L, baseaddr + OFST_DISPLAY_CLK_L);
-   writel(regValues->clkFBL, baseaddr + OFST_DISPLAY_FB_L);
-   writel(regValues->clkFBH_clk0H, baseaddr + OFST_DISPLAY_FB_H_CLK_H);
-   writel(regValues->divclk, baseaddr + OFST_DISPLAY_DIV);
-   writel(regValues->lockL, baseaddr + OFST_DISPLAY_LOCK_L);
-   writel(regValues->fltr_lockH, baseaddr + OFST_DISPLAY_FLTR_LOCK_H);
-}
-
-
-static u32 dglnt_dynclk_find_mode(u32 freq, u32 parentFreq, struct dglnt_dynclk_mode *bestPick)
-{
-	u32 bestError = MMCM_FREQ_OUTMAX;
-	u32 curError;
-	u32 curClkMult;
-	u32 curFreq;
-   u32 divVal;
-	u32 curFb, curClkDiv;
-	u32 minFb = 0;
-	u32 maxFb = 0;
-   u32 curDiv = 1;
-   u32 maxDiv;
-   bool freq_found = false;
-
-	bestPick->freq = 0;
-   if (parentFreq == 0)
-      return 0; 
-
-   if (freq < MMCM_FREQ_OUTMIN)//minimum frequency is actually dictated by VCOmin
-      freq = MMCM_FREQ_OUTMIN;
-   if (freq > MMCM_FREQ_OUTMAX)
-      freq = MMCM_FREQ_OUTMAX;
-
-   if (parentFreq > MMCM_FREQ_PFDMAX)
-      curDiv = 2;      
-   maxDiv = parentFreq / MMCM_FREQ_PFDMIN;
-   if (maxDiv > MMCM_DIV_MAX)
-      maxDiv = MMCM_DIV_MAX;
-
-	while (curDiv <= maxDiv && !freq_found)
-	{
-		minFb = curDiv * DIV_ROUND_UP(MMCM_FREQ_VCOMIN, parentFreq); 
-		maxFb = curDiv * (MMCM_FREQ_VCOMAX / parentFreq); 
-		if (maxFb > MMCM_FB_MAX)
-			maxFb = MMCM_FB_MAX;
-		if (minFb < MMCM_FB_MIN)
-			minFb = MMCM_FB_MIN;
-
-      divVal = curDiv * freq;
-      curClkMult = ((parentFreq * 1000) + (divVal / 2)) / divVal; //This multiplier is used to find the best clkDiv value for each FB value
-		
-		curFb = minFb;
-	   while (curFb <= maxFb && !freq_found)
-	   {
-		   curClkDiv = ((curClkMult * curFb) + 500) / 1000;
-         if (curClkDiv > MMCM_CLKDIV_MAX)
-             curClkDiv = MMCM_CLKDIV_MAX;
-         if (curClkDiv < MMCM_CLKDIV_MIN)
-            curClkDiv = MMCM_CLKDIV_MIN;
-		   curFreq = (((parentFreq * curFb) / curDiv) / curClkDiv);
-         if (curFreq >= freq)			
-            curError = curFreq - freq;
-         else
-            curError = freq - curFreq;
-		   if (curError < bestError)
-		   {
-			   bestError = curError;
-			   bestPick->clkdiv = curClkDiv;
-			   bestPick->fbmult = curFb;
-			   bestPick->maindiv = curDiv;
-			   bestPick->freq = curFreq;
-		   }
-         if (!curError)
-            freq_found = true;
-		   curFb++;
-      }
-      curDiv++;
-	}
-   return bestPick->freq;
-}
-
 static struct dglnt_dynclk *clk_hw_to_dglnt_dynclk(struct clk_hw *clk_hw)
 {
 	return container_of(clk_hw, struct dglnt_dynclk, clk_hw);
@@ -360,15 +49,11 @@ static struct dglnt_dynclk *clk_hw_to_dglnt_dynclk(struct clk_hw *clk_hw)
 static int dglnt_dynclk_enable(struct clk_hw *clk_hw)
 {
 	struct dglnt_dynclk *dglnt_dynclk = clk_hw_to_dglnt_dynclk(clk_hw);
-	unsigned int clock_state;
 
 	if (dglnt_dynclk->freq)
 	{
 		writel(1, dglnt_dynclk->base + OFST_DISPLAY_CTRL);
-		do
-		{
-			clock_state = readl(dglnt_dynclk->base + OFST_DISPLAY_STATUS);
-		} while (!clock_state);
+		return dglnt_dynclk_wait_lock(dglnt_dynclk->base + OFST_DISPLAY_STATUS, ~0);
 	}
 	return 0;
 }
@@ -394,8 +79,9 @@ static int dglnt_dynclk_set_rate(struct clk_hw *clk_hw,
 
 	rate = (rate + 100) / 200; //Convert from Hz to KHz, then multiply by five to account for BUFR division
 	parent_rate = (parent_rate + 500) / 1000; //convert from Hz to KHz 
-   if(!dglnt_dynclk_find_mode(rate, parent_rate, &clkMode))
-      return -EINVAL;
+	if (!dglnt_dynclk_find_mode_obj(rate, parent_rate, dglnt_dynclk->objective,
+					dglnt_dynclk->objective_ppm, &clkMode))
+		return -EINVAL;
 
 	/*
 	 * Write to the PLL dynamic configuration registers to configure it with the calculated
@@ -404,29 +90,90 @@ static int dglnt_dynclk_set_rate(struct clk_hw *clk_hw,
 	dglnt_dynclk_find_reg(&clkReg, &clkMode);
 	dglnt_dynclk_write_reg(&clkReg, dglnt_dynclk->base);
    dglnt_dynclk->freq = clkMode.freq * 200;
+	dglnt_dynclk->req_rate = rate * 200;
+	dglnt_dynclk->parent_khz = parent_rate;
+	dglnt_dynclk->mode = clkMode;
    dglnt_dynclk_disable(clk_hw);
-   dglnt_dynclk_enable(clk_hw);
-	return 0;
+	return dglnt_dynclk_enable(clk_hw);
 }
 
 static long dglnt_dynclk_round_rate(struct clk_hw *hw, unsigned long rate,
 	unsigned long *parent_rate)
 {
+	struct dglnt_dynclk *dglnt_dynclk = clk_hw_to_dglnt_dynclk(hw);
 	struct dglnt_dynclk_mode clkMode;
-   
-   dglnt_dynclk_find_mode(((rate + 100) / 200), ((*parent_rate) + 500) / 1000, &clkMode);
+
+	dglnt_dynclk_find_mode_obj(((rate + 100) / 200), ((*parent_rate) + 500) / 1000,
+				   dglnt_dynclk->objective, dglnt_dynclk->objective_ppm, &clkMode);
 
 	return (clkMode.freq * 200);
 }
 
+static int dglnt_dynclk_is_enabled(struct clk_hw *clk_hw)
+{
+	struct dglnt_dynclk *dglnt_dynclk = clk_hw_to_dglnt_dynclk(clk_hw);
+
+	return readl(dglnt_dynclk->base + OFST_DISPLAY_CTRL) & 1;
+}
+
 static unsigned long dglnt_dynclk_recalc_rate(struct clk_hw *clk_hw,
 	unsigned long parent_rate)
 {
 	struct dglnt_dynclk *dglnt_dynclk = clk_hw_to_dglnt_dynclk(clk_hw);
-	
+	struct dglnt_dynclk_reg clkReg;
+	struct dglnt_dynclk_mode clkMode;
+
+	/*
+	 * A locked clock left by the boot loader is adopted, so a set_rate to
+	 * the same pixel clock leaves the display it lit undisturbed.
+	 */
+	if (!dglnt_dynclk->freq && dglnt_dynclk_is_enabled(clk_hw) &&
+	    readl(dglnt_dynclk->base + OFST_DISPLAY_STATUS))
+	{
+		dglnt_dynclk_read_reg(&clkReg, dglnt_dynclk->base);
+		dglnt_dynclk->freq = dglnt_dynclk_decode_mode(&clkReg,
+				(parent_rate + 500) / 1000, &clkMode) * 200;
+		dglnt_dynclk->req_rate = dglnt_dynclk->freq;
+		dglnt_dynclk->parent_khz = (parent_rate + 500) / 1000;
+		dglnt_dynclk->mode = clkMode;
+	}
+
 	return dglnt_dynclk->freq;
 }
 
+static int dglnt_dynclk_mode_show(struct seq_file *s, void *data)
+{
+	struct dglnt_dynclk *dglnt_dynclk = s->private;
+	struct dglnt_dynclk_mode mode = dglnt_dynclk->mode;
+	unsigned long req = dglnt_dynclk->req_rate;
+	long err_ppm = 0;
+
+	if (req)
+		err_ppm = div_s64(((s64)mode.freq * 200 - req) * 1000000, req);
+
+	seq_printf(s, "objective: %s\n", dglnt_dynclk_objectives[dglnt_dynclk->objective]);
+	seq_printf(s, "objective_ppm: %u\n", dglnt_dynclk->objective_ppm);
+	if (!mode.freq)
+		return 0;
+	seq_printf(s, "parent_khz: %u\n", dglnt_dynclk->parent_khz);
+	seq_printf(s, "maindiv: %u\n", mode.maindiv);
+	seq_printf(s, "fbmult: %u\n", mode.fbmult);
+	seq_printf(s, "clkdiv: %u\n", mode.clkdiv);
+	seq_printf(s, "pfd_khz: %u\n", mode.pfd);
+	seq_printf(s, "vco_khz: %u\n", mode.vco);
+	seq_printf(s, "serial_khz: %u\n", mode.freq);
+	seq_printf(s, "pixel_hz: %u\n", mode.freq * 200);
+	seq_printf(s, "requested_hz: %lu\n", req);
+	seq_printf(s, "error_ppm: %ld\n", err_ppm);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(dglnt_dynclk_mode);
+
+static void dglnt_dynclk_debug_init(struct clk_hw *clk_hw, struct dentry *dentry)
+{
+	debugfs_create_file("dglnt_mode", 0444, dentry,
+			    clk_hw_to_dglnt_dynclk(clk_hw), &dglnt_dynclk_mode_fops);
+}
 
 static const struct clk_ops dglnt_dynclk_ops = {
 	.recalc_rate = dglnt_dynclk_recalc_rate,
@@ -434,8 +181,41 @@ static const struct clk_ops dglnt_dynclk_ops = {
 	.set_rate = dglnt_dynclk_set_rate,
 	.enable = dglnt_dynclk_enable,
 	.disable = dglnt_dynclk_disable,
+	.is_enabled = dglnt_dynclk_is_enabled,
+	.debug_init = dglnt_dynclk_debug_init,
 };
 
+/*
+ * The module parameters win over the device tree, so the objective can
+ * be compared on a running board without rebuilding the DTB.
+ */
+static int dglnt_dynclk_parse_objective(struct device *dev, struct dglnt_dynclk *dglnt_dynclk)
+{
+	const char *name = objective;
+	u32 ppm = 0;
+	int ret;
+
+	if (!name)
+		of_property_read_string(dev->of_node, "dglnt,objective", &name);
+	if (name) {
+		ret = match_string(dglnt_dynclk_objectives,
+				   ARRAY_SIZE(dglnt_dynclk_objectives), name);
+		if (ret < 0) {
+			dev_err(dev, "unknown objective \"%s\"\n", name);
+			return ret;
+		}
+		dglnt_dynclk->objective = ret;
+	}
+
+	if (objective_ppm >= 0)
+		ppm = objective_ppm;
+	else
+		of_property_read_u32(dev->of_node, "dglnt,objective-ppm", &ppm);
+	dglnt_dynclk->objective_ppm = ppm;
+
+	return 0;
+}
+
 static const struct of_device_id dglnt_dynclk_ids[] = {
 	{ .compatible = "dglnt,axi-dynclk2",}, 
 	{ },
@@ -482,6 +262,10 @@ static int dglnt_dynclk_probe(struct platform_device *pdev)
     if (err)
         return err;
 
+    err = dglnt_dynclk_parse_objective(&pdev->dev, dglnt_dynclk);
+    if (err)
+        return err;
+
     /* Initialize clock data */
     init.name = clk_name;
     init.ops = &dglnt_dynclk_ops;
@@ -490,7 +274,8 @@ static int dglnt_dynclk_probe(struct platform_device *pdev)
     init.num_parents = 1;
 
     dglnt_dynclk->freq = 0;
-    dglnt_dynclk_disable(&dglnt_dynclk->clk_hw);
+    if (!readl(dglnt_dynclk->base + OFST_DISPLAY_STATUS))
+        dglnt_dynclk_disable(&dglnt_dynclk->clk_hw);
 
     /* Register clock */
     dglnt_dynclk->clk_hw.init = &init;
@@ -0,0 +1,504 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * MMCM solver for the Digilent axi_dynclk IP core, adapted from Digilent.
+ *
+ * Shared by the clk-dglnt-dynclk kernel module and the U-Boot video
+ * driver, so both program the same register values for a given rate and
+ * the kernel can recognise a mode left running by the boot loader.
+ * Frequencies are in kHz times five, as the IP divides by five in a BUFR.
+ * The clk-wiz-dynclk module uses the solver and the lock wait for the
+ * Clocking Wizard, with a fractional feedback multiplier.
+ */
+
+#ifndef __DGLNT_DYNCLK_H__
+#define __DGLNT_DYNCLK_H__
+
+#include <linux/types.h>
+#include <linux/kernel.h>
+#include <linux/errno.h>
+#include <linux/io.h>
+#include <linux/math64.h>
+#include <linux/delay.h>
+
+#define CLK_BIT_WEDGE 13
+#define CLK_BIT_NOCOUNT 12
+
+#define ERR_CLKCOUNTCALC 0xFFFFFFFF //This value is used to signal an error
+#define ERR_CLKDIVIDER (1 << CLK_BIT_WEDGE | 1 << CLK_BIT_NOCOUNT)
+
+#define DYNCLK_DIV_1_REGMASK 0x1041
+#define DYNCLK_DEFAULT_FREQ 125000 //25 MHz (125 KHz / 5)
+
+#define MMCM_FREQ_VCOMIN 600000
+#define MMCM_FREQ_VCOMAX 1200000
+#define MMCM_FREQ_PFDMIN 10000
+#define MMCM_FREQ_PFDMAX 450000
+#define MMCM_FREQ_OUTMIN 4000
+#define MMCM_FREQ_OUTMAX 800000
+#define MMCM_DIV_MAX 106
+#define MMCM_FB_MIN 2
+#define MMCM_FB_MAX 64
+#define MMCM_CLKDIV_MAX 128
+#define MMCM_CLKDIV_MIN 1
+#define MMCM_FB_FRAC_STEPS 8 //CLKFBOUT_MULT_F steps by 1/8
+#define MMCM_LOCK_TIMEOUT_US 1000
+
+#define OFST_DISPLAY_CTRL 0x0
+#define OFST_DISPLAY_STATUS 0x4
+#define OFST_DISPLAY_CLK_L 0x8
+#define OFST_DISPLAY_FB_L 0x0C
+#define OFST_DISPLAY_FB_H_CLK_H 0x10
+#define OFST_DISPLAY_DIV 0x14
+#define OFST_DISPLAY_LOCK_L 0x18
+#define OFST_DISPLAY_FLTR_LOCK_H 0x1C
+
+static const u64 lock_lookup[64] = {
+   0b0011000110111110100011111010010000000001,
+   0b0011000110111110100011111010010000000001,
+   0b0100001000111110100011111010010000000001,
+   0b0101101011111110100011111010010000000001,
+   0b0111001110111110100011111010010000000001,
+   0b1000110001111110100011111010010000000001,
+   0b1001110011111110100011111010010000000001,
+   0b1011010110111110100011111010010000000001,
+   0b1100111001111110100011111010010000000001,
+   0b1110011100111110100011111010010000000001,
+   0b1111111111111000010011111010010000000001,
+   0b1111111111110011100111111010010000000001,
+   0b1111111111101110111011111010010000000001,
+   0b1111111111101011110011111010010000000001,
+   0b1111111111101000101011111010010000000001,
+   0b1111111111100111000111111010010000000001,
+   0b1111111111100011111111111010010000000001,
+   0b1111111111100010011011111010010000000001,
+   0b1111111111100000110111111010010000000001,
+   0b1111111111011111010011111010010000000001,
+   0b1111111111011101101111111010010000000001,
+   0b1111111111011100001011111010010000000001,
+   0b1111111111011010100111111010010000000001,
+   0b1111111111011001000011111010010000000001,
+   0b1111111111011001000011111010010000000001,
+   0b1111111111010111011111111010010000000001,
+   0b1111111111010101111011111010010000000001,
+   0b1111111111010101111011111010010000000001,
+   0b1111111111010100010111111010010000000001,
+   0b1111111111010100010111111010010000000001,
+   0b1111111111010010110011111010010000000001,
+   0b1111111111010010110011111010010000000001,
+   0b1111111111010010110011111010010000000001,
+   0b1111111111010001001111111010010000000001,
+   0b1111111111010001001111111010010000000001,
+   0b1111111111010001001111111010010000000001,
+   0b1111111111001111101011111010010000000001,
+   0b1111111111001111101011111010010000000001,
+   0b1111111111001111101011111010010000000001,
+   0b1111111111001111101011111010010000000001,
+   0b1111111111001111101011111010010000000001,
+   0b1111111111001111101011111010010000000001,
+   0b1111111111001111101011111010010000000001,
+   0b1111111111001111101011111010010000000001,
+   0b1111111111001111101011111010010000000001,
+   0b1111111111001111101011111010010000000001,
+   0b1111111111001111101011111010010000000001,
+   0b1111111111001111101011111010010000000001,
+   0b1111111111001111101011111010010000000001,
+   0b1111111111001111101011111010010000000001,
+   0b1111111111001111101011111010010000000001,
+   0b1111111111001111101011111010010000000001,
+   0b1111111111001111101011111010010000000001,
+   0b1111111111001111101011111010010000000001,
+   0b1111111111001111101011111010010000000001,
+   0b1111111111001111101011111010010000000001,
+   0b1111111111001111101011111010010000000001,
+   0b1111111111001111101011111010010000000001,
+   0b1111111111001111101011111010010000000001,
+   0b1111111111001111101011111010010000000001,
+   0b1111111111001111101011111010010000000001,
+   0b1111111111001111101011111010010000000001,
+   0b1111111111001111101011111010010000000001,
+   0b1111111111001111101011111010010000000001
+};
+
+static const u32 filter_lookup_low[64] = {
+	 0b0001011111,
+	 0b0001010111,
+	 0b0001111011,
+	 0b0001011011,
+	 0b0001101011,
+	 0b0001110011,
+	 0b0001110011,
+	 0b0001110011,
+	 0b0001110011,
+	 0b0001001011,
+	 0b0001001011,
+	 0b0001001011,
+	 0b0010110011,
+	 0b0001010011,
+	 0b0001010011,
+	 0b0001010011,
+	 0b0001010011,
+	 0b0001010011,
+	 0b0001010011,
+	 0b0001010011,
+	 0b0001010011,
+	 0b0001010011,
+	 0b0001010011,
+	 0b0001100011,
+	 0b0001100011,
+	 0b0001100011,
+	 0b0001100011,
+	 0b0001100011,
+	 0b0001100011,
+	 0b0001100011,
+	 0b0001100011,
+	 0b0001100011,
+	 0b0001100011,
+	 0b0001100011,
+	 0b0001100011,
+	 0b0001100011,
+	 0b0001100011,
+	 0b0010010011,
+	 0b0010010011,
+	 0b0010010011,
+	 0b0010010011,
+	 0b0010010011,
+	 0b0010010011,
+	 0b0010010011,
+	 0b0010010011,
+	 0b0010010011,
+	 0b0010010011,
+	 0b0010100011,
+	 0b0010100011,
+	 0b0010100011,
+	 0b0010100011,
+	 0b0010100011,
+	 0b0010100011,
+	 0b0010100011,
+	 0b0010100011,
+	 0b0010100011,
+	 0b0010100011,
+	 0b0010100011,
+	 0b0010100011,
+	 0b0010100011,
+	 0b0010100011,
+	 0b0010100011,
+	 0b0010100011,
+	 0b0010100011
+};
+
+struct dglnt_dynclk_reg{
+		u32 clk0L;
+		u32 clkFBL;
+		u32 clkFBH_clk0H;
+		u32 divclk;
+		u32 lockL;
+		u32 fltr_lockH;
+};
+
+struct dglnt_dynclk_mode{
+		u32 freq;
+		u32 fbmult;
+		u32 clkdiv;
+		u32 maindiv;
+		u32 vco;	/* kHz */
+		u32 pfd;	/* kHz, input to the phase detector */
+		u32 fbfrac;	/* eighths added to fbmult, fractional solver only */
+};
+
+/*
+ * What the solver optimizes once the frequency error is as small as it
+ * gets: the first solution found (the original behaviour), the highest
+ * VCO for the least output jitter, or the lowest VCO for the least power.
+ */
+enum dglnt_dynclk_objective {
+	DGLNT_DYNCLK_MIN_ERROR,
+	DGLNT_DYNCLK_MIN_JITTER,
+	DGLNT_DYNCLK_MIN_POWER,
+};
+
+
+static inline u32 dglnt_dynclk_divider(u32 divide)
+{
+	u32 output = 0;
+	u32 highTime = 0;
+	u32 lowTime = 0;
+
+	if ((divide < 1) || (divide > 128))
+		return ERR_CLKDIVIDER;
+
+	if (divide == 1)
+		return DYNCLK_DIV_1_REGMASK;
+
+	highTime = divide / 2;
+	if (divide & 0b1) //if divide is odd
+	{
+		lowTime = highTime + 1;
+		output = 1 << CLK_BIT_WEDGE;
+	}
+	else
+	{
+		lowTime = highTime;
+	}
+
+	output |= 0x03F & lowTime;
+	output |= 0xFC0 & (highTime << 6);
+	return output;
+}
+
+static inline u32 dglnt_dynclk_count_calc(u32 divide)
+{
+	u32 output = 0;
+	u32 divCalc = 0;
+
+	divCalc = dglnt_dynclk_divider(divide);
+	if (divCalc == ERR_CLKDIVIDER)
+		output = ERR_CLKCOUNTCALC;
+	else
+		output = (0xFFF & divCalc) | ((divCalc << 10) & 0x00C00000);
+	return output;
+}
+
+
+static inline int dglnt_dynclk_find_reg (struct dglnt_dynclk_reg *regValues, struct dglnt_dynclk_mode *clkParams)
+{
+	if ((clkParams->fbmult < 2) || clkParams->fbmult > 64 )
+		return -EINVAL;
+
+	regValues->clk0L = dglnt_dynclk_count_calc(clkParams->clkdiv);
+	if (regValues->clk0L == ERR_CLKCOUNTCALC)
+		return -EINVAL;
+
+	regValues->clkFBL = dglnt_dynclk_count_calc(clkParams->fbmult);
+	if (regValues->clkFBL == ERR_CLKCOUNTCALC)
+		return -EINVAL;
+
+	regValues->clkFBH_clk0H = 0;
+
+	regValues->divclk = dglnt_dynclk_divider(clkParams->maindiv);
+	if (regValues->divclk == ERR_CLKDIVIDER)
+		return -EINVAL;
+
+	regValues->lockL = (u32) (lock_lookup[clkParams->fbmult - 1] & 0xFFFFFFFF);
+
+	regValues->fltr_lockH = (u32) ((lock_lookup[clkParams->fbmult - 1] >> 32) & 0x000000FF);
+	regValues->fltr_lockH |= ((filter_lookup_low[clkParams->fbmult - 1] << 16) & 0x03FF0000);
+
+	return 0;
+}
+
+static inline void dglnt_dynclk_write_reg (struct dglnt_dynclk_reg *regValues, void __iomem *baseaddr)
+{
+   writel(regValues->clk0L, baseaddr + OFST_DISPLAY_CLK_L);
+   writel(regValues->clkFBL, baseaddr + OFST_DISPLAY_FB_L);
+   writel(regValues->clkFBH_clk0H, baseaddr + OFST_DISPLAY_FB_H_CLK_H);
+   writel(regValues->divclk, baseaddr + OFST_DISPLAY_DIV);
+   writel(regValues->lockL, baseaddr + OFST_DISPLAY_LOCK_L);
+   writel(regValues->fltr_lockH, baseaddr + OFST_DISPLAY_FLTR_LOCK_H);
+}
+
+
+/*
+ * Scores a candidate against the best one so far for an objective.
+ * A higher VCO gives less period jitter on the outputs, which matters for
+ * the 5x TMDS clock; a lower VCO takes less power. A higher PFD divides
+ * less reference noise into the loop, so it breaks ties either way.
+ */
+static inline bool dglnt_dynclk_better(const struct dglnt_dynclk_mode *a, const struct dglnt_dynclk_mode *b, enum dglnt_dynclk_objective objective)
+{
+	if (a->vco != b->vco)
+		return objective == DGLNT_DYNCLK_MIN_JITTER ? a->vco > b->vco : a->vco < b->vco;
+	return a->pfd > b->pfd;
+}
+
+/*
+ * Walks the divider, feedback and output divider space, the feedback in
+ * steps of 1/fbSteps. For
+ * DGLNT_DYNCLK_MIN_ERROR it keeps the first candidate with the smallest
+ * error and stops at an exact one; otherwise it keeps the candidate the
+ * objective ranks best among those within maxError of freq.
+ */
+static inline u32 dglnt_dynclk_search(u32 freq, u32 parentFreq, u32 fbSteps, enum dglnt_dynclk_objective objective, u32 maxError, struct dglnt_dynclk_mode *bestPick)
+{
+	struct dglnt_dynclk_mode cur;
+	u32 fb;
+	u32 bestError = MMCM_FREQ_OUTMAX;
+	u32 curError;
+	u32 curClkMult;
+	u32 divVal;
+	u32 minFb = 0;
+	u32 maxFb = 0;
+	u32 curDiv = 1;
+	u32 maxDiv;
+	bool freq_found = false;
+
+	bestPick->freq = 0;
+
+	if (parentFreq > MMCM_FREQ_PFDMAX)
+		curDiv = 2;
+	maxDiv = parentFreq / MMCM_FREQ_PFDMIN;
+	if (maxDiv > MMCM_DIV_MAX)
+		maxDiv = MMCM_DIV_MAX;
+
+	while (curDiv <= maxDiv && !freq_found)
+	{
+		minFb = curDiv * DIV_ROUND_UP(MMCM_FREQ_VCOMIN, parentFreq);
+		maxFb = curDiv * (MMCM_FREQ_VCOMAX / parentFreq);
+		if (maxFb > MMCM_FB_MAX)
+			maxFb = MMCM_FB_MAX;
+		if (minFb < MMCM_FB_MIN)
+			minFb = MMCM_FB_MIN;
+
+		divVal = curDiv * freq;
+		curClkMult = ((parentFreq * 1000) + (divVal / 2)) / divVal; //This multiplier is used to find the best clkDiv value for each FB value
+
+		for (fb = minFb * fbSteps; fb <= maxFb * fbSteps && !freq_found; fb++)
+		{
+			cur.fbmult = fb / fbSteps;
+			cur.fbfrac = fb % fbSteps;
+			cur.clkdiv = ((curClkMult * fb) + 500 * fbSteps) / (1000 * fbSteps);
+			if (cur.clkdiv > MMCM_CLKDIV_MAX)
+				cur.clkdiv = MMCM_CLKDIV_MAX;
+			if (cur.clkdiv < MMCM_CLKDIV_MIN)
+				cur.clkdiv = MMCM_CLKDIV_MIN;
+			cur.maindiv = curDiv;
+			cur.vco = (parentFreq * fb) / (curDiv * fbSteps);
+			cur.pfd = parentFreq / curDiv;
+			cur.freq = cur.vco / cur.clkdiv;
+			curError = cur.freq >= freq ? cur.freq - freq : freq - cur.freq;
+
+			if (objective == DGLNT_DYNCLK_MIN_ERROR)
+			{
+				if (curError < bestError)
+				{
+					bestError = curError;
+					*bestPick = cur;
+				}
+				if (!curError)
+					freq_found = true;
+			}
+			else if (curError <= maxError &&
+				 (!bestPick->freq || dglnt_dynclk_better(&cur, bestPick, objective)))
+			{
+				*bestPick = cur;
+			}
+		}
+		curDiv++;
+	}
+	return bestPick->freq;
+}
+
+/*
+ * Finds the MMCM settings for freq from parentFreq, both in kHz. The
+ * smallest reachable error comes first; the objective then picks among
+ * the candidates within maxPpm of freq beyond that error. Returns the
+ * output frequency, or 0 if there is none.
+ */
+static inline u32 dglnt_dynclk_solve(u32 freq, u32 parentFreq, u32 fbSteps, enum dglnt_dynclk_objective objective, u32 maxPpm, struct dglnt_dynclk_mode *bestPick)
+{
+	struct dglnt_dynclk_mode cand;
+	u32 maxError;
+
+	bestPick->freq = 0;
+	if (parentFreq == 0)
+		return 0;
+
+	if (freq < MMCM_FREQ_OUTMIN)//minimum frequency is actually dictated by VCOmin
+		freq = MMCM_FREQ_OUTMIN;
+	if (freq > MMCM_FREQ_OUTMAX)
+		freq = MMCM_FREQ_OUTMAX;
+
+	if (!dglnt_dynclk_search(freq, parentFreq, fbSteps, DGLNT_DYNCLK_MIN_ERROR, 0, bestPick) ||
+	    objective == DGLNT_DYNCLK_MIN_ERROR)
+		return bestPick->freq;
+
+	maxError = bestPick->freq >= freq ? bestPick->freq - freq : freq - bestPick->freq;
+	maxError += div_u64((u64)freq * maxPpm, 1000000);
+	if (dglnt_dynclk_search(freq, parentFreq, fbSteps, objective, maxError, &cand))
+		*bestPick = cand;
+	return bestPick->freq;
+}
+
+/* integer feedback, all the axi_dynclk registers can hold */
+static inline u32 dglnt_dynclk_find_mode_obj(u32 freq, u32 parentFreq, enum dglnt_dynclk_objective objective, u32 maxPpm, struct dglnt_dynclk_mode *bestPick)
+{
+	return dglnt_dynclk_solve(freq, parentFreq, 1, objective, maxPpm, bestPick);
+}
+
+/* fractional feedback, for MMCMs programmed through the Clocking Wizard */
+static inline u32 dglnt_dynclk_find_mode_frac(u32 freq, u32 parentFreq, enum dglnt_dynclk_objective objective, u32 maxPpm, struct dglnt_dynclk_mode *bestPick)
+{
+	return dglnt_dynclk_solve(freq, parentFreq, MMCM_FB_FRAC_STEPS, objective, maxPpm, bestPick);
+}
+
+static inline u32 dglnt_dynclk_find_mode(u32 freq, u32 parentFreq, struct dglnt_dynclk_mode *bestPick)
+{
+	return dglnt_dynclk_find_mode_obj(freq, parentFreq, DGLNT_DYNCLK_MIN_ERROR, 0, bestPick);
+}
+
+/*
+ * Waits for the MMCM to lock after it has been reprogrammed, by polling
+ * mask in the status register. Returns -ETIMEDOUT if it does not lock.
+ */
+static inline int dglnt_dynclk_wait_lock(void __iomem *status, u32 mask)
+{
+	u32 timeout = MMCM_LOCK_TIMEOUT_US;
+
+	while (!(readl(status) & mask))
+	{
+		if (!timeout--)
+			return -ETIMEDOUT;
+		udelay(1);
+	}
+	return 0;
+}
+
+static inline void dglnt_dynclk_read_reg(struct dglnt_dynclk_reg *regValues, void __iomem *baseaddr)
+{
+	regValues->clk0L = readl(baseaddr + OFST_DISPLAY_CLK_L);
+	regValues->clkFBL = readl(baseaddr + OFST_DISPLAY_FB_L);
+	regValues->clkFBH_clk0H = readl(baseaddr + OFST_DISPLAY_FB_H_CLK_H);
+	regValues->divclk = readl(baseaddr + OFST_DISPLAY_DIV);
+	regValues->lockL = readl(baseaddr + OFST_DISPLAY_LOCK_L);
+	regValues->fltr_lockH = readl(baseaddr + OFST_DISPLAY_FLTR_LOCK_H);
+}
+
+/* Inverse of dglnt_dynclk_divider() */
+static inline u32 dglnt_dynclk_undivide(u32 reg)
+{
+	if (reg & (1 << CLK_BIT_NOCOUNT))
+		return 1;
+
+	return (reg & 0x03F) + ((reg & 0xFC0) >> 6);
+}
+
+/*
+ * Recover the mode from register values written by dglnt_dynclk_find_reg().
+ * Returns the output frequency, or 0 if the registers do not hold a mode
+ * this solver could have produced (reset values, another writer).
+ */
+static inline u32 dglnt_dynclk_decode_mode(const struct dglnt_dynclk_reg *regValues, u32 parentFreq, struct dglnt_dynclk_mode *mode)
+{
+	struct dglnt_dynclk_reg check;
+
+	mode->freq = 0;
+	mode->clkdiv = dglnt_dynclk_undivide((regValues->clk0L & 0xFFF) | ((regValues->clk0L & 0x00C00000) >> 10));
+	mode->fbmult = dglnt_dynclk_undivide((regValues->clkFBL & 0xFFF) | ((regValues->clkFBL & 0x00C00000) >> 10));
+	mode->maindiv = dglnt_dynclk_undivide(regValues->divclk);
+
+	if (!parentFreq || !mode->clkdiv || !mode->maindiv || mode->maindiv > MMCM_DIV_MAX)
+		return 0;
+	if (dglnt_dynclk_find_reg(&check, mode))
+		return 0;
+	if (check.clk0L != regValues->clk0L || check.clkFBL != regValues->clkFBL ||
+	    check.divclk != regValues->divclk || check.lockL != regValues->lockL ||
+	    check.fltr_lockH != (regValues->fltr_lockH & 0x03FF00FF))
+		return 0;
+
+	mode->vco = (parentFreq * mode->fbmult) / mode->maindiv;
+	mode->pfd = parentFreq / mode->maindiv;
+	mode->fbfrac = 0;
+	mode->freq = mode->vco / mode->clkdiv;
+	return mode->freq;
+}
+
+#endif /* __DGLNT_DYNCLK_H__ */
@@ -0,0 +1,371 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Clocking Wizard pixel clock driver on the dynclk MMCM solver
+ *
+ * The HDMI pipeline takes a pixel clock and a serial clock five times as
+ * fast from one Clocking Wizard MMCM. The in-kernel clocking wizard driver
+ * only changes the output dividers of a wizard with more than one output,
+ * so the VCO stays at its synthesized rate and most pixel clocks are out
+ * of reach. This driver reprograms the input divider, the fractional
+ * feedback multiplier and both output dividers through the wizard's
+ * dynamic reconfiguration registers, with the settings from the
+ * clk-dglnt-dynclk solver and the same lock wait. clk_out2 carries the
+ * MMCM settings and clk_out1 is registered as its fixed-factor child, so
+ * a clk_set_rate() on either output moves both, keeps the ratio between
+ * them and notifies the consumers of both.
+ */
+
+#include <linux/platform_device.h>
+#include <linux/clk-provider.h>
+#include <linux/clk.h>
+#include <linux/bitfield.h>
+#include <linux/io.h>
+#include <linux/iopoll.h>
+#include <linux/of.h>
+#include <linux/module.h>
+#include <linux/overflow.h>
+#include <linux/string.h>
+#include <linux/kernel.h>
+
+#include "dglnt-dynclk.h"
+
+#define WZRD_SR			0x004
+#define WZRD_SR_LOCKED		BIT(0)
+#define WZRD_CFG0		0x200
+#define WZRD_CFG0_DIVCLK	GENMASK(7, 0)
+#define WZRD_CFG0_MULT		GENMASK(15, 8)
+#define WZRD_CFG0_FRAC		GENMASK(25, 16)
+#define WZRD_CLKOUT_DIV(n)	(0x208 + 12 * (n))
+#define WZRD_CLKOUT_PHASE(n)	(0x20C + 12 * (n))
+#define WZRD_CLKOUT_DIV_INT	GENMASK(7, 0)
+#define WZRD_CLKOUT_DIV_FRAC	GENMASK(17, 8)
+#define WZRD_CLKOUT_DIV_FRAC_EN	BIT(18)
+#define WZRD_CFG23		0x25C
+#define WZRD_CFG23_LOAD		BIT(0)
+#define WZRD_CFG23_SADDR	BIT(1)
+
+/* the wizard drops LOCKED within a few AXI cycles of LOAD, allow far more */
+#define WZRD_RECONF_TIMEOUT_US	100
+
+/* the fractional fields are in thousandths, the MMCM steps by 1/8 */
+#define WZRD_FRAC_PER_STEP	(1000 / MMCM_FB_FRAC_STEPS)
+
+#define CLK_WIZ_MAX_OUTPUTS	2
+
+static const char * const clk_wiz_dynclk_objectives[] = {
+	[DGLNT_DYNCLK_MIN_ERROR] = "error",
+	[DGLNT_DYNCLK_MIN_JITTER] = "jitter",
+	[DGLNT_DYNCLK_MIN_POWER] = "power",
+};
+
+struct clk_wiz_dynclk;
+
+/**
+ * struct clk_wiz_dynclk_out - one output of the wizard
+ * @hw: clock registered for the output
+ * @wiz: the wizard
+ * @index: output number, 0 for clk_out1
+ */
+struct clk_wiz_dynclk_out {
+	struct clk_hw hw;
+	struct clk_wiz_dynclk *wiz;
+	unsigned int index;
+};
+
+#define to_clk_wiz_dynclk_out(h) container_of(h, struct clk_wiz_dynclk_out, hw)
+
+/**
+ * struct clk_wiz_dynclk - driver state
+ * @dev: platform device
+ * @base: dynamic reconfiguration registers
+ * @ratio: clk_out1 divider over the clk_out2 divider
+ * @objective: solver objective
+ * @objective_ppm: extra error the objective may trade, in ppm
+ * @out: the output that carries the MMCM settings, clk_out2 if there are two
+ * @data: clock provider data, hws[] follows
+ */
+struct clk_wiz_dynclk {
+	struct device *dev;
+	void __iomem *base;
+	u32 ratio;
+	enum dglnt_dynclk_objective objective;
+	u32 objective_ppm;
+	struct clk_wiz_dynclk_out out;
+	struct clk_hw_onecell_data data;
+};
+
+/*
+ * The solver works on the fastest output. With two outputs that is
+ * clk_out2, and clk_out1 divides by ratio times as much.
+ */
+static u32 clk_wiz_dynclk_scale(struct clk_wiz_dynclk *wiz, unsigned int index)
+{
+	return wiz->data.num > 1 && index == 0 ? wiz->ratio : 1;
+}
+
+static unsigned long clk_wiz_dynclk_calc(unsigned long parent_rate, u32 div,
+					 u32 mult1000, u32 odiv1000)
+{
+	if (!div || !odiv1000)
+		return 0;
+	return div_u64((u64)parent_rate * mult1000, div * odiv1000);
+}
+
+static int clk_wiz_dynclk_solve(struct clk_wiz_dynclk_out *out, unsigned long rate,
+				unsigned long parent_rate, struct dglnt_dynclk_mode *mode)
+{
+	struct clk_wiz_dynclk *wiz = out->wiz;
+
+	if (!rate || !parent_rate)
+		return -EINVAL;
+	if (!dglnt_dynclk_find_mode_frac(DIV_ROUND_CLOSEST(rate, 1000),
+					 DIV_ROUND_CLOSEST(parent_rate, 1000),
+					 wiz->objective, wiz->objective_ppm, mode))
+		return -EINVAL;
+	if (mode->clkdiv * clk_wiz_dynclk_scale(wiz, 0) > MMCM_CLKDIV_MAX)
+		return -ERANGE;
+	return 0;
+}
+
+static unsigned long clk_wiz_dynclk_mode_rate(const struct dglnt_dynclk_mode *mode,
+					      unsigned long parent_rate)
+{
+	return clk_wiz_dynclk_calc(parent_rate, mode->maindiv,
+				   mode->fbmult * 1000 + mode->fbfrac * WZRD_FRAC_PER_STEP,
+				   mode->clkdiv * 1000);
+}
+
+static int clk_wiz_dynclk_program(struct clk_wiz_dynclk *wiz,
+				  const struct dglnt_dynclk_mode *mode)
+{
+	unsigned int i;
+	u32 reg;
+	int ret;
+
+	reg = readl(wiz->base + WZRD_CFG0);
+	reg &= ~(WZRD_CFG0_DIVCLK | WZRD_CFG0_MULT | WZRD_CFG0_FRAC);
+	reg |= FIELD_PREP(WZRD_CFG0_DIVCLK, mode->maindiv) |
+	       FIELD_PREP(WZRD_CFG0_MULT, mode->fbmult) |
+	       FIELD_PREP(WZRD_CFG0_FRAC, mode->fbfrac * WZRD_FRAC_PER_STEP);
+	writel(reg, wiz->base + WZRD_CFG0);
+
+	for (i = 0; i < wiz->data.num; i++) {
+		reg = readl(wiz->base + WZRD_CLKOUT_DIV(i));
+		reg &= ~(WZRD_CLKOUT_DIV_INT | WZRD_CLKOUT_DIV_FRAC |
+			 WZRD_CLKOUT_DIV_FRAC_EN);
+		reg |= FIELD_PREP(WZRD_CLKOUT_DIV_INT,
+				  mode->clkdiv * clk_wiz_dynclk_scale(wiz, i));
+		writel(reg, wiz->base + WZRD_CLKOUT_DIV(i));
+		writel(0, wiz->base + WZRD_CLKOUT_PHASE(i));
+	}
+
+	/*
+	 * LOCKED still shows the old lock right after LOAD; wait for the
+	 * reconfiguration to take it down before waiting for the new lock.
+	 */
+	writel(WZRD_CFG23_LOAD | WZRD_CFG23_SADDR, wiz->base + WZRD_CFG23);
+	ret = readl_poll_timeout_atomic(wiz->base + WZRD_SR, reg,
+					!(reg & WZRD_SR_LOCKED), 1,
+					WZRD_RECONF_TIMEOUT_US);
+	if (ret) {
+		dev_err(wiz->dev, "reconfiguration did not start\n");
+		return ret;
+	}
+
+	ret = dglnt_dynclk_wait_lock(wiz->base + WZRD_SR, WZRD_SR_LOCKED);
+	if (ret)
+		dev_err(wiz->dev, "MMCM did not lock, D %u M %u.%03u O %u\n",
+			mode->maindiv, mode->fbmult,
+			mode->fbfrac * WZRD_FRAC_PER_STEP, mode->clkdiv);
+	return ret;
+}
+
+static unsigned long clk_wiz_dynclk_recalc_rate(struct clk_hw *hw,
+						unsigned long parent_rate)
+{
+	struct clk_wiz_dynclk_out *out = to_clk_wiz_dynclk_out(hw);
+	struct clk_wiz_dynclk *wiz = out->wiz;
+	u32 cfg0 = readl(wiz->base + WZRD_CFG0);
+	u32 div = readl(wiz->base + WZRD_CLKOUT_DIV(out->index));
+	u32 odiv1000 = FIELD_GET(WZRD_CLKOUT_DIV_INT, div) * 1000;
+
+	/* only CLKOUT0 has a fractional divider */
+	if (out->index == 0)
+		odiv1000 += FIELD_GET(WZRD_CLKOUT_DIV_FRAC, div);
+
+	return clk_wiz_dynclk_calc(parent_rate, FIELD_GET(WZRD_CFG0_DIVCLK, cfg0),
+				   FIELD_GET(WZRD_CFG0_MULT, cfg0) * 1000 +
+				   FIELD_GET(WZRD_CFG0_FRAC, cfg0),
+				   odiv1000);
+}
+
+static long clk_wiz_dynclk_round_rate(struct clk_hw *hw, unsigned long rate,
+				      unsigned long *parent_rate)
+{
+	struct clk_wiz_dynclk_out *out = to_clk_wiz_dynclk_out(hw);
+	struct dglnt_dynclk_mode mode;
+	int ret;
+
+	ret = clk_wiz_dynclk_solve(out, rate, *parent_rate, &mode);
+	if (ret)
+		return ret;
+	return clk_wiz_dynclk_mode_rate(&mode, *parent_rate);
+}
+
+static int clk_wiz_dynclk_set_rate(struct clk_hw *hw, unsigned long rate,
+				   unsigned long parent_rate)
+{
+	struct clk_wiz_dynclk_out *out = to_clk_wiz_dynclk_out(hw);
+	struct dglnt_dynclk_mode mode;
+	int ret;
+
+	ret = clk_wiz_dynclk_solve(out, rate, parent_rate, &mode);
+	if (ret)
+		return ret;
+	return clk_wiz_dynclk_program(out->wiz, &mode);
+}
+
+static const struct clk_ops clk_wiz_dynclk_ops = {
+	.recalc_rate = clk_wiz_dynclk_recalc_rate,
+	.round_rate = clk_wiz_dynclk_round_rate,
+	.set_rate = clk_wiz_dynclk_set_rate,
+};
+
+static int clk_wiz_dynclk_parse_dt(struct clk_wiz_dynclk *wiz)
+{
+	struct device_node *np = wiz->dev->of_node;
+	const char *name;
+	int ret;
+
+	wiz->ratio = 5;
+	of_property_read_u32(np, "dglnt,serial-ratio", &wiz->ratio);
+	if (!wiz->ratio || wiz->ratio > MMCM_CLKDIV_MAX)
+		return dev_err_probe(wiz->dev, -EINVAL, "bad dglnt,serial-ratio %u\n",
+				     wiz->ratio);
+
+	if (!of_property_read_string(np, "dglnt,objective", &name)) {
+		ret = match_string(clk_wiz_dynclk_objectives,
+				   ARRAY_SIZE(clk_wiz_dynclk_objectives), name);
+		if (ret < 0)
+			return dev_err_probe(wiz->dev, ret, "unknown objective \"%s\"\n",
+					     name);
+		wiz->objective = ret;
+	}
+	of_property_read_u32(np, "dglnt,objective-ppm", &wiz->objective_ppm);
+
+	return 0;
+}
+
+static int clk_wiz_dynclk_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct device_node *np = dev->of_node;
+	const char *names[CLK_WIZ_MAX_OUTPUTS];
+	struct clk_wiz_dynclk_out *out;
+	struct clk_wiz_dynclk *wiz;
+	struct clk_init_data init;
+	const char *parent_name;
+	struct clk *axi_clk;
+	struct clk_hw *hw;
+	u32 nr_outputs = 1;
+	u32 div0, div1;
+	int ret;
+
+	of_property_read_u32(np, "xlnx,nr-outputs", &nr_outputs);
+	if (!nr_outputs || nr_outputs > CLK_WIZ_MAX_OUTPUTS)
+		return dev_err_probe(dev, -EINVAL, "%u outputs, 1 or 2 supported\n",
+				     nr_outputs);
+
+	wiz = devm_kzalloc(dev, struct_size(wiz, data.hws, nr_outputs), GFP_KERNEL);
+	if (!wiz)
+		return -ENOMEM;
+	wiz->dev = dev;
+	wiz->data.num = nr_outputs;
+
+	wiz->base = devm_platform_ioremap_resource(pdev, 0);
+	if (IS_ERR(wiz->base))
+		return PTR_ERR(wiz->base);
+
+	axi_clk = devm_clk_get_enabled(dev, "s_axi_aclk");
+	if (IS_ERR(axi_clk))
+		return dev_err_probe(dev, PTR_ERR(axi_clk), "no s_axi_aclk\n");
+
+	parent_name = of_clk_get_parent_name(np,
+			of_property_match_string(np, "clock-names", "clk_in1"));
+	if (!parent_name)
+		return dev_err_probe(dev, -EINVAL, "no clk_in1\n");
+
+	ret = clk_wiz_dynclk_parse_dt(wiz);
+	if (ret)
+		return ret;
+
+	ret = of_property_read_string_array(np, "clock-output-names", names,
+					    nr_outputs);
+	if (ret != nr_outputs)
+		return dev_err_probe(dev, -EINVAL, "need %u clock-output-names\n",
+				     nr_outputs);
+
+	/* the solver works on the fastest output */
+	out = &wiz->out;
+	out->wiz = wiz;
+	out->index = nr_outputs - 1;
+	init.name = names[out->index];
+	init.ops = &clk_wiz_dynclk_ops;
+	init.flags = 0;
+	init.parent_names = &parent_name;
+	init.num_parents = 1;
+	out->hw.init = &init;
+	ret = devm_clk_hw_register(dev, &out->hw);
+	if (ret)
+		return ret;
+	wiz->data.hws[out->index] = &out->hw;
+
+	/*
+	 * clk_out1 follows clk_out2 at the fixed ratio, and a rate set on it
+	 * goes to clk_out2 times the ratio.
+	 */
+	if (nr_outputs > 1) {
+		div0 = FIELD_GET(WZRD_CLKOUT_DIV_INT,
+				 readl(wiz->base + WZRD_CLKOUT_DIV(0)));
+		div1 = FIELD_GET(WZRD_CLKOUT_DIV_INT,
+				 readl(wiz->base + WZRD_CLKOUT_DIV(1)));
+		if (div0 != div1 * wiz->ratio)
+			dev_warn(dev, "clk_out1 divider %u is not %u times %u until the first rate change\n",
+				 div0, wiz->ratio, div1);
+
+		hw = devm_clk_hw_register_fixed_factor(dev, names[0], names[1],
+						       CLK_SET_RATE_PARENT, 1,
+						       wiz->ratio);
+		if (IS_ERR(hw))
+			return PTR_ERR(hw);
+		wiz->data.hws[0] = hw;
+	}
+
+	ret = devm_of_clk_add_hw_provider(dev, of_clk_hw_onecell_get, &wiz->data);
+	if (ret)
+		return ret;
+
+	dev_info(dev, "%s %lu Hz, objective %s\n", names[0],
+		 clk_hw_get_rate(wiz->data.hws[0]),
+		 clk_wiz_dynclk_objectives[wiz->objective]);
+
+	return 0;
+}
+
+static const struct of_device_id clk_wiz_dynclk_ids[] = {
+	{ .compatible = "dglnt,clk-wiz-dynclk", },
+	{ },
+};
+MODULE_DEVICE_TABLE(of, clk_wiz_dynclk_ids);
+
+static struct platform_driver clk_wiz_dynclk_driver = {
+	.driver = {
+		.name = "clk-wiz-dynclk",
+		.of_match_table = clk_wiz_dynclk_ids,
+	},
+	.probe = clk_wiz_dynclk_probe,
+};
+module_platform_driver(clk_wiz_dynclk_driver);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("Clocking Wizard pixel clock driver on the dynclk MMCM solver");
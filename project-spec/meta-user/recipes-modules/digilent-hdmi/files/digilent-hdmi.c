@@ -413,6 +413,7 @@ static struct platform_driver hdmi_driver = {
     .driver = {
         .name = "digilent-hdmi",
         .of_match_table = digilent_hdmi_of_match,
+        .probe_type = PROBE_PREFER_ASYNCHRONOUS,
     },
 };
 
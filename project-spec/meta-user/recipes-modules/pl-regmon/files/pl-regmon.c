@@ -0,0 +1,680 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * PL display register monitor
+ *
+ * Field debugging of the display IPs used peekpoke, which maps /dev/mem
+ * in a new process for every register access: far too slow to catch a
+ * frame buffer stall or a VTC glitch. This driver maps the register
+ * windows of the clock generator, the frame buffer read DMA and the VTC
+ * once, and exposes them on /dev/pl-regmon for mmap(). It also samples a
+ * configurable set of those registers into a ring buffer, read from the
+ * same device with a timestamp per sample, either from a hard interrupt
+ * timer at up to PL_REGMON_MAX_RATE Hz or on the frame interrupt of a VTC
+ * window for one sample per frame.
+ *
+ * The windows belong to their own drivers. No region is claimed here, and
+ * no interrupt is taken: the VTC driver owns the frame interrupt and calls
+ * the frame notifier this subscribes to while sampling on it.
+ */
+
+#include <linux/platform_device.h>
+#include <linux/device.h>
+#include <linux/hrtimer.h>
+#include <linux/io.h>
+#include <linux/kref.h>
+#include <linux/log2.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/notifier.h>
+#include <linux/of.h>
+#include <linux/of_address.h>
+#include <linux/of_irq.h>
+#include <linux/poll.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/xlnx-vtc.h>
+#include <linux/kernel.h>
+
+#include "pl-regmon.h"
+
+#define PL_REGMON_MAX_WINDOWS	4
+
+#define PL_REGMON_TRIGGER_OFF	-1
+#define PL_REGMON_TRIGGER_TIMER	-2
+
+static unsigned int ring_samples = 4096;
+module_param(ring_samples, uint, 0444);
+MODULE_PARM_DESC(ring_samples, "Samples buffered for the reader, a power of two");
+
+/**
+ * struct pl_regmon_window - one register window
+ * @name: name used in "regs" and "trigger"
+ * @res: physical range
+ * @base: kernel mapping
+ * @pgoff: mmap offset on /dev/pl-regmon, in pages
+ * @irq: interrupt of the IP, or <= 0 if it has none
+ * @np: node of the IP, to find its VTC frame notifier
+ */
+struct pl_regmon_window {
+	const char *name;
+	struct resource res;
+	void __iomem *base;
+	unsigned long pgoff;
+	int irq;
+	struct device_node *np;
+};
+
+struct pl_regmon_reg {
+	unsigned int window;
+	u32 offset;
+};
+
+/*
+ * Open files keep the state after the device is removed, with @gone set,
+ * so it is freed with a reference count rather than devm.
+ */
+struct pl_regmon {
+	struct kref ref;
+	struct device *dev;
+	struct miscdevice misc;
+	struct pl_regmon_window win[PL_REGMON_MAX_WINDOWS];
+	unsigned int nwin;
+
+	struct mutex cfg_lock;	/* configuration, start and stop */
+	struct pl_regmon_reg regs[PL_REGMON_MAX_REGS];
+	void __iomem *addr[PL_REGMON_MAX_REGS];
+	unsigned int nregs;
+	int trigger;		/* window index or PL_REGMON_TRIGGER_* */
+	u32 rate;
+	struct hrtimer timer;
+	struct notifier_block frame_nb;
+
+	spinlock_t lock;	/* ring */
+	u8 *ring;
+	size_t sample_size;
+	unsigned int head, tail;	/* free running sample counts */
+	u32 seq;
+	u64 overruns;
+	wait_queue_head_t wait;
+	bool gone;		/* removed, only open files are left */
+};
+
+static void pl_regmon_free(struct kref *ref)
+{
+	struct pl_regmon *rm = container_of(ref, struct pl_regmon, ref);
+	unsigned int i;
+
+	/* a window that failed to parse may hold its node too */
+	for (i = 0; i < PL_REGMON_MAX_WINDOWS; i++)
+		of_node_put(rm->win[i].np);
+	vfree(rm->ring);
+	mutex_destroy(&rm->cfg_lock);
+	kfree(rm);
+}
+
+static void pl_regmon_sample(struct pl_regmon *rm)
+{
+	struct pl_regmon_sample *s;
+	u64 now = ktime_get_ns();
+	unsigned long flags;
+	unsigned int i;
+
+	spin_lock_irqsave(&rm->lock, flags);
+	if (rm->head - rm->tail == ring_samples) {
+		rm->tail++;
+		rm->overruns++;
+	}
+	s = (void *)(rm->ring +
+		     (rm->head & (ring_samples - 1)) * rm->sample_size);
+	s->time_ns = now;
+	s->seq = rm->seq++;
+	s->nregs = rm->nregs;
+	for (i = 0; i < rm->nregs; i++)
+		s->val[i] = readl(rm->addr[i]);
+	rm->head++;
+	spin_unlock_irqrestore(&rm->lock, flags);
+
+	wake_up_interruptible(&rm->wait);
+}
+
+static enum hrtimer_restart pl_regmon_timer(struct hrtimer *timer)
+{
+	struct pl_regmon *rm = container_of(timer, struct pl_regmon, timer);
+
+	pl_regmon_sample(rm);
+	hrtimer_forward_now(timer, ns_to_ktime(NSEC_PER_SEC / rm->rate));
+
+	return HRTIMER_RESTART;
+}
+
+/* Called from the VTC interrupt handler, which acknowledges the frame */
+static int pl_regmon_frame(struct notifier_block *nb, unsigned long action,
+			   void *data)
+{
+	pl_regmon_sample(container_of(nb, struct pl_regmon, frame_nb));
+
+	return NOTIFY_OK;
+}
+
+static void pl_regmon_stop(struct pl_regmon *rm)
+{
+	if (rm->trigger == PL_REGMON_TRIGGER_TIMER)
+		hrtimer_cancel(&rm->timer);
+	else if (rm->trigger >= 0)
+		xlnx_vtc_unregister_frame_notifier(rm->win[rm->trigger].np,
+						   &rm->frame_nb);
+	rm->trigger = PL_REGMON_TRIGGER_OFF;
+}
+
+static int pl_regmon_start(struct pl_regmon *rm, int trigger)
+{
+	int ret;
+
+	spin_lock_irq(&rm->lock);
+	rm->sample_size = PL_REGMON_SAMPLE_SIZE(rm->nregs);
+	rm->head = 0;
+	rm->tail = 0;
+	rm->seq = 0;
+	rm->overruns = 0;
+	spin_unlock_irq(&rm->lock);
+
+	if (trigger == PL_REGMON_TRIGGER_TIMER) {
+		hrtimer_start(&rm->timer, ns_to_ktime(NSEC_PER_SEC / rm->rate),
+			      HRTIMER_MODE_REL_HARD);
+	} else {
+		ret = xlnx_vtc_register_frame_notifier(rm->win[trigger].np,
+						       &rm->frame_nb);
+		if (ret == -ENODEV)
+			dev_err(rm->dev, "%s is not a VTC with a frame interrupt\n",
+				rm->win[trigger].name);
+		if (ret)
+			return ret == -ENODEV ? -ENXIO : ret;
+	}
+	rm->trigger = trigger;
+
+	return 0;
+}
+
+static int pl_regmon_find_window(struct pl_regmon *rm, const char *name,
+				 size_t len)
+{
+	unsigned int i;
+
+	for (i = 0; i < rm->nwin; i++)
+		if (strlen(rm->win[i].name) == len &&
+		    !strncmp(rm->win[i].name, name, len))
+			return i;
+
+	return -ENOENT;
+}
+
+/* sysfs */
+
+static ssize_t windows_show(struct device *dev, struct device_attribute *attr,
+			    char *buf)
+{
+	struct pl_regmon *rm = dev_get_drvdata(dev);
+	const struct pl_regmon_window *w;
+	unsigned int i;
+	int len = 0;
+
+	for (i = 0; i < rm->nwin; i++) {
+		w = &rm->win[i];
+		len += sysfs_emit_at(buf, len, "%s %pa 0x%llx 0x%lx %d\n",
+				     w->name, &w->res.start,
+				     (u64)resource_size(&w->res),
+				     w->pgoff << PAGE_SHIFT,
+				     w->irq > 0 ? w->irq : -1);
+	}
+
+	return len;
+}
+static DEVICE_ATTR_RO(windows);
+
+static ssize_t regs_show(struct device *dev, struct device_attribute *attr,
+			 char *buf)
+{
+	struct pl_regmon *rm = dev_get_drvdata(dev);
+	unsigned int i;
+	int len = 0;
+
+	mutex_lock(&rm->cfg_lock);
+	for (i = 0; i < rm->nregs; i++)
+		len += sysfs_emit_at(buf, len, "%s%s+0x%03x", i ? " " : "",
+				     rm->win[rm->regs[i].window].name,
+				     rm->regs[i].offset);
+	mutex_unlock(&rm->cfg_lock);
+	len += sysfs_emit_at(buf, len, "\n");
+
+	return len;
+}
+
+/* "vtc+0x004 frmbuf+0x10 ...", set while sampling is off */
+static ssize_t regs_store(struct device *dev, struct device_attribute *attr,
+			  const char *buf, size_t count)
+{
+	struct pl_regmon *rm = dev_get_drvdata(dev);
+	struct pl_regmon_reg regs[PL_REGMON_MAX_REGS];
+	const char *p = buf, *plus;
+	unsigned int n = 0;
+	char num[16];
+	size_t len;
+	int win, ret;
+
+	for (;;) {
+		p = skip_spaces(p);
+		if (!*p)
+			break;
+		len = strcspn(p, " \t\n");
+		plus = strnchr(p, len, '+');
+		if (!plus || n == PL_REGMON_MAX_REGS)
+			return -EINVAL;
+		win = pl_regmon_find_window(rm, p, plus - p);
+		if (win < 0)
+			return win;
+		if (p + len - plus - 1 >= sizeof(num))
+			return -EINVAL;
+		strscpy(num, plus + 1, p + len - plus);
+		ret = kstrtou32(num, 0, &regs[n].offset);
+		if (ret)
+			return ret;
+		if (regs[n].offset & 3 ||
+		    regs[n].offset >= resource_size(&rm->win[win].res))
+			return -EINVAL;
+		regs[n++].window = win;
+		p += len;
+	}
+
+	mutex_lock(&rm->cfg_lock);
+	if (rm->trigger != PL_REGMON_TRIGGER_OFF) {
+		mutex_unlock(&rm->cfg_lock);
+		return -EBUSY;
+	}
+	memcpy(rm->regs, regs, n * sizeof(regs[0]));
+	for (rm->nregs = 0; rm->nregs < n; rm->nregs++)
+		rm->addr[rm->nregs] = rm->win[regs[rm->nregs].window].base +
+				      regs[rm->nregs].offset;
+	mutex_unlock(&rm->cfg_lock);
+
+	return count;
+}
+static DEVICE_ATTR_RW(regs);
+
+static ssize_t rate_show(struct device *dev, struct device_attribute *attr,
+			 char *buf)
+{
+	struct pl_regmon *rm = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%u\n", rm->rate);
+}
+
+static ssize_t rate_store(struct device *dev, struct device_attribute *attr,
+			  const char *buf, size_t count)
+{
+	struct pl_regmon *rm = dev_get_drvdata(dev);
+	u32 rate;
+	int ret;
+
+	ret = kstrtou32(buf, 0, &rate);
+	if (ret)
+		return ret;
+	if (!rate || rate > PL_REGMON_MAX_RATE)
+		return -EINVAL;
+
+	mutex_lock(&rm->cfg_lock);
+	if (rm->trigger == PL_REGMON_TRIGGER_TIMER)
+		ret = -EBUSY;
+	else
+		rm->rate = rate;
+	mutex_unlock(&rm->cfg_lock);
+
+	return ret ? ret : count;
+}
+static DEVICE_ATTR_RW(rate);
+
+static ssize_t trigger_show(struct device *dev, struct device_attribute *attr,
+			    char *buf)
+{
+	struct pl_regmon *rm = dev_get_drvdata(dev);
+	int trigger = READ_ONCE(rm->trigger);
+
+	if (trigger == PL_REGMON_TRIGGER_OFF)
+		return sysfs_emit(buf, "off\n");
+	if (trigger == PL_REGMON_TRIGGER_TIMER)
+		return sysfs_emit(buf, "timer\n");
+	return sysfs_emit(buf, "%s\n", rm->win[trigger].name);
+}
+
+/*
+ * "timer" or the name of a VTC window starts sampling with an empty ring,
+ * "off" stops it. Starting needs at least one register in "regs".
+ */
+static ssize_t trigger_store(struct device *dev, struct device_attribute *attr,
+			     const char *buf, size_t count)
+{
+	struct pl_regmon *rm = dev_get_drvdata(dev);
+	size_t len = strcspn(buf, "\n");
+	int trigger, ret = 0;
+
+	if (len == 3 && !strncmp(buf, "off", 3)) {
+		trigger = PL_REGMON_TRIGGER_OFF;
+	} else if (len == 5 && !strncmp(buf, "timer", 5)) {
+		trigger = PL_REGMON_TRIGGER_TIMER;
+	} else {
+		trigger = pl_regmon_find_window(rm, buf, len);
+		if (trigger < 0)
+			return trigger;
+	}
+
+	mutex_lock(&rm->cfg_lock);
+	if (trigger != PL_REGMON_TRIGGER_OFF && !rm->nregs) {
+		mutex_unlock(&rm->cfg_lock);
+		return -EINVAL;
+	}
+	pl_regmon_stop(rm);
+	if (trigger != PL_REGMON_TRIGGER_OFF)
+		ret = pl_regmon_start(rm, trigger);
+	mutex_unlock(&rm->cfg_lock);
+
+	return ret ? ret : count;
+}
+static DEVICE_ATTR_RW(trigger);
+
+static ssize_t samples_show(struct device *dev, struct device_attribute *attr,
+			    char *buf)
+{
+	struct pl_regmon *rm = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%u\n", READ_ONCE(rm->seq));
+}
+static DEVICE_ATTR_RO(samples);
+
+static ssize_t overruns_show(struct device *dev, struct device_attribute *attr,
+			     char *buf)
+{
+	struct pl_regmon *rm = dev_get_drvdata(dev);
+	u64 overruns;
+
+	spin_lock_irq(&rm->lock);
+	overruns = rm->overruns;
+	spin_unlock_irq(&rm->lock);
+
+	return sysfs_emit(buf, "%llu\n", overruns);
+}
+static DEVICE_ATTR_RO(overruns);
+
+static struct attribute *pl_regmon_attrs[] = {
+	&dev_attr_windows.attr,
+	&dev_attr_regs.attr,
+	&dev_attr_rate.attr,
+	&dev_attr_trigger.attr,
+	&dev_attr_samples.attr,
+	&dev_attr_overruns.attr,
+	NULL,
+};
+ATTRIBUTE_GROUPS(pl_regmon);
+
+/* /dev/pl-regmon */
+
+static struct pl_regmon *file_to_pl_regmon(struct file *file)
+{
+	return container_of(file->private_data, struct pl_regmon, misc);
+}
+
+/* misc_open() holds off misc_deregister() until this has its reference */
+static int pl_regmon_open(struct inode *inode, struct file *file)
+{
+	kref_get(&file_to_pl_regmon(file)->ref);
+
+	return 0;
+}
+
+static int pl_regmon_release(struct inode *inode, struct file *file)
+{
+	kref_put(&file_to_pl_regmon(file)->ref, pl_regmon_free);
+
+	return 0;
+}
+
+/* Whole samples, oldest first; blocks until there is one or it is removed */
+static ssize_t pl_regmon_read(struct file *file, char __user *buf,
+			      size_t count, loff_t *ppos)
+{
+	struct pl_regmon *rm = file_to_pl_regmon(file);
+	u8 sample[PL_REGMON_SAMPLE_SIZE(PL_REGMON_MAX_REGS)];
+	size_t size, done = 0;
+	int ret;
+
+	for (;;) {
+		spin_lock_irq(&rm->lock);
+		size = rm->sample_size;
+		if (rm->head == rm->tail || count - done < size) {
+			spin_unlock_irq(&rm->lock);
+			if (done)
+				return done;
+			if (count < size)
+				return -EINVAL;
+			if (READ_ONCE(rm->gone))
+				return -ENODEV;
+			if (file->f_flags & O_NONBLOCK)
+				return -EAGAIN;
+			ret = wait_event_interruptible(rm->wait,
+					READ_ONCE(rm->head) != READ_ONCE(rm->tail) ||
+					READ_ONCE(rm->gone));
+			if (ret)
+				return ret;
+			continue;
+		}
+		memcpy(sample, rm->ring +
+		       (rm->tail & (ring_samples - 1)) * size, size);
+		rm->tail++;
+		spin_unlock_irq(&rm->lock);
+
+		if (copy_to_user(buf + done, sample, size))
+			return done ? done : -EFAULT;
+		done += size;
+	}
+}
+
+static __poll_t pl_regmon_poll(struct file *file, poll_table *wait)
+{
+	struct pl_regmon *rm = file_to_pl_regmon(file);
+
+	poll_wait(file, &rm->wait, wait);
+	if (READ_ONCE(rm->head) != READ_ONCE(rm->tail))
+		return EPOLLIN | EPOLLRDNORM;
+	if (READ_ONCE(rm->gone))
+		return EPOLLHUP | EPOLLERR;
+
+	return 0;
+}
+
+/* Window i is at its pgoff, uncached like any register mapping */
+static int pl_regmon_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct pl_regmon *rm = file_to_pl_regmon(file);
+	unsigned long size = vma->vm_end - vma->vm_start;
+	const struct pl_regmon_window *w;
+	unsigned long pages, off;
+	unsigned int i;
+
+	/* the PL may be reconfigured once the overlay is gone */
+	if (READ_ONCE(rm->gone))
+		return -ENODEV;
+
+	for (i = 0; i < rm->nwin; i++) {
+		w = &rm->win[i];
+		pages = PAGE_ALIGN(resource_size(&w->res)) >> PAGE_SHIFT;
+		if (vma->vm_pgoff < w->pgoff ||
+		    vma->vm_pgoff >= w->pgoff + pages)
+			continue;
+
+		off = vma->vm_pgoff - w->pgoff;
+		if (size > (pages - off) << PAGE_SHIFT)
+			return -EINVAL;
+
+		vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+		return io_remap_pfn_range(vma, vma->vm_start,
+					  PHYS_PFN(w->res.start) + off, size,
+					  vma->vm_page_prot);
+	}
+
+	return -EINVAL;
+}
+
+static const struct file_operations pl_regmon_fops = {
+	.owner = THIS_MODULE,
+	.open = pl_regmon_open,
+	.release = pl_regmon_release,
+	.read = pl_regmon_read,
+	.poll = pl_regmon_poll,
+	.mmap = pl_regmon_mmap,
+	.llseek = noop_llseek,
+};
+
+/*
+ * The windows are the nodes in xlnx,windows: the first reg range and the
+ * first interrupt of each, named by xlnx,window-names.
+ */
+static int pl_regmon_parse_dt(struct pl_regmon *rm)
+{
+	struct device_node *np = rm->dev->of_node, *wnp;
+	struct pl_regmon_window *w;
+	unsigned long pgoff = 0;
+	int n, ret;
+
+	n = of_count_phandle_with_args(np, "xlnx,windows", NULL);
+	if (n <= 0 || n > PL_REGMON_MAX_WINDOWS) {
+		dev_err(rm->dev, "need 1 to %d xlnx,windows\n",
+			PL_REGMON_MAX_WINDOWS);
+		return -EINVAL;
+	}
+
+	for (rm->nwin = 0; rm->nwin < n; rm->nwin++) {
+		w = &rm->win[rm->nwin];
+		wnp = of_parse_phandle(np, "xlnx,windows", rm->nwin);
+		if (!wnp)
+			return -EINVAL;
+
+		ret = of_address_to_resource(wnp, 0, &w->res);
+		w->irq = of_irq_get(wnp, 0);
+		if (of_property_read_string_index(np, "xlnx,window-names",
+						  rm->nwin, &w->name))
+			w->name = devm_kasprintf(rm->dev, GFP_KERNEL, "%pOFn",
+						 wnp);
+		w->np = wnp;
+		if (ret)
+			return ret;
+		if (w->irq == -EPROBE_DEFER)
+			return w->irq;
+		if (!w->name)
+			return -ENOMEM;
+		if (!PAGE_ALIGNED(w->res.start)) {
+			dev_err(rm->dev, "%s is not page aligned\n", w->name);
+			return -EINVAL;
+		}
+
+		w->base = devm_ioremap(rm->dev, w->res.start,
+				       resource_size(&w->res));
+		if (!w->base)
+			return -ENOMEM;
+		w->pgoff = pgoff;
+		pgoff += PAGE_ALIGN(resource_size(&w->res)) >> PAGE_SHIFT;
+	}
+
+	return 0;
+}
+
+static int pl_regmon_probe(struct platform_device *pdev)
+{
+	struct pl_regmon *rm;
+	int ret;
+
+	if (!is_power_of_2(ring_samples))
+		return -EINVAL;
+
+	rm = kzalloc(sizeof(*rm), GFP_KERNEL);
+	if (!rm)
+		return -ENOMEM;
+
+	kref_init(&rm->ref);
+	rm->dev = &pdev->dev;
+	rm->trigger = PL_REGMON_TRIGGER_OFF;
+	rm->rate = 1000;
+	rm->sample_size = PL_REGMON_SAMPLE_SIZE(0);
+	mutex_init(&rm->cfg_lock);
+	spin_lock_init(&rm->lock);
+	init_waitqueue_head(&rm->wait);
+	hrtimer_init(&rm->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL_HARD);
+	rm->timer.function = pl_regmon_timer;
+	rm->frame_nb.notifier_call = pl_regmon_frame;
+
+	ret = pl_regmon_parse_dt(rm);
+	if (ret)
+		goto err_put;
+
+	rm->ring = vmalloc(ring_samples *
+			   PL_REGMON_SAMPLE_SIZE(PL_REGMON_MAX_REGS));
+	if (!rm->ring) {
+		ret = -ENOMEM;
+		goto err_put;
+	}
+
+	platform_set_drvdata(pdev, rm);
+
+	rm->misc.minor = MISC_DYNAMIC_MINOR;
+	rm->misc.name = "pl-regmon";
+	rm->misc.fops = &pl_regmon_fops;
+	rm->misc.parent = rm->dev;
+	rm->misc.mode = 0600;
+	ret = misc_register(&rm->misc);
+	if (ret)
+		goto err_put;
+
+	dev_info(rm->dev, "%u windows, %u samples buffered\n", rm->nwin,
+		 ring_samples);
+
+	return 0;
+
+err_put:
+	kref_put(&rm->ref, pl_regmon_free);
+	return ret;
+}
+
+static void pl_regmon_remove(struct platform_device *pdev)
+{
+	struct pl_regmon *rm = platform_get_drvdata(pdev);
+
+	/* no new opens; open files see gone and the ring is kept for them */
+	misc_deregister(&rm->misc);
+	mutex_lock(&rm->cfg_lock);
+	pl_regmon_stop(rm);
+	mutex_unlock(&rm->cfg_lock);
+	WRITE_ONCE(rm->gone, true);
+	wake_up_interruptible(&rm->wait);
+	kref_put(&rm->ref, pl_regmon_free);
+}
+
+static const struct of_device_id pl_regmon_ids[] = {
+	{ .compatible = "xlnx,pl-regmon", },
+	{ },
+};
+MODULE_DEVICE_TABLE(of, pl_regmon_ids);
+
+static struct platform_driver pl_regmon_driver = {
+	.driver = {
+		.name = "pl-regmon",
+		.of_match_table = pl_regmon_ids,
+		.dev_groups = pl_regmon_groups,
+	},
+	.probe = pl_regmon_probe,
+	.remove = pl_regmon_remove,
+};
+module_platform_driver(pl_regmon_driver);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("PL display register window access and sampling");
@@ -0,0 +1,34 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+/*
+ * pl-regmon user space interface
+ *
+ * /dev/pl-regmon maps the register windows with mmap(), at the offsets
+ * listed in the "windows" sysfs attribute, and read() returns samples of
+ * the registers set in "regs" as struct pl_regmon_sample records.
+ */
+
+#ifndef PL_REGMON_H
+#define PL_REGMON_H
+
+#include <linux/types.h>
+
+#define PL_REGMON_DEV		"/dev/pl-regmon"
+#define PL_REGMON_MAX_REGS	32
+#define PL_REGMON_MAX_RATE	20000
+
+/*
+ * One sample, followed by nregs register values in the order of "regs".
+ * seq counts every sample taken, so a gap means the ring overflowed.
+ */
+struct pl_regmon_sample {
+	__u64 time_ns;		/* CLOCK_MONOTONIC */
+	__u32 seq;
+	__u32 nregs;
+	__u32 val[];
+};
+
+/* bytes of a sample with n registers, padded to 8 */
+#define PL_REGMON_SAMPLE_SIZE(n) \
+	((sizeof(struct pl_regmon_sample) + 4 * (n) + 7) & ~7UL)
+
+#endif
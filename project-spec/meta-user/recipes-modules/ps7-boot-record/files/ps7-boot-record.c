@@ -0,0 +1,415 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Zynq-7000 ps7_init boot timing record
+ *
+ * ps7_init() in the FSBL times the MIO, PLL, clock, DDR and peripheral
+ * phases and each poll on PLL lock, DCI calibration and DDR init with the
+ * global timer, and leaves the result in a reserved DDR region. This
+ * driver validates the record and reports it in the log and in sysfs.
+ *
+ * It also merges the record with the U-Boot bootstage records passed in
+ * /bootstage into one timeline, in microseconds from the start of
+ * ps7_init(). U-Boot samples the global timer together with its own
+ * bootstage clock in /chosen/u-boot,bootstage-anchor, which places its
+ * records after the FSBL. The kernel starts at the U-Boot start_kernel
+ * mark; kernel events are added from user space (boot-timeline).
+ */
+
+#include <linux/platform_device.h>
+#include <linux/device.h>
+#include <linux/io.h>
+#include <linux/of.h>
+#include <linux/of_reserved_mem.h>
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/math64.h>
+#include <linux/sort.h>
+
+/* Layout of struct ps7_boot_record in ps7_init.h, 32-bit words */
+#define PS7_BOOT_RECORD_MAGIC	0x52375350
+#define PS7_BOOT_RECORD_VERSION	1
+#define PS7_BOOT_PHASES		5
+#define PS7_BOOT_RECORD_POLLS	8
+
+struct ps7_boot_poll {
+	u32 addr;
+	u32 mask;
+	u32 phase;
+	u32 us;
+};
+
+struct ps7_boot_record {
+	u32 magic;
+	u32 version;
+	u32 size;
+	u32 status;
+	u32 timer_hz;
+	u32 timer_lo;
+	u32 timer_hi;
+	u32 total_us;
+	u32 phase_us[PS7_BOOT_PHASES];
+	u32 npolls;
+	struct ps7_boot_poll polls[PS7_BOOT_RECORD_POLLS];
+	u32 checksum;
+};
+
+/* one entry of the merged timeline */
+struct ps7_boot_event {
+	s64 start_us;
+	u32 dur_us;
+	const char *source;
+	const char *name;
+};
+
+struct ps7_boot_data {
+	struct ps7_boot_record rec;
+	bool have_record;
+	struct ps7_boot_event *events;
+	unsigned int nevents;
+	s64 kernel_start_us;
+};
+
+static const char *const ps7_boot_phase_names[PS7_BOOT_PHASES] = {
+	"mio", "pll", "clock", "ddr", "peripherals",
+};
+
+static int ps7_boot_record_check(struct device *dev,
+				 const struct ps7_boot_record *rec)
+{
+	const u32 *p = (const u32 *)rec;
+	unsigned int i;
+	u32 sum = 0;
+
+	if (rec->magic != PS7_BOOT_RECORD_MAGIC) {
+		dev_info(dev, "no boot record\n");
+		return -ENODEV;
+	}
+	if (rec->version != PS7_BOOT_RECORD_VERSION ||
+	    rec->size != sizeof(*rec)) {
+		dev_err(dev, "unsupported boot record version %u size %u\n",
+			rec->version, rec->size);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < sizeof(*rec) / sizeof(*p); i++)
+		sum += p[i];
+	if (sum) {
+		dev_err(dev, "boot record checksum mismatch\n");
+		return -EINVAL;
+	}
+
+	if (rec->npolls > PS7_BOOT_RECORD_POLLS)
+		return -EINVAL;
+
+	return 0;
+}
+
+static struct ps7_boot_record *ps7_boot_rec(struct device *dev)
+{
+	struct ps7_boot_data *data = dev_get_drvdata(dev);
+
+	return &data->rec;
+}
+
+static ssize_t status_show(struct device *dev, struct device_attribute *attr,
+			   char *buf)
+{
+	struct ps7_boot_record *rec = ps7_boot_rec(dev);
+
+	return sysfs_emit(buf, "%u\n", rec->status);
+}
+static DEVICE_ATTR_RO(status);
+
+static ssize_t total_us_show(struct device *dev, struct device_attribute *attr,
+			     char *buf)
+{
+	struct ps7_boot_record *rec = ps7_boot_rec(dev);
+
+	return sysfs_emit(buf, "%u\n", rec->total_us);
+}
+static DEVICE_ATTR_RO(total_us);
+
+static ssize_t phases_show(struct device *dev, struct device_attribute *attr,
+			   char *buf)
+{
+	struct ps7_boot_record *rec = ps7_boot_rec(dev);
+	unsigned int i;
+	int len = 0;
+
+	for (i = 0; i < PS7_BOOT_PHASES; i++)
+		len += sysfs_emit_at(buf, len, "%s %u\n",
+				     ps7_boot_phase_names[i], rec->phase_us[i]);
+	return len;
+}
+static DEVICE_ATTR_RO(phases);
+
+static ssize_t polls_show(struct device *dev, struct device_attribute *attr,
+			  char *buf)
+{
+	struct ps7_boot_record *rec = ps7_boot_rec(dev);
+	const struct ps7_boot_poll *poll;
+	unsigned int i;
+	int len = 0;
+
+	for (i = 0; i < rec->npolls; i++) {
+		poll = &rec->polls[i];
+		len += sysfs_emit_at(buf, len, "%s 0x%08x 0x%08x %u\n",
+				     poll->phase < PS7_BOOT_PHASES ?
+				     ps7_boot_phase_names[poll->phase] : "?",
+				     poll->addr, poll->mask, poll->us);
+	}
+	return len;
+}
+static DEVICE_ATTR_RO(polls);
+
+static ssize_t timer_show(struct device *dev, struct device_attribute *attr,
+			  char *buf)
+{
+	struct ps7_boot_record *rec = ps7_boot_rec(dev);
+
+	return sysfs_emit(buf, "%llu %u\n",
+			  (u64)rec->timer_hi << 32 | rec->timer_lo,
+			  rec->timer_hz);
+}
+static DEVICE_ATTR_RO(timer);
+
+static ssize_t timeline_show(struct device *dev, struct device_attribute *attr,
+			     char *buf)
+{
+	struct ps7_boot_data *data = dev_get_drvdata(dev);
+	const struct ps7_boot_event *ev;
+	unsigned int i;
+	int len = 0;
+
+	for (i = 0; i < data->nevents; i++) {
+		ev = &data->events[i];
+		len += sysfs_emit_at(buf, len, "%lld %u %s %s\n", ev->start_us,
+				     ev->dur_us, ev->source, ev->name);
+	}
+	return len;
+}
+static DEVICE_ATTR_RO(timeline);
+
+static ssize_t kernel_start_us_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	struct ps7_boot_data *data = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%lld\n", data->kernel_start_us);
+}
+static DEVICE_ATTR_RO(kernel_start_us);
+
+static struct attribute *ps7_boot_record_attrs[] = {
+	&dev_attr_status.attr,
+	&dev_attr_total_us.attr,
+	&dev_attr_phases.attr,
+	&dev_attr_polls.attr,
+	&dev_attr_timer.attr,
+	&dev_attr_timeline.attr,
+	&dev_attr_kernel_start_us.attr,
+	NULL,
+};
+
+static umode_t ps7_boot_record_attr_visible(struct kobject *kobj,
+					    struct attribute *attr, int n)
+{
+	struct ps7_boot_data *data = dev_get_drvdata(kobj_to_dev(kobj));
+
+	if (attr == &dev_attr_timeline.attr ||
+	    attr == &dev_attr_kernel_start_us.attr || data->have_record)
+		return attr->mode;
+	return 0;
+}
+
+static const struct attribute_group ps7_boot_record_group = {
+	.attrs = ps7_boot_record_attrs,
+	.is_visible = ps7_boot_record_attr_visible,
+};
+__ATTRIBUTE_GROUPS(ps7_boot_record);
+
+static void ps7_boot_add(struct ps7_boot_data *data, s64 start_us, u32 dur_us,
+			 const char *source, const char *name)
+{
+	struct ps7_boot_event *ev = &data->events[data->nevents++];
+
+	ev->start_us = start_us;
+	ev->dur_us = dur_us;
+	ev->source = source;
+	ev->name = name;
+}
+
+static int ps7_boot_event_cmp(const void *a, const void *b)
+{
+	const struct ps7_boot_event *x = a, *y = b;
+
+	if (x->start_us != y->start_us)
+		return x->start_us < y->start_us ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Start of the U-Boot bootstage clock on the timeline. The anchor is the
+ * global timer count and the bootstage time sampled together; the timer
+ * keeps the rate it had at the end of ps7_init(). Without the record or
+ * the anchor, or if the timer was restarted, U-Boot is placed right after
+ * ps7_init() and the FSBL time in between is lost.
+ */
+static s64 ps7_boot_uboot_base(struct device *dev, struct ps7_boot_data *data)
+{
+	const struct ps7_boot_record *rec = &data->rec;
+	struct device_node *chosen;
+	u64 end, now;
+	u32 anchor[3];
+	int ret;
+
+	if (!data->have_record)
+		return 0;
+
+	chosen = of_find_node_by_path("/chosen");
+	ret = of_property_read_u32_array(chosen, "u-boot,bootstage-anchor",
+					 anchor, ARRAY_SIZE(anchor));
+	of_node_put(chosen);
+
+	end = (u64)rec->timer_hi << 32 | rec->timer_lo;
+	now = (u64)anchor[0] << 32 | anchor[1];
+	if (ret || !rec->timer_hz || now < end) {
+		dev_info(dev, "no usable U-Boot anchor, FSBL time not counted\n");
+		return rec->total_us;
+	}
+
+	return rec->total_us +
+	       div_u64((now - end) * USEC_PER_SEC, rec->timer_hz) - anchor[2];
+}
+
+/*
+ * U-Boot stores each bootstage record as /bootstage/<n> with a name and
+ * either a mark time or an accumulated time, both in microseconds.
+ */
+static int ps7_boot_build_timeline(struct device *dev,
+				   struct ps7_boot_data *data)
+{
+	const struct ps7_boot_record *rec = &data->rec;
+	struct device_node *stages, *np;
+	unsigned int n = PS7_BOOT_PHASES + 1;
+	const char *name;
+	s64 base, t;
+	u32 val;
+	int i;
+
+	stages = of_find_node_by_path("/bootstage");
+	n += of_get_child_count(stages);
+
+	data->events = devm_kcalloc(dev, n, sizeof(*data->events), GFP_KERNEL);
+	if (!data->events) {
+		of_node_put(stages);
+		return -ENOMEM;
+	}
+
+	if (data->have_record) {
+		for (i = 0, t = 0; i < PS7_BOOT_PHASES; i++) {
+			ps7_boot_add(data, t, rec->phase_us[i], "ps7",
+				     ps7_boot_phase_names[i]);
+			t += rec->phase_us[i];
+		}
+	}
+
+	base = ps7_boot_uboot_base(dev, data);
+	data->kernel_start_us = -1;
+	for_each_child_of_node(stages, np) {
+		if (of_property_read_string(np, "name", &name))
+			continue;
+		name = devm_kstrdup(dev, name, GFP_KERNEL);
+		if (!name) {
+			of_node_put(np);
+			of_node_put(stages);
+			return -ENOMEM;
+		}
+
+		if (!of_property_read_u32(np, "mark", &val)) {
+			ps7_boot_add(data, base + val, 0, "uboot", name);
+			if (!strcmp(name, "start_kernel"))
+				data->kernel_start_us = base + val;
+		} else if (!of_property_read_u32(np, "accum", &val)) {
+			ps7_boot_add(data, base, val, "uboot", name);
+		}
+	}
+	of_node_put(stages);
+
+	if (data->kernel_start_us >= 0)
+		ps7_boot_add(data, data->kernel_start_us, 0, "kernel",
+			     "start");
+
+	sort(data->events, data->nevents, sizeof(*data->events),
+	     ps7_boot_event_cmp, NULL);
+
+	return 0;
+}
+
+static int ps7_boot_record_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct ps7_boot_data *data;
+	struct ps7_boot_record *rec;
+	struct reserved_mem *rmem;
+	struct device_node *np;
+	void *mem;
+	int ret;
+
+	np = of_parse_phandle(dev->of_node, "memory-region", 0);
+	if (!np)
+		return dev_err_probe(dev, -EINVAL, "no memory-region\n");
+	rmem = of_reserved_mem_lookup(np);
+	of_node_put(np);
+	if (!rmem || rmem->size < sizeof(*rec))
+		return dev_err_probe(dev, -EINVAL, "invalid memory-region\n");
+
+	data = devm_kzalloc(dev, sizeof(*data), GFP_KERNEL);
+	if (!data)
+		return -ENOMEM;
+	rec = &data->rec;
+
+	mem = memremap(rmem->base, sizeof(*rec), MEMREMAP_WB);
+	if (!mem)
+		return -ENOMEM;
+	memcpy(rec, mem, sizeof(*rec));
+	memunmap(mem);
+
+	/* the U-Boot part of the timeline is still useful without a record */
+	data->have_record = !ps7_boot_record_check(dev, rec);
+
+	ret = ps7_boot_build_timeline(dev, data);
+	if (ret)
+		return ret;
+
+	platform_set_drvdata(pdev, data);
+
+	if (data->have_record)
+		dev_info(dev, "ps7_init %u us (mio %u, pll %u, clock %u, ddr %u, peripherals %u), status %u\n",
+			 rec->total_us, rec->phase_us[0], rec->phase_us[1],
+			 rec->phase_us[2], rec->phase_us[3], rec->phase_us[4],
+			 rec->status);
+	if (data->kernel_start_us >= 0)
+		dev_info(dev, "kernel started at %lld us\n",
+			 data->kernel_start_us);
+
+	return 0;
+}
+
+static const struct of_device_id ps7_boot_record_ids[] = {
+	{ .compatible = "xlnx,ps7-boot-record", },
+	{ },
+};
+MODULE_DEVICE_TABLE(of, ps7_boot_record_ids);
+
+static struct platform_driver ps7_boot_record_driver = {
+	.driver = {
+		.name = "ps7-boot-record",
+		.of_match_table = ps7_boot_record_ids,
+		.dev_groups = ps7_boot_record_groups,
+	},
+	.probe = ps7_boot_record_probe,
+};
+module_platform_driver(ps7_boot_record_driver);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("Zynq-7000 ps7_init boot timing record");
@@ -0,0 +1,267 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Zynq-7000 AXI HP port (AFI) QoS and issuing capability driver
+ *
+ * Each HP port between the PL masters and the DDR controller has an AFI
+ * block with read/write command issuing limits, a QoS value that is passed
+ * to the DDR arbiter, and a write data FIFO threshold. The FSBL leaves them
+ * at reset values, which gives the frame buffer DMA on the port no
+ * advantage over CPU traffic. This driver applies values from the device
+ * tree at probe and exposes every field in sysfs for tuning at runtime,
+ * together with the read-only data FIFO levels.
+ */
+
+#include <linux/platform_device.h>
+#include <linux/device.h>
+#include <linux/io.h>
+#include <linux/of.h>
+#include <linux/module.h>
+#include <linux/spinlock.h>
+#include <linux/kernel.h>
+
+#define AFI_RDCHAN_CTRL		0x00
+#define AFI_RDCHAN_ISSUINGCAP	0x04
+#define AFI_RDQOS		0x08
+#define AFI_RDDATAFIFO_LEVEL	0x0C
+#define AFI_WRCHAN_CTRL		0x14
+#define AFI_WRCHAN_ISSUINGCAP	0x18
+#define AFI_WRQOS		0x1C
+#define AFI_WRDATAFIFO_LEVEL	0x20
+
+#define AFI_CHAN_CTRL_FABRIC_QOS_EN	BIT(1)
+#define AFI_WRCHAN_CTRL_THRESHOLD	GENMASK(11, 8)
+#define AFI_ISSUINGCAP_MASK		GENMASK(2, 0)
+#define AFI_QOS_MASK			GENMASK(3, 0)
+#define AFI_FIFO_LEVEL_MASK		GENMASK(7, 0)
+
+struct zynq_afi_qos {
+	struct device *dev;
+	void __iomem *base;
+	spinlock_t lock; /* serializes read-modify-write of the registers */
+};
+
+/**
+ * struct zynq_afi_field - one tunable or status field of the AFI
+ * @attr: sysfs attribute
+ * @prop: device tree property, NULL for status fields
+ * @reg: register offset
+ * @mask: field mask in the register
+ * @bias: value added to the register field to get the user value
+ * @max: largest user value
+ */
+struct zynq_afi_field {
+	struct device_attribute attr;
+	const char *prop;
+	u32 reg;
+	u32 mask;
+	u32 bias;
+	u32 max;
+};
+
+#define to_zynq_afi_field(a) container_of(a, struct zynq_afi_field, attr)
+
+static u32 zynq_afi_get(struct zynq_afi_qos *afi,
+			const struct zynq_afi_field *field)
+{
+	u32 val = readl(afi->base + field->reg) & field->mask;
+
+	return (val >> __ffs(field->mask)) + field->bias;
+}
+
+static void zynq_afi_set(struct zynq_afi_qos *afi,
+			 const struct zynq_afi_field *field, u32 val)
+{
+	unsigned long flags;
+	u32 reg;
+
+	spin_lock_irqsave(&afi->lock, flags);
+	reg = readl(afi->base + field->reg) & ~field->mask;
+	reg |= ((val - field->bias) << __ffs(field->mask)) & field->mask;
+	writel(reg, afi->base + field->reg);
+	spin_unlock_irqrestore(&afi->lock, flags);
+}
+
+static ssize_t zynq_afi_show(struct device *dev, struct device_attribute *attr,
+			     char *buf)
+{
+	struct zynq_afi_qos *afi = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%u\n",
+			  zynq_afi_get(afi, to_zynq_afi_field(attr)));
+}
+
+static ssize_t zynq_afi_store(struct device *dev,
+			      struct device_attribute *attr,
+			      const char *buf, size_t count)
+{
+	struct zynq_afi_qos *afi = dev_get_drvdata(dev);
+	const struct zynq_afi_field *field = to_zynq_afi_field(attr);
+	u32 val;
+	int ret;
+
+	ret = kstrtou32(buf, 0, &val);
+	if (ret)
+		return ret;
+	if (val < field->bias || val > field->max)
+		return -EINVAL;
+
+	zynq_afi_set(afi, field, val);
+	return count;
+}
+
+#define ZYNQ_AFI_FIELD(_name, _prop, _reg, _mask, _bias, _max)		\
+	static struct zynq_afi_field zynq_afi_##_name = {		\
+		.attr = __ATTR(_name, 0644, zynq_afi_show,		\
+			       zynq_afi_store),				\
+		.prop = _prop,						\
+		.reg = _reg,						\
+		.mask = _mask,						\
+		.bias = _bias,						\
+		.max = _max,						\
+	}
+
+#define ZYNQ_AFI_STATUS(_name, _reg, _mask)				\
+	static struct zynq_afi_field zynq_afi_##_name = {		\
+		.attr = __ATTR(_name, 0444, zynq_afi_show, NULL),	\
+		.reg = _reg,						\
+		.mask = _mask,						\
+	}
+
+/* issuing capability is the number of outstanding commands, 1 to 8 */
+ZYNQ_AFI_FIELD(rd_issuing_cap, "xlnx,rd-issuing-cap", AFI_RDCHAN_ISSUINGCAP,
+	       AFI_ISSUINGCAP_MASK, 1, 8);
+ZYNQ_AFI_FIELD(wr_issuing_cap, "xlnx,wr-issuing-cap", AFI_WRCHAN_ISSUINGCAP,
+	       AFI_ISSUINGCAP_MASK, 1, 8);
+/* QoS given to the DDR arbiter unless the fabric drives AxQOS */
+ZYNQ_AFI_FIELD(rd_qos, "xlnx,rd-qos", AFI_RDQOS, AFI_QOS_MASK, 0, 15);
+ZYNQ_AFI_FIELD(wr_qos, "xlnx,wr-qos", AFI_WRQOS, AFI_QOS_MASK, 0, 15);
+ZYNQ_AFI_FIELD(rd_fabric_qos, "xlnx,rd-fabric-qos", AFI_RDCHAN_CTRL,
+	       AFI_CHAN_CTRL_FABRIC_QOS_EN, 0, 1);
+ZYNQ_AFI_FIELD(wr_fabric_qos, "xlnx,wr-fabric-qos", AFI_WRCHAN_CTRL,
+	       AFI_CHAN_CTRL_FABRIC_QOS_EN, 0, 1);
+/* write data beats buffered before the write command is released */
+ZYNQ_AFI_FIELD(wr_data_threshold, "xlnx,wr-data-threshold", AFI_WRCHAN_CTRL,
+	       AFI_WRCHAN_CTRL_THRESHOLD, 0, 15);
+ZYNQ_AFI_STATUS(rd_fifo_level, AFI_RDDATAFIFO_LEVEL, AFI_FIFO_LEVEL_MASK);
+ZYNQ_AFI_STATUS(wr_fifo_level, AFI_WRDATAFIFO_LEVEL, AFI_FIFO_LEVEL_MASK);
+
+static struct zynq_afi_field *zynq_afi_fields[] = {
+	&zynq_afi_rd_issuing_cap,
+	&zynq_afi_wr_issuing_cap,
+	&zynq_afi_rd_qos,
+	&zynq_afi_wr_qos,
+	&zynq_afi_rd_fabric_qos,
+	&zynq_afi_wr_fabric_qos,
+	&zynq_afi_wr_data_threshold,
+	&zynq_afi_rd_fifo_level,
+	&zynq_afi_wr_fifo_level,
+};
+
+static struct attribute *zynq_afi_attrs[] = {
+	&zynq_afi_rd_issuing_cap.attr.attr,
+	&zynq_afi_wr_issuing_cap.attr.attr,
+	&zynq_afi_rd_qos.attr.attr,
+	&zynq_afi_wr_qos.attr.attr,
+	&zynq_afi_rd_fabric_qos.attr.attr,
+	&zynq_afi_wr_fabric_qos.attr.attr,
+	&zynq_afi_wr_data_threshold.attr.attr,
+	&zynq_afi_rd_fifo_level.attr.attr,
+	&zynq_afi_wr_fifo_level.attr.attr,
+	NULL,
+};
+ATTRIBUTE_GROUPS(zynq_afi);
+
+/*
+ * Apply the device tree values. The fabric QoS flags are booleans, a
+ * register QoS value implies the register is used instead of the fabric.
+ */
+static int zynq_afi_parse_dt(struct zynq_afi_qos *afi)
+{
+	struct device_node *np = afi->dev->of_node;
+	struct zynq_afi_field *field;
+	unsigned int i;
+	u32 val;
+
+	for (i = 0; i < ARRAY_SIZE(zynq_afi_fields); i++) {
+		field = zynq_afi_fields[i];
+		if (!field->prop)
+			continue;
+
+		if (field->mask == AFI_CHAN_CTRL_FABRIC_QOS_EN) {
+			if (of_property_read_bool(np, field->prop))
+				zynq_afi_set(afi, field, 1);
+			continue;
+		}
+
+		if (of_property_read_u32(np, field->prop, &val))
+			continue;
+		if (val < field->bias || val > field->max) {
+			dev_err(afi->dev, "%s out of range: %u\n",
+				field->prop, val);
+			return -EINVAL;
+		}
+		zynq_afi_set(afi, field, val);
+
+		if (field == &zynq_afi_rd_qos &&
+		    !of_property_read_bool(np, zynq_afi_rd_fabric_qos.prop))
+			zynq_afi_set(afi, &zynq_afi_rd_fabric_qos, 0);
+		if (field == &zynq_afi_wr_qos &&
+		    !of_property_read_bool(np, zynq_afi_wr_fabric_qos.prop))
+			zynq_afi_set(afi, &zynq_afi_wr_fabric_qos, 0);
+	}
+
+	return 0;
+}
+
+static int zynq_afi_qos_probe(struct platform_device *pdev)
+{
+	struct zynq_afi_qos *afi;
+	int ret;
+
+	afi = devm_kzalloc(&pdev->dev, sizeof(*afi), GFP_KERNEL);
+	if (!afi)
+		return -ENOMEM;
+
+	afi->dev = &pdev->dev;
+	spin_lock_init(&afi->lock);
+
+	afi->base = devm_platform_ioremap_resource(pdev, 0);
+	if (IS_ERR(afi->base))
+		return PTR_ERR(afi->base);
+
+	platform_set_drvdata(pdev, afi);
+
+	ret = zynq_afi_parse_dt(afi);
+	if (ret)
+		return ret;
+
+	dev_info(afi->dev, "rd cap %u qos %u%s, wr cap %u qos %u%s thr %u\n",
+		 zynq_afi_get(afi, &zynq_afi_rd_issuing_cap),
+		 zynq_afi_get(afi, &zynq_afi_rd_qos),
+		 zynq_afi_get(afi, &zynq_afi_rd_fabric_qos) ? " (fabric)" : "",
+		 zynq_afi_get(afi, &zynq_afi_wr_issuing_cap),
+		 zynq_afi_get(afi, &zynq_afi_wr_qos),
+		 zynq_afi_get(afi, &zynq_afi_wr_fabric_qos) ? " (fabric)" : "",
+		 zynq_afi_get(afi, &zynq_afi_wr_data_threshold));
+
+	return 0;
+}
+
+static const struct of_device_id zynq_afi_qos_ids[] = {
+	{ .compatible = "xlnx,zynq-afi-qos", },
+	{ },
+};
+MODULE_DEVICE_TABLE(of, zynq_afi_qos_ids);
+
+static struct platform_driver zynq_afi_qos_driver = {
+	.driver = {
+		.name = "zynq-afi-qos",
+		.of_match_table = zynq_afi_qos_ids,
+		.dev_groups = zynq_afi_groups,
+	},
+	.probe = zynq_afi_qos_probe,
+};
+module_platform_driver(zynq_afi_qos_driver);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("Zynq-7000 AXI HP port QoS and issuing capability driver");